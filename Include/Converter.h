@@ -120,6 +120,29 @@ inline s32 App10StrToS32(const T* in, const T** out = nullptr) {
     }
 }
 
+//! Get count of base 10 digits of an unsigned 32 bit integer.
+inline u32 AppDigitCount(u32 val) {
+    u32 ret = 1;
+    for (; val >= 10; val /= 10) {
+        ++ret;
+    }
+    return ret;
+}
+
+//! Convert an unsigned 32 bit integer into a string of base 10 digits.
+/** \param[in] val: The value to convert.
+\param[out] out: The buffer of at least AppDigitCount(val) chars, no tail 0 is written.
+\return Count of chars written.
+*/
+template <typename T>
+inline u32 AppU32To10Str(u32 val, T* out) {
+    const u32 ret = AppDigitCount(val);
+    for (T* pos = out + ret; pos > out; val /= 10) {
+        *--pos = static_cast<T>('0' + val % 10);
+    }
+    return ret;
+}
+
 //! Convert a hex-encoded character to an unsigned integer.
 /** \param[in] in The digit to convert. Only digits 0 to 9 and chars A-F,a-f
 will be considered.
@@ -35,6 +35,7 @@
 #include "MapFile.h"
 #include "MemSlabPool.h"
 #include "Net/TlsContext.h"
+#include "Net/TlsSessionCache.h"
 #include "Script/ScriptManager.h"
 
 namespace app {
@@ -144,6 +145,7 @@ struct EngineData {
     EngineStats mStats;
     Process* mAllProcess;
     s32 mProcessCount;
+    net::TlsSessionCache* mTlsCache;
 };
 
 class Engine {
@@ -211,6 +213,11 @@ public:
         return reinterpret_cast<EngineData*>(mMapfile.getMem())->mStats;
     }
 
+    // @return TLS session cache of all processes, nullptr if disabled
+    net::TlsSessionCache* getTlsSessionCache() {
+        return reinterpret_cast<EngineData*>(mMapfile.getMem())->mTlsCache;
+    }
+
     MemSlabPool& getMemSlabPool() {
         return *reinterpret_cast<MemSlabPool*>(mMapfile.getMem() + sizeof(EngineData));
     }
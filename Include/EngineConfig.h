@@ -50,21 +50,56 @@ public:
     u8 mMaxThread;
     s16 mMaxProcess;
     u64 mMemSize;
+    u32 mTlsCacheSize;          //max TLS sessions in shared mem, 0=disable
+    u32 mTlsCacheTime;          //in seconds, timeout of TLS session
+    u32 mTlsTicketTime;         //in seconds, rotate interval of shared ticket keys, 0=disable
     String mLogPath;
     String mPidFile;
     String mMemName;
+    //a route of L7 proxy, requests matched are forwarded to one of the backends
+    struct UpstreamCfg {
+        u8 mBalance;            //0=round-robin, 1=least outstanding requests
+        String mPath;           //prefix of path, eg: "/api/"
+        String mHost;           //Host of request, empty = any host
+        TVector<String> mBackend; //eg: "http://127.0.0.1:9000", "https://10.0.0.2:9443"
+        UpstreamCfg() : mBalance(0) {
+        }
+    };
     struct WebsiteCfg {
         u8 mType;               //0=http, 1=https
         u32 mTimeout;           //in milliseconds
         u32 mSpeed;             //in bytes per seconds
         String mRootPath;
         String mPathTLS;
+        u32 mCacheSize;         //max bytes of site cache, 0=disable cache
+        u32 mCacheFileSize;     //max bytes of one cached file
+        u32 mCacheTime;         //in milliseconds, cached file will be reloaded after this time
+        u32 mPipeline;          //max requests in flight of a connection, 1=no pipelining, it's the max streams of HTTP/2 too
+        bool mHTTP2;            //true to accept HTTP/2, by ALPN "h2" or prior knowledge h2c
+        bool mKTLS;             //true to encrypt the sending of https by kernel(kTLS) if available
+        u32 mTlsPool;           //max TLS handshakes in ThreadPool at once, 0=handshake in loop
+        u32 mUpstreamIdle;      //max idle keep-alive connections of each backend
+        u32 mUpstreamIdleTime;  //in milliseconds, idle connections of backends are closed after this time
+        u32 mUploadDepth;       //max writes in flight of an upload
+        u64 mUploadMax;         //max bytes of an upload, a larger one gets 413
+        TVector<UpstreamCfg> mUpstream;
         net::NetAddress mLocal;
         HashDict* mDict;         //cache of site
         WebsiteCfg() :
             mType(0),
             mTimeout(20*1000),
             mSpeed(1024 * 4),
+            mCacheSize(32 * 1024 * 1024),
+            mCacheFileSize(256 * 1024),
+            mCacheTime(60 * 1000),
+            mPipeline(16),
+            mHTTP2(true),
+            mKTLS(false),
+            mTlsPool(0),
+            mUpstreamIdle(8),
+            mUpstreamIdleTime(30 * 1000),
+            mUploadDepth(4),
+            mUploadMax(1024ULL * 1024 * 1024),
             mDict(nullptr) {
         }
         ~WebsiteCfg() {
@@ -74,12 +109,30 @@ public:
             }
         }
     };
+    struct BackendCfg {
+        u32 mWeight;            //[1-100]
+        net::NetAddress mAddress;
+    };
     struct ProxyCfg {
         u8 mType;    //0=[tcp-tcp], 1=[tls-tcp], 2=[tcp-tls], 3=[tls-tls]
+        u8 mBalance; //0=weighted least connections, 1=consistent hash of client IP
         u32 mTimeout; //in milliseconds
         u32 mSpeed;  //in bytes per seconds
+        u32 mCheckTime; //in milliseconds, interval of active TCP health check, 0=disable
+        u32 mMaxFails;  //a backend is ejected after these connect failures in a row, 0=never eject
+        u32 mEjectTime; //in milliseconds, an ejected backend is retried after this time
         net::NetAddress mLocal;
-        net::NetAddress mRemote;
+        net::NetAddress mRemote; //the first backend
+        TVector<BackendCfg> mBackend;
+        ProxyCfg() :
+            mType(0),
+            mBalance(0),
+            mTimeout(30 * 1000),
+            mSpeed(0),
+            mCheckTime(5 * 1000),
+            mMaxFails(3),
+            mEjectTime(30 * 1000) {
+        }
     };
     TVector<WebsiteCfg> mWebsite;
     TVector<ProxyCfg> mProxy;
@@ -63,6 +63,15 @@ public:
     }
 
     /**
+    * @return last modify time of file, in seconds
+    */
+    s64 getModifyTime()const {
+        return mModifyTime;
+    }
+
+    /**
+    * @brief write the bytes of [mUsed, mAllocated) of \p it, mUsed grows by the written size,
+    *        so a short write is resumed by write(it, offset + written).
     * @param offset д����ʼ��
     */
     s32 write(RequestFD* it, usz offset = 0);
@@ -77,7 +86,8 @@ public:
     /**
     * @brief open file
     * @param fname file name
-    * @param flag 0=not share, 1=share read, 2=share write, 4=create if not exists
+    * @param flag 0=not share, 1=share read, 2=share write, 4=create if not exists,
+    *        8=the file may not exist, no error log if failed
     * @return 0 if success, else failed.
     */
     s32 open(const String& fname, s32 flag = 1);
@@ -85,10 +95,17 @@ public:
     //�ضϻ���չ�ļ�
     bool setFileSize(usz fsz);
 
+    /**
+    * @brief allocate disk space of [offset, offset+len) ahead of writes, the file size is not changed.
+    * @return true if success, false if not supported by file system.
+    */
+    bool reserve(usz offset, usz len);
+
 protected:
     friend class app::Loop;
     FD mFile;
     usz mFileSize;
+    s64 mModifyTime;
     String mFilename;
 
 #if defined(DOS_LINUX) || defined(DOS_ANDROID)
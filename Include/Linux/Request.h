@@ -96,6 +96,7 @@ public:
     s8* mData;
     u32 mAllocated;
     u32 mUsed;          //data size
+    u8 mRecordType;     //TCP write only, TLS record type sent by kTLS, 0=as is
 };
 
 
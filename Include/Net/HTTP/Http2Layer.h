@@ -0,0 +1,166 @@
+#ifndef APP_HTTP2LAYER_H
+#define	APP_HTTP2LAYER_H
+
+#include "TVector.h"
+#include "RingBuffer.h"
+#include "Loop.h"
+#include "Net/HTTP/HttpHpack.h"
+#include "Net/HTTP/HttpMsg.h"
+
+namespace app {
+namespace net {
+
+//RFC 7540, 6
+enum EHttp2FrameType {
+    EH2F_DATA = 0,
+    EH2F_HEADERS = 1,
+    EH2F_PRIORITY = 2,
+    EH2F_RST_STREAM = 3,
+    EH2F_SETTINGS = 4,
+    EH2F_PUSH_PROMISE = 5,
+    EH2F_PING = 6,
+    EH2F_GOAWAY = 7,
+    EH2F_WINDOW_UPDATE = 8,
+    EH2F_CONTINUATION = 9
+};
+
+//RFC 7540, 7
+enum EHttp2Error {
+    EH2E_NO_ERROR = 0,
+    EH2E_PROTOCOL_ERROR = 1,
+    EH2E_INTERNAL_ERROR = 2,
+    EH2E_FLOW_CONTROL_ERROR = 3,
+    EH2E_SETTINGS_TIMEOUT = 4,
+    EH2E_STREAM_CLOSED = 5,
+    EH2E_FRAME_SIZE_ERROR = 6,
+    EH2E_REFUSED_STREAM = 7,
+    EH2E_CANCEL = 8,
+    EH2E_COMPRESSION_ERROR = 9,
+    EH2E_ENHANCE_YOUR_CALM = 11
+};
+
+
+class HttpLayer;
+struct Http2Stream;
+
+/**
+ * @brief server side framing of HTTP/2 for a HttpLayer, which is negotiated by ALPN "h2",
+ *        or by the connection preface of a cleartext connection(h2c with prior knowledge).
+ *        Every stream is mapped to a HttpMsg, so the stations and eventers of Website work
+ *        unchanged: the HTTP/1.1 response they write into the msg is translated to HEADERS
+ *        and DATA frames here, the DATA frames are bounded by flow control windows of peer.
+ *        The request body cached by a stream is bounded by the stream window of server,
+ *        the window is given back only as the eventer consumes the body, see onBodyUsed().
+ */
+class Http2Layer {
+public:
+    Http2Layer(HttpLayer& it);
+
+    ~Http2Layer();
+
+    /**
+     * @return 1 if buf begins with the connection preface of client,
+     *         0 if more bytes are needed to tell, else -1.
+     */
+    static s32 checkPreface(const s8* buf, usz len);
+
+    //@return size of read cache, a whole frame must be fit in.
+    static u32 getReadSize();
+
+    //@brief send the SETTINGS of server, it's the connection preface of server.
+    bool start();
+
+    /**
+     * @brief parse whole frames of buf, the incomplete frame is left.
+     * @return bytes parsed, or -1 if the connection should be closed.
+     */
+    ssz parseBuf(const s8* buf, usz len);
+
+    bool sendResp(HttpMsg* msg);
+
+    bool sendFile(HttpMsg* msg);
+
+    //@brief the eventer had consumed some body of msg, give back the windows
+    void onBodyUsed(HttpMsg* msg);
+
+    //@return EE_OK to keep the connection
+    s32 onTimeout();
+
+    //@brief called when connection closed, all streams are dropped.
+    void onClose();
+
+private:
+    u32 onFrame(u8 type, u8 flags, u32 sid, const u8* buf, u32 len);
+    u32 onHeaders(u8 flags, u32 sid, const u8* buf, u32 len);
+    u32 onHeadBlock();
+    u32 onData(u8 flags, u32 sid, const u8* buf, u32 len);
+    u32 onSettings(u8 flags, const u8* buf, u32 len);
+    u32 onWindowUpdate(u32 sid, const u8* buf, u32 len);
+
+    //@brief map pseudo-headers of request to msg
+    s32 initMsg(HttpMsg* msg);
+
+    //@return false if the stream had been reset
+    bool stepMsg(Http2Stream* st, u8 station);
+
+    //@brief translate the response of msg to frames
+    bool pump(Http2Stream* st);
+    s32 translate(Http2Stream* st, RingBuffer& in);
+    s32 writeHead(Http2Stream* st);
+    void writeData(Http2Stream* st, RingBuffer* in, const s8* buf, u32 len, bool end);
+    u32 getRoom(const Http2Stream* st)const;
+
+    //@brief send WINDOW_UPDATE for the body which had been consumed from CacheIn of stream
+    void updateWindow(Http2Stream* st);
+
+    //@brief go on to send the streams blocked by flow control
+    void resumeStreams();
+
+    void writeFrameHead(u32 len, u8 type, u8 flags, u32 sid);
+    void writeRst(u32 sid, u32 ecode);
+    void writeWindowUpdate(u32 sid, u32 inc);
+    void goaway(u32 ecode);
+
+    Http2Stream* getStream(u32 sid)const;
+    Http2Stream* getStream(const HttpMsg* msg)const;
+    void resetStream(Http2Stream* st, u32 ecode);
+    void finishStream(Http2Stream* st);
+    void closeStream(Http2Stream* st);
+
+    bool flush();
+    void notify();
+    void checkClose();
+    void onWrite(RequestFD* it);
+
+    static void funcOnWrite(RequestFD* it) {
+        Http2Layer& nd = *(Http2Layer*)it->mUser;
+        nd.onWrite(it);
+    }
+
+    HttpLayer& mLayer;
+    HttpHpack mDecoder;
+    HttpHpack mEncoder;
+    RingBuffer mOut;                //frames to send
+    Packet mBlock;                  //header block of HEADERS + CONTINUATION
+    Packet mHead;                   //HTTP/1.1 response head to translate
+    Packet mEncode;                 //encoded header block of response
+    TVector<Http2Stream*> mStreams;
+    TVector<HttpMsg*> mSent;        //responses wait for the write callback
+    s64 mSendWindow;                //connection window of peer
+    u32 mPeerWindow;                //SETTINGS_INITIAL_WINDOW_SIZE of peer
+    u32 mPeerFrameSize;             //SETTINGS_MAX_FRAME_SIZE of peer
+    u32 mMaxStreams;
+    u32 mLastStream;                //max stream id of peer
+    u32 mRecvConn;                  //bytes of DATA got, but not given back to the connection window
+    u32 mBlockStream;               //stream of the incomplete header block, 0=none
+    u8 mBlockFlags;
+    u8 mGoaway;                     //0=no, 1=received from peer, 2=sent for error
+    bool mPreface;                  //true if got the preface of client
+    bool mWriting;
+    bool mActive;                   //true if got frames since last timeout
+};
+
+}//namespace net
+}//namespace app
+
+#endif //APP_HTTP2LAYER_H
@@ -0,0 +1,115 @@
+#ifndef APP_HTTPCLIENTPOOL_H
+#define	APP_HTTPCLIENTPOOL_H
+
+#include "Nocopy.h"
+#include "TMap.h"
+#include "Strings.h"
+#include "Loop.h"
+#include "RefCount.h"
+
+namespace app {
+namespace net {
+
+class HttpLayer;
+struct HttpClientHost;
+
+/**
+ * @brief keep-alive pool of client connections(HttpLayer) of a Loop, keyed by scheme/host/port.
+ *        A connection is parked here when its response is done, and reused by the next
+ *        request to the same origin, so a TLS connection pays the handshake only once.
+ *        An idle connection keeps a read in flight, so it's dropped at once if the peer
+ *        closes it or sends anything unexpected.
+ * @note all connections must be closed before the pool is deleted, see close().
+ */
+class HttpClientPool : public Nocopy {
+public:
+    /**
+     * @param owner grabbed by each connection and the timer of pool, so the owner of a pool
+     *        member is alive until all of them are closed. nullptr if the pool outlives them.
+     */
+    HttpClientPool(Loop* loop, RefCount* owner = nullptr);
+
+    ~HttpClientPool();
+
+    /**
+     * @param maxIdle max idle connections of each origin, 0 = no reuse.
+     * @param idleTime idle connections older than it are closed, in milliseconds.
+     */
+    s32 open(u32 maxIdle = 8, u32 idleTime = 30 * 1000);
+
+    //@brief close the idle connections, the busy ones are closed when their responses are done.
+    void close();
+
+    /**
+     * @brief get a client connection for url, the newest idle one of same origin is reused.
+     * @return connection with an empty msg, fill the headers and event of the msg, then call
+     *         HttpLayer::get(url) with the same url. nullptr if url is bad.
+     */
+    HttpLayer* acquire(const String& url);
+
+    /**
+     * @brief called by HttpLayer when a response is done on a keep-alive connection.
+     * @return false if the pool is full or closed, then the caller closes the connection.
+     */
+    bool release(HttpLayer* it);
+
+    /**
+     * @brief give up a connection which failed to send the request, it's closed if connected,
+     *        else it's released at once.
+     */
+    void abort(HttpLayer* it);
+
+    //@brief called by HttpLayer when closed
+    void onClose(HttpLayer* it);
+
+    Loop* getLoop()const {
+        return mLoop;
+    }
+
+    u32 getIdleCount()const {
+        return mIdleCount;
+    }
+
+    //@return requests sent on reused connections
+    u64 getHits()const {
+        return mHits;
+    }
+
+    //@return requests which opened a new connection
+    u64 getMisses()const {
+        return mMisses;
+    }
+
+private:
+    s32 onTimeout(HandleTime& it);
+
+    void onCloseTime(Handle* it);
+
+    static s32 funcOnTime(HandleTime* it) {
+        HttpClientPool& nd = *(HttpClientPool*)it->getUser();
+        return nd.onTimeout(*it);
+    }
+
+    static void funcOnClose(Handle* it) {
+        HttpClientPool& nd = *(HttpClientPool*)it->getUser();
+        nd.onCloseTime(it);
+    }
+
+    void closeIdle(HttpClientHost* host, s64 deadline);
+
+    Loop* mLoop;
+    RefCount* mOwner;
+    HandleTime mTime;
+    TMap<String, HttpClientHost*> mHosts;
+    u64 mHits;
+    u64 mMisses;
+    u32 mMaxIdle;
+    u32 mIdleTime;
+    u32 mIdleCount;
+    bool mRunning;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_HTTPCLIENTPOOL_H
@@ -4,6 +4,7 @@
 #include "HandleFile.h"
 #include "Net/HTTP/HttpLayer.h"
 #include "Script/ScriptManager.h"
+#include "gzip/EncoderGzip.h"
 
 namespace app {
 
@@ -15,6 +16,7 @@ public:
     virtual s32 onSent(net::HttpMsg& req) override;
     virtual s32 onFinish(net::HttpMsg& resp) override;
     virtual s32 onBodyPart(net::HttpMsg& resp) override;
+    virtual s32 onHead(net::HttpMsg& msg) override;
     virtual s32 onOpen(net::HttpMsg& msg) override;
     virtual s32 onClose() override;
 
@@ -36,11 +38,16 @@ private:
     net::HttpMsg* mMsg;
     usz mReaded;
     u16 mEvtFlags;
+#if defined(DUSE_ZLIB)
+    EncoderGzip* mGzip;     //borrowed from Website::getGzipPool(), body is gzip encoded if not null
+    s8* mGzipIn;            //raw output of lua, compressed into mBody
+#endif
 
     void creatCurrContext();
     void onRead(RequestFD* it);
     void onClose(Handle* it);
     s32 launchRead();
+    void releaseGzip();
 
     static void funcOnRead(RequestFD* it) {
         HttpEvtLua& nd = *(HttpEvtLua*)it->mUser;
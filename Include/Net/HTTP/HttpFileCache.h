@@ -0,0 +1,186 @@
+#ifndef APP_HTTPFILECACHE_H
+#define	APP_HTTPFILECACHE_H
+
+#include "RefCount.h"
+#include "Strings.h"
+#include "HashDict.h"
+
+namespace app {
+namespace net {
+
+/**
+ * @brief a cached static file, the whole response is stored in one block:
+ *        [status line + headers + Connection:keep-alive\r\n + \r\n][file body]
+ *        so a cache hit is sent by one write request, without any file operation.
+ */
+class HttpFileNode : public RefCount {
+public:
+    /**
+     * @param path url path of file, used as key of cache
+     * @param mime content type of file, must be a static str
+     * @param fsize file size
+     * @param mtime last modify time of file, in seconds
+     * @param gzip true if body is gzip encoded, key of node is "gz:" + path
+     */
+    HttpFileNode(const StringView& path, const StringView& mime, usz fsize, s64 mtime, bool gzip = false);
+
+    virtual ~HttpFileNode();
+
+    /**
+     * @brief append file body, the body can't be larger than file size
+     * @return true if success, else false.
+     */
+    bool append(const void* buf, usz len);
+
+    //@return true if all body had been appended
+    bool isFull()const {
+        return mBodySize == mFileSize;
+    }
+
+    const StringView& getKey()const {
+        return mKey;
+    }
+
+    //@return url path of file
+    StringView getPath()const {
+        return mGzip ? StringView(mKey.mData + 3, mKey.mLen - 3) : mKey;
+    }
+
+    const StringView& getMime()const {
+        return mMime;
+    }
+
+    bool isGzip()const {
+        return mGzip;
+    }
+
+    //@return whole response, include head block
+    StringView getResp()const {
+        return StringView(mData, mHeadSize + mBodySize);
+    }
+
+    StringView getHead()const {
+        return StringView(mData, mHeadSize);
+    }
+
+    //@return head block without the tail "Connection:keep-alive\r\n\r\n"
+    StringView getHeadBase()const {
+        return StringView(mData, mHeadSize - G_KEEP_ALIVE_SIZE);
+    }
+
+    static const usz G_KEEP_ALIVE_SIZE = sizeof("Connection:keep-alive\r\n\r\n") - 1;
+
+    StringView getBody()const {
+        return StringView(mData + mHeadSize, mBodySize);
+    }
+
+    StringView getETag()const {
+        return StringView(mETag, mETagSize);
+    }
+
+    //@return Last-Modified in GMT string
+    StringView getLastModified()const {
+        return StringView(mGMT, mGMTSize);
+    }
+
+    s64 getModifyTime()const {
+        return mModifyTime;
+    }
+
+    usz getFileSize()const {
+        return mFileSize;
+    }
+
+    //@return memory used by this node
+    usz getMemSize()const {
+        return mHeadSize + mFileSize + mPath.getLen();
+    }
+
+private:
+    friend class HttpFileCache;
+    HttpFileNode* mPrev;    //LRU list
+    HttpFileNode* mNext;    //LRU list
+    s64 mExpire;            //in milliseconds
+    String mPath;
+    StringView mKey;        //view of mPath, key of dict
+    StringView mMime;
+    s8* mData;
+    usz mHeadSize;
+    usz mBodySize;
+    usz mFileSize;
+    s64 mModifyTime;
+    bool mGzip;
+    u8 mETagSize;
+    u8 mGMTSize;
+    s8 mETag[40];
+    s8 mGMT[40];
+};
+
+
+/**
+ * @brief LRU cache of static files for a website, bounded by total bytes.
+ *        The HashDict of WebsiteCfg is used as the index of path.
+ */
+class HttpFileCache {
+public:
+    /**
+     * @param dict index of cache, key=StringView, value=HttpFileNode*
+     * @param maxSize max bytes of all cached files, 0=disable cache
+     * @param maxFile max bytes of one cached file
+     * @param ttl in milliseconds, a cached file will be dropped after ttl
+     */
+    HttpFileCache(HashDict* dict, usz maxSize, usz maxFile, u32 ttl);
+
+    ~HttpFileCache();
+
+    /**
+     * @brief find a fresh cached file, the node is moved to head of LRU list.
+     * @param gzip true to find the gzip encoded variant of file.
+     * @return node if hit, caller should grab it if hold the node, else nullptr.
+     */
+    HttpFileNode* get(const StringView& path, bool gzip = false);
+
+    /**
+     * @return true if file of this size can be cached.
+     */
+    bool canCache(usz fsize)const {
+        return mDict && mMaxSize > 0 && fsize <= mMaxFile && fsize <= mMaxSize;
+    }
+
+    /**
+     * @brief add a full node to cache, replace the old one of same path.
+     *        The least recently used nodes will be dropped if cache is full.
+     * @return true if success, else false.
+     */
+    bool add(HttpFileNode* it);
+
+    void remove(const StringView& path);
+
+    void clear();
+
+    usz getSize()const {
+        return mSize;
+    }
+
+    usz getCount()const {
+        return mCount;
+    }
+
+private:
+    void unlink(HttpFileNode* it);
+    void pushFront(HttpFileNode* it);
+
+    HashDict* mDict;
+    HttpFileNode* mHead;    //most recently used
+    HttpFileNode* mTail;    //least recently used
+    usz mSize;
+    usz mCount;
+    usz mMaxSize;
+    usz mMaxFile;
+    u32 mTTL;
+};
+
+}//namespace net
+}//namespace app
+
+#endif //APP_HTTPFILECACHE_H
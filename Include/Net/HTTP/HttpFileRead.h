@@ -3,6 +3,7 @@
 
 #include "HandleFile.h"
 #include "Net/HTTP/HttpLayer.h"
+#include "Net/HTTP/HttpFileCache.h"
 
 namespace app {
 
@@ -14,24 +15,39 @@ public:
     virtual s32 onSent(net::HttpMsg& req)override;
     virtual s32 onFinish(net::HttpMsg& resp)override;
     virtual s32 onBodyPart(net::HttpMsg& resp)override;
+    virtual s32 onHead(net::HttpMsg& msg)override;
     virtual s32 onOpen(net::HttpMsg& msg)override;
     virtual s32 onClose()override;
+    virtual s32 onDrain(net::HttpMsg& msg)override;
 
 private:
-    //RingBuffer mBuf;
-    SRingBufPos mChunkPos;
     RingBuffer* mBody;
     RequestFD mReqs;
     HandleFile mFile;
     net::HttpMsg* mMsg;
+    net::HttpFileNode* mCacheNode;  //fill cache while reading
     usz mReaded;
+    usz mOffset;    //first byte of range
+    usz mLeft;      //bytes of range to read
+    usz mBuffered;  //bytes of output cache counted in the global sum
     bool mDone;
+    bool mGzip;     //read the pre-compressed sibling file: "url.gz"
 
     void onFileRead(RequestFD* it);
     void onFileClose(Handle* it);
 
     s32 launchRead();
 
+    /**
+     * @return true if the output cache is above the high watermark, the reading is paused
+     *         until onDrain(). The watermark is lowered if all readers buffer too many bytes.
+     */
+    bool isFull()const;
+
+    //@brief sync mBuffered to the global sum of buffered bytes
+    void updateBuffered(usz now);
+    void addCache(net::Website* site);
+
     static void funcOnRead(RequestFD* it) {
         HttpFileRead& nd = *(HttpFileRead*)it->mUser;
         nd.onFileRead(it);
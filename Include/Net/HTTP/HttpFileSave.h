@@ -6,6 +6,15 @@
 
 namespace app {
 
+/**
+ * @brief save the body of request to file while receiving.
+ *        Up to WebsiteCfg::mUploadDepth writes are kept in flight, each write is a block of the
+ *        receive cache of msg, the blocks are released in order when their writes are done.
+ *        A body over WebsiteCfg::mUploadMax is dropped and answered with 413,
+ *        or the link is closed if the body without Content-Length grows over it.
+ *        Each upload is saved to its own file, LogPath/upload_<pid>_<id>.bin,
+ *        the file is removed if the upload fails.
+ */
 class HttpFileSave :public net::HttpEventer {
 public:
     HttpFileSave();
@@ -14,21 +23,54 @@ public:
     virtual s32 onSent(net::HttpMsg& req)override;
     virtual s32 onFinish(net::HttpMsg& resp)override;
     virtual s32 onBodyPart(net::HttpMsg& resp)override;
+    virtual s32 onHead(net::HttpMsg& msg)override;
     virtual s32 onOpen(net::HttpMsg& msg)override;
     virtual s32 onClose()override;
 
+    virtual bool isReadBody()const override {
+        return true;
+    }
+
 private:
-    RingBuffer mBuf;
-    RingBuffer* mBody;
-    RequestFD mReqs;
+    static const u32 G_MAX_DEPTH = 16;
+
+    //a write in flight
+    struct Slot {
+        RequestFD mReq;
+        SRingBufPos mEnd;   //end of the block in receive cache
+        usz mOffset;        //offset in file
+        bool mFinish;
+    };
+
+    Slot mSlots[G_MAX_DEPTH];   //FIFO of writes, from mFirst
+    u32 mFirst;
+    u32 mFly;                   //writes in flight, the msg is grabbed if > 0
+    u32 mDepth;
     HandleFile mFile;
+    net::HttpMsg* mMsg;
+    String mRemove;             //file of a failed upload, removed when closed
+    SRingBufPos mWritePos;      //next byte of receive cache to write
+    usz mLaunched;
     usz mWrited;
+    usz mReserved;              //bytes reserved by Content-Length
+    usz mMaxSize;
+    bool mBodyDone;
+    bool mError;
     bool mDone;
+    bool mSaved;                //all of the body is written
+    bool mTooLarge;
+
     void onFileWrite(RequestFD* it);
     void onFileClose(Handle* it);
 
     s32 launchWrite();
 
+    //@brief close the file, the reserved space after the written bytes is released
+    void closeFile();
+
+    //@brief response 200 after all of the body is written
+    void finish(bool step);
+
     static void funcOnWrite(RequestFD* it) {
         HttpFileSave& nd = *(HttpFileSave*)it->mUser;
         nd.onFileWrite(it);
@@ -0,0 +1,80 @@
+#ifndef APP_HTTPGZIP_H
+#define	APP_HTTPGZIP_H
+
+#include "TVector.h"
+#include "RingBuffer.h"
+#include "gzip/EncoderGzip.h"
+#include "Net/HTTP/HttpHead.h"
+#include "Net/HTTP/HttpFileCache.h"
+
+#if defined(DUSE_ZLIB)
+
+namespace app {
+namespace net {
+
+class HttpGzip {
+public:
+    /**
+     * @return true if the Accept-Encoding of request allow gzip.
+     */
+    static bool isAccept(const HttpHead& head);
+
+    /**
+     * @return true if the content of this mime is worth to compress.
+     */
+    static bool isCompressible(const StringView& mime);
+
+    /**
+     * @brief add "Content-Encoding: gzip" and "Vary: Accept-Encoding"
+     */
+    static void writeHead(HttpHead& head);
+
+    /**
+     * @brief add "Content-Encoding: gzip" only.
+     */
+    static void writeEncoding(HttpHead& head);
+
+    /**
+     * @brief add "Vary: Accept-Encoding", for every compressible response even if not gzip.
+     */
+    static void writeVary(HttpHead& head);
+
+    /**
+     * @brief compress data and write them into out as http chunks.
+     * @param last true if this is the end of body, the last chunk "0\r\n\r\n" will be wrote too.
+     */
+    static void writeChunk(EncoderGzip& enc, RingBuffer& out, const void* data, usz len, bool last);
+
+    /**
+     * @brief create the gzip variant of a full cached file.
+     * @return new node, or nullptr if the compressed body is not smaller.
+     */
+    static HttpFileNode* compress(EncoderGzip& enc, const HttpFileNode& src);
+};
+
+
+/**
+ * @brief deflate contexts of a loop, reused by messages,
+ *        so deflateInit2() is not called for every message.
+ */
+class HttpGzipPool {
+public:
+    HttpGzipPool(u32 maxIdle = 16);
+
+    ~HttpGzipPool();
+
+    //@return a reseted encoder, caller should push() it back.
+    EncoderGzip* pop();
+
+    void push(EncoderGzip* it);
+
+private:
+    u32 mMaxIdle;
+    TVector<EncoderGzip*> mIdle;
+};
+
+}//namespace net
+}//namespace app
+
+#endif // DUSE_ZLIB
+#endif //APP_HTTPGZIP_H
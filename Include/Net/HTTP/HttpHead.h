@@ -69,6 +69,68 @@ public:
 
 
 
+/**
+ * @brief IDs of well-known header names, resolved by HttpHead::getID() with a perfect hash.
+ */
+enum EHttpHeadID {
+    EHH_ACCEPT = 0,                      //Accept
+    EHH_ACCEPT_CHARSET,                  //Accept-Charset
+    EHH_ACCEPT_ENCODING,                 //Accept-Encoding
+    EHH_ACCEPT_LANGUAGE,                 //Accept-Language
+    EHH_ACCEPT_RANGES,                   //Accept-Ranges
+    EHH_ACCESS_CONTROL_ALLOW_ORIGIN,     //Access-Control-Allow-Origin
+    EHH_AGE,                             //Age
+    EHH_ALLOW,                           //Allow
+    EHH_AUTHORIZATION,                   //Authorization
+    EHH_CACHE_CONTROL,                   //Cache-Control
+    EHH_CONNECTION,                      //Connection
+    EHH_CONTENT_DISPOSITION,             //Content-Disposition
+    EHH_CONTENT_ENCODING,                //Content-Encoding
+    EHH_CONTENT_LANGUAGE,                //Content-Language
+    EHH_CONTENT_LENGTH,                  //Content-Length
+    EHH_CONTENT_LOCATION,                //Content-Location
+    EHH_CONTENT_RANGE,                   //Content-Range
+    EHH_CONTENT_TYPE,                    //Content-Type
+    EHH_COOKIE,                          //Cookie
+    EHH_DATE,                            //Date
+    EHH_ETAG,                            //ETag
+    EHH_EXPECT,                          //Expect
+    EHH_EXPIRES,                         //Expires
+    EHH_HOST,                            //Host
+    EHH_IF_MATCH,                        //If-Match
+    EHH_IF_MODIFIED_SINCE,               //If-Modified-Since
+    EHH_IF_NONE_MATCH,                   //If-None-Match
+    EHH_IF_RANGE,                        //If-Range
+    EHH_IF_UNMODIFIED_SINCE,             //If-Unmodified-Since
+    EHH_KEEP_ALIVE,                      //Keep-Alive
+    EHH_LAST_MODIFIED,                   //Last-Modified
+    EHH_LOCATION,                        //Location
+    EHH_ORIGIN,                          //Origin
+    EHH_PRAGMA,                          //Pragma
+    EHH_PROXY_AUTHORIZATION,             //Proxy-Authorization
+    EHH_PROXY_CONNECTION,                //Proxy-Connection
+    EHH_RANGE,                           //Range
+    EHH_REFERER,                         //Referer
+    EHH_SERVER,                          //Server
+    EHH_SET_COOKIE,                      //Set-Cookie
+    EHH_TE,                              //TE
+    EHH_TRANSFER_ENCODING,               //Transfer-Encoding
+    EHH_UPGRADE,                         //Upgrade
+    EHH_USER_AGENT,                      //User-Agent
+    EHH_VARY,                            //Vary
+    EHH_VIA,                             //Via
+    EHH_X_FORWARDED_FOR,                 //X-Forwarded-For
+    EHH_X_REAL_IP,                       //X-Real-IP
+
+    EHH_COUNT,
+    EHH_UNKNOWN = EHH_COUNT
+};
+
+
+/**
+ * @brief headers are kept in a vector by order, the first line of each well-known
+ *        header is also indexed by EHttpHeadID, so get() of them is O(1).
+ */
 class HttpHead {
 public:
     HttpHead();
@@ -77,43 +139,37 @@ public:
     
     void writeLength(usz sz) {
         s8 tmp[128];
-        StringView key("Content-Length",sizeof("Content-Length")-1);
         StringView val(tmp,snprintf(tmp, sizeof(tmp), "%llu", sz));
-        add(key,val);
+        add(EHH_CONTENT_LENGTH, val);
     }
 
     void writeContentRange(usz total, usz start, usz stop) {
         s8 tmp[128];
-        StringView key("Content-Range",sizeof("Content-Range")-1);
         StringView val(tmp,snprintf(tmp, sizeof(tmp), "bytes %llu-%llu/%llu", start, stop, total));
-        add(key,val);
+        add(EHH_CONTENT_RANGE, val);
     }
 
     //@brief default is "text/html; charset=utf-8"
     void writeDefaultContentType() {
-        StringView key("Content-Type",sizeof("Content-Type")-1);
         StringView val("text/html;charset=utf-8",sizeof("text/html;charset=utf-8")-1);
-        add(key,val);
+        add(EHH_CONTENT_TYPE, val);
     }
 
     void writeContentType(const StringView& val) {
-        StringView key("Content-Type",sizeof("Content-Type")-1);
-        add(key,val);
+        add(EHH_CONTENT_TYPE, val);
     }
 
     void writeKeepAlive(bool it) {
-        StringView key("Connection",sizeof("Connection")-1);
         StringView val("keep-alive",sizeof("keep-alive")-1);
         if (!it) {
             val.set("close",sizeof("close")-1);
         }
-        add(key,val);
+        add(EHH_CONNECTION, val);
     }
 
     void writeChunked() {
-        StringView key("Transfer-Encoding",sizeof("Transfer-Encoding")-1);
         StringView val("chunked",sizeof("chunked")-1);
-        add(key,val);
+        add(EHH_TRANSFER_ENCODING, val);
     }
 
     //Transfer-Encoding : chunked
@@ -121,15 +177,29 @@ public:
 
     void add(const StringView& key, const StringView& val);
     void add(const String& key, const String& val);
+    void add(EHttpHeadID id, const StringView& val);
 
     void remove(const StringView& key, s32 cnt = 1);
 
     StringView get(const StringView& key, usz pos = 0)const;
 
+    //@return value of the first line of this header, O(1)
+    StringView get(EHttpHeadID id)const;
+
     void clear() {
         mData.clear();
+        memset(mIndex, 0, sizeof(mIndex));
     }
 
+    /**
+     * @return EHH_UNKNOWN if it's not a well-known header name, case insensitive.
+     */
+    static EHttpHeadID getID(const StringView& key);
+
+    //@return standard name of a well-known header
+    static const StringView& getName(EHttpHeadID id);
+
+    //@note don't change keys by this vector, or the index is broken.
     TVector<HeadLine>& getData() {
         return mData;
     }
@@ -149,7 +219,11 @@ public:
     }
 
 private:
+    void addIndex(EHttpHeadID id);
+    void resetIndex();
+
     TVector<HeadLine> mData;
+    u16 mIndex[EHH_COUNT];  //1 + position in mData, 0 = none
 };
 
 }//namespace net
@@ -0,0 +1,94 @@
+#ifndef APP_HTTPHPACK_H
+#define	APP_HTTPHPACK_H
+
+#include "Packet.h"
+#include "Net/HTTP/HttpHead.h"
+
+namespace app {
+namespace net {
+
+struct HpackEntry;
+
+/**
+ * @brief HPACK(RFC 7541) header compression of HTTP/2.
+ *        One object keeps the dynamic table of one direction, so a connection needs
+ *        two of them: one to decode requests, one to encode responses.
+ */
+class HttpHpack {
+public:
+    /**
+     * @param maxTable max bytes of dynamic table, it's the SETTINGS_HEADER_TABLE_SIZE.
+     */
+    HttpHpack(u32 maxTable = 4096);
+
+    ~HttpHpack();
+
+    /**
+     * @brief decode a whole header block, fields are added to out by order,
+     *        pseudo-header fields such as ":path" are added too.
+     * @return EE_OK if success, else EE_ERROR, it's a COMPRESSION_ERROR of connection.
+     */
+    s32 decode(const u8* buf, usz len, HttpHead& out);
+
+    /**
+     * @brief start a new header block to encode, a pending table size update is written first.
+     */
+    void beginBlock(Packet& out);
+
+    /**
+     * @brief encode a header field.
+     * @param key lowercase name of field
+     * @param index false if the field should not be kept in dynamic table, eg: Set-Cookie
+     */
+    void encode(const StringView& key, const StringView& val, Packet& out, bool index = true);
+
+    //@brief encode pseudo-header ":status"
+    void encodeStatus(u16 status, Packet& out);
+
+    /**
+     * @brief change max size of dynamic table, entries are evicted if need.
+     *        for the encoder, the new size is sent to peer by next beginBlock().
+     * @note size is bounded by maxTable of constructor.
+     */
+    void setMaxTableSize(u32 size);
+
+    u32 getTableSize()const {
+        return mSize;
+    }
+
+    u32 getTableCount()const {
+        return mCount;
+    }
+
+private:
+    /**
+     * @brief get field by HPACK index, static table is [1-61], dynamic table is [62-...]
+     * @return true if success, else false.
+     */
+    bool getField(u32 idx, StringView& key, StringView& val)const;
+
+    /**
+     * @return index of the field if key and val are matched, else 0.
+     * @param keyIdx index of the first field which name is matched, 0 if none.
+     */
+    u32 findField(const StringView& key, const StringView& val, u32& keyIdx)const;
+
+    void addField(const StringView& key, const StringView& val);
+
+    void evict(u32 room);
+
+    HpackEntry** mEntries;  //ring, mEntries[mFirst] is the newest entry
+    u32 mCapacity;
+    u32 mFirst;
+    u32 mCount;
+    u32 mSize;              //RFC 7541: size of entry = key + value + 32
+    u32 mMaxSize;
+    u32 mLimit;
+    bool mSizeUpdate;
+    Packet mCache;          //decoded strings of huffman
+};
+
+}//namespace net
+}//namespace app
+
+#endif //APP_HTTPHPACK_H
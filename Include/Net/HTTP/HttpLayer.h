@@ -51,8 +51,11 @@ namespace net {
 
 
 class Website;
+class Http2Layer;
+class HttpClientPool;
+struct HttpClientHost;
 
-class HttpLayer : public RefCount {
+class HttpLayer : public RefCount, public Node2 {
 public:
     HttpLayer(EHttpParserType tp = EHTTP_BOTH);
 
@@ -68,8 +71,18 @@ public:
 
     s32 get(const String& gurl);
 
+    //@note write the body into CacheOut of msg after this, then call sendReq()
     s32 post(const String& gurl);
 
+    /**
+     * @brief send a request of client, the headers are HeadOut of msg, and the Host is of gurl.
+     *        The connection is opened if it's not connected yet.
+     */
+    s32 request(EHttpMethod method, const String& gurl);
+
+    //@return true if it's a client connection which can send requests now
+    bool isAlive();
+
     EHttpParserType getType()const {
         return mPType;
     }
@@ -78,11 +91,37 @@ public:
         return mTCP;
     }
 
+    //@return true if the connection is HTTP/2
+    bool isHttp2()const {
+        return nullptr != mHttp2;
+    }
+
     bool onLink(RequestFD* it);
 
+    void postClose();
+
+    //@brief send CacheOut of the request msg, it's safe to call it again before the last write is done
     bool sendReq();
     bool sendResp(HttpMsg* msg);
 
+    /**
+     * @brief send the cached file of msg as whole response, by one write request.
+     */
+    bool sendFile(HttpMsg* msg);
+
+    /**
+     * @brief called by eventer after it consumed some body from CacheIn of msg,
+     *        a HTTP/2 stream gives back the flow control window here.
+     */
+    void onBodyUsed(HttpMsg* msg);
+
+    /**
+     * @brief stop reading the socket after the bytes in hand are parsed, until holdRead(false).
+     *        a consumer of body pushes back on a fast peer by it, a HTTP/2 connection is not held,
+     *        its streams are held back by flow control, see onBodyUsed().
+     */
+    void holdRead(bool hold);
+
     /* Executes the parser. Returns number of parsed bytes. Sets
      * `parser->EHttpError` on error. */
     usz parseBuf(const s8* data, usz len);
@@ -90,6 +129,13 @@ public:
     static void setMaxHeaderSize(u32 size) {
         GMAX_HEAD_SIZE = size;
     }
+
+    /**
+     * @brief enable or disable the SIMD(SSE4.2/AVX2) scan of request line and headers,
+     *        it's enabled by default if CPU supports. The parse result is same with scalar code.
+     * @return true if SIMD scan is in use.
+     */
+    static bool setSIMD(bool on);
     static StringView getMethodStr(EHttpMethod it);
 
     static const s8* getErrStr(EHttpError it);
@@ -99,6 +145,19 @@ public:
     }
 
 private:
+    friend class Http2Layer;
+    friend class HttpClientPool;
+
+    //@brief a response of client is done, keep the connection in pool or close it
+    void onResponse();
+
+    /**
+     * @brief check the protocol of a server connection by ALPN or preface of h2c,
+     *        the read request is replaced by a bigger one if it's HTTP/2.
+     * @return 1 if protocol is known, 0 if more bytes are needed, -1 if error.
+     */
+    s32 checkProtocol(RequestFD*& it);
+
     s32 onTimeout(HandleTime& it);
 
     void onClose(Handle* it);
@@ -107,9 +166,18 @@ private:
 
     void onWrite(RequestFD* it, HttpMsg* msg);
 
+    void onWriteFile(RequestFD* it, HttpMsg* msg);
+
     void onRead(RequestFD* it);
 
-    void postClose();
+    //queue a request of server, responses are sent by the order of requests
+    void pushPipe(HttpMsg* msg);
+
+    //remove the finished head of pipeline, and go on to send the next response
+    void popPipe(HttpMsg* msg);
+
+    //go on to read requests if there is room in pipeline
+    void resumeRead();
 
     DFINLINE s32 writeIF(RequestFD* it) {
         return mHTTPS ? mTCP.write(it) : mTCP.getHandleTCP().write(it);
@@ -131,6 +199,18 @@ private:
         nd->onWrite(it, msg);
     }
 
+    static void funcOnWriteFile(RequestFD* it) {
+        HttpMsg* msg = reinterpret_cast<HttpMsg*>(it->mUser);
+        HttpLayer* nd = msg->getHttpLayer();
+        DASSERT(msg && nd);
+        nd->onWriteFile(it, msg);
+    }
+
+    //@brief the head written before a cached body, the body write reports the result
+    static void funcOnWriteHead(RequestFD* it) {
+        RequestFD::delRequest(it);
+    }
+
     static void funcOnRead(RequestFD* it) {
         HttpLayer& nd = *(HttpLayer*)it->mUser;
         nd.onRead(it);
@@ -153,6 +233,17 @@ private:
     Website* mWebsite;
     HandleTLS mTCP;
     HttpMsg* mMsg;
+    HttpMsg* mPipeHead;     //the request which is responding
+    HttpMsg* mPipeTail;
+    u32 mPipeCount;
+    RequestFD* mReadPaused; //held read request when pipeline is full
+    Http2Layer* mHttp2;     //not null if the connection is HTTP/2
+    HttpClientPool* mPool;  //not null if it's a client connection of pool
+    HttpClientHost* mPoolHost;
+    s64 mIdleTime;          //time of release to pool, in milliseconds
+    bool mConnected;        //client only
+    bool mReadHold;         //true if reading is held by holdRead()
+    u8 mProtocol;           //0=unknown, 1=HTTP/1.x, 2=HTTP/2
 
     //parser
 private:
@@ -26,6 +26,7 @@
 #ifndef APP_HTTPMSG_H
 #define	APP_HTTPMSG_H
 
+#include "Logger.h"
 #include "RefCount.h"
 #include "RingBuffer.h"
 #include "Net/HTTP/HttpURL.h"
@@ -242,6 +243,7 @@ enum EHttpParserType {
 
 class HttpMsg;
 class HttpLayer;
+class HttpFileNode;
 
 
 class HttpEventer : public RefCount {
@@ -249,8 +251,34 @@ public:
     HttpEventer() { }
     virtual ~HttpEventer() { }
     virtual s32 onClose() = 0;
+
+    /**
+     * @brief called when all headers of request had been received, before onOpen().
+     *        it's the chance to negotiate the response headers.
+     */
+    virtual s32 onHead(HttpMsg& msg) {
+        return EE_OK;
+    }
+
     virtual s32 onOpen(HttpMsg& msg) = 0;
     virtual s32 onSent(HttpMsg& req) = 0;
+
+    /**
+     * @brief called when some bytes of CacheOut had been sent, the response of server
+     *        or the request of client, a producer paused by a full output cache can go on here.
+     */
+    virtual s32 onDrain(HttpMsg& msg) {
+        return EE_OK;
+    }
+
+    /**
+     * @return true if the eventer reads the request body from CacheIn,
+     *         else the body is dropped as soon as it's received.
+     */
+    virtual bool isReadBody()const {
+        return false;
+    }
+
     virtual s32 onFinish(HttpMsg& resp) = 0;
     virtual s32 onBodyPart(HttpMsg& resp) = 0;
 };
@@ -293,6 +321,15 @@ public:
         return mEvent;
     }
 
+    /**
+     * @brief bind a cached file, which will be sent as the whole response.
+     */
+    void setFileNode(HttpFileNode* it);
+
+    HttpFileNode* getFileNode()const {
+        return mFileNode;
+    }
+
     void writeOutHead(const s8* name, const s8* value);
 
     void writeOutBody(const void* buf, usz bsz);
@@ -325,6 +362,7 @@ public:
         mCacheIn.reset();
         mCacheOut.reset();
         mURL.clear();
+        setFileNode(nullptr);
     }
 
     /*
@@ -361,6 +399,9 @@ public:
     /**request func*/
     s32 writeGet(const String& req);
 
+    /**request func, write the request line and HeadOut into CacheOut*/
+    s32 writeRequest(EHttpMethod method, const String& req);
+
     /**request func*/
     void setURL(const HttpURL& it) {
         mURL = it;
@@ -431,7 +472,8 @@ protected:
     }
 
     friend class HttpLayer;
-    u8 mRespStatus; //for HttpLayer
+    friend class Http2Layer;
+    u8 mRespStatus; //for HttpLayer, 0=idle, 1=writing, 2=wait for previous responses of pipeline
     u8 mStationID;
     u16 mStatusCode;
     u16 mFlags;
@@ -449,6 +491,8 @@ protected:
 
     HttpLayer* mLayer;
     HttpEventer* mEvent;
+    HttpFileNode* mFileNode;
+    HttpMsg* mPipeNext;     //pipeline of HttpLayer
 };
 
 
@@ -0,0 +1,149 @@
+#ifndef APP_HTTPPROXY_H
+#define	APP_HTTPPROXY_H
+
+#include "TVector.h"
+#include "EngineConfig.h"
+#include "Net/HTTP/HttpClientPool.h"
+#include "Net/HTTP/HttpMsg.h"
+
+namespace app {
+namespace net {
+
+//a backend of upstream group
+struct HttpBackend {
+    String mURL;        //scheme://host:port, without '/' at end
+    u32 mFly;           //outstanding requests
+    u64 mTotal;         //requests sent to it
+    HttpBackend() : mFly(0), mTotal(0) {
+    }
+};
+
+
+/**
+ * @brief a group of backends for a route(Host + prefix of path)
+ */
+class HttpUpstream {
+public:
+    HttpUpstream(const EngineConfig::UpstreamCfg& cfg);
+
+    ~HttpUpstream();
+
+    //@return true if the Host and path of request match this route
+    bool match(const StringView& host, const StringView& path)const;
+
+    /**
+     * @brief pick a backend by the balance policy, mFly of it is increased.
+     *        call release() when the request is done.
+     */
+    HttpBackend* pick();
+
+    void release(HttpBackend* it) {
+        DASSERT(it && it->mFly > 0);
+        --it->mFly;
+    }
+
+    const String& getPath()const {
+        return mPath;
+    }
+
+private:
+    TVector<HttpBackend> mBackends;
+    String mPath;
+    String mHost;
+    u32 mNext;      //for round-robin
+    u8 mBalance;    //0=round-robin, 1=least outstanding requests
+};
+
+
+/**
+ * @brief L7 reverse proxy of a Website, requests are routed by Host and path to upstream groups,
+ *        and forwarded over keep-alive connections of backends, see StationProxy & HttpEvtProxy.
+ */
+class HttpProxy : public RefCount {
+public:
+    HttpProxy(Loop* loop, const EngineConfig::WebsiteCfg& cfg);
+
+    virtual ~HttpProxy();
+
+    s32 open();
+
+    //@brief close the idle connections, it's deleted when all connections are closed.
+    void close();
+
+    /**
+     * @return the upstream group of the longest matched path, or nullptr if not proxied.
+     */
+    HttpUpstream* match(HttpMsg& msg);
+
+    HttpClientPool& getPool() {
+        return mPool;
+    }
+
+private:
+    HttpClientPool mPool;
+    TVector<HttpUpstream*> mGroups;
+    u32 mMaxIdle;
+    u32 mIdleTime;
+};
+
+
+/**
+ * @brief eventer of a proxied request, the request is forwarded to backend when its headers are
+ *        received, then bodies of request & response are forwarded part by part, not buffered.
+ *        If the receiver is slow, the sender is held by HttpLayer::holdRead() or the flow
+ *        control of HTTP/2, and goes on when the output cache drains.
+ */
+class HttpEvtProxy : public HttpEventer {
+public:
+    HttpEvtProxy(HttpProxy* proxy, HttpUpstream* group);
+
+    virtual ~HttpEvtProxy();
+
+    //request of client
+    virtual s32 onClose() override;
+    virtual s32 onHead(HttpMsg& msg) override;
+    virtual s32 onOpen(HttpMsg& msg) override;
+    virtual s32 onSent(HttpMsg& req) override;
+    virtual s32 onFinish(HttpMsg& msg) override;
+    virtual s32 onBodyPart(HttpMsg& msg) override;
+    virtual s32 onDrain(HttpMsg& msg) override;
+
+    virtual bool isReadBody()const override {
+        return true;
+    }
+
+    //response of backend
+    s32 onBackHead(HttpMsg& msg);
+    s32 onBackBody(HttpMsg& msg);
+    s32 onBackFinish(HttpMsg& msg);
+    s32 onBackDrain(HttpMsg& msg);
+    void onBackClose();
+
+private:
+    //@brief go on to send the response to client, after the request is done
+    s32 stepResp();
+
+    //@brief response 502 to client, or close the client if the headers had been sent
+    void failResp();
+
+    /**
+     * @brief move all bytes of input, and frame them as a chunk if chunked.
+     */
+    static void moveBody(RingBuffer& in, RingBuffer& out, bool chunked);
+
+    HttpProxy* mProxy;
+    HttpUpstream* mGroup;
+    HttpBackend* mBackend;
+    HttpMsg* mReq;          //request of client
+    HttpLayer* mBack;       //connection to backend, not null before the response is done
+    u8 mStation;            //station of response, ES_INIT if the response is not started
+    bool mReqChunked;
+    bool mRespChunked;
+    bool mReqDone;
+    bool mRespDone;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_HTTPPROXY_H
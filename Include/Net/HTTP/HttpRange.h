@@ -0,0 +1,58 @@
+#ifndef APP_HTTPRANGE_H
+#define	APP_HTTPRANGE_H
+
+#include "Strings.h"
+#include "Net/HTTP/HttpHead.h"
+
+namespace app {
+namespace net {
+
+class HttpMsg;
+
+/**
+ * @brief conditional and range requests of static files.
+ *        Validators are compared exactly with the ETag & Last-Modified sent by us,
+ *        so If-Modified-Since is not parsed as a date.
+ */
+class HttpRange {
+public:
+    /**
+     * @brief write the strong ETag of a file: "mtime-size[-gz]" in hex, with the quotes.
+     * @return length of tag.
+     */
+    static usz writeETag(s8* tag, usz tsz, s64 mtime, usz fsize, bool gzip);
+
+    /**
+     * @brief check If-None-Match, If-Modified-Since, Range and If-Range of request.
+     *        Only a single range is served, a request of multiple ranges gets the whole file.
+     * @param etag ETag of file.
+     * @param mtime Last-Modified of file, in GMT string.
+     * @param fsize file size.
+     * @param start [out] first byte to send.
+     * @param len [out] bytes to send.
+     * @return 304 if the copy of client is fresh, 206 if a satisfiable range,
+     *         416 if the range is not satisfiable, else 200 for the whole file.
+     */
+    static s32 check(const HttpHead& in, const StringView& etag, const StringView& mtime,
+        usz fsize, usz& start, usz& len);
+
+    /**
+     * @brief write status line and headers of a static file into cache of msg,
+     *        the Content-Type should had been added to head of msg.
+     * @param status result of check()
+     */
+    static void writeHead(HttpMsg& msg, s32 status, const StringView& etag, const StringView& mtime,
+        usz fsize, usz start, usz len);
+
+private:
+    //@return true if one of tags in list match etag, weak comparison
+    static bool matchETag(const StringView& list, const StringView& etag);
+
+    //@return 206 or 416, or 200 if the Range is ignored
+    static s32 parseRange(const StringView& range, usz fsize, usz& start, usz& len);
+};
+
+}//namespace net
+}//namespace app
+
+#endif //APP_HTTPRANGE_H
@@ -121,6 +121,24 @@ public:
 };
 
 
+
+class HttpProxy;
+
+/***************************************************************************************************
+* @brief station of L7 proxy, put before the station of ES_HEAD and ES_BODY_DONE.
+*        a request matched by routes of proxy is forwarded to backend by HttpEvtProxy,
+*        others go on to the next station.
+***************************************************************************************************/
+class StationProxy : public MsgStation {
+public:
+    StationProxy(HttpProxy* proxy, MsgStation* next);
+    virtual ~StationProxy();
+    virtual s32 onMsg(HttpMsg* msg) override;
+private:
+    HttpProxy* mProxy;
+};
+
+
 } //namespace net
 } //namespace app
 #endif //APP_MSGSTATION_H
@@ -5,6 +5,9 @@
 #include "Net/Acceptor.h"
 #include "Net/HTTP/HttpLayer.h"
 #include "Net/HTTP/MsgStation.h"
+#include "Net/HTTP/HttpFileCache.h"
+#include "Net/HTTP/HttpGzip.h"
+#include "Net/HTTP/HttpProxy.h"
 #include "Net/TlsContext.h"
 
 namespace app {
@@ -48,6 +51,16 @@ public:
         return mTlsContext;
     }
 
+    HttpFileCache& getCache() {
+        return mCache;
+    }
+
+#if defined(DUSE_ZLIB)
+    HttpGzipPool& getGzipPool() {
+        return mGzipPool;
+    }
+#endif
+
     void bind(HttpLayer* it) {
         if (it) {
             it->grab();
@@ -76,7 +89,14 @@ private:
         con->drop();
     }
 
+    void initProxy();
+
     TlsContext mTlsContext;
+    HttpFileCache mCache;
+    HttpProxy* mProxy;  //not null if L7 proxy is enabled
+#if defined(DUSE_ZLIB)
+    HttpGzipPool mGzipPool;
+#endif
     TVector<MsgStation*> mStations;
     TVector<MsgStation*> mLineLua;
     TVector<MsgStation*> mLineStatic;
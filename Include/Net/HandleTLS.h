@@ -28,6 +28,7 @@
 
 
 #include "RingBuffer.h"
+#include "Packet.h"
 #include "Loop.h"
 #include "Net/TlsContext.h"
 #include "Net/HandleTCP.h"
@@ -65,13 +66,30 @@ public:
     }
 
     s32 close() {
+        if (mHandshaking) {
+            //the socket is in use by thread pool
+            mCloseLater = true;
+            return EE_OK;
+        }
         return mTCP.close();
     }
 
+    /**
+     * @brief close the inner TCP by loop, it's closed after the handshake if in thread pool.
+     * Handle::launchClose() can't be used, the loop would take this as a HandleTCP.
+     */
+    s32 launchClose();
+
     s32 setHost(const s8* hostName, usz length);
 
     s32 verify(s32 vfg);
 
+    //@return the protocol selected by ALPN, empty if none
+    StringView getALPN()const;
+
+    //@return true if the sending is encrypted by kernel(kTLS), @see TlsContext::setKTLS()
+    bool isKTLS()const;
+
     const NetAddress& getLocal()const {
         return mTCP.getLocal();
     }
@@ -86,7 +104,23 @@ public:
 
 
 protected:
-    s32 handshake();
+    /**
+     * @param pool true to run the handshake step in ThreadPool if allowed, @see TlsContext::setHandshakePool()
+     * @return EE_POSTED if running in ThreadPool, and it goes on in handshakeByLoop().
+     */
+    s32 handshake(bool pool = false);
+
+    //@return true if offloaded to ThreadPool
+    bool postHandshake();
+
+    //called by thread pool
+    void handshakeByPool(RequestFD* it);
+
+    //called by loop thread
+    void handshakeByLoop(RequestFD* it);
+
+    //@return true if go on reading
+    bool onHandshake(s32 ret);
 
     s32 onTimeout(HandleTime& it);
 
@@ -145,6 +179,13 @@ protected:
     //д
     s32 postWrite();
 
+    /**
+     * @brief encrypt the plaintext of mWaitWrites, small writes queued while the socket is
+     *        busy are coalesced into records of TlsSession::getRecordSize(). It works only
+     *        while no ciphertext is in sending, so the output is bounded and mCache is free.
+     */
+    void sealWrites();
+
     //
     s32 postRead();
 
@@ -164,14 +205,20 @@ protected:
     RequestFD mRead;
     RequestFD mWrite;
     RequestFD* mFlyWrites;
+    RequestFD* mWaitWrites;     //plaintext to encrypt
     RequestFD* mFlyReads;
     RequestFD* mLandWrites;
     RequestFD* mLandReads;
     void* mTlsSession;
+    u32 mPoolLimit;         //max handshakes in ThreadPool, 0=handshake in loop
+    s32 mHandshakeRet;      //result of handshakeByPool()
+    bool mHandshaking;      //true if the session is in use by ThreadPool
+    bool mCloseLater;
     s8 mHostName[256];
     RingBuffer mInBuffers;
     RingBuffer mOutBuffers;
     SRingBufPos mCommitPos;
+    Packet mCache;              //plaintext of a coalesced record, or gathered ciphertext in sending
 };
 
 
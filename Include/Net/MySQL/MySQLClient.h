@@ -0,0 +1,200 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_MYSQLCLIENT_H
+#define	APP_MYSQLCLIENT_H
+
+#include "Loop.h"
+#include "Net/NetAddress.h"
+#include "Net/HandleTCP.h"
+#include "Net/MySQL/MySQLResponse.h"
+
+namespace app {
+namespace net {
+class MySQLClientPool;
+class MySQLRequest;
+
+/**
+ * @brief a connection to MySQL server, speaks the client/server protocol on Loop.
+ *        Auth plugins: mysql_native_password, caching_sha2_password (the full auth
+ *        is done with the RSA public key of server, see MySQLClientPool::setServerPublicKey()),
+ *        without TLS.
+ *        Commands are written without waiting for the replies of previous ones,
+ *        the server replies them in order, so the replies are matched by FIFO.
+ */
+class MySQLClient : public Node2 {
+public:
+    MySQLClient(MySQLClientPool* pool);
+
+    ~MySQLClient();
+
+    MySQLClientPool* getPool() const {
+        return mPool;
+    }
+
+    s32 open(const net::NetAddress& remote) {
+        mTCP.setRemote(remote);
+        return open();
+    }
+
+    s32 close();
+
+    /**
+    * @brief queue the command on this connection, it's written at once if no write is in flight,
+    *        else it's written together with the other queued commands when the write is done.
+    */
+    bool postTask(MySQLRequest* it);
+
+    //@return true if the in-flight commands reach MySQLClientPool::getMaxPipeline()
+    bool isFull()const;
+
+    u32 getFlyCount()const {
+        return mFlyCount;
+    }
+
+    //@return id of connection given by server
+    u32 getConnectionID()const {
+        return mConnectionID;
+    }
+
+    s32 onTimeout(HandleTime& it);
+
+    void onClose(Handle* it);
+
+    void onConnect(RequestFD* it);
+
+    void onWrite(RequestFD* it);
+
+    void onRead(RequestFD* it);
+
+private:
+
+    static s32 funcOnTime(HandleTime* it) {
+        MySQLClient& nd = *(MySQLClient*)it->getUser();
+        return nd.onTimeout(*it);
+    }
+
+    static void funcOnWrite(RequestFD* it) {
+        MySQLClient& nd = *(MySQLClient*)it->mUser;
+        nd.onWrite(it);
+    }
+
+    static void funcOnRead(RequestFD* it) {
+        MySQLClient& nd = *(MySQLClient*)it->mUser;
+        nd.onRead(it);
+    }
+
+    static void funcOnConnect(RequestFD* it) {
+        MySQLClient& nd = *(MySQLClient*)it->mUser;
+        nd.onConnect(it);
+    }
+
+    static void funcOnClose(Handle* it) {
+        MySQLClient& nd = *(MySQLClient*)it->getUser();
+        nd.onClose(it);
+    }
+
+    static const u32 G_OUT_CACHE = 16 * 1024;
+    static const u32 G_READ_SIZE = 4 * 1024;
+    static const u32 G_SCRAMBLE_SIZE = 20;
+
+    //packets after connected, the server speaks first
+    enum EHandshake {
+        EHS_GREETING,   //initial handshake of server
+        EHS_AUTH,       //OK, ERR, auth switch, or more data of auth plugin
+        EHS_PUBLIC_KEY, //RSA public key of caching_sha2_password
+        EHS_READY
+    };
+
+    enum EAuthPlugin {
+        EAP_NATIVE,         //mysql_native_password
+        EAP_CACHING_SHA2,   //caching_sha2_password
+        EAP_UNKNOWN
+    };
+
+    /* 0=init, 1=fly(handshake), 4=ready */
+    s32 mStatus;
+    u32 mStep;              //EHandshake
+    u32 mPlugin;            //EAuthPlugin
+    u32 mConnectionID;
+    u8 mSeq;                //sequence of the next packet in handshake
+    u8 mScramble[G_SCRAMBLE_SIZE];
+    Node2 mFlyQueue;        //in-flight commands, FIFO
+    u32 mFlyCount;
+    u32 mUnsent;            //count of the newest commands in mFlyQueue which are not written yet
+    u32 mReplied;           //replies since last timeout check
+    bool mStalled;          //no reply in last period
+    RequestFD* mWriting;    //write of commands in flight
+    RequestFD* mOutCache;   //reused by the writes of commands in G_OUT_CACHE bytes
+    MySQLClientPool* mPool;
+    net::HandleTCP mTCP;
+    Loop* mLoop;
+    MySQLResponse mResult;
+    u32 mKept;              //bytes of a partial packet kept at head of read buffer
+
+    //@brief deliver mResult to the oldest in-flight command
+    void callback();
+
+    /**
+    * @brief keep the partial packet at head of read buffer, the buffer grows if it's full,
+    *        so a packet is always contiguous in buffer.
+    * @return the buffer to read next.
+    */
+    RequestFD* keepTail(RequestFD* it, const s8* pos);
+
+    //@brief write all unsent commands in one request
+    bool flush();
+
+    //@return false if the connection should be closed
+    bool onHandshake(const u8* pkt, u32 len);
+
+    bool onGreeting(const u8* pkt, u32 len);
+
+    //@brief the reply of auth, may be an auth switch
+    bool onAuth(const u8* pkt, u32 len);
+
+    //@brief the RSA public key asked from server
+    bool onPublicKey(const u8* pkt, u32 len);
+
+    //@brief write the password encrypted by RSA public key \p pem
+    bool writePassword(const u8* pem, u32 len);
+
+    /**
+    * @return bytes of the auth data of plugin, written in out
+    */
+    u32 getAuthData(u8* out)const;
+
+    static u32 getPlugin(const s8* name, usz len);
+
+    //@brief write a packet of handshake, with sequence mSeq
+    bool writePacket(const u8* data, u32 len);
+
+    s32 open();
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_MYSQLCLIENT_H
@@ -0,0 +1,176 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_MYSQLCLIENTPOOL_H
+#define	APP_MYSQLCLIENTPOOL_H
+
+#include "Loop.h"
+#include "Strings.h"
+#include "Net/NetAddress.h"
+
+namespace app {
+namespace net {
+class MySQLRequest;
+class MySQLClient;
+
+
+/**
+ * @brief pool of MySQL connections on a Loop, no thread is needed.
+ *        Commands are pipelined on a few connections, a connection has at most
+ *        getMaxPipeline() commands in flight, the others are queued in pool.
+ *        All callbacks are called on the thread of Loop.
+ */
+class MySQLClientPool {
+public:
+    MySQLClientPool(Loop* loop);
+
+    ~MySQLClientPool();
+
+    /**
+     * @param maxTCP max connections.
+     * @param database the default database, nullptr or "" if none.
+     */
+    void open(const net::NetAddress& serverIP, s32 maxTCP, const s8* user, const s8* password,
+        const s8* database = nullptr);
+
+    //@brief close all connections, the queued commands are failed.
+    void close();
+
+    //@return true if closed and all connections are closed, the pool can be deleted.
+    bool isClosed()const {
+        return !mRunning && mIdleCount == mMaxTCP;
+    }
+
+    const String& getUser()const {
+        return mUser;
+    }
+
+    const String& getPassword()const {
+        return mPassword;
+    }
+
+    const String& getDatabase()const {
+        return mDatabase;
+    }
+
+    /**
+    * @brief the RSA public key of server in PEM, the password is encrypted by it in the full auth of
+    *        caching_sha2_password, which is needed without TLS if the server has no cache of the user.
+    */
+    void setServerPublicKey(const s8* pem, usz len) {
+        mServerKey.setLen(0);
+        mServerKey.append(pem, len);
+    }
+
+    const String& getServerPublicKey()const {
+        return mServerKey;
+    }
+
+    /**
+    * @brief ask the RSA public key from server if none is set by setServerPublicKey(), as
+    *        GET_SERVER_PUBLIC_KEY of libmysqlclient. The key got is trusted as it is,
+    *        so a man in the middle can take the password with a key of its own. Off by default,
+    *        the full auth fails without a key.
+    */
+    void setGetServerPublicKey(bool it) {
+        mGetServerKey = it;
+    }
+
+    bool isGetServerPublicKey()const {
+        return mGetServerKey;
+    }
+
+    const net::NetAddress& getRemoterAddr()const {
+        return mRemoterAddr;
+    }
+
+    Loop* getLoop()const {
+        return mLoop;
+    }
+
+    /**
+    * @brief max in-flight commands per connection.
+    */
+    void setMaxPipeline(u32 it) {
+        mMaxPipeline = AppClamp(it, 1U, 64U * 1024U);
+    }
+
+    u32 getMaxPipeline() const {
+        return mMaxPipeline;
+    }
+
+    //@return count of queued commands, they are waiting for a connection with room
+    u32 getTaskCount()const {
+        return mTaskCount;
+    }
+
+    bool postTask(MySQLRequest* it);
+
+    /**
+    * @brief a connection is ready or has room for more commands, the queued tasks are posted to it.
+    */
+    void push(MySQLClient* it);
+
+    /**
+    * @param fly true if it's closed before ready.
+    */
+    void onClose(MySQLClient* it, bool fly);
+
+protected:
+    MySQLRequest* popTask();
+    void pushTask(MySQLRequest* it);
+
+    MySQLClient* popIdle();
+    void pushIdle(MySQLClient* it);
+
+    //@return a ready connection which is not full, round-robin
+    MySQLClient* pop();
+
+    //@brief call back the queued commands with an error
+    void failTasks(const s8* msg);
+
+private:
+    bool mRunning;
+    bool mGetServerKey;
+    s32 mMaxTCP;
+    s32 mFlyCount;  //connecting
+    s32 mIdleCount;
+    u32 mMaxPipeline;
+    u32 mTaskCount;
+    net::NetAddress mRemoterAddr;
+    Loop* mLoop;
+    String mUser;
+    String mPassword;
+    String mDatabase;
+    String mServerKey; //PEM
+    Node2 mAliveQueue; //ready tcp, busy or not
+    Node2 mIdleQueue;  //disconnected tcp
+    Node2 mTask;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_MYSQLCLIENTPOOL_H
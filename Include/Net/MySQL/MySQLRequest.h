@@ -0,0 +1,141 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_MYSQLREQUEST_H
+#define	APP_MYSQLREQUEST_H
+
+#include "Node.h"
+#include "RefCount.h"
+#include "Net/MySQL/MySQLResponse.h"
+
+namespace app {
+namespace net {
+class MySQLClient;
+class MySQLClientPool;
+
+/**
+ * @brief a command to MySQL, it's posted to MySQLClientPool and the callback is called
+ *        on the thread of Loop when the reply is received, or the connection is lost.
+ *        eg:
+ *        MySQLRequest* req = new MySQLRequest();
+ *        req->setPool(pool);
+ *        req->setCallback(func);
+ *        req->query("SELECT id,name FROM user LIMIT 5");
+ *        req->drop();
+ */
+class MySQLRequest : public Node2, public RefCount {
+public:
+    MySQLRequest();
+
+    virtual ~MySQLRequest();
+
+    void setPool(MySQLClientPool* it) {
+        mPool = it;
+    }
+
+    MySQLClientPool* getPool()const {
+        return mPool;
+    }
+
+    MySQLClient* getClient()const {
+        return mLink;
+    }
+
+    void setClient(MySQLClient* it) {
+        mLink = it;
+    }
+
+    void setCallback(AppMySQLCaller it) {
+        mCallback = it;
+    }
+
+    AppMySQLCaller getCallback()const {
+        return mCallback;
+    }
+
+    void setUserPointer(void* it) {
+        mUserPointer = it;
+    }
+
+    void* getUserPointer()const {
+        return mUserPointer;
+    }
+
+    /**
+    * @brief COM_QUERY, a single statement, the string values in it should be escaped by escape().
+    * @return true if posted.
+    */
+    bool query(const s8* sql, usz len);
+
+    bool query(const s8* sql) {
+        return query(sql, strlen(sql));
+    }
+
+    //@brief COM_PING
+    bool ping();
+
+    //@return the packet, with the 4 bytes head
+    const s8* getRequestBuf()const {
+        return mRequest.c_str();
+    }
+
+    u32 getRequestSize()const {
+        return static_cast<u32>(mRequest.getLen());
+    }
+
+    //@return the SQL of query
+    StringView getSQL()const {
+        return mRequest.getLen() > 5 ? StringView(mRequest.c_str() + 5, mRequest.getLen() - 5) : StringView("", 0);
+    }
+
+    /**
+    * @brief escape a string value as mysql_real_escape_string(), for the charsets of ASCII compatible.
+    * @param out size of it should be >= 2*len+1.
+    * @return length of the escaped, with a tail '\0'.
+    */
+    static usz escape(s8* out, const s8* in, usz len);
+
+    //payload of a packet must be less than it, larger commands are not supported
+    static const u32 G_MAX_PACKET = 0xFFFFFF;
+
+private:
+    bool launch(u8 cmd, const s8* data, usz len);
+
+    MySQLClientPool* mPool;
+    MySQLClient* mLink;
+    AppMySQLCaller mCallback;
+    void* mUserPointer;
+    String mRequest;
+
+    MySQLRequest(const MySQLRequest&) = delete;
+    MySQLRequest(MySQLRequest&&) = delete;
+    const MySQLRequest& operator=(const MySQLRequest&) = delete;
+    const MySQLRequest& operator=(MySQLRequest&&) = delete;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_MYSQLREQUEST_H
@@ -0,0 +1,166 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_MYSQLRESPONSE_H
+#define	APP_MYSQLRESPONSE_H
+
+#include "Strings.h"
+#include "TVector.h"
+
+namespace app {
+namespace net {
+
+class MySQLRequest;
+class MySQLResponse;
+
+///A callable function pointer for MySQLResponse.
+typedef void(*AppMySQLCaller)(MySQLRequest* it, MySQLResponse*);
+
+
+/**
+ * @brief result of a command, decoded from the packets of MySQL protocol.
+ *        Text resultset only, all values are strings as sent by server, with a tail '\0'.
+ *        Later resultsets of a multi-result reply (eg: CALL) are skipped, the 1st is kept.
+ */
+class MySQLResponse {
+public:
+    MySQLResponse();
+
+    ~MySQLResponse();
+
+    void clear();
+
+    bool isError()const {
+        return 0 != mErrorCode;
+    }
+
+    //@return error code of server, or 2013 if the connection is lost, 0 if no error
+    u16 getErrorCode()const {
+        return mErrorCode;
+    }
+
+    //@return message of error, "" if no error
+    const s8* getError()const {
+        return isError() ? mData.c_str() : "";
+    }
+
+    u64 getAffectedRows()const {
+        return mAffectedRows;
+    }
+
+    u64 getLastInsertID()const {
+        return mLastInsertID;
+    }
+
+    u16 getWarnings()const {
+        return mWarnings;
+    }
+
+    u32 getFieldCount()const {
+        return static_cast<u32>(mFields.size());
+    }
+
+    u32 getRowCount()const {
+        return mRowCount;
+    }
+
+    StringView getFieldName(u32 col)const;
+
+    //@return index of the field, -1 if not found
+    s32 findField(const s8* name)const;
+
+    bool isNull(u32 row, u32 col)const;
+
+    //@return value of the cell, "" if NULL
+    StringView getValue(u32 row, u32 col)const;
+
+    s64 getS64(u32 row, u32 col)const;
+
+    u64 getU64(u32 row, u32 col)const;
+
+    f64 getF64(u32 row, u32 col)const;
+
+    /**
+    * @brief decode a packet of the reply, the data is copied.
+    * @param pkt payload of packet, without the 4 bytes head.
+    * @return 1 if the reply is finished, 0 if more packets are needed, -1 if bad packet.
+    */
+    s32 decode(const u8* pkt, u32 len);
+
+    void makeError(u16 code, const s8* msg);
+
+    static const u16 G_SERVER_MORE_RESULTS = 0x0008;
+
+private:
+    enum EDecodeStep {
+        EDS_HEAD,       //OK, ERR, or count of fields
+        EDS_FIELD,      //definitions of fields
+        EDS_FIELD_EOF,
+        EDS_ROW         //rows till EOF or ERR
+    };
+
+    struct Cell {
+        u32 mPos;   //offset in mData
+        u32 mLen;   //G_NULL_CELL if NULL
+    };
+
+    static const u32 G_NULL_CELL = 0xFFFFFFFFU;
+
+    u8 mStep;
+    bool mSkip;         //in the later resultsets
+    u16 mErrorCode;
+    u16 mWarnings;
+    u32 mFieldLeft;
+    u32 mFieldTotal;    //fields of the current resultset
+    u32 mRowCount;
+    u64 mAffectedRows;
+    u64 mLastInsertID;
+    String mData;       //names of fields & values of cells, or the message of error
+    TVector<Cell> mFields;
+    TVector<Cell> mCells;
+
+    const Cell* getCell(u32 row, u32 col)const;
+
+    void append(TVector<Cell>& out, const u8* str, u32 len);
+
+    //@return 1 if finished, 0 if more resultsets are coming
+    s32 onEnd(u16 status);
+
+    s32 decodeOK(const u8* pkt, u32 len);
+
+    s32 decodeError(const u8* pkt, u32 len);
+
+    s32 decodeRow(const u8* pkt, u32 len);
+
+    MySQLResponse(const MySQLResponse&) = delete;
+    MySQLResponse(MySQLResponse&&) = delete;
+    const MySQLResponse& operator=(const MySQLResponse&) = delete;
+    const MySQLResponse& operator=(MySQLResponse&&) = delete;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_MYSQLRESPONSE_H
@@ -0,0 +1,117 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_REDISBATCH_H
+#define	APP_REDISBATCH_H
+
+
+#include "TVector.h"
+#include "Net/RedisClient/RedisRequest.h"
+
+namespace app {
+namespace net {
+
+/**
+ * @brief a group of commands sent as one unit.
+ *        The encoders of RedisRequest append commands into one buffer, commit() sends the buffer
+ *        with a single write, and the callback gets an array of all responses in order.
+ *        In cluster mode the commands are split by pool of their slots, the keyless commands go
+ *        with the nearest keyed one. Redirects inside a batch are not followed, they come back as
+ *        errors in the array.
+ *
+ * eg:
+ *     RedisBatch* req = new RedisBatch();
+ *     req->setCallback(fun);
+ *     req->setPool(pool);
+ *     req->multi();
+ *     req->set("k1", "v1");
+ *     req->get("k1");
+ *     req->exec();
+ *     req->commit();
+ *     req->drop();
+ */
+class RedisBatch : public RedisRequest {
+public:
+    RedisBatch();
+    virtual ~RedisBatch();
+
+    //@brief start a transaction, the commands till exec() should be in one slot in cluster mode
+    bool multi();
+
+    bool exec();
+
+    //@return count of appended commands
+    u32 getCount()const {
+        return static_cast<u32>(mParts.size());
+    }
+
+    /**
+    * @brief send all of the appended commands, no more command can be appended after it.
+    * @return true if launched, the callback will get an array of getCount() responses.
+    */
+    bool commit();
+
+protected:
+    virtual bool append(u32 slot, u32 argc, const s8** argv, const u32* lens)override;
+
+private:
+    //a command in buffer
+    struct Part {
+        u32 mEnd;       //end of command in buffer
+        u32 mIndex;     //index in responses of parent
+        u16 mSlot;
+    };
+    TVector<Part> mParts;
+    u32 mAllocated;         //size of buffer
+    u32 mWait;              //sub-batches in flight
+    RedisBatch* mParent;
+    RedisResponse* mResult; //responses of sub-batches
+
+    //@brief grow the buffer for \p len more bytes
+    bool reserve(u64 len);
+
+    bool appendRaw(const s8* buf, u32 len, u32 index, u16 slot);
+
+    //@brief resolve the slots of keyless commands
+    void fixSlots();
+
+    //@brief split to sub-batches by pool if the commands are in many pools
+    bool split();
+
+    //@param res responses of sub-batch, nullptr if fail to launch it
+    void onPart(RedisBatch* part, RedisResponse* res);
+
+    RedisResponse* createResult();
+
+    static void funcOnPart(RedisRequest* it, RedisResponse* res) {
+        RedisBatch* nd = static_cast<RedisBatch*>(it);
+        nd->mParent->onPart(nd, res);
+    }
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_REDISBATCH_H
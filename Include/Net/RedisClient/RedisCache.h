@@ -0,0 +1,132 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#ifndef APP_REDISCACHE_H
+#define	APP_REDISCACHE_H
+
+
+#include "Node.h"
+#include "Strings.h"
+
+namespace app {
+namespace net {
+class RedisResponse;
+
+/**
+ * @brief client side cache of a pool, for the hot keys read by GET & HGET.
+ *        The connections of pool turn on CLIENT TRACKING by RESP3, the cache is filled by the
+ *        replies of them, and invalidated by the push messages of server. The cache is cleared
+ *        if a connection is closed, the invalidations of it may be lost.
+ *        Least recently used keys are dropped if more than getMaxKeys().
+ */
+class RedisCache {
+public:
+    RedisCache(u32 maxKeys);
+
+    ~RedisCache();
+
+    /**
+    * @brief get key & field of a cacheable command: GET key, HGET key field.
+    * @param out [out] key & field.
+    * @return count of key & field, 0 if not cacheable.
+    */
+    static u32 getCacheKey(u32 argc, const s8** argv, const u32* lens, StringView* out);
+
+    /**
+    * @brief same as getCacheKey(), but from the request buffer of command.
+    */
+    static u32 getCacheKey(const s8* req, u32 size, StringView* out);
+
+    /**
+    * @brief find a cached value.
+    * @param out [out] the value, it's valid till the cache is changed, mData is nullptr if nil.
+    * @return true if hit.
+    */
+    bool find(const StringView* key, u32 cnt, StringView& out);
+
+    //@brief cache a reply of bulk string or nil
+    void insert(const StringView* key, u32 cnt, const RedisResponse& val);
+
+    //@brief drop a key, with all of the fields of it
+    void invalidate(const StringView& key);
+
+    //@brief handle a push message: invalidate key or invalidate null
+    void onPush(const RedisResponse& msg);
+
+    void clear();
+
+    u32 getMaxKeys()const {
+        return mMaxKeys;
+    }
+
+    u32 getCount()const {
+        return mCount;
+    }
+
+    u64 getHits()const {
+        return mHits;
+    }
+
+    u64 getMisses()const {
+        return mMisses;
+    }
+
+private:
+    //a cached value of field, or of key itself if mField is empty
+    struct Value {
+        Value* mNext;
+        String mField;
+        String mValue;
+        bool mNil;
+    };
+
+    //a cached key, linked in mLRU
+    struct Entry : public Node2 {
+        Entry* mChain;  //in bucket
+        u64 mHash;
+        String mKey;
+        Value* mValues;
+    };
+
+    Entry** mBuckets;
+    u32 mMask;
+    u32 mCount;
+    u32 mMaxKeys;
+    u64 mHits;
+    u64 mMisses;
+    Node2 mLRU;     //recently used at head
+
+    Entry* findEntry(const StringView& key, u64 hash, Entry*** prev);
+
+    void remove(Entry* it, Entry** prev);
+
+    RedisCache(const RedisCache&) = delete;
+    const RedisCache& operator=(const RedisCache&) = delete;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_REDISCACHE_H
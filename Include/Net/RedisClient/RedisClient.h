@@ -69,8 +69,20 @@ public:
 
     s32 close();
 
+    /**
+    * @brief queue the command on this connection, it's written at once if no write is in flight,
+    *        else it's written together with the other queued commands when the write is done.
+    *        Responses are matched to the in-flight commands in order.
+    */
     bool postTask(RedisCommand* it);
 
+    //@return true if the in-flight commands reach RedisClientPool::getMaxPipeline()
+    bool isFull()const;
+
+    u32 getFlyCount()const {
+        return mFlyCount;
+    }
+
     s32 onTimeout(HandleTime& it);
 
     void onClose(Handle* it);
@@ -112,22 +124,66 @@ private:
         nd.onClose(it);
     }
 
-    /* SELECT is not allowed in cluster mode.
-       0=init, 1=fly, 2=password, 4=select db(ready) */
+    static const u32 G_OUT_CACHE = 16 * 1024;
+    static const u32 G_READ_SIZE = 4 * 1024;
+
+    //commands sent after connected, in order, a step is skipped if not needed
+    enum EHandshake {
+        EHS_AUTH,
+        EHS_HELLO,      //RESP3, for the push messages of CLIENT TRACKING
+        EHS_TRACKING,
+        EHS_SELECT,     //SELECT is not allowed in cluster mode
+        EHS_READONLY,   //to read from a replica of cluster
+        EHS_READY
+    };
+
+    /* 0=init, 1=fly, 2=password, 4=ready, 8=tracking keys of the cache of pool */
     s32 mStatus;
+    u32 mStep;              //EHandshake, the reply of it is waited
     void* mUserPointer;
-    RedisRequest* mCMD;
+    Node2 mFlyQueue;        //in-flight commands, FIFO
+    u32 mFlyCount;
+    u32 mUnsent;            //count of the newest commands in mFlyQueue which are not written yet
+    u32 mReplied;           //responses since last timeout check
+    bool mStalled;          //no response in last period
+    RequestFD* mWriting;    //write of commands in flight
+    RequestFD* mOutCache;   //reused by the writes of commands in G_OUT_CACHE bytes
     RedisClientPool* mPool;
     net::HandleTCP mTCP;
     Loop* mLoop;
     MemoryHub* mHub;
     RedisResponse* mResult;
+    RedisResponse* mBatchResult;    //responses of a batch command, see RedisBatch
+    RedisScanner mScanner;
+    u32 mKept;              //bytes of a partial response kept at head of read buffer
 
+    //@brief deliver mResult to the oldest in-flight command
     void callback();
 
-    void onPassword();
+    /**
+    * @brief collect mResult into mBatchResult if the oldest command is a batch.
+    * @return true if all responses of the oldest command are received, they are in mResult.
+    */
+    bool collect();
+
+    void releaseResult(RedisResponse*& it);
+
+    /**
+    * @brief keep the partial response at head of read buffer, the buffer grows if it's full,
+    *        so a response is always contiguous in buffer.
+    * @return the buffer to read next.
+    */
+    RequestFD* keepTail(RequestFD* it, const s8* pos);
+
+    //@brief write all unsent commands in one request
+    bool flush();
+
+    //@brief send the command of mStep, or of the next step needed, the connection is ready if no more
+    void launchStep();
+
+    void onStep();
 
-    void onSelectDB();
+    void writeCommand(u32 argc, const s8** argv, const u32* lens);
 
     s32 open();
 };
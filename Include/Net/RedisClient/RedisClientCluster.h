@@ -27,11 +27,14 @@
 #define	APP_REDISCLIENTCLUSTER_H
 
 #include "TMap.h"
+#include "TVector.h"
 #include "Strings.h"
 #include "Net/NetAddress.h"
 #include "Net/RedisClient/RedisClientPool.h"
 
 namespace app {
+class MemoryHub;
+
 namespace net {
 class RedisResponse;
 
@@ -76,6 +79,19 @@ public:
 
     bool updateSlots();
 
+    /**
+    * @brief refresh the slot map in background, at most one CLUSTER SLOTS is in flight,
+    *        and not sooner than G_REFRESH_GAP since last refresh.
+    * @param it the pool to ask, any pool if nullptr.
+    */
+    bool refreshSlots(RedisClientPool* it = nullptr);
+
+    /**
+    * @brief a MOVED is received, the slot is fixed at once and the whole slot map is refreshed,
+    *        so the other moved slots are fixed before their commands are redirected.
+    */
+    void onMoved(u32 slot, RedisClientPool* it);
+
 
     /**
     * @brief open a pool
@@ -83,7 +99,11 @@ public:
     */
     RedisClientPool* open(const s8* ipport, u32 maxTCP = 0, const s8* passowrd = nullptr);
 
-    RedisClientPool* open(const net::NetAddress& addr, u32 maxTCP = 0, const s8* passowrd = nullptr);
+    /**
+    * @param replica true if the pool is to a replica, the connections of it send READONLY.
+    */
+    RedisClientPool* open(const net::NetAddress& addr, u32 maxTCP = 0, const s8* passowrd = nullptr,
+        bool replica = false);
 
     const TMap<net::NetAddress::ID, String>& getAllPassword()const {
         return mPassword;
@@ -131,7 +151,27 @@ public:
         return mMaxSlots;
     }
 
-    RedisClientPool* getBySlot(u32 it);
+    //@return the hub shared by all pools of cluster
+    MemoryHub* getMemHub()const {
+        return mHub;
+    }
+
+    /**
+    * @brief route the read commands to replicas of slot, round-robin. Off by default,
+    *        a replica may lag behind master. Set it before open().
+    */
+    void setReadReplica(bool it) {
+        mReadReplica = it;
+    }
+
+    bool isReadReplica() const {
+        return mReadReplica;
+    }
+
+    /**
+    * @param read true if it's a read command, a replica is returned if isReadReplica().
+    */
+    RedisClientPool* getBySlot(u32 it, bool read = false);
 
     RedisClientPool* getByAddress(const s8* iport);
 
@@ -142,12 +182,29 @@ public:
     void close();
 
 private:
+    static const s64 G_REFRESH_GAP = 1000;
+
+    //slot map, a refresh builds a copy and replaces the old one as a whole
+    struct SlotTable {
+        RedisClientPool** mMaster;          //[mMaxSlots]
+        u32* mReplica;                      //[mMaxSlots], (first << 8) | count, in mReplicas
+        TVector<RedisClientPool*> mReplicas;
+
+        SlotTable(u32 cnt);
+        ~SlotTable();
+    };
+
     //0=init,1=starting,2=got slots error,3=started
     volatile u32 mStatus;
     u32 mMaxRedirect; //limit of moved or ask
     u32 mMaxSlots;
-    RedisClientPool** mSlots;
+    u32 mReplicaNext;
+    bool mReadReplica;
+    bool mRefreshing;   //CLUSTER SLOTS in flight
+    s64 mRefreshTime;
+    SlotTable* mSlots;
     Loop* mLoop;
+    MemoryHub* mHub;
     u32 mMaxTCP;
     TMap<net::NetAddress::ID, String> mPassword;
     String mDefaultPassword;
@@ -155,6 +212,8 @@ private:
 
     void clearSlot(u32 it);
     void clearSlots(RedisClientPool* it);
+
+    bool launchSlots(RedisClientPool* it);
 };
 
 } //namespace net
@@ -39,6 +39,7 @@ class RedisRequest;
 class RedisResponse;
 class RedisClient;
 class RedisClientCluster;
+class RedisCache;
 
 
 /**
@@ -62,6 +63,9 @@ public:
         return mDatabaseID;
     }
 
+    /**
+    * @brief a connection is ready or has room for more commands, the queued tasks are posted to it.
+    */
     void push(RedisClient* it);
 
     const net::NetAddress& getRemoterAddr()const {
@@ -92,12 +96,45 @@ public:
         return mMaxRetry;
     }
 
+    /**
+    * @brief max in-flight commands per connection.
+    */
+    void setMaxPipeline(u32 it) {
+        mMaxPipeline = AppClamp(it, 1U, 64U * 1024U);
+    }
+
+    u32 getMaxPipeline() const {
+        return mMaxPipeline;
+    }
+
     Loop* getLoop()const {
         return mLoop;
     }
 
     bool postTask(RedisCommand* it);
 
+    /**
+    * @brief turn on the client side cache of GET & HGET, call it before open().
+    *        The connections speak RESP3 and turn on CLIENT TRACKING, see RedisCache.
+    * @param maxKeys max keys cached, 0 to turn off.
+    */
+    void setCache(u32 maxKeys);
+
+    RedisCache* getCache()const {
+        return mCache;
+    }
+
+    /**
+    * @brief the pool is to a replica of cluster, the connections send READONLY.
+    */
+    void setReadOnly(bool it) {
+        mReadOnly = it;
+    }
+
+    bool isReadOnly()const {
+        return mReadOnly;
+    }
+
 protected:
     void setPassword(const s8* pass);
 
@@ -107,24 +144,28 @@ protected:
     RedisClient* popIdle();
     void pushIdle(RedisClient* it);
 
+    //@return a ready connection which is not full, round-robin
     RedisClient* pop();
 
 
 private:
     bool mRunning;
+    bool mReadOnly;
     String mPassword;
     s32 mDatabaseID;
     u32 mMaxRetry;
+    u32 mMaxPipeline;
     net::NetAddress mRemoterAddr;
     Loop* mLoop;
     RedisClientCluster* mCluster;
     s32 mMaxTCP;
-    s32 mFlyCount;
+    s32 mFlyCount;  //connecting
     s32 mFailCount;
-    Node2 mAliveQueue;
+    Node2 mAliveQueue; //ready tcp, busy or not
     Node2 mIdleQueue;  //disconnected tcp
     Node2 mTask;
     MemoryHub* mHub;
+    RedisCache* mCache;
 };
 
 } //namespace net
@@ -39,7 +39,7 @@ namespace net {
 class RedisCommand : public Node2 {
 public:
     RedisCommand();
-    ~RedisCommand();
+    virtual ~RedisCommand();
 
     void grab();
 
@@ -132,6 +132,23 @@ public:
         return mRequestSize;
     }
 
+    //@return count of responses of the request buffer if it's a batch, else 0
+    u32 getReplyCount()const {
+        return mReplyCount;
+    }
+
+    //@return bytes of an encoded command, with a tail '\0'
+    static u64 getEncodeSize(u32 argc, const u32* lens);
+
+    /**
+    * @brief encode a command in RESP without printf, the buffer should be >= getEncodeSize().
+    * @return bytes of command, without the tail '\0'
+    */
+    static u32 encode(s8* buf, u64 allsz, u32 argc, const s8** argv, const u32* lens);
+
+    //@return true if the command only reads keys, it can be served by a replica of cluster
+    static bool isReadCommand(const s8* name, u32 len);
+
 protected:
     MemoryHub* mHub;
     RedisClientPool* mPool;
@@ -140,12 +157,35 @@ protected:
     s8* mRequestBuf;
     u32 mRequestSize;
     u32 mRequestCount; //relaunch times
+    u32 mReplyCount;
     u16 mSlot;
+    bool mBatch;       //commands are appended by append() instead of being launched
 
     bool launch(u32 argc, const s8** argv, const u32* lens);
 
     bool launch(u32 slot, u32 argc, const s8** argv, const u32* lens);
 
+    /**
+    * @brief append a command to batch, called by launch() if mBatch.
+    * @param slot hash slot of key, G_NO_SLOT if no key.
+    */
+    virtual bool append(u32 slot, u32 argc, const s8** argv, const u32* lens);
+
+    static const u16 G_NO_SLOT = 0xFFFF;
+
+    //commands encoded in this size are kept in mInline
+    static const u32 G_INLINE_SIZE = 128;
+
+    s8 mInline[G_INLINE_SIZE];
+
+    void releaseRequestBuf();
+
+    void releaseBuf(s8* it) {
+        if (it != mInline) {
+            mHub->release(it);
+        }
+    }
+
     bool isClusterMode()const {
         return nullptr != mCluster;
     }
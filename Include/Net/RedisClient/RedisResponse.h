@@ -44,9 +44,62 @@ enum ERedisResultType {
     ERRT_STRING = '+',
     ERRT_BULK_STR = '$',
     ERRT_INT = ':',
-    ERRT_ARRAY = '*'
+    ERRT_ARRAY = '*',
+
+    //RESP3, "_" is decoded as ERRT_NIL, "!" as ERRT_ERROR, "=" as ERRT_BULK_STR
+    ERRT_BOOL = '#',
+    ERRT_DOUBLE = ',',      //string of double, see getF64()
+    ERRT_BIG_NUM = '(',     //string of big number
+    ERRT_MAP = '%',         //nodes of key & value in turn
+    ERRT_SET = '~',
+    ERRT_PUSH = '>'         //out of band message, eg: invalidate of CLIENT TRACKING
 };
 
+/**
+ * @brief find the end of a reply in stream, the reply may be received by many reads.
+ *        The scanned part is not scanned again, bulk strings are skipped by size.
+ */
+class RedisScanner {
+public:
+    RedisScanner() {
+        reset();
+    }
+
+    void reset() {
+        mPos = 0;
+        mNodes = 0;
+        mDepth = 0;
+        mAttribute = 0;
+        mError = false;
+    }
+
+    /**
+    * @param str start of the reply, includes the bytes given by the previous calls.
+    * @return size of the reply if all of it is received, else 0.
+    */
+    u64 scan(const s8* str, u64 len);
+
+    //@return count of nodes of the reply, valid if scan() succeed
+    u32 getNodeCount()const {
+        return mNodes;
+    }
+
+    //@return true if the stream is not RESP
+    bool isError()const {
+        return mError;
+    }
+
+private:
+    static const u32 G_MAX_DEPTH = 16;
+    u64 mPos;                   //scanned bytes from the start of reply
+    u32 mNodes;
+    u32 mDepth;
+    s64 mLeft[G_MAX_DEPTH];     //nodes left of the arrays being scanned
+    u32 mAttribute;             //bit i is set if the array at depth i is an attribute
+    bool mError;
+};
+
+
 class RedisResponse {
 public:
     union SRedisValue {
@@ -74,6 +127,15 @@ public:
         return mValue.mVal64;
     }
 
+    f64 getF64()const {
+        return ERRT_DOUBLE == mType ? strtod(mValue.mValStr, nullptr) : static_cast<f64>(mValue.mVal64);
+    }
+
+    //@return true if it's an array, map, set or push message
+    bool isAggregate()const {
+        return ERRT_ARRAY == mType || ERRT_MAP == mType || ERRT_SET == mType || ERRT_PUSH == mType;
+    }
+
     bool isFinished()const {
         return EDS_DONE == mStatus;
     }
@@ -83,38 +145,64 @@ public:
     }
 
     bool isOK()const {
-        return (ERRT_STRING == mType && mValue.mValStr
+        return (ERRT_STRING == mType && mValue.mValStr && mUsed >= 2
             && (*(u16*)mValue.mValStr) == *(u16*)("OK"));
     }
 
     //eg: MOVED 153 127.0.0.1:3292
     bool isMoved() const {
-        return (ERRT_ERROR == mType && mValue.mValStr
+        return (ERRT_ERROR == mType && mValue.mValStr && mUsed >= 6
             && (*(u32*)mValue.mValStr) == *(u32*)("MOVE")
             && (*(u16*)(mValue.mValStr + sizeof(u32))) == *(u16*)("D "));
     }
 
     //eg: ASK 153 127.0.0.1:3292
     bool isAsk() const {
-        return (ERRT_ERROR == mType && mValue.mValStr
+        return (ERRT_ERROR == mType && mValue.mValStr && mUsed >= 4
             && (*(u32*)mValue.mValStr) == *(u32*)("ASK "));
     }
 
     /**
-    * @brief decode a item in stream.
+    * @brief decode a whole reply found by RedisScanner, all of the nodes are in one arena.
+    *        Strings are views into \p str, the '\r' behind each string is replaced by '\0',
+    *        so \p str should be kept till the reply is released, or call own().
     * eg: stream is "+OK\r\n" or "$3\r\nabc\r\n"
-    *     \p str point to the start of stream.
-    *     \p len the position of stream's last '\n'(position start at 0).
-    * @return the end position;
+    * @param len size of reply, returned by RedisScanner::scan().
+    * @param nodes count of nodes, returned by RedisScanner::getNodeCount().
+    */
+    void decode(s8* str, u64 len, u32 nodes);
+
+    //@brief copy the strings viewed by a decoded reply, then the stream can be released.
+    void own();
+
+    /**
+    * @brief make a string or nil which views \p str, eg: a value in RedisCache.
+    * @param str should be ended by '\0'
     */
-    const s8* import(const s8* str, u64 len);
+    void makeView(u8 type, const s8* str, u32 len);
 
     void show(u32 level = 1, u32 index = 1)const;
 
     void makeError(const s8* str);
 
+    /**
+    * @brief make an array of \p cnt empty results, it's finished when all of them are set.
+    */
+    void makeArray(u32 cnt);
+
+    /**
+    * @brief set a result of the array made by makeArray().
+    * @param it allocated in the same hub, it's owned by this array now.
+    */
+    void setResult(u32 idx, RedisResponse* it);
+
+    /**
+    * @brief detach a result from the array made by makeArray(), the caller owns it.
+    */
+    RedisResponse* takeResult(u32 idx);
+
     RedisResponse* getResult(u32 idx)const {
-        if (ERRT_ARRAY != mType || EDS_DONE != mStatus || nullptr == mValue.mNodes) {
+        if (!isAggregate() || EDS_DONE != mStatus || nullptr == mValue.mNodes) {
             return nullptr;
         }
         if (idx < mAllocated) {
@@ -124,17 +212,22 @@ public:
     }
 
 private:
-    bool decodeSize(const s8 ch);
+    s8* mArena;     //child nodes of a decoded reply
+    s8* mStore;     //strings copied by own()
+    bool mView;     //mValue is not owned by this node, it's in stream or arena
+
+    //@brief a node in arena of a decoded reply, it doesn't grab the hub
+    RedisResponse(MemoryHub& it, bool view);
+
+    s8* decodeNode(s8* str, RedisResponse*& nodes, RedisResponse**& slots);
+
+    u64 getViewSize()const;
+
+    s8* copyView(s8* pos);
 
     enum EDecodeStatus {
         EDS_INIT = 0,
-        EDS_INT,
-        EDS_ARRAY,
-        EDS_ARRAY_SIZE,
-        EDS_STR,
-        EDS_BULK_STR,
-        EDS_BULK_SIZE,
-        //EDS_TAIL,   // "\r\n"
+        EDS_ARRAY,  //made by makeArray(), waiting results
         EDS_DONE = 0xFF
     };
 
@@ -0,0 +1,253 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+
+#ifndef APP_REDISSUBSCRIBER_H
+#define	APP_REDISSUBSCRIBER_H
+
+#include "TVector.h"
+#include "Loop.h"
+#include "Net/NetAddress.h"
+#include "Net/HandleTCP.h"
+#include "Net/RedisClient/RedisResponse.h"
+
+struct lua_State;
+
+namespace app {
+class MemoryHub;
+
+namespace net {
+
+/**
+* @brief callback of a message.
+* @param channel the channel of message, not the pattern.
+*/
+typedef void(*AppRedisSubCaller)(void* user, const StringView& channel, const StringView& msg);
+
+/**
+ * @brief a long-lived connection for SUBSCRIBE & PSUBSCRIBE.
+ *        The messages of a read are decoded in place, then dispatched to the listeners of their
+ *        channels, which are found by a hash table. A lost connection is retried by a timer with
+ *        a doubled delay, till close() or a failed AUTH, and the channels are subscribed again after
+ *        reconnected. A listener is a C++ function, or a Lua function by reference of registry,
+ *        which is called as: func(channel, msg).
+ */
+class RedisSubscriber {
+public:
+    RedisSubscriber(Loop* loop);
+
+    ~RedisSubscriber();
+
+    //@return EE_OK if connecting, or else it's not running.
+    s32 open(const net::NetAddress& addr, const s8* passowrd = nullptr);
+
+    //@brief stop reconnecting and close the connection, see isClosed().
+    s32 close();
+
+    /**
+    * @brief add a listener, SUBSCRIBE is sent if it's the first one of channel.
+    * @param pattern true to PSUBSCRIBE.
+    */
+    bool subscribe(const StringView& channel, AppRedisSubCaller func, void* user, bool pattern = false);
+
+    /**
+    * @param ref reference of a Lua function by luaL_ref(vm, LUA_REGISTRYINDEX), it's
+    *        unreferenced by unsubscribe().
+    */
+    bool subscribe(const StringView& channel, lua_State* vm, s32 ref, bool pattern = false);
+
+    //@brief drop all listeners of channel
+    void unsubscribe(const StringView& channel, bool pattern = false);
+
+    //@return true if the channels are subscribed
+    bool isReady()const {
+        return 4 == mStatus;
+    }
+
+    //@return false if stopped by close() or a failed AUTH.
+    bool isRunning()const {
+        return mRunning;
+    }
+
+    //@return true if the connection and the retry timer are closed, it's safe to delete this.
+    bool isClosed()const {
+        return 0 == mStatus && !mWaiting;
+    }
+
+    //@return count of reconnections since the channels were subscribed last time.
+    u32 getRetryCount()const {
+        return mRetry;
+    }
+
+    u32 getChannelCount()const {
+        return mCount;
+    }
+
+    u64 getMessageCount()const {
+        return mMessages;
+    }
+
+    const net::NetAddress& getRemoterAddr()const {
+        return mTCP.getRemote();
+    }
+
+private:
+    static const u32 G_READ_SIZE = 4 * 1024;
+    static const s64 G_RETRY_DELAY = 100;       //ms, doubled after each failed reconnection
+    static const s64 G_MAX_RETRY_DELAY = 10 * 1000;
+
+    struct Listener {
+        AppRedisSubCaller mFunc;
+        void* mUser;
+        lua_State* mVM;
+        s32 mRef;
+    };
+
+    struct Channel {
+        Channel* mChain;    //in bucket
+        u64 mHash;
+        String mName;
+        bool mPattern;
+        TVector<Listener> mListeners;
+    };
+
+    //a message of this read, dispatched after all of the read is decoded
+    struct Event {
+        Channel* mChannel;
+        StringView mName;
+        StringView mMsg;
+    };
+
+    //0=closed, 1=connecting, 2=auth, 4=ready
+    s32 mStatus;
+    u32 mRetry;
+    u32 mKept;              //bytes of a partial message kept at head of read buffer
+    bool mRunning;
+    bool mWaiting;          //mRetryTime is opened
+    bool mActive;           //data received since last timeout check
+    bool mPinged;
+    u32 mMask;
+    u32 mCount;
+    u64 mMessages;
+    Channel** mBuckets;
+    TVector<Event> mEvents;
+    TVector<Channel*> mDead;    //removed while dispatching
+    bool mDispatching;
+    String mPassword;
+    Loop* mLoop;
+    MemoryHub* mHub;
+    RedisResponse* mResult;
+    RedisScanner mScanner;
+    net::HandleTCP mTCP;
+    HandleTime mRetryTime;
+
+    s32 onTimeout(HandleTime& it);
+
+    s32 onRetry(HandleTime& it);
+
+    void onRetryClose(Handle* it);
+
+    //@brief reconnect after a delay by mRetryTime
+    void retry();
+
+    void onClose(Handle* it);
+
+    void onConnect(RequestFD* it);
+
+    void onWrite(RequestFD* it);
+
+    void onRead(RequestFD* it);
+
+    s32 connect();
+
+    //@brief collect a message of mResult into mEvents
+    void onMessage();
+
+    void dispatch();
+
+    void call(const Listener& it, const StringView& channel, const StringView& msg);
+
+    //@brief SUBSCRIBE & PSUBSCRIBE all channels after connected
+    void launchAll();
+
+    void launch(const s8* cmd, u32 clen, const StringView& channel);
+
+    bool writeCommand(u32 argc, const s8** argv, const u32* lens);
+
+    RequestFD* keepTail(RequestFD* it, const s8* pos);
+
+    Channel* findChannel(const StringView& name, bool pattern, u64 hash, Channel*** prev);
+
+    Channel* addChannel(const StringView& name, bool pattern);
+
+    void releaseListener(Listener& it);
+
+    void resize();
+
+    static u64 getHash(const StringView& name, bool pattern);
+
+    static s32 funcOnTime(HandleTime* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->getUser();
+        return nd.onTimeout(*it);
+    }
+
+    static s32 funcOnRetry(HandleTime* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->getUser();
+        return nd.onRetry(*it);
+    }
+
+    static void funcOnRetryClose(Handle* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->getUser();
+        nd.onRetryClose(it);
+    }
+
+    static void funcOnWrite(RequestFD* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->mUser;
+        nd.onWrite(it);
+    }
+
+    static void funcOnRead(RequestFD* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->mUser;
+        nd.onRead(it);
+    }
+
+    static void funcOnConnect(RequestFD* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->mUser;
+        nd.onConnect(it);
+    }
+
+    static void funcOnClose(Handle* it) {
+        RedisSubscriber& nd = *(RedisSubscriber*)it->getUser();
+        nd.onClose(it);
+    }
+
+    RedisSubscriber(const RedisSubscriber&) = delete;
+    const RedisSubscriber& operator=(const RedisSubscriber&) = delete;
+};
+
+} //namespace net
+} //namespace app
+
+#endif //APP_REDISSUBSCRIBER_H
@@ -253,6 +253,12 @@ public:
 
     s32 send(const void* iBuffer, s32 iSize);
 
+    /**
+    *@brief Send a record of TLS control message(handshake, alert) if kernel TLS is on.
+    *@param recordType TLS record type.
+    */
+    s32 sendRecord(u8 recordType, const void* iBuffer, s32 iSize);
+
     /**
     *@brief Send in a loop, if using nonblock socket.
     */
@@ -113,16 +113,27 @@ private:
     u8 mType;
     Loop& mLoop;
     TcpProxyHub* mHub;
+    s32 mBackend; //index of backend in hub, -1 if not picked
+    bool mConnected;
     net::HandleTLS mTLS;
     net::HandleTLS mTLS2; //backend
 };
 
 
 
+/**
+ * @brief a listener of TcpProxy, it picks a backend for each connection by weighted least
+ *        connections or consistent hashing of client IP. Backends are checked by TCP connect
+ *        on a timer, and ejected after some connect failures in a row.
+ */
 class TcpProxyHub :public RefCount {
 public:
-    TcpProxyHub(EngineConfig::ProxyCfg& cfg) :mConfig(cfg) { }
-    virtual ~TcpProxyHub() { }
+    TcpProxyHub(EngineConfig::ProxyCfg& cfg);
+
+    virtual ~TcpProxyHub();
+
+    //@brief start the timer of health check, the hub is grabbed until the timer closed.
+    s32 open(Loop& loop);
 
     static void funcOnLink(RequestFD* it) {
         TcpProxy* con = new TcpProxy(*it->mHandle->getLoop());
@@ -134,8 +145,100 @@ public:
         return mConfig;
     }
 
+    /**
+     * @brief pick a backend for a new connection, the link count of it is increased.
+     *        call release() when the connection is closed.
+     * @param client address of client.
+     * @return index of backend, or -1 if all backends are ejected.
+     */
+    s32 pick(const NetAddress& client);
+
+    const NetAddress& getBackend(s32 idx)const {
+        return mBackends[idx]->mAddress;
+    }
+
+    //@brief report the result of connecting to backend, for passive ejection.
+    void onConnect(s32 idx, bool success);
+
+    void release(s32 idx) {
+        DASSERT(mBackends[idx]->mLinks > 0);
+        --mBackends[idx]->mLinks;
+    }
+
 private:
+    struct Backend {
+        NetAddress mAddress;
+        u32 mWeight;
+        u32 mLinks;     //active connections
+        u32 mFails;     //connect failures in a row
+        s64 mEjectTime; //ejected until this time, 0 if alive
+        bool mProbing;
+        Backend() : mWeight(1), mLinks(0), mFails(0), mEjectTime(0), mProbing(false) { }
+    };
+
+    //a virtual node of consistent hash ring
+    struct RingNode {
+        u32 mHash;
+        u32 mIndex;
+        bool operator<(const RingNode& it)const {
+            return mHash < it.mHash;
+        }
+        bool operator>(const RingNode& it)const {
+            return mHash > it.mHash;
+        }
+        bool operator==(const RingNode& it)const {
+            return mHash == it.mHash;
+        }
+    };
+
+    //a TCP connect to check a backend
+    struct Probe {
+        TcpProxyHub* mHub;
+        u32 mIndex;
+        HandleTCP mTCP;
+    };
+
+    bool isAlive(const Backend& it)const {
+        return 0 == it.mEjectTime || mLoop->getTime() >= it.mEjectTime;
+    }
+
+    void eject(u32 idx);
+
+    void probe(u32 idx);
+
+    void onProbe(Probe& pb, RequestFD* it);
+
+    s32 onTimeout(HandleTime& it);
+
+    void onCloseTime(Handle* it);
+
+    static s32 funcOnTime(HandleTime* it) {
+        TcpProxyHub& nd = *(TcpProxyHub*)it->getUser();
+        return nd.onTimeout(*it);
+    }
+
+    static void funcOnCloseTime(Handle* it) {
+        TcpProxyHub& nd = *(TcpProxyHub*)it->getUser();
+        nd.onCloseTime(it);
+    }
+
+    static s32 funcOnProbeTime(HandleTime* it) {
+        return EE_ERROR; //timeout of connecting, close it
+    }
+
+    static void funcOnProbe(RequestFD* it) {
+        Probe& pb = *(Probe*)it->mUser;
+        pb.mHub->onProbe(pb, it);
+    }
+
+    static void funcOnCloseProbe(Handle* it);
+
     EngineConfig::ProxyCfg mConfig;
+    Loop* mLoop;
+    HandleTime mTime;
+    TVector<Backend*> mBackends;
+    TVector<RingNode> mRing;
+    u32 mNext; //for least connections
 };
 
 } //namespace net
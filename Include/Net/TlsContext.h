@@ -31,6 +31,8 @@
 namespace app {
 namespace net {
 
+class TlsSessionCache;
+
 // call once
 void AppInitTlsLib();
 // call once
@@ -64,6 +66,53 @@ public:
 
     s32 setPrivateKey(const s8* key, usz length);
 
+    /**
+     * @brief set protocols of server side ALPN, by order of preference.
+     * @param protos wire format, eg: "\x02h2\x08http/1.1"
+     */
+    s32 setALPN(const s8* protos, usz length);
+
+    /**
+     * @brief share sessions and ticket keys of server side with other processes.
+     * @param cache shared cache, nullptr to keep the cache of OpenSSL.
+     * @param sidCtx session id context, sessions are resumed in same context only.
+     */
+    s32 setSessionCache(TlsSessionCache* cache, const s8* sidCtx, usz length);
+
+    TlsSessionCache* getSessionCache()const {
+        return mSessionCache;
+    }
+
+    /**
+     * @brief hand over the encryption of sending to kernel(kTLS) after handshake,
+     *        then the plaintext is written to socket directly. A connection falls back
+     *        to OpenSSL if the kernel module or the cipher is not available.
+     * @return EE_OK if kTLS is supported by this build, else EE_ERROR.
+     */
+    s32 setKTLS(bool on);
+
+    bool isKTLS()const {
+        return mKTLS;
+    }
+
+    /**
+     * @brief run the CPU heavy handshake steps of server in ThreadPool, so the loop is not
+     *        stalled by a storm of handshakes, the connection goes on in its loop when done.
+     * @param maxJobs max handshakes in ThreadPool at once, more are run in loop, 0=all in loop.
+     */
+    void setHandshakePool(u32 maxJobs) {
+        mPoolJobs = maxJobs;
+    }
+
+    u32 getHandshakePool()const {
+        return mPoolJobs;
+    }
+
+    const s8* getALPN(u32& length)const {
+        length = mALPNSize;
+        return mALPN;
+    }
+
     s32 getVerifyFlags()const {
         return mVerifyFlags;
     }
@@ -74,7 +123,12 @@ public:
 
 private:
     void* mTlsContext;  // SSL_CTX
+    TlsSessionCache* mSessionCache;
     s32 mVerifyFlags;
+    u32 mALPNSize;
+    u32 mPoolJobs;
+    bool mKTLS;
+    s8 mALPN[64];
 };
 
 
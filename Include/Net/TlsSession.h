@@ -38,9 +38,16 @@
 #include <openssl/bio.h>
 #include <openssl/x509v3.h>
 
+//kernel TLS of sending, OpenSSL passes the keys to BIO when the write keys change
+#if defined(DOS_LINUX) && !defined(OPENSSL_NO_KTLS) && (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+#define DUSE_KTLS
+#endif
+
 namespace app {
 namespace net {
 
+class Socket;
+
 class TlsSession {
 public:
     static void showError();
@@ -64,6 +71,15 @@ public:
 
     s32 write(const void* buf, s32 len);
 
+    /**
+     * @brief dynamic record sizing: a new or idle connection gets small records which fit in
+     *        one TCP segment, so the peer can decrypt the first bytes without waiting for a
+     *        whole 16KB record; full records are used once enough bytes are sent.
+     * @param now current time in milliseconds
+     * @return max bytes of plaintext for the next record.
+     */
+    u32 getRecordSize(s64 now);
+
     s32 read(void* buf, s32 len);
 
     s32 getError(s32 nread)const;
@@ -74,10 +90,88 @@ public:
 
     s32 verify(s32 verify_flags, const s8* hostname);
 
+    //@return the protocol selected by ALPN, empty if none
+    StringView getALPN()const;
+
+    /**
+     * @brief allow kernel TLS(kTLS) of sending on sock.
+     * @param sock nullptr to disable.
+     */
+    void setKTLS(Socket* sock) {
+        mSock = sock;
+    }
+
+    //@return true if OpenSSL hands the sending over to kernel, the output buffer gets plaintext from now on.
+    bool isKTLS()const {
+        return mKTLS;
+    }
+
+    /**
+     * @brief called by BIO of output when OpenSSL hands over the write keys.
+     *        The bytes already buffered must reach the socket before the kernel starts to encrypt,
+     *        so the keys are kept until they are sent, @see commitSend().
+     * @return 1 if the kernel takes over, else 0 and OpenSSL encrypts as usual.
+     */
+    s32 startKTLS(const void* cryptoInfo);
+
+    /**
+     * @brief buffer a record of TLS control message(handshake, alert) for kernel TLS,
+     *        it is sent alone with its record type in order, @see getSendLimit().
+     * @return bytes buffered, or -1 if failed.
+     */
+    s32 writeRecord(u8 recordType, const void* buf, s32 len);
+
+    void setRecordType(u8 tp) {
+        mRecordType = tp;
+    }
+
+    u8 getRecordType()const {
+        return mRecordType;
+    }
+
+    /**
+     * @brief the head of output buffer may be a segment which must be sent by one write.
+     * @param recordType the TLS record type of the segment, 0=as is.
+     * @return max bytes of the next write.
+     */
+    s32 getSendLimit(u8& recordType)const;
+
+    /**
+     * @brief called when bytes of output buffer are sent, the kept keys are passed to kernel
+     *        once the bytes before them are sent.
+     * @return EE_OK if success, else the connection must be closed.
+     */
+    s32 commitSend(s32 size);
+
 private:
     SSL* mSSL;
     BIO* mInBIO;
     BIO* mOutBIO;
+    RingBuffer* mOutBuffers;
+    Socket* mSock;          //not null if kTLS allowed
+    s64 mWriteTime;         //time of last record in milliseconds
+    u32 mWriteSize;         //bytes sent in small records
+    //bytes at head of output buffer, which can't be coalesced with others
+    struct STlsSegment {
+        s32 mSize;
+        u8 mRecordType;     //0=as is, else record type sent by kTLS
+        bool mKeyAfter;     //pass the keys to kernel after this segment is sent
+    };
+    static const u32 G_MAX_SEGMENTS = 8;
+
+    bool pushSegment(s32 size, u8 recordType, bool keyAfter);
+
+    //@return EE_OK if the kept keys are passed to kernel
+    s32 installKTLS();
+
+    STlsSegment mSegments[G_MAX_SEGMENTS];
+    u32 mSegmentHead;
+    u32 mSegmentCount;
+    s32 mSegmentBytes;      //bytes of all segments
+    u32 mCryptoSize;        //size of kept keys, 0=none
+    u8 mCryptoInfo[64];     //struct tls12_crypto_info_xxx
+    u8 mRecordType;         //record type of next write when kTLS, 0=application data
+    bool mKTLS;
 };
 
 }//namespace net
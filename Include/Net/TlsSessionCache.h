@@ -0,0 +1,126 @@
+#ifndef APP_TLSSESSIONCACHE_H
+#define APP_TLSSESSIONCACHE_H
+
+#include "Nocopy.h"
+#include "Spinlock.h"
+#include "Packet.h"
+#include "MemSlabPool.h"
+
+namespace app {
+namespace net {
+
+struct TlsCacheNode;
+
+//keys of session ticket, RFC 5077
+struct TlsTicketKey {
+    u8 mName[16];
+    u8 mAES[32];
+    u8 mHMAC[32];
+};
+
+struct TlsCacheStats {
+    u64 mHits;          //sessions found by id
+    u64 mMisses;        //sessions not found or expired
+    u64 mStores;
+    u64 mEvicts;        //sessions removed for room
+    u64 mTicketNew;     //tickets issued
+    u64 mTicketHits;    //tickets with a known key
+    u64 mTicketMisses;  //tickets with unknown or expired key
+};
+
+/**
+ * @brief TLS session cache of all processes, it lives in the shared memory of Engine,
+ *        sessions are serialized into the MemSlabPool, so any child process can resume
+ *        the session of others. The keys of session ticket are kept here too, and rotated
+ *        by time, so a ticket issued by one process can be decrypted by others.
+ * @note pointers in shared memory are used as is, like MemSlabPool, so the processes
+ *       must map the shared memory at same address(fork).
+ */
+class TlsSessionCache : public Nocopy {
+public:
+    /**
+     * @brief create the cache in pool, called by main process before fork.
+     * @param maxCount max sessions, 0=disable session cache
+     * @param timeout session timeout in seconds
+     * @param ticketTime rotate interval of ticket keys in seconds, 0=disable shared tickets
+     * @return nullptr if both are disabled or no memory.
+     */
+    static TlsSessionCache* create(MemSlabPool& pool, u32 maxCount, u32 timeout, u32 ticketTime);
+
+    /**
+     * @param sid session id
+     * @param data serialized session
+     * @param expire timestamp in seconds
+     */
+    void add(const u8* sid, u32 sidLen, const u8* data, u32 dataLen, s64 expire);
+
+    /**
+     * @brief copy the serialized session to out.
+     * @return true if hit, else false.
+     */
+    bool get(const u8* sid, u32 sidLen, Packet& out);
+
+    void remove(const u8* sid, u32 sidLen);
+
+    /**
+     * @brief get the current key to encrypt a new ticket, the keys are rotated here.
+     * @return false if shared tickets are disabled.
+     */
+    bool getTicketKey(TlsTicketKey& out);
+
+    /**
+     * @brief find the key to decrypt a ticket.
+     * @return 0 if not found, 1 if found, 2 if found but the ticket should be renewed.
+     */
+    s32 findTicketKey(const u8* name, TlsTicketKey& out);
+
+    void getStats(TlsCacheStats& out);
+
+    u32 getMaxCount()const {
+        return mMaxCount;
+    }
+
+    u32 getCount()const {
+        return mCount;
+    }
+
+    u32 getTimeout()const {
+        return mTimeout;
+    }
+
+    bool hasTicket()const {
+        return mTicketTime > 0;
+    }
+
+private:
+    TlsSessionCache(MemSlabPool& pool, TlsCacheNode** buckets, u32 bucketCount, u32 maxCount, u32 timeout, u32 ticketTime);
+
+    ~TlsSessionCache() { }
+
+    TlsCacheNode* find(const u8* sid, u32 sidLen, u32 hash)const;
+
+    //@brief remove node from hash bucket and LRU list, then free it.
+    void unlink(TlsCacheNode* nd);
+
+    bool rotateKey(s64 now);
+
+    Spinlock mLock;
+    MemSlabPool& mPool;
+    TlsCacheNode** mBuckets;
+    TlsCacheNode* mHead;    //LRU list, mHead is the newest
+    TlsCacheNode* mTail;
+    u32 mBucketCount;       //power of 2
+    u32 mCount;
+    u32 mMaxCount;
+    u32 mTimeout;
+    u32 mTicketTime;
+    u32 mKeyCount;          //valid keys in mKeys
+    s64 mKeyTime;           //timestamp of mKeys[0]
+    TlsTicketKey mKeys[2];  //mKeys[0]=current, mKeys[1]=previous
+    TlsCacheStats mStats;
+};
+
+}//namespace net
+}//namespace app
+
+#endif //APP_TLSSESSIONCACHE_H
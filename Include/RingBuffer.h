@@ -125,8 +125,9 @@ public:
 
     /**
     * @brief peek data bufs when reading.
+    * @param max_size max bytes of all bufs.
     */
-    SRingBufPos peekHeadNode(SRingBufPos pos, StringView* bufs, s32* bufs_count);
+    SRingBufPos peekHeadNode(SRingBufPos pos, StringView* bufs, s32* bufs_count, s32 max_size = 0x7FFFFFFF);
 
     /**
     * @param pos readed position of peeked head cache before.
@@ -319,6 +319,8 @@ public:
         if (&it != this) {
             if (it.isAllocated()) {
                 setBuffer(it.mBuffer);
+                mAllocated = it.mAllocated;
+                mLen = it.mLen;
                 it.mBuffer = reinterpret_cast<T*>(&it.mAllocated);
                 it.mAllocated = 0;
                 it.mLen = 0;
@@ -122,6 +122,13 @@ public:
 
     static u64 getTimeStr(s8* cache, usz cacheSize, const s8* format = "%Y-%m-%d %H:%M:%S");
     static u64 getTimeStr(wchar_t* cache, usz cacheSize, const wchar_t* format = L"%Y-%m-%d %H:%M:%S");
+
+    /**
+    *@brief Get time as GMT string, eg: "Sat, 11 Mar 2017 21:49:51 GMT", used by http headers.
+    *@param iTime timestamp in seconds.
+    *@return len of output str.
+    */
+    static u64 getTimeStrGMT(s64 iTime, s8* cache, usz cacheSize, const s8* format = "%a, %d %b %Y %H:%M:%S GMT");
 };
 
 } // end namespace app
@@ -14,6 +14,21 @@ public:
         clear();
     }
 
+    ~EncoderGzip() {
+        deflateEnd(&mStream);
+    }
+
+    /**
+     * @brief reuse the deflate stream for next message without realloc the window.
+     */
+    void reset() {
+        mStream.avail_in = 0;
+        mStream.next_in = nullptr;
+        mStream.avail_out = 0;
+        mStream.next_out = nullptr;
+        deflateReset(&mStream);
+    }
+
     void clear() {
         mStream.zalloc = nullptr;
         mStream.zfree = nullptr;
@@ -84,6 +99,27 @@ public:
         output.resize(usedsz);
     }
 
+    /**
+     * @brief set input for streaming compress, see compressTo()
+     */
+    void setInput(const s8* data, usz size) {
+        mStream.next_in = reinterpret_cast<z_const Bytef*>(data);
+        mStream.avail_in = static_cast<u32>(size);
+    }
+
+    /**
+     * @brief streaming compress the input into a caller buffer.
+     *        call it again while the return value is equal to osz.
+     * @param flush Z_NO_FLUSH, Z_SYNC_FLUSH, or Z_FINISH at the end of stream
+     * @return bytes wrote into out
+     */
+    usz compressTo(s8* out, usz osz, s32 flush) {
+        mStream.next_out = reinterpret_cast<Bytef*>(out);
+        mStream.avail_out = static_cast<u32>(osz);
+        deflate(&mStream, flush);
+        return osz - mStream.avail_out;
+    }
+
     template <typename T>
     void finish(T& output) {
         usz usedsz = output.size();
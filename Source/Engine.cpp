@@ -189,6 +189,8 @@ bool Engine::init(const s8* fname, bool child) {
         new (&mpool) MemSlabPool(getMemSlabPoolSize()); // mpool.initSlabSize();
         // mpool.mLock.tryUnlock();  TODO clear lock when ...
         getEngineStats().clear();
+        reinterpret_cast<EngineData*>(mMapfile.getMem())->mTlsCache = net::TlsSessionCache::create(
+            mpool, mConfig.mTlsCacheSize, mConfig.mTlsCacheTime, mConfig.mTlsTicketTime);
 
         System::removeFile(mConfig.mPidFile.c_str());
         FileWriter file;
@@ -245,6 +247,17 @@ bool Engine::uninit() {
             Logger::log(ELL_INFO, "Engine::uninit>>share mem[%u][used/total=%lu/%lu, req=%lu, fail=%lu]", i,
                 mstat.mUsed, mstat.mTotal, mstat.mRequests, mstat.mFails);
         }
+
+        net::TlsSessionCache* tcache = getTlsSessionCache();
+        if (tcache) {
+            net::TlsCacheStats tstat;
+            tcache->getStats(tstat);
+            Logger::log(ELL_INFO,
+                "Engine::uninit>>tls cache[count=%u, hit=%lu, miss=%lu, store=%lu, evict=%lu], "
+                "ticket[new=%lu, hit=%lu, miss=%lu]",
+                tcache->getCount(), tstat.mHits, tstat.mMisses, tstat.mStores, tstat.mEvicts, tstat.mTicketNew,
+                tstat.mTicketHits, tstat.mTicketMisses);
+        }
     }
     Logger::log(ELL_INFO, "Engine::uninit>>pid = %d, main = %c, script=%llu", mPID, mMain ? 'Y' : 'N',
         script::ScriptManager::getInstance().getMemory());
@@ -414,8 +427,9 @@ void Engine::initTask() {
         nd->setTimeout(mConfig.mProxy[i].mTimeout);
         nd->setBackend(mConfig.mProxy[i].mRemote);
         if (0 == nd->open(mConfig.mProxy[i].mLocal)) {
-            Logger::log(ELL_INFO, "Engine::init>>start TcpProxy=[%s->%s]", mConfig.mProxy[i].mLocal.getStr(),
-                mConfig.mProxy[i].mRemote.getStr());
+            pxhub->open(mLoop);
+            Logger::log(ELL_INFO, "Engine::init>>start TcpProxy=[%s->%s], backends=%llu", mConfig.mProxy[i].mLocal.getStr(),
+                mConfig.mProxy[i].mRemote.getStr(), (u64)mConfig.mProxy[i].mBackend.size());
         } else {
             Logger::log(ELL_ERROR, "Engine::init>>fail TcpProxy=[%s->%s]", mConfig.mProxy[i].mLocal.getStr(),
                 mConfig.mProxy[i].mRemote.getStr());
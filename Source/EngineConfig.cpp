@@ -34,32 +34,23 @@
 
 namespace app {
 
-static u64 hashCallback(const void* key) {
-    const String& str = *reinterpret_cast<const String*>(key);
-    return AppHashSIP(str.c_str(), str.getLen());
+static u64 hashViewCallback(const void* key) {
+    const StringView& str = *reinterpret_cast<const StringView*>(key);
+    return AppHashSIP(str.mData, str.mLen);
 }
 
-static bool compareCallback(void* iUserData, const void* key1, const void* key2) {
-    return (*reinterpret_cast<const String*>(key1)) == (*reinterpret_cast<const String*>(key2));
+static bool compareViewCallback(void* iUserData, const void* key1, const void* key2) {
+    return (*reinterpret_cast<const StringView*>(key1)) == (*reinterpret_cast<const StringView*>(key2));
 }
 
-static void freeCallback(void* iUserData, void* val) {
-    String* it = reinterpret_cast<String*>(val);
-    delete it;
-}
-
-static void* keyValueDump(void* iUserData, const void* kval) {
-    String* ret = new String(*reinterpret_cast<const String*>(kval));
-    return ret;
-}
-
-static DictFunctions gDictCalls = {
-    hashCallback,
-    keyValueDump,
-    keyValueDump,
-    compareCallback,
-    freeCallback,
-    freeCallback
+//key=StringView, value=cached node, both are owned by site cache.
+static DictFunctions gCacheCalls = {
+    hashViewCallback,
+    nullptr,
+    nullptr,
+    compareViewCallback,
+    nullptr,
+    nullptr
 };
 
 
@@ -71,6 +62,9 @@ EngineConfig::EngineConfig() :
     mMaxThread(3),
     mMaxProcess(0),
     mMemSize(1024 * 1024 * 1),
+    mTlsCacheSize(4096),
+    mTlsCacheTime(300),
+    mTlsTicketTime(3600),
     mLogPath("Log/"),
     mPidFile("Log/PID.txt"),
     mMemName("GMAP/MainMem.map") {
@@ -102,6 +96,9 @@ bool EngineConfig::save(const String& cfg) {
     val["AcceptPost"] = mMaxPostAccept;
     val["ThreadPool"] = mMaxThread;
     val["Process"] = mMaxProcess;
+    val["TlsCache"] = mTlsCacheSize;
+    val["TlsCacheTime"] = mTlsCacheTime;
+    val["TlsTicketTime"] = mTlsTicketTime;
 
     Json::StreamWriterBuilder builder;
     builder["emitUTF8"] = true;
@@ -152,6 +149,9 @@ bool EngineConfig::load(const String& runPath, const String& cfg, bool mainProce
         mMaxPostAccept = AppClamp<u8>(val["AcceptPost"].asInt(), 1, 255);
         mMaxThread = AppClamp<u8>(val["ThreadPool"].asInt(), 1, 255);
         mMaxProcess = AppClamp<s16>(val["Process"].asInt(), -1024, 1024);
+        mTlsCacheSize = AppClamp<u32>(val.get("TlsCache", mTlsCacheSize).asUInt(), 0, 1024 * 1024);
+        mTlsCacheTime = AppClamp<u32>(val.get("TlsCacheTime", mTlsCacheTime).asUInt(), 1, 24 * 3600);
+        mTlsTicketTime = AppClamp<u32>(val.get("TlsTicketTime", mTlsTicketTime).asUInt(), 0, 24 * 3600);
 
         if (val.isMember("Proxy")) {
             ProxyCfg nd;
@@ -161,7 +161,35 @@ bool EngineConfig::load(const String& runPath, const String& cfg, bool mainProce
                 nd.mSpeed = (u32)val["Proxy"][i]["MaxSpeed"].asInt();
                 nd.mTimeout = 1000 * AppClamp<u32>(val["Proxy"][i]["Timeout"].asInt(), 0, 3600);
                 nd.mLocal.setIPort(val["Proxy"][i]["Lisen"].asCString());
-                nd.mRemote.setIPort(val["Proxy"][i]["Backend"].asCString());
+                nd.mBalance = (u8)AppClamp<s32>(val["Proxy"][i].get("Balance", 0).asInt(), 0, 1);
+                nd.mCheckTime = 1000 * AppClamp<u32>(val["Proxy"][i].get("HealthCheck", 5).asUInt(), 0, 3600);
+                nd.mMaxFails = AppClamp<u32>(val["Proxy"][i].get("MaxFails", 3).asUInt(), 0, 1000);
+                nd.mEjectTime = 1000 * AppClamp<u32>(val["Proxy"][i].get("EjectTime", 30).asUInt(), 1, 3600);
+                //"Backend": "ip:port", or ["ip:port", {"Addr":"ip:port", "Weight":2}]
+                nd.mBackend.clear();
+                const Json::Value& bks = val["Proxy"][i]["Backend"];
+                BackendCfg bk;
+                if (bks.isString()) {
+                    bk.mWeight = 1;
+                    bk.mAddress.setIPort(bks.asCString());
+                    nd.mBackend.pushBack(bk);
+                } else {
+                    for (u32 k = 0; k < bks.size(); ++k) {
+                        if (bks[k].isString()) {
+                            bk.mWeight = 1;
+                            bk.mAddress.setIPort(bks[k].asCString());
+                        } else {
+                            bk.mWeight = AppClamp<u32>(bks[k].get("Weight", 1).asUInt(), 1, 100);
+                            bk.mAddress.setIPort(bks[k]["Addr"].asCString());
+                        }
+                        nd.mBackend.pushBack(bk);
+                    }
+                }
+                if (0 == nd.mBackend.size()) {
+                    Logger::logError("EngineConfig::load, proxy[%u][%s] no backend", i, nd.mLocal.getStr());
+                    continue;
+                }
+                nd.mRemote = nd.mBackend[0].mAddress;
                 mProxy.pushBack(nd);
             }
         }
@@ -172,6 +200,35 @@ bool EngineConfig::load(const String& runPath, const String& cfg, bool mainProce
                 nd.mType = (u8)val["Website"][i]["Type"].asInt();
                 nd.mTimeout = 1000 * AppClamp<u32>(val["Website"][i]["Timeout"].asInt(), 0, 3600);
                 nd.mLocal.setIPort(val["Website"][i]["Lisen"].asCString());
+                nd.mCacheSize = 1024 * AppClamp<u32>(val["Website"][i].get("CacheSize", 32 * 1024).asInt(), 0, 1024 * 1024);
+                nd.mCacheFileSize = 1024 * AppClamp<u32>(val["Website"][i].get("CacheFileSize", 256).asInt(), 1, 64 * 1024);
+                nd.mCacheTime = 1000 * AppClamp<u32>(val["Website"][i].get("CacheTime", 60).asInt(), 1, 3600);
+                nd.mPipeline = AppClamp<u32>(val["Website"][i].get("Pipeline", 16).asInt(), 1, 256);
+                nd.mHTTP2 = 0 != val["Website"][i].get("HTTP2", 1).asInt();
+                nd.mKTLS = 0 != val["Website"][i].get("KTLS", 0).asInt();
+                nd.mTlsPool = AppClamp<u32>(val["Website"][i].get("TlsPool", 0).asInt(), 0, 1024);
+                nd.mUpstreamIdle = AppClamp<u32>(val["Website"][i].get("UpstreamIdle", 8).asInt(), 0, 1024);
+                nd.mUpstreamIdleTime = 1000 * AppClamp<u32>(val["Website"][i].get("UpstreamIdleTime", 30).asInt(), 1, 3600);
+                nd.mUploadDepth = AppClamp<u32>(val["Website"][i].get("UploadDepth", 4).asInt(), 1, 16);
+                nd.mUploadMax = 1024ULL * 1024 * AppClamp<u32>(val["Website"][i].get("UploadMax", 1024).asInt(), 1, 1024 * 1024);
+                nd.mUpstream.clear();
+                if (val["Website"][i].isMember("Upstream")) {
+                    const Json::Value& ups = val["Website"][i]["Upstream"];
+                    for (u32 k = 0; k < ups.size(); ++k) {
+                        UpstreamCfg up;
+                        up.mBalance = (u8)AppClamp<s32>(ups[k].get("Balance", 0).asInt(), 0, 1);
+                        up.mPath = ups[k].get("Path", "/").asCString();
+                        up.mHost = ups[k].get("Host", "").asCString();
+                        for (u32 j = 0; j < ups[k]["Backend"].size(); ++j) {
+                            up.mBackend.pushBack(String(ups[k]["Backend"][j].asCString()));
+                        }
+                        if (0 == up.mBackend.size()) {
+                            Logger::logError("EngineConfig::load, website[%u] upstream[%u] no backend", i, k);
+                            continue;
+                        }
+                        nd.mUpstream.pushBack(up);
+                    }
+                }
                 nd.mRootPath = val["Website"][i]["Path"].asCString();
                 nd.mRootPath.replace('\\', '/');
                 if ('/' == nd.mRootPath.lastChar()) {
@@ -190,7 +247,7 @@ bool EngineConfig::load(const String& runPath, const String& cfg, bool mainProce
                     }
                 }
                 mWebsite.pushBack(nd);
-                mWebsite.getLast().mDict = new HashDict(gDictCalls, nullptr);
+                mWebsite.getLast().mDict = new HashDict(gCacheCalls, nullptr);
             }
         }
     }
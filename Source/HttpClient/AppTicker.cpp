@@ -8,7 +8,7 @@
 #include "AppTicker.h"
 #include "Net/HandleTCP.h"
 #include "Net/HTTP/HttpLayer.h"
-#include "Net/HTTP/HttpFileSave.h"
+#include "HttpFileDown.h"
 
 
 #ifdef DOS_WINDOWS
@@ -28,7 +28,8 @@ usz AppTicker::gTotalActiveResp = 0;
 
 
 AppTicker::AppTicker()
-    :mLoop(Engine::getInstance().getLoop()) {
+    :mLoop(Engine::getInstance().getLoop())
+    , mPool(&Engine::getInstance().getLoop()) {
     mTime.setClose(EHT_TIME, AppTicker::funcOnClose, this);
     mTime.setTime(AppTicker::funcOnTime, 2000, 1000, -1);
 }
@@ -37,6 +38,10 @@ AppTicker::~AppTicker() {
 }
 
 s32 AppTicker::start() {
+    s32 ret = mPool.open();
+    if (EE_OK != ret) {
+        return ret;
+    }
     return mLoop.openHandle(&mTime);
 }
 
@@ -65,21 +70,26 @@ s32 AppTicker::onTimeout(HandleTime* it) {
             if (0 == url[0]) {
                 snprintf(url, sizeof(url), "%s", "http://www.httpwatch.com/httpgallery/chunked/chunkedimage.aspx");
             }
-            net::HttpLayer* nd = new net::HttpLayer(net::EHTTP_RESPONSE);
+            net::HttpLayer* nd = mPool.acquire(url);
+            if (!nd) {
+                return EE_OK;
+            }
             nd->getMsg()->getHeadOut().writeKeepAlive(true);
             nd->getMsg()->getHeadOut().add("Accept", "*/*");
-            HttpFileSave* evt = new HttpFileSave();
+            HttpFileDown* evt = new HttpFileDown();
             nd->getMsg()->setEvent(evt);
+            evt->drop(); //held by msg
             s32 fly = nd->get(url);
             printf("url = %s, ip=%s\n", url, nd->getHandle().getRemote().getStr());
-            if (EE_OK != fly) {
+            if (EE_OK != fly && !nd->isAlive()) {
+                //a reused connection is closed by itself
                 delete nd;
-                delete evt;
             }
         } else {
-            printf("Handle=%d, Fly=%d, In=%llu/%llu, Out=%llu/%llu, Active=%llu/%llu\n",
+            printf("Handle=%d, Fly=%d, In=%llu/%llu, Out=%llu/%llu, Active=%llu/%llu, Pool=%u/%llu/%llu\n",
                 mLoop.getHandleCount(), mLoop.getFlyRequest(),
-                gTotalPacketIn, gTotalSizeIn, gTotalPacketOut, gTotalSizeOut, gTotalActive, gTotalActiveResp);
+                gTotalPacketIn, gTotalSizeIn, gTotalPacketOut, gTotalSizeOut, gTotalActive, gTotalActiveResp,
+                mPool.getIdleCount(), mPool.getHits(), mPool.getMisses());
         }
         if (++G_LOG_FLUSH_CNT >= 20) {
             G_LOG_FLUSH_CNT = 0;
@@ -88,6 +98,7 @@ s32 AppTicker::onTimeout(HandleTime* it) {
         return EE_OK;
     }
 
+    mPool.close();
     Engine::getInstance().postCommand(ECT_EXIT);    //mLoop.stop();
     Logger::log(ELL_INFO, "AppTicker::onTimeout>>exiting...");
     return EE_ERROR;
@@ -3,6 +3,7 @@
 
 #include "MsgHeader.h"
 #include "Loop.h"
+#include "Net/HTTP/HttpClientPool.h"
 
 
 namespace app {
@@ -97,6 +98,7 @@ public:
 private:
     HandleTime mTime;
     Loop& mLoop;
+    net::HttpClientPool mPool;
 };
 
 }//namespace app
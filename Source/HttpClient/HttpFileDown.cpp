@@ -0,0 +1,151 @@
+#include "HttpFileDown.h"
+#include "RingBuffer.h"
+#include "Logger.h"
+
+namespace app {
+
+HttpFileDown::HttpFileDown()
+    :mMsg(nullptr)
+    , mWrited(0)
+    , mExpect(~(usz)0)
+    , mWriting(false)
+    , mBodyDone(false)
+    , mError(false)
+    , mFinished(false) {
+
+    mReqs.mCall = HttpFileDown::funcOnWrite;
+    mReqs.mUser = this;
+
+    mFile.setClose(EHT_FILE, HttpFileDown::funcOnClose, this);
+}
+
+HttpFileDown::~HttpFileDown() {
+}
+
+s32 HttpFileDown::onSent(net::HttpMsg& msg) {
+    //go on to send body here
+    return EE_OK;
+}
+
+s32 HttpFileDown::onOpen(net::HttpMsg& msg) {
+    if (mFile.isOpen() || mFinished) {
+        return EE_ERROR; //one response per eventer
+    }
+    StringView val = msg.getHeadIn().get(net::EHH_CONTENT_LENGTH);
+    if (val.mLen > 0) {
+        mExpect = 0;
+        for (usz i = 0; i < val.mLen && val.mData[i] >= '0' && val.mData[i] <= '9'; ++i) {
+            mExpect = mExpect * 10 + (val.mData[i] - '0');
+        }
+    }
+    if (EE_OK != mFile.open("Log/httpfile.html", 6)) {
+        return EE_ERROR;
+    }
+    //the file is reused by every download
+    mFile.setFileSize(0);
+    mMsg = &msg;
+    grab(); //dropped by onFileClose()
+    return EE_OK;
+}
+
+s32 HttpFileDown::onClose() {
+    //the msg is released, the writes in flight grab it, so none is in flight here
+    if (!mWriting) {
+        finish();
+    }
+    mMsg = nullptr;
+    return EE_OK;
+}
+
+s32 HttpFileDown::onFinish(net::HttpMsg& msg) {
+    mBodyDone = true;
+    if (EE_OK != launchWrite()) {
+        finish();
+        return EE_ERROR;
+    }
+    if (!mWriting) {
+        finish();
+    }
+    return EE_OK;
+}
+
+void HttpFileDown::onFileClose(Handle* it) {
+    drop();
+}
+
+void HttpFileDown::onFileWrite(RequestFD* it) {
+    mWriting = false;
+    net::HttpMsg* msg = mMsg;
+    if (it->mError || 0 == it->mUsed) {
+        mError = true;
+        Logger::log(ELL_ERROR, "HttpFileDown::onFileWrite>>err=%d, offset=%llu, file=%s",
+            it->mError, (u64)mWrited, mFile.getFileName().c_str());
+    } else {
+        //a short write leaves the rest in cache, it's written by the next launchWrite()
+        msg->getCacheIn().commitHead(it->mUsed);
+        mWrited += it->mUsed;
+        launchWrite();
+    }
+    if (!mWriting) {
+        if (mError && !mBodyDone) {
+            msg->getHttpLayer()->postClose();
+        }
+        if (mError || mBodyDone) {
+            finish();
+        }
+    }
+    msg->drop(); //grabbed by launchWrite(), may call onClose()
+}
+
+s32 HttpFileDown::onBodyPart(net::HttpMsg& msg) {
+    if (!mFile.isOpen() || mError) {
+        return EE_ERROR;
+    }
+    if (EE_OK != launchWrite()) {
+        if (!mWriting) {
+            finish();
+        }
+        return EE_ERROR;
+    }
+    return EE_OK;
+}
+
+
+s32 HttpFileDown::launchWrite() {
+    if (mWriting || mError || !mMsg || mMsg->getCacheIn().getSize() == 0) {
+        return mError ? EE_ERROR : EE_OK;
+    }
+    StringView buf = mMsg->getCacheIn().peekHead();
+    mReqs.mData = buf.mData;
+    mReqs.mAllocated = static_cast<u32>(buf.mLen);
+    mReqs.mUsed = 0;
+    if (EE_OK != mFile.write(&mReqs, mWrited)) {
+        mError = true;
+        Logger::log(ELL_ERROR, "HttpFileDown::launchWrite>>offset=%llu, file=%s",
+            (u64)mWrited, mFile.getFileName().c_str());
+        return EE_ERROR;
+    }
+    mWriting = true;
+    mMsg->grab(); //keep the receive cache till the write is done
+    return EE_OK;
+}
+
+
+void HttpFileDown::finish() {
+    if (mFinished || !mFile.isOpen()) {
+        return;
+    }
+    mFinished = true;
+    const usz left = mMsg ? mMsg->getCacheIn().getSize() : 0;
+    if (mError || !mBodyDone || left > 0 || (~(usz)0 != mExpect && mExpect != mWrited)) {
+        Logger::log(ELL_ERROR, "HttpFileDown::finish>>saved=%llu, expect=%lld, left=%llu, done=%d, err=%d, file=%s",
+            (u64)mWrited, (s64)mExpect, (u64)left, mBodyDone ? 1 : 0, mError ? 1 : 0, mFile.getFileName().c_str());
+    } else {
+        Logger::log(ELL_INFO, "HttpFileDown::finish>>saved=%llu, file=%s",
+            (u64)mWrited, mFile.getFileName().c_str());
+    }
+    mFile.launchClose();
+}
+
+
+}//namespace app
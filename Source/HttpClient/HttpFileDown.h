@@ -0,0 +1,58 @@
+#ifndef APP_HTTPFILEDOWN_H
+#define	APP_HTTPFILEDOWN_H
+
+#include "HandleFile.h"
+#include "Net/HTTP/HttpLayer.h"
+
+namespace app {
+
+/**
+ * @brief save the body of response to file while receiving.
+ *        One block of the receive cache is written at a time, the msg is grabbed till the write is done.
+ *        The saved size is checked with Content-Length when the response is finished.
+ */
+class HttpFileDown :public net::HttpEventer {
+public:
+    HttpFileDown();
+    virtual ~HttpFileDown();
+
+    virtual s32 onSent(net::HttpMsg& req)override;
+    virtual s32 onFinish(net::HttpMsg& resp)override;
+    virtual s32 onBodyPart(net::HttpMsg& resp)override;
+    virtual s32 onOpen(net::HttpMsg& msg)override;
+    virtual s32 onClose()override;
+
+    usz getWrited()const {
+        return mWrited;
+    }
+
+private:
+    net::HttpMsg* mMsg;
+    RequestFD mReqs;
+    HandleFile mFile;
+    usz mWrited;
+    usz mExpect;    //Content-Length of response, ~0 if not given
+    bool mWriting;  //mReqs is in flight
+    bool mBodyDone;
+    bool mError;
+    bool mFinished; //the file is closing
+    void onFileWrite(RequestFD* it);
+    void onFileClose(Handle* it);
+
+    s32 launchWrite();
+
+    //@brief check the saved size and close the file
+    void finish();
+
+    static void funcOnWrite(RequestFD* it) {
+        HttpFileDown& nd = *(HttpFileDown*)it->mUser;
+        nd.onFileWrite(it);
+    }
+    static void funcOnClose(Handle* it) {
+        HttpFileDown& nd = *(HttpFileDown*)it->getUser();
+        nd.onFileClose(it);
+    }
+};
+
+}//namespace app
+#endif //APP_HTTPFILEDOWN_H
@@ -40,19 +40,21 @@
 
 namespace app {
 
-static usz AppGetFileSize(s32 fd) {
+static usz AppGetFileSize(s32 fd, s64& mtime) {
     usz filesize = 0;
     struct stat statbuff;
     if (fstat(fd, &statbuff) < 0) {
+        mtime = 0;
         return filesize;
     } else {
         filesize = (S_ISDIR(statbuff.st_mode)) ? 0 : statbuff.st_size;
+        mtime = statbuff.st_mtime;
     }
     return filesize;
 }
 
 
-HandleFile::HandleFile() : mFile(-1), mFileSize(0) {
+HandleFile::HandleFile() : mFile(-1), mFileSize(0), mModifyTime(0) {
     mType = EHT_FILE;
     mLoop = &Engine::getInstance().getLoop();
 }
@@ -69,6 +71,7 @@ s32 HandleFile::close() {
         mFile = -1;
         mFilename.setLen(0);
         mFileSize = 0;
+        mModifyTime = 0;
     }
     return EE_OK;
 }
@@ -83,6 +86,11 @@ bool HandleFile::setFileSize(usz fsz) {
     return true;
 }
 
+bool HandleFile::reserve(usz offset, usz len) {
+    //FALLOC_FL_KEEP_SIZE: an aborted upload will not leave zeros at tail
+    return -1 != mFile && 0 == fallocate(mFile, FALLOC_FL_KEEP_SIZE, offset, len);
+}
+
 s32 HandleFile::open(const String& fname, s32 flag) {
     close();
     mFilename = fname;
@@ -98,11 +106,14 @@ s32 HandleFile::open(const String& fname, s32 flag) {
 
     if (-1 == mFile) {
         mFlag |= (EHF_CLOSING | EHF_CLOSE);
+        if (flag & 8) {
+            return EE_NO_OPEN;
+        }
         Logger::log(ELL_ERROR, "HandleFile::open>> mode=0x%X, ecode=%d, file=%s", fmode, System::getAppError(),
             mFilename.c_str());
         return EE_NO_OPEN;
     }
-    mFileSize = AppGetFileSize(mFile);
+    mFileSize = AppGetFileSize(mFile, mModifyTime);
     return mLoop->openHandle(this);
 }
 
@@ -168,7 +179,6 @@ void HandleFile::stepByPool(RequestFD* it) {
         ret = pread64(mFile, it->mData + it->mUsed, it->mAllocated - it->mUsed, offset);
     } else {
         ret = pwrite64(mFile, it->mData + it->mUsed, it->mAllocated - it->mUsed, offset);
-        DASSERT(it->mAllocated - it->mUsed == ret);
     }
     if (ret > 0) {
         it->mUsed += ret;
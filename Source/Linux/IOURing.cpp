@@ -351,9 +351,10 @@ void IOURing::postQueue() {
         mFlyRequest++;
         //++cnt;
         sqe->user_data = (u64)req;
-        sqe->addr = (u64)req->mData;
+        // go on after mUsed, same as the thread pool, a short read or write is resumed so
+        sqe->addr = (u64)(req->mData + req->mUsed);
         sqe->fd = handle->getHandle();
-        sqe->len = req->mAllocated;
+        sqe->len = req->mAllocated - req->mUsed;
         sqe->off = req->mOffset; // default set offset = -1
         sqe->opcode = (ERT_READ == req->mType ? IORING_OP_READ : IORING_OP_WRITE);
         std::atomic_store_explicit(
@@ -286,6 +286,9 @@ void Loop::updatePending() {
                         } else {
                             wdsz = hnd->mSock.sendTo(buf.mData, (s32)buf.mLen, ndu->mRemote);
                         }
+                    } else if (nd->mRecordType) {
+                        //TLS control record of kTLS, @see TlsSession::writeRecord()
+                        wdsz = hnd->mSock.sendRecord(nd->mRecordType, buf.mData, (s32)buf.mLen);
                     } else { // TCP currently
                         wdsz = hnd->mSock.send(buf.mData, (s32)buf.mLen);
                     }
@@ -703,6 +706,10 @@ s32 Loop::openHandle(Handle* it) {
             ret = System::getAppError();
             Logger::log(ELL_ERROR, "Loop::openHandle>>addr=%s,tcp.con unblock, ecode=%d", nd->mRemote.getStr(), ret);
             sock.close();
+        } else if (0 != sock.setDelay(false)) {
+            ret = System::getAppError();
+            Logger::log(ELL_ERROR, "Loop::openHandle>>addr=%s,tcp.con delay, ecode=%d", nd->mRemote.getStr(), ret);
+            sock.close();
         } else {
             EventPoller::SEvent evt;
             evt.mEvent = EPOLLIN | EPOLLOUT | EPOLLET | EPOLLERR | EPOLLHUP;
@@ -0,0 +1,1161 @@
+#include "Net/HTTP/Http2Layer.h"
+#include "Net/HTTP/HttpLayer.h"
+#include "Net/HTTP/Website.h"
+#include "Net/HTTP/MsgStation.h"
+#include "Net/HTTP/HttpFileCache.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+static const s8 G_H2_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+static const usz G_H2_PREFACE_SIZE = sizeof(G_H2_PREFACE) - 1;
+
+static const u32 G_H2_FRAME_HEAD = 9;
+static const u32 G_H2_MAX_FRAME = 16384;            //SETTINGS_MAX_FRAME_SIZE of server
+static const u32 G_H2_MAX_BLOCK = 64 * 1024;        //max bytes of a request header block
+static const u32 G_H2_MAX_HEAD = 16 * 1024;         //max bytes of a HTTP/1.1 response head
+static const u32 G_H2_RECV_WINDOW = 1024 * 1024;    //connection window of server
+static const u32 G_H2_STREAM_WINDOW = 256 * 1024;   //stream window of server, the max body cached by a stream
+static const s64 G_H2_MAX_WINDOW = 0x7FFFFFFF;
+
+//flags of frame
+static const u8 G_H2_END_STREAM = 0x1;
+static const u8 G_H2_ACK = 0x1;
+static const u8 G_H2_END_HEADERS = 0x4;
+static const u8 G_H2_PADDED = 0x8;
+static const u8 G_H2_PRIORITY = 0x20;
+
+//state of the HTTP/1.1 response to translate
+enum EHttp2Resp {
+    EH2R_HEAD = 0,          //wait the whole head
+    EH2R_BODY,              //body of Content-Length
+    EH2R_BODY_EOF,          //body without length, it ends with the msg
+    EH2R_CHUNK_SIZE,
+    EH2R_CHUNK_EXT,
+    EH2R_CHUNK_DATA,
+    EH2R_CHUNK_CRLF,
+    EH2R_TRAILER,
+    EH2R_DONE
+};
+
+struct Http2Stream {
+    HttpMsg* mMsg;          //owned by stream
+    u32 mID;
+    u8 mResp;               //EHttp2Resp
+    bool mEndIn;            //got END_STREAM of request
+    bool mEndOut;           //sent END_STREAM of response
+    bool mBlocked;          //blocked by flow control
+    s64 mWindow;            //stream window of peer
+    u64 mLeft;              //bytes left of body or chunk
+    usz mFileSent;          //body bytes sent of cached file
+    u32 mLine;              //bytes of current trailer line
+    u32 mRecved;            //bytes of DATA got, but not given back to the windows of peer
+
+    Http2Stream(u32 sid, HttpMsg* msg, u32 window)
+        : mMsg(msg)
+        , mID(sid)
+        , mResp(EH2R_HEAD)
+        , mEndIn(false)
+        , mEndOut(false)
+        , mBlocked(false)
+        , mWindow(window)
+        , mLeft(0)
+        , mFileSent(0)
+        , mLine(0)
+        , mRecved(0) {
+    }
+};
+
+
+static DFINLINE u32 AppReadU32(const u8* buf) {
+    return (u32)buf[0] << 24 | (u32)buf[1] << 16 | (u32)buf[2] << 8 | buf[3];
+}
+
+static void AppWriteU32(RingBuffer& out, u32 val) {
+    u8 buf[4] = {(u8)(val >> 24), (u8)(val >> 16), (u8)(val >> 8), (u8)val};
+    out.write(buf, sizeof(buf));
+}
+
+static usz AppPutSetting(u8* buf, u16 id, u32 val) {
+    buf[0] = (u8)(id >> 8);
+    buf[1] = (u8)id;
+    buf[2] = (u8)(val >> 24);
+    buf[3] = (u8)(val >> 16);
+    buf[4] = (u8)(val >> 8);
+    buf[5] = (u8)val;
+    return 6;
+}
+
+static void AppSkipRing(RingBuffer& in, usz len) {
+    while (len > 0) {
+        StringView blk = in.peekHead();
+        usz n = AppMin(blk.mLen, len);
+        if (0 == n) {
+            break;
+        }
+        in.commitHead((s32)n);
+        len -= n;
+    }
+}
+
+/**
+ * @brief parse chunk size line, CRLF after chunk data, and trailer.
+ * @return 0 to go on, 1 if the state is changed, -1 if error.
+ */
+static s32 AppParseChunk(Http2Stream* st, s8 ch) {
+    switch (st->mResp) {
+    case EH2R_CHUNK_SIZE:
+        if (ch >= '0' && ch <= '9') {
+            st->mLeft = (st->mLeft << 4) | (u64)(ch - '0');
+        } else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') {
+            st->mLeft = (st->mLeft << 4) | (u64)((ch | 0x20) - 'a' + 10);
+        } else if (';' == ch || ' ' == ch || '\t' == ch) {
+            st->mResp = EH2R_CHUNK_EXT;
+        } else if ('\n' == ch) {
+            st->mResp = st->mLeft > 0 ? EH2R_CHUNK_DATA : EH2R_TRAILER;
+            st->mLine = 0;
+            return 1;
+        } else if ('\r' != ch) {
+            return -1;
+        }
+        return st->mLeft > 0xFFFFFFFFFFULL ? -1 : 0;
+
+    case EH2R_CHUNK_EXT:
+        if ('\n' == ch) {
+            st->mResp = st->mLeft > 0 ? EH2R_CHUNK_DATA : EH2R_TRAILER;
+            st->mLine = 0;
+            return 1;
+        }
+        return 0;
+
+    case EH2R_CHUNK_CRLF:
+        if ('\n' == ch) {
+            st->mResp = EH2R_CHUNK_SIZE;
+            st->mLeft = 0;
+            return 1;
+        }
+        return '\r' == ch ? 0 : -1;
+
+    case EH2R_TRAILER:
+        if ('\n' == ch) {
+            if (0 == st->mLine) {
+                st->mResp = EH2R_DONE;
+                return 1;
+            }
+            st->mLine = 0;
+        } else if ('\r' != ch) {
+            ++st->mLine;
+        }
+        return 0;
+
+    default:
+        return -1;
+    }
+}
+
+
+Http2Layer::Http2Layer(HttpLayer& it)
+    : mLayer(it)
+    , mSendWindow(65535)
+    , mPeerWindow(65535)
+    , mPeerFrameSize(G_H2_MAX_FRAME)
+    , mMaxStreams(100)
+    , mLastStream(0)
+    , mRecvConn(0)
+    , mBlockStream(0)
+    , mBlockFlags(0)
+    , mGoaway(0)
+    , mPreface(false)
+    , mWriting(false)
+    , mActive(true) {
+    mOut.init();
+    Website* site = it.getWebsite();
+    if (site) {
+        mMaxStreams = site->getConfig().mPipeline;
+    }
+}
+
+
+Http2Layer::~Http2Layer() {
+    onClose();
+}
+
+
+s32 Http2Layer::checkPreface(const s8* buf, usz len) {
+    usz cmp = len < G_H2_PREFACE_SIZE ? len : G_H2_PREFACE_SIZE;
+    if (0 != memcmp(buf, G_H2_PREFACE, cmp)) {
+        return -1;
+    }
+    return G_H2_PREFACE_SIZE == cmp ? 1 : 0;
+}
+
+
+u32 Http2Layer::getReadSize() {
+    return 20 * 1024;
+}
+
+
+bool Http2Layer::start() {
+    u8 buf[24];
+    usz len = 0;
+    len += AppPutSetting(buf + len, 0x3, mMaxStreams);      //SETTINGS_MAX_CONCURRENT_STREAMS
+    len += AppPutSetting(buf + len, 0x4, G_H2_STREAM_WINDOW); //SETTINGS_INITIAL_WINDOW_SIZE
+    len += AppPutSetting(buf + len, 0x5, G_H2_MAX_FRAME);   //SETTINGS_MAX_FRAME_SIZE
+    len += AppPutSetting(buf + len, 0x6, G_H2_MAX_BLOCK);   //SETTINGS_MAX_HEADER_LIST_SIZE
+    writeFrameHead((u32)len, EH2F_SETTINGS, 0, 0);
+    mOut.write(buf, (s32)len);
+    writeWindowUpdate(0, G_H2_RECV_WINDOW - 65535);
+    return flush();
+}
+
+
+ssz Http2Layer::parseBuf(const s8* buf, usz len) {
+    const u8* pos = reinterpret_cast<const u8*>(buf);
+    const u8* end = pos + len;
+    if (!mPreface) {
+        s32 ret = checkPreface(buf, len);
+        if (0 == ret) {
+            return 0;
+        }
+        if (ret < 0) {
+            goaway(EH2E_PROTOCOL_ERROR);
+            flush();
+            return -1;
+        }
+        pos += G_H2_PREFACE_SIZE;
+        mPreface = true;
+    }
+    u32 ecode = EH2E_NO_ERROR;
+    while ((usz)(end - pos) >= G_H2_FRAME_HEAD) {
+        const u32 flen = (u32)pos[0] << 16 | (u32)pos[1] << 8 | pos[2];
+        if (flen > G_H2_MAX_FRAME) {
+            ecode = EH2E_FRAME_SIZE_ERROR;
+            break;
+        }
+        if ((usz)(end - pos) < G_H2_FRAME_HEAD + flen) {
+            break; //incomplete frame
+        }
+        ecode = onFrame(pos[3], pos[4], AppReadU32(pos + 5) & 0x7FFFFFFF, pos + G_H2_FRAME_HEAD, flen);
+        pos += G_H2_FRAME_HEAD + flen;
+        if (EH2E_NO_ERROR != ecode) {
+            break;
+        }
+    }
+    mActive = true;
+    if (EH2E_NO_ERROR != ecode) {
+        goaway(ecode);
+        flush();
+        return -1;
+    }
+    flush();
+    checkClose();
+    return pos - reinterpret_cast<const u8*>(buf);
+}
+
+
+u32 Http2Layer::onFrame(u8 type, u8 flags, u32 sid, const u8* buf, u32 len) {
+    if (mBlockStream && (EH2F_CONTINUATION != type || sid != mBlockStream)) {
+        return EH2E_PROTOCOL_ERROR; //header block must be contiguous
+    }
+    switch (type) {
+    case EH2F_DATA:
+        return onData(flags, sid, buf, len);
+
+    case EH2F_HEADERS:
+        return onHeaders(flags, sid, buf, len);
+
+    case EH2F_PRIORITY:
+        if (0 == sid) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        return 5 == len ? EH2E_NO_ERROR : EH2E_FRAME_SIZE_ERROR;
+
+    case EH2F_RST_STREAM:
+    {
+        if (0 == sid || sid > mLastStream) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        if (4 != len) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        Http2Stream* st = getStream(sid);
+        if (st) {
+            closeStream(st);
+        }
+        return EH2E_NO_ERROR;
+    }
+
+    case EH2F_SETTINGS:
+        if (0 != sid) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        return onSettings(flags, buf, len);
+
+    case EH2F_PUSH_PROMISE:
+        return EH2E_PROTOCOL_ERROR; //client can't push
+
+    case EH2F_PING:
+        if (0 != sid) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        if (8 != len) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        if (0 == (flags & G_H2_ACK)) {
+            writeFrameHead(8, EH2F_PING, G_H2_ACK, 0);
+            mOut.write(buf, 8);
+        }
+        return EH2E_NO_ERROR;
+
+    case EH2F_GOAWAY:
+        if (0 != sid) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        if (len < 8) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        if (0 == mGoaway) {
+            mGoaway = 1;
+        }
+        return EH2E_NO_ERROR;
+
+    case EH2F_WINDOW_UPDATE:
+        return onWindowUpdate(sid, buf, len);
+
+    case EH2F_CONTINUATION:
+        if (0 == mBlockStream) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        mBlock.write(buf, len);
+        if (mBlock.size() > G_H2_MAX_BLOCK) {
+            return EH2E_ENHANCE_YOUR_CALM;
+        }
+        return (flags & G_H2_END_HEADERS) ? onHeadBlock() : EH2E_NO_ERROR;
+
+    default:
+        return EH2E_NO_ERROR; //unknown frame must be ignored
+    }
+}
+
+
+u32 Http2Layer::onHeaders(u8 flags, u32 sid, const u8* buf, u32 len) {
+    if (0 == sid) {
+        return EH2E_PROTOCOL_ERROR;
+    }
+    u32 pad = 0;
+    if (flags & G_H2_PADDED) {
+        if (len < 1) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        pad = buf[0];
+        ++buf;
+        --len;
+    }
+    if (flags & G_H2_PRIORITY) {
+        if (len < 5) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        buf += 5;
+        len -= 5;
+    }
+    if (pad > len) {
+        return EH2E_PROTOCOL_ERROR;
+    }
+    len -= pad;
+    mBlock.resize(0);
+    mBlock.write(buf, len);
+    mBlockStream = sid;
+    mBlockFlags = flags;
+    return (flags & G_H2_END_HEADERS) ? onHeadBlock() : EH2E_NO_ERROR;
+}
+
+
+u32 Http2Layer::onHeadBlock() {
+    const u32 sid = mBlockStream;
+    const bool endStream = 0 != (mBlockFlags & G_H2_END_STREAM);
+    const u8* blk = reinterpret_cast<const u8*>(mBlock.getPointer());
+    mBlockStream = 0;
+
+    Http2Stream* st = getStream(sid);
+    if (st) {
+        //trailer fields of request, they're dropped
+        HttpHead trailer;
+        if (EE_OK != mDecoder.decode(blk, mBlock.size(), trailer)) {
+            return EH2E_COMPRESSION_ERROR;
+        }
+        if (st->mEndIn || !endStream) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        st->mEndIn = true;
+        stepMsg(st, ES_BODY_DONE);
+        return EH2E_NO_ERROR;
+    }
+    if (0 == (sid & 1) || sid <= mLastStream) {
+        return EH2E_PROTOCOL_ERROR;
+    }
+    mLastStream = sid;
+
+    HttpMsg* msg = new HttpMsg(&mLayer);
+    if (EE_OK != mDecoder.decode(blk, mBlock.size(), msg->getHeadIn())) {
+        msg->drop();
+        return EH2E_COMPRESSION_ERROR; //the decoder is out of sync
+    }
+    if (mGoaway || mStreams.size() >= mMaxStreams) {
+        msg->drop();
+        writeRst(sid, EH2E_REFUSED_STREAM);
+        return EH2E_NO_ERROR;
+    }
+    if (EE_OK != initMsg(msg)) {
+        msg->drop();
+        writeRst(sid, EH2E_PROTOCOL_ERROR);
+        return EH2E_NO_ERROR;
+    }
+    st = new Http2Stream(sid, msg, mPeerWindow);
+    mStreams.pushBack(st);
+    if (stepMsg(st, ES_INIT) && stepMsg(st, ES_PATH) && stepMsg(st, ES_HEAD) && endStream) {
+        st->mEndIn = true;
+        stepMsg(st, ES_BODY_DONE);
+    }
+    return EH2E_NO_ERROR;
+}
+
+
+u32 Http2Layer::onData(u8 flags, u32 sid, const u8* buf, u32 len) {
+    if (0 == sid) {
+        return EH2E_PROTOCOL_ERROR;
+    }
+    const u32 flen = len;
+    if (flags & G_H2_PADDED) {
+        if (len < 1) {
+            return EH2E_FRAME_SIZE_ERROR;
+        }
+        u32 pad = buf[0];
+        ++buf;
+        --len;
+        if (pad > len) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        len -= pad;
+    }
+    mRecvConn += flen;
+    if (mRecvConn > G_H2_RECV_WINDOW) {
+        return EH2E_FLOW_CONTROL_ERROR; //peer ignored the connection window
+    }
+    Http2Stream* st = getStream(sid);
+    if (!st || st->mEndIn) {
+        if (sid > mLastStream) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        if (flen > 0) {
+            mRecvConn -= flen;
+            writeWindowUpdate(0, flen);
+        }
+        writeRst(sid, EH2E_STREAM_CLOSED);
+        return EH2E_NO_ERROR;
+    }
+    //padding is not cached, it's given back with the consumed body, see updateWindow()
+    st->mRecved += flen;
+    if (st->mRecved > G_H2_STREAM_WINDOW) {
+        resetStream(st, EH2E_FLOW_CONTROL_ERROR);
+        return EH2E_NO_ERROR;
+    }
+    if (len > 0) {
+        st->mMsg->getCacheIn().write(buf, (s32)len);
+        if (!stepMsg(st, ES_BODY)) {
+            return EH2E_NO_ERROR;
+        }
+    }
+    if (flags & G_H2_END_STREAM) {
+        st->mEndIn = true;
+        if (!stepMsg(st, ES_BODY_DONE)) {
+            return EH2E_NO_ERROR;
+        }
+    }
+    updateWindow(st);
+    return EH2E_NO_ERROR;
+}
+
+
+void Http2Layer::updateWindow(Http2Stream* st) {
+    const usz cached = (usz)st->mMsg->getCacheIn().getSize();
+    if (cached >= st->mRecved) {
+        return;
+    }
+    const u32 inc = st->mRecved - (u32)cached;
+    if (cached > 0 && inc < G_H2_STREAM_WINDOW / 2) {
+        return; //wait more bytes consumed, don't flood the peer with tiny updates
+    }
+    st->mRecved -= inc;
+    mRecvConn -= inc;
+    writeWindowUpdate(0, inc);
+    if (!st->mEndIn) {
+        writeWindowUpdate(st->mID, inc);
+    }
+}
+
+
+void Http2Layer::onBodyUsed(HttpMsg* msg) {
+    Http2Stream* st = getStream(msg);
+    if (st) {
+        updateWindow(st);
+        flush();
+    }
+}
+
+
+u32 Http2Layer::onSettings(u8 flags, const u8* buf, u32 len) {
+    if (flags & G_H2_ACK) {
+        return 0 == len ? EH2E_NO_ERROR : EH2E_FRAME_SIZE_ERROR;
+    }
+    if (0 != len % 6) {
+        return EH2E_FRAME_SIZE_ERROR;
+    }
+    for (u32 i = 0; i < len; i += 6) {
+        const u16 id = (u16)(buf[i] << 8 | buf[i + 1]);
+        const u32 val = AppReadU32(buf + i + 2);
+        switch (id) {
+        case 0x1: //SETTINGS_HEADER_TABLE_SIZE
+            mEncoder.setMaxTableSize(val);
+            break;
+        case 0x2: //SETTINGS_ENABLE_PUSH
+            if (val > 1) {
+                return EH2E_PROTOCOL_ERROR;
+            }
+            break;
+        case 0x4: //SETTINGS_INITIAL_WINDOW_SIZE
+        {
+            if (val > G_H2_MAX_WINDOW) {
+                return EH2E_FLOW_CONTROL_ERROR;
+            }
+            const s64 delta = (s64)val - (s64)mPeerWindow;
+            mPeerWindow = val;
+            for (usz k = 0; k < mStreams.size(); ++k) {
+                mStreams[k]->mWindow += delta;
+                if (mStreams[k]->mWindow > G_H2_MAX_WINDOW) {
+                    return EH2E_FLOW_CONTROL_ERROR;
+                }
+            }
+            break;
+        }
+        case 0x5: //SETTINGS_MAX_FRAME_SIZE
+            if (val < 16384 || val > 16777215) {
+                return EH2E_PROTOCOL_ERROR;
+            }
+            mPeerFrameSize = val;
+            break;
+        default:
+            break;
+        }
+    }
+    writeFrameHead(0, EH2F_SETTINGS, G_H2_ACK, 0);
+    resumeStreams();
+    return EH2E_NO_ERROR;
+}
+
+
+u32 Http2Layer::onWindowUpdate(u32 sid, const u8* buf, u32 len) {
+    if (4 != len) {
+        return EH2E_FRAME_SIZE_ERROR;
+    }
+    const u32 inc = AppReadU32(buf) & 0x7FFFFFFF;
+    if (0 == sid) {
+        if (0 == inc) {
+            return EH2E_PROTOCOL_ERROR;
+        }
+        mSendWindow += inc;
+        if (mSendWindow > G_H2_MAX_WINDOW) {
+            return EH2E_FLOW_CONTROL_ERROR;
+        }
+    } else {
+        Http2Stream* st = getStream(sid);
+        if (!st) {
+            return sid > mLastStream ? EH2E_PROTOCOL_ERROR : EH2E_NO_ERROR;
+        }
+        st->mWindow += inc;
+        if (0 == inc || st->mWindow > G_H2_MAX_WINDOW) {
+            resetStream(st, 0 == inc ? EH2E_PROTOCOL_ERROR : EH2E_FLOW_CONTROL_ERROR);
+            return EH2E_NO_ERROR;
+        }
+    }
+    resumeStreams();
+    return EH2E_NO_ERROR;
+}
+
+
+s32 Http2Layer::initMsg(HttpMsg* msg) {
+    static const StringView G_METHOD(":method", sizeof(":method") - 1);
+    static const StringView G_PATH(":path", sizeof(":path") - 1);
+    static const StringView G_SCHEME(":scheme", sizeof(":scheme") - 1);
+    static const StringView G_AUTHORITY(":authority", sizeof(":authority") - 1);
+
+    HttpHead& hds = msg->getHeadIn();
+    StringView method = hds.get(G_METHOD);
+    StringView path = hds.get(G_PATH);
+    if (0 == method.mLen || 0 == path.mLen) {
+        return EE_ERROR;
+    }
+    s32 id = HTTP_DELETE;
+    for (; id <= HTTP_SOURCE; ++id) {
+        if (method == HttpLayer::getMethodStr((EHttpMethod)id)) {
+            break;
+        }
+    }
+    if (id > HTTP_SOURCE || !msg->mURL.decode(path.mData, path.mLen)) {
+        return EE_ERROR;
+    }
+    msg->mType = EHTTP_REQUEST;
+    msg->mMethod = (EHttpMethod)id;
+    msg->mFlags = F_CONNECTION_KEEP_ALIVE;
+
+    StringView auth = hds.get(G_AUTHORITY);
+    if (auth.mLen > 0 && 0 == hds.get(EHH_HOST).mLen) {
+        String host(auth.mData, auth.mLen); //auth is moved by add()
+        hds.add(EHH_HOST, StringView(host.c_str(), host.getLen()));
+    }
+    hds.remove(G_METHOD);
+    hds.remove(G_PATH);
+    hds.remove(G_SCHEME);
+    hds.remove(G_AUTHORITY);
+    return EE_OK;
+}
+
+
+bool Http2Layer::stepMsg(Http2Stream* st, u8 station) {
+    const u32 sid = st->mID;
+    Website* site = mLayer.getWebsite();
+    st->mMsg->setStationID(station);
+    s32 ret = site ? site->stepMsg(st->mMsg) : EE_ERROR;
+    st = getStream(sid); //the stream may be reset by sendResp()
+    if (!st) {
+        return false;
+    }
+    if (EE_OK != ret) {
+        resetStream(st, EH2E_INTERNAL_ERROR);
+        return false;
+    }
+    return true;
+}
+
+
+bool Http2Layer::pump(Http2Stream* st) {
+    HttpMsg* msg = st->mMsg;
+    if (msg->getRespStatus() > 0) {
+        return true; //go on after the write callback, see notify()
+    }
+    bool done;
+    HttpFileNode* file = msg->getFileNode();
+    if (file) {
+        if (EH2R_HEAD == st->mResp) {
+            StringView hd = file->getHead();
+            mHead.resize(0);
+            mHead.write(hd.mData, hd.mLen);
+            if (EE_OK != writeHead(st)) {
+                resetStream(st, EH2E_INTERNAL_ERROR);
+                return false;
+            }
+        }
+        StringView body = file->getBody();
+        while (EH2R_BODY == st->mResp) {
+            const u32 room = getRoom(st);
+            if (0 == room) {
+                st->mBlocked = true;
+                break;
+            }
+            if (st->mFileSent + st->mLeft > body.mLen) {
+                resetStream(st, EH2E_INTERNAL_ERROR);
+                return false;
+            }
+            const u32 n = (u32)AppMin<u64>(room, st->mLeft);
+            st->mLeft -= n;
+            writeData(st, nullptr, body.mData + st->mFileSent, n, 0 == st->mLeft);
+            st->mFileSent += n;
+            if (0 == st->mLeft) {
+                st->mResp = EH2R_DONE;
+            }
+        }
+        done = EH2R_DONE == st->mResp;
+    } else {
+        if (EE_OK != translate(st, msg->getCacheOut())) {
+            Logger::log(ELL_ERROR, "Http2Layer::pump>>invalid response, stream=%u", st->mID);
+            resetStream(st, EH2E_INTERNAL_ERROR);
+            return false;
+        }
+        done = 0 == msg->getCacheOut().getSize();
+    }
+    if (done) {
+        msg->grab();
+        msg->setRespStatus(1);
+        mSent.pushBack(msg);
+    }
+    return flush();
+}
+
+
+s32 Http2Layer::translate(Http2Stream* st, RingBuffer& in) {
+    while (in.getSize() > 0) {
+        switch (st->mResp) {
+        case EH2R_HEAD:
+        {
+            //the head may be written by pieces, wait the empty line
+            StringView bufs[G_H2_MAX_HEAD / D_RBUF_BLOCK_SIZE + 1];
+            s32 cnt = sizeof(bufs) / sizeof(bufs[0]);
+            in.peekHeadNode(in.getHead(), bufs, &cnt);
+            mHead.resize(0);
+            for (s32 i = 0; i < cnt; ++i) {
+                mHead.write(bufs[i].mData, bufs[i].mLen);
+            }
+            const s8* hd = mHead.getPointer();
+            usz hlen = 0;
+            for (usz i = 3; i < mHead.size(); ++i) {
+                if ('\n' == hd[i] && '\r' == hd[i - 1] && '\n' == hd[i - 2] && '\r' == hd[i - 3]) {
+                    hlen = i + 1;
+                    break;
+                }
+            }
+            if (0 == hlen) {
+                return mHead.size() >= G_H2_MAX_HEAD ? EE_ERROR : EE_OK;
+            }
+            mHead.resize(hlen);
+            AppSkipRing(in, hlen);
+            if (EE_OK != writeHead(st)) {
+                return EE_ERROR;
+            }
+            break;
+        }
+
+        case EH2R_BODY:
+        case EH2R_BODY_EOF:
+        case EH2R_CHUNK_DATA:
+        {
+            const u32 room = getRoom(st);
+            if (0 == room) {
+                st->mBlocked = true;
+                return EE_OK;
+            }
+            u64 avail = in.getSize();
+            if (EH2R_BODY_EOF != st->mResp && avail > st->mLeft) {
+                avail = st->mLeft;
+            }
+            const u32 n = (u32)AppMin<u64>(avail, room);
+            const bool end = EH2R_BODY == st->mResp && n == st->mLeft;
+            writeData(st, &in, nullptr, n, end);
+            if (EH2R_BODY_EOF != st->mResp) {
+                st->mLeft -= n;
+                if (0 == st->mLeft) {
+                    st->mResp = EH2R_BODY == st->mResp ? EH2R_DONE : EH2R_CHUNK_CRLF;
+                }
+            }
+            break;
+        }
+
+        case EH2R_DONE:
+            //discard the rest, eg: body of the response to HEAD
+            AppSkipRing(in, in.getSize());
+            break;
+
+        default:
+        {
+            StringView blk = in.peekHead();
+            usz i = 0;
+            s32 ret = 0;
+            while (i < blk.mLen && 0 == ret) {
+                ret = AppParseChunk(st, blk.mData[i++]);
+            }
+            in.commitHead((s32)i);
+            if (ret < 0) {
+                return EE_ERROR;
+            }
+            if (EH2R_DONE == st->mResp && !st->mEndOut) {
+                writeData(st, nullptr, nullptr, 0, true);
+            }
+            break;
+        }
+        }//switch
+    }
+    return EE_OK;
+}
+
+
+s32 Http2Layer::writeHead(Http2Stream* st) {
+    s8* pos = mHead.getPointer();
+    s8* end = pos + mHead.size();
+    //status line, eg: HTTP/1.1 200 OK
+    if (mHead.size() < 12 || 0 != memcmp(pos, "HTTP/1.", 7)) {
+        return EE_ERROR;
+    }
+    s8* eol = (s8*)memchr(pos, '\n', end - pos);
+    if (!eol) {
+        return EE_ERROR;
+    }
+    u32 status = 0;
+    for (s8* num = pos + 9; num < pos + 12; ++num) {
+        if (*num < '0' || *num > '9') {
+            return EE_ERROR;
+        }
+        status = status * 10 + (*num - '0');
+    }
+
+    bool chunked = false;
+    s64 clen = -1;
+    mEncode.resize(0);
+    mEncoder.beginBlock(mEncode);
+    mEncoder.encodeStatus((u16)status, mEncode);
+    for (pos = eol + 1; pos < end; pos = eol + 1) {
+        eol = (s8*)memchr(pos, '\n', end - pos);
+        if (!eol) {
+            break;
+        }
+        s8* lend = (eol > pos && '\r' == eol[-1]) ? eol - 1 : eol;
+        s8* colon = (s8*)memchr(pos, ':', lend - pos);
+        if (!colon || colon == pos) {
+            continue;
+        }
+        s8* kend = colon;
+        while (kend > pos && (' ' == kend[-1] || '\t' == kend[-1])) {
+            --kend;
+        }
+        s8* val = colon + 1;
+        while (val < lend && (' ' == *val || '\t' == *val)) {
+            ++val;
+        }
+        while (lend > val && (' ' == lend[-1] || '\t' == lend[-1])) {
+            --lend;
+        }
+        for (s8* ch = pos; ch < kend; ++ch) {
+            if (*ch >= 'A' && *ch <= 'Z') {
+                *ch |= 0x20; //field names must be lowercase in HTTP/2
+            }
+        }
+        StringView key(pos, kend - pos);
+        StringView value(val, lend - val);
+        bool index = true;
+        switch (HttpHead::getID(key)) {
+        case EHH_CONNECTION:
+        case EHH_KEEP_ALIVE:
+        case EHH_PROXY_CONNECTION:
+        case EHH_UPGRADE:
+        case EHH_HOST:
+        case EHH_TE:
+            continue; //connection-specific fields are not allowed
+
+        case EHH_TRANSFER_ENCODING:
+            chunked = value.mLen >= 7 && 0 == AppStrNocaseCMP(lend - 7, "chunked", 7);
+            continue;
+
+        case EHH_CONTENT_LENGTH:
+            clen = 0;
+            for (usz i = 0; i < value.mLen && value.mData[i] >= '0' && value.mData[i] <= '9'; ++i) {
+                clen = clen * 10 + (value.mData[i] - '0');
+            }
+            index = false;
+            break;
+
+        case EHH_CONTENT_RANGE:
+        case EHH_DATE:
+        case EHH_ETAG:
+        case EHH_LAST_MODIFIED:
+        case EHH_SET_COOKIE:
+            index = false; //changed by every response
+            break;
+
+        default:
+            break;
+        }
+        mEncoder.encode(key, value, mEncode, index);
+    }
+
+    if (204 == status || 304 == status || HTTP_HEAD == st->mMsg->getMethod() || (!chunked && 0 == clen)) {
+        st->mResp = EH2R_DONE;
+    } else if (chunked) {
+        st->mResp = EH2R_CHUNK_SIZE;
+        st->mLeft = 0;
+    } else if (clen > 0) {
+        st->mResp = EH2R_BODY;
+        st->mLeft = clen;
+    } else {
+        st->mResp = EH2R_BODY_EOF;
+    }
+
+    //split the header block by max frame size of peer
+    const bool endStream = EH2R_DONE == st->mResp;
+    const s8* blk = mEncode.getPointer();
+    usz left = mEncode.size();
+    u8 type = EH2F_HEADERS;
+    do {
+        const u32 n = (u32)AppMin<usz>(left, mPeerFrameSize);
+        u8 flags = n == left ? G_H2_END_HEADERS : 0;
+        if (EH2F_HEADERS == type && endStream) {
+            flags |= G_H2_END_STREAM;
+        }
+        writeFrameHead(n, type, flags, st->mID);
+        mOut.write(blk, (s32)n);
+        blk += n;
+        left -= n;
+        type = EH2F_CONTINUATION;
+    } while (left > 0);
+    st->mEndOut = endStream;
+    return EE_OK;
+}
+
+
+void Http2Layer::writeData(Http2Stream* st, RingBuffer* in, const s8* buf, u32 len, bool end) {
+    writeFrameHead(len, EH2F_DATA, end ? G_H2_END_STREAM : 0, st->mID);
+    if (in) {
+        for (u32 left = len; left > 0;) {
+            StringView blk = in->peekHead();
+            const u32 n = (u32)AppMin<usz>(blk.mLen, left);
+            if (0 == n) {
+                break;
+            }
+            mOut.write(blk.mData, (s32)n);
+            in->commitHead((s32)n);
+            left -= n;
+        }
+    } else if (len > 0) {
+        mOut.write(buf, (s32)len);
+    }
+    st->mWindow -= len;
+    mSendWindow -= len;
+    st->mEndOut = st->mEndOut || end;
+}
+
+
+u32 Http2Layer::getRoom(const Http2Stream* st)const {
+    s64 ret = AppMin<s64>(st->mWindow, mSendWindow);
+    ret = AppMin<s64>(ret, mPeerFrameSize);
+    return ret > 0 ? (u32)ret : 0;
+}
+
+
+void Http2Layer::resumeStreams() {
+    //backward, pump() may remove the current stream
+    for (usz i = mStreams.size(); i > 0; --i) {
+        Http2Stream* st = mStreams[i - 1];
+        if (st->mBlocked) {
+            st->mBlocked = false;
+            pump(st);
+        }
+    }
+}
+
+
+void Http2Layer::writeFrameHead(u32 len, u8 type, u8 flags, u32 sid) {
+    u8 head[G_H2_FRAME_HEAD] = {
+        (u8)(len >> 16), (u8)(len >> 8), (u8)len, type, flags,
+        (u8)((sid >> 24) & 0x7F), (u8)(sid >> 16), (u8)(sid >> 8), (u8)sid
+    };
+    mOut.write(head, G_H2_FRAME_HEAD);
+}
+
+
+void Http2Layer::writeRst(u32 sid, u32 ecode) {
+    writeFrameHead(4, EH2F_RST_STREAM, 0, sid);
+    AppWriteU32(mOut, ecode);
+}
+
+
+void Http2Layer::writeWindowUpdate(u32 sid, u32 inc) {
+    writeFrameHead(4, EH2F_WINDOW_UPDATE, 0, sid);
+    AppWriteU32(mOut, inc);
+}
+
+
+void Http2Layer::goaway(u32 ecode) {
+    Logger::log(ELL_ERROR, "Http2Layer::goaway>>remote=%s, last stream=%u, ecode=%u",
+        mLayer.getHandle().getRemote().getStr(), mLastStream, ecode);
+    writeFrameHead(8, EH2F_GOAWAY, 0, 0);
+    AppWriteU32(mOut, mLastStream);
+    AppWriteU32(mOut, ecode);
+    mGoaway = 2;
+}
+
+
+Http2Stream* Http2Layer::getStream(u32 sid)const {
+    for (usz i = 0; i < mStreams.size(); ++i) {
+        if (sid == mStreams[i]->mID) {
+            return mStreams[i];
+        }
+    }
+    return nullptr;
+}
+
+
+Http2Stream* Http2Layer::getStream(const HttpMsg* msg)const {
+    for (usz i = 0; i < mStreams.size(); ++i) {
+        if (msg == mStreams[i]->mMsg) {
+            return mStreams[i];
+        }
+    }
+    return nullptr;
+}
+
+
+void Http2Layer::resetStream(Http2Stream* st, u32 ecode) {
+    writeRst(st->mID, ecode);
+    closeStream(st);
+    flush();
+}
+
+
+void Http2Layer::finishStream(Http2Stream* st) {
+    if (!st->mEndOut) {
+        writeData(st, nullptr, nullptr, 0, true);
+    }
+    if (!st->mEndIn) {
+        writeRst(st->mID, EH2E_NO_ERROR); //the rest of request is not needed
+    }
+    closeStream(st);
+}
+
+
+void Http2Layer::closeStream(Http2Stream* st) {
+    if (st->mRecved > 0) {
+        //the body cached by stream is dropped, give back the connection window
+        mRecvConn -= st->mRecved;
+        writeWindowUpdate(0, st->mRecved);
+    }
+    for (usz i = 0; i < mStreams.size(); ++i) {
+        if (st == mStreams[i]) {
+            mStreams.erase(i);
+            break;
+        }
+    }
+    st->mMsg->drop();
+    delete st;
+}
+
+
+bool Http2Layer::sendResp(HttpMsg* msg) {
+    Http2Stream* st = getStream(msg);
+    return st ? pump(st) : false;
+}
+
+
+bool Http2Layer::sendFile(HttpMsg* msg) {
+    DASSERT(msg && msg->getFileNode());
+    return sendResp(msg);
+}
+
+
+bool Http2Layer::flush() {
+    if (mWriting || 0 == mOut.getSize()) {
+        return true;
+    }
+    RequestFD* nd = RequestFD::newRequest(0);
+    nd->mUser = this;
+    nd->mCall = Http2Layer::funcOnWrite;
+    StringView pack = mOut.peekHead();
+    nd->mData = pack.mData;
+    nd->mAllocated = (u32)pack.mLen;
+    nd->mUsed = (u32)pack.mLen;
+    if (EE_OK != mLayer.writeIF(nd)) {
+        RequestFD::delRequest(nd);
+        return false;
+    }
+    mLayer.grab();
+    mWriting = true;
+    return true;
+}
+
+
+void Http2Layer::notify() {
+    if (0 == mSent.size()) {
+        return;
+    }
+    TVector<HttpMsg*> sent;
+    sent.swap(mSent);
+    Website* site = mLayer.getWebsite();
+    for (usz i = 0; i < sent.size(); ++i) {
+        HttpMsg* msg = sent[i];
+        msg->setRespStatus(0);
+        Http2Stream* st = getStream(msg);
+        if (st) {
+            if (msg->getFileNode()) {
+                msg->setFileNode(nullptr);
+            }
+            if (msg->getEvent()) {
+                msg->getEvent()->onDrain(*msg);
+            }
+            if (msg->getCacheOut().getSize() > 0) {
+                pump(st);
+            } else {
+                const u32 sid = st->mID;
+                s32 ret = site ? site->stepMsg(msg) : EE_ERROR;
+                st = getStream(sid);
+                if (st) {
+                    if (EE_OK != ret) {
+                        resetStream(st, EH2E_INTERNAL_ERROR);
+                    } else if (ES_CLOSE == msg->getStationID()) {
+                        finishStream(st);
+                    }
+                }
+            }
+        }
+        msg->drop();
+    }
+}
+
+
+void Http2Layer::checkClose() {
+    if (mWriting || mOut.getSize() > 0) {
+        return;
+    }
+    if (2 == mGoaway || (1 == mGoaway && 0 == mStreams.size())) {
+        mLayer.postClose();
+    }
+}
+
+
+void Http2Layer::onWrite(RequestFD* it) {
+    mWriting = false;
+    if (EE_OK != it->mError) {
+        Logger::log(ELL_ERROR, "Http2Layer::onWrite>>size=%u, ecode=%d", it->mUsed, it->mError);
+    } else {
+        mOut.commitHead(static_cast<s32>(it->mUsed));
+        notify();
+        flush();
+        checkClose();
+    }
+    RequestFD::delRequest(it);
+    mLayer.drop(); //may delete this
+}
+
+
+s32 Http2Layer::onTimeout() {
+    if (!mWriting) {
+        notify();
+        flush();
+    }
+    if (mActive || mStreams.size() > 0) {
+        mActive = false;
+        return EE_OK;
+    }
+    return EE_ERROR;
+}
+
+
+void Http2Layer::onClose() {
+    Website* site = mLayer.getWebsite();
+    TVector<Http2Stream*> all;
+    all.swap(mStreams);
+    for (usz i = 0; i < all.size(); ++i) {
+        Http2Stream* st = all[i];
+        if (!st->mEndIn && site) {
+            st->mMsg->setStationID(ES_CLOSE);
+            site->stepMsg(st->mMsg);
+        }
+        st->mMsg->drop();
+        delete st;
+    }
+    for (usz i = 0; i < mSent.size(); ++i) {
+        mSent[i]->setRespStatus(0);
+        mSent[i]->drop();
+    }
+    mSent.resize(0);
+    mGoaway = 2;
+}
+
+
+}//namespace net
+}//namespace app
@@ -0,0 +1,203 @@
+#include "Net/HTTP/HttpClientPool.h"
+#include "Net/HTTP/HttpLayer.h"
+#include "Net/HTTP/HttpURL.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+//idle connections of an origin, the newest is the next of mIdle
+struct HttpClientHost {
+    Node2 mIdle;
+    u32 mCount;
+
+    HttpClientHost() : mCount(0) {
+    }
+};
+
+
+HttpClientPool::HttpClientPool(Loop* loop, RefCount* owner) :
+    mLoop(loop),
+    mOwner(owner),
+    mHits(0),
+    mMisses(0),
+    mMaxIdle(8),
+    mIdleTime(30 * 1000),
+    mIdleCount(0),
+    mRunning(false) {
+    DASSERT(loop);
+    mTime.setClose(EHT_TIME, HttpClientPool::funcOnClose, this);
+}
+
+
+HttpClientPool::~HttpClientPool() {
+    DASSERT(0 == mIdleCount);
+    TMap<String, HttpClientHost*>::Iterator it = mHosts.getIterator();
+    for (; !it.atEnd(); it++) {
+        delete it->getValue();
+    }
+    mHosts.clear();
+}
+
+
+s32 HttpClientPool::open(u32 maxIdle, u32 idleTime) {
+    if (mRunning) {
+        return EE_OK;
+    }
+    mMaxIdle = maxIdle;
+    mIdleTime = AppMax<u32>(idleTime, 1000);
+    mTime.setTime(HttpClientPool::funcOnTime, 1000, 1000, -1);
+    s32 ret = mLoop->openHandle(&mTime);
+    if (EE_OK != ret) {
+        Logger::log(ELL_ERROR, "HttpClientPool::open>>timer ecode=%d", ret);
+        return ret;
+    }
+    mRunning = true;
+    if (mOwner) {
+        mOwner->grab();
+    }
+    return EE_OK;
+}
+
+
+void HttpClientPool::close() {
+    if (!mRunning) {
+        return;
+    }
+    mRunning = false;
+    mTime.launchClose();
+    TMap<String, HttpClientHost*>::Iterator it = mHosts.getIterator();
+    for (; !it.atEnd(); it++) {
+        closeIdle(it->getValue(), 0x7FFFFFFFFFFFFFFFLL);
+    }
+}
+
+
+HttpLayer* HttpClientPool::acquire(const String& url) {
+    HttpURL hurl;
+    hurl.append(url.c_str(), url.getLen());
+    if (!hurl.parser()) {
+        Logger::log(ELL_ERROR, "HttpClientPool::acquire>>bad url=%s", url.c_str());
+        return nullptr;
+    }
+    StringView host = hurl.getHost();
+    s8 key[300];
+    snprintf(key, sizeof(key), "%s://%.*s:%u", hurl.isHttps() ? "https" : "http",
+        (s32)host.mLen, host.mData, hurl.getPort());
+    const String skey(key);
+
+    HttpClientHost* hst;
+    TMap<String, HttpClientHost*>::Node* hnd = mHosts.find(skey);
+    if (hnd) {
+        hst = hnd->getValue();
+    } else {
+        hst = new HttpClientHost();
+        mHosts.insert(skey, hst);
+    }
+
+    while (!hst->mIdle.empty()) {
+        HttpLayer* nd = static_cast<HttpLayer*>(hst->mIdle.getNext());
+        nd->delink();
+        --hst->mCount;
+        --mIdleCount;
+        if (nd->isAlive()) {
+            ++mHits;
+            nd->mMsg = new HttpMsg(nd);
+            return nd;
+        }
+        nd->postClose();
+    }
+
+    ++mMisses;
+    if (mOwner) {
+        mOwner->grab();
+    }
+    HttpLayer* nd = new HttpLayer(EHTTP_RESPONSE);
+    nd->mPool = this;
+    nd->mPoolHost = hst;
+    return nd;
+}
+
+
+bool HttpClientPool::release(HttpLayer* it) {
+    DASSERT(it && it->empty());
+    HttpClientHost* hst = it->mPoolHost;
+    if (!mRunning || !hst || hst->mCount >= mMaxIdle || !it->isAlive()) {
+        return false;
+    }
+    it->mIdleTime = mLoop->getTime();
+    hst->mIdle.pushBack(*it);
+    ++hst->mCount;
+    ++mIdleCount;
+    return true;
+}
+
+
+void HttpClientPool::abort(HttpLayer* it) {
+    DASSERT(it && it->mPool == this && it->empty());
+    if (it->mConnected) {
+        it->postClose();
+        return;
+    }
+    //never opened, so HttpLayer::onClose() will not be called
+    if (it->mMsg) {
+        HttpMsg* msg = it->mMsg;
+        it->mMsg = nullptr;
+        msg->drop();
+    }
+    it->mPool = nullptr;
+    it->drop();
+    if (mOwner) {
+        mOwner->drop(); //the pool may be deleted here
+    }
+}
+
+
+void HttpClientPool::onClose(HttpLayer* it) {
+    if (!it->empty()) {
+        //closed by peer while idle
+        it->delink();
+        --it->mPoolHost->mCount;
+        --mIdleCount;
+    }
+    if (mOwner) {
+        mOwner->drop(); //the pool may be deleted here
+    }
+}
+
+
+void HttpClientPool::closeIdle(HttpClientHost* host, s64 deadline) {
+    //the oldest is the previous of mIdle
+    while (!host->mIdle.empty()) {
+        HttpLayer* nd = static_cast<HttpLayer*>(host->mIdle.getPrevious());
+        if (nd->mIdleTime > deadline) {
+            break;
+        }
+        nd->delink();
+        --host->mCount;
+        --mIdleCount;
+        nd->postClose();
+    }
+}
+
+
+s32 HttpClientPool::onTimeout(HandleTime& it) {
+    const s64 deadline = mLoop->getTime() - mIdleTime;
+    TMap<String, HttpClientHost*>::Iterator nd = mHosts.getIterator();
+    for (; !nd.atEnd(); nd++) {
+        closeIdle(nd->getValue(), deadline);
+    }
+    return EE_OK;
+}
+
+
+void HttpClientPool::onCloseTime(Handle* it) {
+    Logger::log(ELL_INFO, "HttpClientPool::onCloseTime>>idle=%u, hit=%llu, miss=%llu",
+        mIdleCount, mHits, mMisses);
+    if (mOwner) {
+        mOwner->drop(); //the pool may be deleted here
+    }
+}
+
+} //namespace net
+} //namespace app
@@ -2,6 +2,7 @@
 #include "RingBuffer.h"
 #include "Net/HTTP/Website.h"
 #include "Net/HTTP/MsgStation.h"
+#include "Net/HTTP/HttpGzip.h"
 #include "Script/LuaFunc.h"
 
 // TODO
@@ -9,9 +10,14 @@
 namespace app {
 
 static const s32 G_BLOCK_HEAD_SIZE = 6;
+static const s32 G_BLOCK_SIZE = 4 * 1024;
 
 HttpEvtLua::HttpEvtLua(const StringView& file) :
     mReaded(0), mFileName(file), mEvtFlags(0), mMsg(nullptr), mBody(nullptr) {
+#if defined(DUSE_ZLIB)
+    mGzip = nullptr;
+    mGzipIn = nullptr;
+#endif
 
     mReqs.mCall = HttpEvtLua::funcOnRead;
     // mReqs.mUser = this;
@@ -19,6 +25,35 @@ HttpEvtLua::HttpEvtLua(const StringView& file) :
 }
 
 HttpEvtLua::~HttpEvtLua() {
+#if defined(DUSE_ZLIB)
+    delete mGzip;
+    delete[] mGzipIn;
+#endif
+}
+
+s32 HttpEvtLua::onHead(net::HttpMsg& msg) {
+#if defined(DUSE_ZLIB)
+    net::Website* site = msg.getHttpLayer()->getWebsite();
+    if (!mGzip && site && net::HttpGzip::isAccept(msg.getHeadIn())) {
+        mGzip = site->getGzipPool().pop();
+        net::HttpGzip::writeHead(msg.getHeadOut());
+    }
+#endif
+    return EE_OK;
+}
+
+void HttpEvtLua::releaseGzip() {
+#if defined(DUSE_ZLIB)
+    if (mGzip) {
+        net::Website* site = mMsg ? mMsg->getHttpLayer()->getWebsite() : nullptr;
+        if (site) {
+            site->getGzipPool().push(mGzip);
+        } else {
+            delete mGzip;
+        }
+        mGzip = nullptr;
+    }
+#endif
 }
 
 s32 HttpEvtLua::onSent(net::HttpMsg& msg) {
@@ -70,6 +105,7 @@ s32 HttpEvtLua::onFinish(net::HttpMsg& msg) {
 }
 
 void HttpEvtLua::onClose(Handle* it) {
+    releaseGzip();
     if (mMsg) {
         mMsg->drop();
         mMsg = nullptr;
@@ -89,6 +125,17 @@ void HttpEvtLua::onRead(RequestFD* it) {
         Logger::log(ELL_ERROR, "HttpEvtLua::onRead>>err file=%p", 0);
         return;
     }
+#if defined(DUSE_ZLIB)
+    if (mGzip) {
+        //stream compress, the deflate context is reused by next message of this loop
+        bool last = it->mUsed < it->mAllocated;
+        net::HttpGzip::writeChunk(*mGzip, *mBody, it->mData, it->mUsed, last);
+        if (last) {
+            mEvtFlags = true;
+            mMsg->setStationID(net::ES_RESP_BODY_DONE);
+        }
+    } else
+#endif
     if (it->mUsed > 0) {
         s8 chunked[8];
         snprintf(chunked, sizeof(chunked), "%04x\r\n", it->mUsed);
@@ -138,8 +185,19 @@ s32 HttpEvtLua::launchRead() {
         return EE_RETRY;
     }
     if (0 == mReqs.mUsed) {
-        mChunkPos = mBody->getTail();
-        mReqs.mAllocated = mBody->peekTailNode(G_BLOCK_HEAD_SIZE, &mReqs.mData, 4 * 1024);
+#if defined(DUSE_ZLIB)
+        if (mGzip) {
+            if (!mGzipIn) {
+                mGzipIn = new s8[G_BLOCK_SIZE];
+            }
+            mReqs.mData = mGzipIn;
+            mReqs.mAllocated = G_BLOCK_SIZE;
+        } else
+#endif
+        {
+            mChunkPos = mBody->getTail();
+            mReqs.mAllocated = mBody->peekTailNode(G_BLOCK_HEAD_SIZE, &mReqs.mData, G_BLOCK_SIZE);
+        }
         mReqs.mUser = this;
         // if (EE_OK != mLuaUserData.read(&mReqs, mReaded)) {
         //     mReqs.mUser = nullptr;
@@ -0,0 +1,212 @@
+#include "Net/HTTP/HttpFileCache.h"
+#include "Net/HTTP/HttpRange.h"
+#include "Net/HTTP/HttpGzip.h"
+#include "Timer.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+static const StringView G_GZIP_KEY("gz:", sizeof("gz:") - 1);
+
+HttpFileNode::HttpFileNode(const StringView& path, const StringView& mime, usz fsize, s64 mtime, bool gzip)
+    : mPrev(nullptr)
+    , mNext(nullptr)
+    , mExpire(0)
+    , mMime(mime)
+    , mBodySize(0)
+    , mFileSize(fsize)
+    , mModifyTime(mtime)
+    , mGzip(gzip) {
+    if (gzip) {
+        mPath.append(G_GZIP_KEY.mData, G_GZIP_KEY.mLen);
+    }
+    mPath.append(path.mData, path.mLen);
+    mKey.set(mPath.c_str(), mPath.getLen());
+    mETagSize = (u8)HttpRange::writeETag(mETag, sizeof(mETag), mtime, fsize, gzip);
+    mGMTSize = (u8)Timer::getTimeStrGMT(mtime, mGMT, sizeof(mGMT));
+
+    const s8* coding = "";
+#if defined(DUSE_ZLIB)
+    if (gzip) {
+        coding = "Content-Encoding:gzip\r\nVary:Accept-Encoding\r\n";
+    } else if (HttpGzip::isCompressible(mime)) {
+        coding = "Vary:Accept-Encoding\r\n";
+    }
+#endif
+    //built in a growable string, a long mime is never cut, and the head always ends with
+    //"Connection:keep-alive\r\n\r\n", see getHeadBase()
+    s8 num[24];
+    String head(320 + mime.mLen);
+    head += "HTTP/1.1 200 OK\r\nContent-Type:";
+    head.append(mime.mData, mime.mLen);
+    head += "\r\nContent-Length:";
+    head.append(num, snprintf(num, sizeof(num), "%llu", (unsigned long long)fsize));
+    head += "\r\nETag:";
+    head.append(mETag, mETagSize);
+    head += "\r\nLast-Modified:";
+    head.append(mGMT, mGMTSize);
+    head += "\r\n"
+        "Accept-Ranges:bytes\r\n"
+        "Access-Control-Allow-Origin:*\r\n";
+    head += coding;
+    head += "Connection:keep-alive\r\n"
+        "\r\n";
+    mHeadSize = head.getLen();
+    mData = new s8[mHeadSize + mFileSize];
+    memcpy(mData, head.c_str(), mHeadSize);
+}
+
+
+HttpFileNode::~HttpFileNode() {
+    delete[] mData;
+}
+
+
+bool HttpFileNode::append(const void* buf, usz len) {
+    if (mBodySize + len > mFileSize) {
+        return false;
+    }
+    memcpy(mData + mHeadSize + mBodySize, buf, len);
+    mBodySize += len;
+    return true;
+}
+
+
+
+HttpFileCache::HttpFileCache(HashDict* dict, usz maxSize, usz maxFile, u32 ttl)
+    : mDict(dict)
+    , mHead(nullptr)
+    , mTail(nullptr)
+    , mSize(0)
+    , mCount(0)
+    , mMaxSize(maxSize)
+    , mMaxFile(maxFile)
+    , mTTL(ttl) {
+}
+
+
+HttpFileCache::~HttpFileCache() {
+    clear();
+}
+
+
+void HttpFileCache::clear() {
+    if (mDict) {
+        mDict->clear();
+    }
+    for (HttpFileNode* nd = mHead; nd; nd = mHead) {
+        mHead = nd->mNext;
+        nd->mPrev = nullptr;
+        nd->mNext = nullptr;
+        nd->drop();
+    }
+    mTail = nullptr;
+    mSize = 0;
+    mCount = 0;
+}
+
+
+void HttpFileCache::unlink(HttpFileNode* it) {
+    if (it->mPrev) {
+        it->mPrev->mNext = it->mNext;
+    } else {
+        mHead = it->mNext;
+    }
+    if (it->mNext) {
+        it->mNext->mPrev = it->mPrev;
+    } else {
+        mTail = it->mPrev;
+    }
+    it->mPrev = nullptr;
+    it->mNext = nullptr;
+}
+
+
+void HttpFileCache::pushFront(HttpFileNode* it) {
+    it->mPrev = nullptr;
+    it->mNext = mHead;
+    if (mHead) {
+        mHead->mPrev = it;
+    } else {
+        mTail = it;
+    }
+    mHead = it;
+}
+
+
+HttpFileNode* HttpFileCache::get(const StringView& url, bool gzip) {
+    if (!mDict || 0 == mCount) {
+        return nullptr;
+    }
+    s8 kbuf[1024];
+    StringView path(url);
+    if (gzip) {
+        if (url.mLen + G_GZIP_KEY.mLen > sizeof(kbuf)) {
+            return nullptr;
+        }
+        memcpy(kbuf, G_GZIP_KEY.mData, G_GZIP_KEY.mLen);
+        memcpy(kbuf + G_GZIP_KEY.mLen, url.mData, url.mLen);
+        path.set(kbuf, G_GZIP_KEY.mLen + url.mLen);
+    }
+    DictNode* dn = mDict->find(&path);
+    if (!dn) {
+        return nullptr;
+    }
+    HttpFileNode* nd = reinterpret_cast<HttpFileNode*>(dn->mValue.mVal);
+    if (Timer::getRelativeTime() >= nd->mExpire) {
+        //expired, reload it
+        remove(path);
+        return nullptr;
+    }
+    if (nd != mHead) {
+        unlink(nd);
+        pushFront(nd);
+    }
+    return nd;
+}
+
+
+bool HttpFileCache::add(HttpFileNode* it) {
+    if (!it || !it->isFull() || !canCache(it->getFileSize())) {
+        return false;
+    }
+    remove(it->getKey());
+
+    const usz msz = it->getMemSize();
+    while (mTail && mSize + msz > mMaxSize) {
+        remove(mTail->getKey());
+    }
+
+    if (DICT_OK != mDict->add(&it->mKey, it)) {
+        Logger::log(ELL_ERROR, "HttpFileCache::add>>fail to add=%.*s", (s32)it->mKey.mLen, it->mKey.mData);
+        return false;
+    }
+    it->grab();
+    it->mExpire = Timer::getRelativeTime() + mTTL;
+    pushFront(it);
+    mSize += msz;
+    ++mCount;
+    return true;
+}
+
+
+void HttpFileCache::remove(const StringView& path) {
+    if (!mDict) {
+        return;
+    }
+    DictNode* dn = mDict->unlink(&path);
+    if (!dn) {
+        return;
+    }
+    HttpFileNode* nd = reinterpret_cast<HttpFileNode*>(dn->mValue.mVal);
+    mDict->releaseNode(dn);
+    unlink(nd);
+    mSize -= nd->getMemSize();
+    --mCount;
+    nd->drop();
+}
+
+
+}//namespace net
+}//namespace app
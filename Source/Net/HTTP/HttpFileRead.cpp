@@ -1,17 +1,32 @@
 #include "Net/HTTP/HttpFileRead.h"
 #include "RingBuffer.h"
+#include "Timer.h"
 #include "Net/HTTP/Website.h"
 #include "Net/HTTP/MsgStation.h"
+#include "Net/HTTP/HttpRange.h"
 
 namespace app {
 
-static const s32 G_BLOCK_HEAD_SIZE = 6;
+static const s32 G_READ_SIZE = 4 * 1024;
+
+//watermarks of output cache per response
+static const s32 G_HIGH_MARK = 256 * 1024;
+static const s32 G_LOW_MARK = 64 * 1024;
+
+//bytes buffered by all readers, over G_MAX_BUFFERED the readers fill to G_LOW_MARK only
+static const usz G_MAX_BUFFERED = 64 * 1024 * 1024;
+static usz G_BUFFERED = 0;
 
 HttpFileRead::HttpFileRead()
     :mReaded(0)
+    , mOffset(0)
+    , mLeft(0)
+    , mBuffered(0)
     , mMsg(nullptr)
     , mBody(nullptr)
-    , mDone(false) {
+    , mCacheNode(nullptr)
+    , mDone(false)
+    , mGzip(false) {
 
     mReqs.mCall = HttpFileRead::funcOnRead;
     //mReqs.mUser = this;
@@ -20,6 +35,10 @@ HttpFileRead::HttpFileRead()
 }
 
 HttpFileRead::~HttpFileRead() {
+    if (mCacheNode) {
+        mCacheNode->drop();
+        mCacheNode = nullptr;
+    }
 }
 
 s32 HttpFileRead::onSent(net::HttpMsg& msg) {
@@ -27,6 +46,19 @@ s32 HttpFileRead::onSent(net::HttpMsg& msg) {
     return EE_OK;
 }
 
+s32 HttpFileRead::onHead(net::HttpMsg& msg) {
+#if defined(DUSE_ZLIB)
+    //the .gz sibling is tried by onOpen(), the plain file is the fallback
+    StringView path = msg.getURL().getPath();
+    mGzip = false;
+    if (net::HttpGzip::isCompressible(net::HttpMsg::getMimeType(path.mData, path.mLen))) {
+        net::HttpGzip::writeVary(msg.getHeadOut());
+        mGzip = net::HTTP_GET == msg.getMethod() && net::HttpGzip::isAccept(msg.getHeadIn());
+    }
+#endif
+    return EE_OK;
+}
+
 s32 HttpFileRead::onOpen(net::HttpMsg& msg) {
     mDone = false;
     mReaded = 0;
@@ -37,18 +69,57 @@ s32 HttpFileRead::onOpen(net::HttpMsg& msg) {
     }
     String fnm(site->getConfig().mRootPath);
     fnm += msg.getURL().getPath();
-    if (EE_OK == mFile.open(fnm, 1)) {
-        msg.grab();
-        grab();
-        mMsg = &msg;
-        if (EE_OK != launchRead()) {
-            mDone = true;
-            mFile.launchClose();
-            return EE_POSTED;
-        }
+    if (mGzip) {
+        const usz plen = fnm.getLen();
+        fnm += ".gz";
+        mGzip = EE_OK == mFile.open(fnm, 1 | 8);
+        fnm.setLen(plen);
+    }
+    if (!mGzip && EE_OK != mFile.open(fnm, 1)) {
+        return EE_ERROR;
+    }
+#if defined(DUSE_ZLIB)
+    if (mGzip) {
+        net::HttpGzip::writeEncoding(msg.getHeadOut());
+    }
+#endif
+    msg.grab();
+    grab();
+    mMsg = &msg;
+
+    //304 & 416 skip the file, a range is read from its offset
+    const usz fsize = mFile.getFileSize();
+    s8 etag[40];
+    s8 gmt[40];
+    StringView tag(etag, net::HttpRange::writeETag(etag, sizeof(etag), mFile.getModifyTime(), fsize, mGzip));
+    StringView mtime(gmt, Timer::getTimeStrGMT(mFile.getModifyTime(), gmt, sizeof(gmt)));
+    s32 status = net::HTTP_STATUS_OK;
+    usz start = 0;
+    usz len = fsize;
+    if (net::HTTP_GET == msg.getMethod() || net::HTTP_HEAD == msg.getMethod()) {
+        status = net::HttpRange::check(msg.getHeadIn(), tag, mtime, fsize, start, len);
+    }
+    net::HttpRange::writeHead(msg, status, tag, mtime, fsize, start, len);
+    mOffset = start;
+    mLeft = (net::HTTP_STATUS_OK == status || net::HTTP_STATUS_PARTIAL_CONTENT == status) ? len : 0;
+    if (0 == mLeft || net::HTTP_HEAD == msg.getMethod()) {
+        mDone = true;
+        msg.setStationID(net::ES_RESP_BODY_DONE);
+        mFile.launchClose();
         return EE_OK;
     }
-    return EE_ERROR;
+
+    if (net::HTTP_STATUS_OK == status && net::HTTP_GET == msg.getMethod() && site->getCache().canCache(fsize)) {
+        StringView path = msg.getURL().getPath();
+        mCacheNode = new net::HttpFileNode(path, net::HttpMsg::getMimeType(path.mData, path.mLen),
+            fsize, mFile.getModifyTime(), mGzip);
+    }
+    if (EE_OK != launchRead()) {
+        mDone = true;
+        mFile.launchClose();
+        return EE_POSTED;
+    }
+    return EE_OK;
 }
 
 s32 HttpFileRead::onClose() {
@@ -63,7 +134,33 @@ s32 HttpFileRead::onFinish(net::HttpMsg& msg) {
     return onBodyPart(msg);
 }
 
+s32 HttpFileRead::onDrain(net::HttpMsg& msg) {
+    if (!mBody) {
+        return EE_OK;
+    }
+    updateBuffered(mDone ? 0 : mBody->getSize());
+    if (!mDone && mFile.isOpen() && mBody->getSize() <= G_LOW_MARK) {
+        launchRead();
+    }
+    return EE_OK;
+}
+
+bool HttpFileRead::isFull()const {
+    return mBody->getSize() >= (G_BUFFERED > G_MAX_BUFFERED ? G_LOW_MARK : G_HIGH_MARK);
+}
+
+void HttpFileRead::updateBuffered(usz now) {
+    G_BUFFERED -= mBuffered;
+    G_BUFFERED += now;
+    mBuffered = now;
+}
+
 void HttpFileRead::onFileClose(Handle* it) {
+    updateBuffered(0);
+    if (mCacheNode) {
+        mCacheNode->drop();
+        mCacheNode = nullptr;
+    }
     if (mMsg) {
         mMsg->drop();
         mMsg = nullptr;
@@ -76,29 +173,40 @@ void HttpFileRead::onFileClose(Handle* it) {
 void HttpFileRead::onFileRead(RequestFD* it) {
     if (it->mError) {
         mDone = true;
+        if (mCacheNode) {
+            mCacheNode->drop();
+            mCacheNode = nullptr;
+        }
         mMsg->setStationID(net::ES_RESP_BODY_DONE);
         mFile.launchClose();
         Logger::log(ELL_ERROR, "HttpFileRead::onFileRead>>err file=%s", mFile.getFileName().c_str());
         return;
     }
+    if (mCacheNode && !mCacheNode->append(it->mData, it->mUsed)) {
+        mCacheNode->drop(); //file changed while reading
+        mCacheNode = nullptr;
+    }
     if (it->mUsed > 0) {
-        s8 chunked[8];
-        snprintf(chunked, sizeof(chunked), "%04x\r\n", it->mUsed);
-        mBody->rewrite(mChunkPos, chunked, G_BLOCK_HEAD_SIZE);
+        //read into the send cache directly, the body has Content-Length
         mBody->commitTailPos(it->mUsed);
-        mBody->write("\r\n", 2);
-        if (it->mUsed < it->mAllocated) {
+        mLeft -= it->mUsed;
+        if (0 == mLeft) {
             mDone = true;
-            mBody->write("0\r\n\r\n", 5);
             mMsg->setStationID(net::ES_RESP_BODY_DONE);
         }
     } else {
+        //truncated while reading, the Content-Length can't be fulfilled
+        Logger::log(ELL_ERROR, "HttpFileRead::onFileRead>>truncated file=%s, left=%llu",
+            mFile.getFileName().c_str(), (u64)mLeft);
         mDone = true;
-        mBody->write("0\r\n\r\n", 5);
         mMsg->setStationID(net::ES_RESP_BODY_DONE);
+        mMsg->getHttpLayer()->postClose();
     }
 
     net::Website* site = mMsg->getHttpLayer()->getWebsite();
+    if (mDone && mCacheNode && site) {
+        addCache(site);
+    }
     if (site) {
         if (EE_OK != site->stepMsg(mMsg)) {
             mDone = true;
@@ -111,12 +219,38 @@ void HttpFileRead::onFileRead(RequestFD* it) {
     it->mUsed = 0;
     it->mUser = nullptr;
     if (mDone) {
+        updateBuffered(0);
         mFile.launchClose();
     } else {
-        launchRead();
+        updateBuffered(mBody->getSize());
+        if (!isFull()) {
+            launchRead();
+        }
     }
 }
 
+void HttpFileRead::addCache(net::Website* site) {
+    net::HttpFileCache& cache = site->getCache();
+    if (mCacheNode->isFull() && cache.add(mCacheNode)) {
+#if defined(DUSE_ZLIB)
+        //keep a compressed variant of text files which have no .gz sibling
+        if (!mGzip && net::HttpGzip::isCompressible(mCacheNode->getMime())) {
+            net::HttpGzipPool& pool = site->getGzipPool();
+            EncoderGzip* enc = pool.pop();
+            net::HttpFileNode* gz = net::HttpGzip::compress(*enc, *mCacheNode);
+            pool.push(enc);
+            if (gz) {
+                cache.add(gz);
+                gz->drop();
+            }
+        }
+#endif
+    }
+    mCacheNode->drop();
+    mCacheNode = nullptr;
+}
+
+
 s32 HttpFileRead::onBodyPart(net::HttpMsg& msg) {
     if (!mFile.isOpen()) {
         return EE_ERROR;
@@ -130,10 +264,9 @@ s32 HttpFileRead::launchRead() {
         return EE_RETRY;
     }
     if (0 == mReqs.mUsed) {
-        mChunkPos = mBody->getTail();
-        mReqs.mAllocated = mBody->peekTailNode(G_BLOCK_HEAD_SIZE, &mReqs.mData, 4 * 1024);
+        mReqs.mAllocated = mBody->peekTailNode(&mReqs.mData, (s32)AppMin<usz>(mLeft, G_READ_SIZE));
         mReqs.mUser = this;
-        if (EE_OK != mFile.read(&mReqs, mReaded)) {
+        if (EE_OK != mFile.read(&mReqs, mOffset + mReaded)) {
             mReqs.mUser = nullptr;
             return mFile.launchClose();
         }
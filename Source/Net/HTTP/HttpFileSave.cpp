@@ -1,15 +1,37 @@
+#include <atomic>
 #include "Net/HTTP/HttpFileSave.h"
 #include "RingBuffer.h"
+#include "Engine.h"
+#include "System.h"
+#include "Net/HTTP/Website.h"
+#include "Net/HTTP/MsgStation.h"
 
 namespace app {
 
+const u32 HttpFileSave::G_MAX_DEPTH;
+
+//id of upload file in this process, the pid in name tells the processes apart
+static std::atomic<u32> G_UPLOAD_ID(0);
+
 HttpFileSave::HttpFileSave()
-    :mWrited(0)
-    , mBody(nullptr)
-    , mDone(false) {
+    :mFirst(0)
+    , mFly(0)
+    , mDepth(1)
+    , mMsg(nullptr)
+    , mLaunched(0)
+    , mWrited(0)
+    , mReserved(0)
+    , mMaxSize(~(usz)0)
+    , mBodyDone(false)
+    , mError(false)
+    , mDone(false)
+    , mSaved(false)
+    , mTooLarge(false) {
 
-    mReqs.mCall = HttpFileSave::funcOnWrite;
-    mReqs.mUser = this;
+    for (u32 i = 0; i < G_MAX_DEPTH; ++i) {
+        mSlots[i].mReq.mCall = HttpFileSave::funcOnWrite;
+        mSlots[i].mReq.mUser = this;
+    }
 
     mFile.setClose(EHT_FILE, HttpFileSave::funcOnClose, this);
 }
@@ -22,22 +44,75 @@ s32 HttpFileSave::onSent(net::HttpMsg& msg) {
     return EE_OK;
 }
 
+s32 HttpFileSave::onHead(net::HttpMsg& msg) {
+    net::Website* site = msg.getHttpLayer()->getWebsite();
+    mDepth = site ? AppClamp<u32>(site->getConfig().mUploadDepth, 1, G_MAX_DEPTH) : 1;
+    mMaxSize = site ? static_cast<usz>(site->getConfig().mUploadMax) : ~(usz)0;
+
+    StringView val = msg.getHeadIn().get(net::EHH_CONTENT_LENGTH);
+    usz len = 0;
+    for (usz i = 0; i < val.mLen && val.mData[i] >= '0' && val.mData[i] <= '9'; ++i) {
+        const usz num = val.mData[i] - '0';
+        if (len > (mMaxSize - num) / 10) {
+            //the body is dropped, and 413 is sent by onOpen()
+            mTooLarge = true;
+            Logger::log(ELL_INFO, "HttpFileSave::onHead>>too large, Content-Length=%.*s, max=%llu",
+                (s32)val.mLen, val.mData, (u64)mMaxSize);
+            return EE_ERROR;
+        }
+        len = len * 10 + num;
+    }
+    //each upload owns its file, so the truncate in closeFile() never cuts the bytes of others
+    s8 name[64];
+    snprintf(name, sizeof(name), "upload_%d_%u.bin", System::getPID(), ++G_UPLOAD_ID);
+    if (EE_OK != mFile.open(Engine::getInstance().getConfig().mLogPath + name, 6)) {
+        return EE_ERROR;
+    }
+    grab();
+    mMsg = &msg;
+    if (mFile.getFileSize() > 0) {
+        mFile.setFileSize(0); //left by an old process of the same pid
+    }
+
+    //pre-size the file, the writes in flight will not fight for extents
+    if (len > 0) {
+        if (mFile.reserve(0, len)) {
+            mReserved = len;
+        } else {
+            Logger::log(ELL_INFO, "HttpFileSave::onHead>>can't reserve %llu bytes, file=%s",
+                (u64)len, mFile.getFileName().c_str());
+        }
+    }
+    return EE_OK;
+}
+
 s32 HttpFileSave::onOpen(net::HttpMsg& msg) {
-    mDone = false;
-    mBody = &msg.getCacheOut();
-    s32 ret = mFile.open("Log/httpfile.html", 4);
-    if (EE_OK == ret) {
-        mWrited = mFile.getFileSize();
+    if (mTooLarge) {
+        msg.setStatus(net::HTTP_STATUS_PAYLOAD_TOO_LARGE);
+        return EE_ERROR;
+    }
+    if (!mFile.isOpen() || mError) {
+        return EE_ERROR;
     }
-    return ret;
+    mBodyDone = true;
+    if (EE_OK != launchWrite()) {
+        mError = true;
+        return EE_ERROR;
+    }
+    if (0 == mFly) {
+        finish(false);
+    }
+    return EE_OK;
 }
 
 s32 HttpFileSave::onClose() {
     mDone = true;
-    if (mFile.isClose()) {
-        delete this;
-    } else {
-        mFile.launchClose();
+    if (0 == mFly) {
+        if (!mTooLarge && !mFile.isClose()) {
+            closeFile();
+        } else {
+            mMsg = nullptr;
+        }
     }
     return EE_OK;
 }
@@ -47,45 +122,166 @@ s32 HttpFileSave::onFinish(net::HttpMsg& msg) {
 }
 
 void HttpFileSave::onFileClose(Handle* it) {
-    if (mDone) {
-        delete this;
+    if (mRemove.size() > 0) {
+        System::removeFile(mRemove);
     }
+    drop();
 }
 
 void HttpFileSave::onFileWrite(RequestFD* it) {
-    if (it->mError) {
-        return;
+    Slot* slot = nullptr;
+    for (u32 i = 0; i < mFly; ++i) {
+        slot = &mSlots[(mFirst + i) % G_MAX_DEPTH];
+        if (&slot->mReq == it) {
+            break;
+        }
     }
-    mBody->commitHead(it->mUsed);
-    mWrited += it->mUsed;
-    it->mUsed = 0;
-    if (mDone) {
-        mFile.launchClose();
-    } else {
-        launchWrite();
+    DASSERT(slot && &slot->mReq == it);
+
+    if (it->mError || 0 == it->mUsed) {
+        mError = true;
+        Logger::log(ELL_ERROR, "HttpFileSave::onFileWrite>>err=%d, offset=%llu, file=%s",
+            it->mError, (u64)slot->mOffset, mFile.getFileName().c_str());
+    } else if (it->mUsed < it->mAllocated) {
+        //short write, go on with the rest of block
+        if (EE_OK == mFile.write(it, slot->mOffset + it->mUsed)) {
+            return;
+        }
+        mError = true;
+    }
+    slot->mFinish = true;
+
+    //release the blocks of receive cache in order
+    RingBuffer& body = mMsg->getCacheIn();
+    while (mFly > 0 && mSlots[mFirst].mFinish) {
+        Slot& nd = mSlots[mFirst];
+        nd.mFinish = false;
+        mWrited += nd.mReq.mAllocated;
+        body.commitHeadPos(nd.mEnd);
+        mFirst = (mFirst + 1) % G_MAX_DEPTH;
+        --mFly;
+    }
+    mMsg->getHttpLayer()->onBodyUsed(mMsg);
+
+    if (!mError && !mDone) {
+        if (EE_OK != launchWrite()) {
+            mError = true;
+        } else if (mBodyDone && 0 == mFly) {
+            finish(true);
+        }
+    }
+    if (0 == mFly) {
+        net::HttpMsg* msg = mMsg;
+        if (mError && !mDone) {
+            mDone = true;
+            msg->getHttpLayer()->postClose();
+        }
+        if (mDone) {
+            closeFile();
+        }
+        msg->drop(); //may call onClose()
     }
 }
 
 s32 HttpFileSave::onBodyPart(net::HttpMsg& msg) {
-    if (!mFile.isOpen()) {
+    if (mTooLarge) {
+        msg.getCacheIn().reset();
+        msg.getHttpLayer()->onBodyUsed(&msg);
+        return EE_ERROR;
+    }
+    if (!mFile.isOpen() || mError || mDone) {
+        return EE_ERROR;
+    }
+    if (EE_OK != launchWrite()) {
+        mError = true;
+        if (0 == mFly) {
+            mDone = true;
+            msg.getHttpLayer()->postClose();
+        }
         return EE_ERROR;
     }
-    return launchWrite();
+    return EE_OK;
 }
 
 
 s32 HttpFileSave::launchWrite() {
-    if (0 == mReqs.mUsed && mBody->getSize() > 0) {
-        StringView buf = mBody->peekHead();
-        mReqs.mData = buf.mData;
-        mReqs.mAllocated = static_cast<u32>(buf.mLen);
-        mReqs.mUsed = mReqs.mAllocated;
-        if (EE_OK != mFile.write(&mReqs, mWrited)) {
-            return mFile.launchClose();
+    RingBuffer& body = mMsg->getCacheIn();
+    if (!mWritePos.mNode) {
+        mWritePos = body.getHead();
+    }
+    while (mFly < mDepth) {
+        StringView buf;
+        s32 cnt = 1;
+        SRingBufPos end = body.peekHeadNode(mWritePos, &buf, &cnt);
+        if (0 == cnt) {
+            break;
+        }
+        if (buf.mLen > mMaxSize - mLaunched) {
+            //a body without Content-Length grows over the limit
+            Logger::log(ELL_INFO, "HttpFileSave::launchWrite>>too large, max=%llu, file=%s",
+                (u64)mMaxSize, mFile.getFileName().c_str());
+            mMsg->setStatus(net::HTTP_STATUS_PAYLOAD_TOO_LARGE);
+            return EE_ERROR;
         }
+        Slot& slot = mSlots[(mFirst + mFly) % G_MAX_DEPTH];
+        slot.mReq.mData = buf.mData;
+        slot.mReq.mAllocated = static_cast<u32>(buf.mLen);
+        slot.mReq.mUsed = 0;
+        slot.mEnd = end;
+        slot.mOffset = mLaunched;
+        slot.mFinish = false;
+        if (EE_OK != mFile.write(&slot.mReq, slot.mOffset)) {
+            return EE_ERROR;
+        }
+        if (0 == mFly++) {
+            mMsg->grab(); //keep the receive cache till the writes are done
+        }
+        mWritePos = end;
+        mLaunched += buf.mLen;
     }
     return EE_OK;
 }
 
 
+void HttpFileSave::finish(bool step) {
+    mDone = true;
+    mSaved = true;
+    Logger::log(ELL_INFO, "HttpFileSave::finish>>saved=%llu, file=%s",
+        (u64)mWrited, mFile.getFileName().c_str());
+    net::HttpMsg& msg = *mMsg;
+    net::HttpHead& hed = msg.getHeadOut();
+    StringView key("Transfer-Encoding", sizeof("Transfer-Encoding") - 1);
+    hed.remove(key);
+    hed.writeLength(0);
+    msg.getCacheOut().reset();
+    msg.writeStatus(net::HTTP_STATUS_OK);
+    msg.dumpHeadOut();
+    msg.writeOutBody("\r\n", 2);
+    msg.setStationID(net::ES_RESP_BODY_DONE);
+    if (!step) {
+        //called in onOpen(), StationBodyDone sends it
+        closeFile();
+        return;
+    }
+    net::Website* site = msg.getHttpLayer()->getWebsite();
+    if (!site || EE_OK != site->stepMsg(&msg)) {
+        msg.getHttpLayer()->postClose();
+    }
+}
+
+
+void HttpFileSave::closeFile() {
+    mMsg = nullptr;
+    //KEEP_SIZE reservation stays after EOF, truncate gives back the part never written
+    if (mWrited < mReserved) {
+        mFile.setFileSize(mWrited);
+    }
+    if (!mSaved) {
+        //a failed or aborted upload leaves nothing behind, the name is cleared by close
+        mRemove = mFile.getFileName();
+    }
+    mFile.launchClose();
+}
+
+
 }//namespace app
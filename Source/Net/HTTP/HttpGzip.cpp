@@ -0,0 +1,160 @@
+#include "Net/HTTP/HttpGzip.h"
+#include "Packet.h"
+
+#if defined(DUSE_ZLIB)
+
+namespace app {
+namespace net {
+
+static const usz G_GZIP_CHUNK = 4 * 1024;
+
+bool HttpGzip::isAccept(const HttpHead& head) {
+    StringView val = head.get(EHH_ACCEPT_ENCODING);
+    const s8* curr = val.mData;
+    const s8* end = val.mData + val.mLen;
+    while (curr < end) {
+        while (curr < end && (' ' == *curr || '\t' == *curr || ',' == *curr)) {
+            ++curr;
+        }
+        const s8* tok = curr;
+        while (curr < end && ',' != *curr && ';' != *curr && ' ' != *curr) {
+            ++curr;
+        }
+        usz tlen = curr - tok;
+        bool hit = (4 == tlen && 0 == AppStrNocaseCMP(tok, "gzip", 4)) || (1 == tlen && '*' == *tok);
+        const s8* param = curr;
+        while (curr < end && ',' != *curr) {
+            ++curr;
+        }
+        if (hit) {
+            //gzip;q=0 means not acceptable
+            for (; param + 2 < curr; ++param) {
+                if (('q' == param[0] || 'Q' == param[0]) && '=' == param[1]) {
+                    param += 2;
+                    while (param < curr && ('0' == *param || '.' == *param)) {
+                        ++param;
+                    }
+                    return param < curr && *param >= '1' && *param <= '9';
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool HttpGzip::isCompressible(const StringView& mime) {
+    if (mime.mLen > 5 && 0 == AppStrNocaseCMP(mime.mData, "text/", 5)) {
+        return true;
+    }
+    static const StringView G_MIMES[] = {
+        {"application/json", sizeof("application/json") - 1},
+        {"application/x-javascript", sizeof("application/x-javascript") - 1},
+        {"application/javascript", sizeof("application/javascript") - 1},
+        {"application/xml", sizeof("application/xml") - 1},
+        {"application/postscript", sizeof("application/postscript") - 1},
+        {"image/svg+xml", sizeof("image/svg+xml") - 1}
+    };
+    for (usz i = 0; i < sizeof(G_MIMES) / sizeof(G_MIMES[0]); ++i) {
+        if (mime.mLen >= G_MIMES[i].mLen && 0 == AppStrNocaseCMP(mime.mData, G_MIMES[i].mData, G_MIMES[i].mLen)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void HttpGzip::writeHead(HttpHead& head) {
+    writeEncoding(head);
+    writeVary(head);
+}
+
+
+void HttpGzip::writeEncoding(HttpHead& head) {
+    StringView val("gzip", sizeof("gzip") - 1);
+    head.add(EHH_CONTENT_ENCODING, val);
+}
+
+
+void HttpGzip::writeVary(HttpHead& head) {
+    head.add(EHH_VARY, head.getName(EHH_ACCEPT_ENCODING));
+}
+
+
+void HttpGzip::writeChunk(EncoderGzip& enc, RingBuffer& out, const void* data, usz len, bool last) {
+    s8 buf[G_GZIP_CHUNK];
+    s8 chunked[16];
+    const s32 flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+    usz got;
+    enc.setInput(reinterpret_cast<const s8*>(data), len);
+    do {
+        got = enc.compressTo(buf, sizeof(buf), flush);
+        if (got > 0) {
+            out.write(chunked, snprintf(chunked, sizeof(chunked), "%llx\r\n", (unsigned long long)got));
+            out.write(buf, (s32)got);
+            out.write("\r\n", 2);
+        }
+    } while (got == sizeof(buf));
+    if (last) {
+        out.write("0\r\n\r\n", 5);
+    }
+}
+
+
+HttpFileNode* HttpGzip::compress(EncoderGzip& enc, const HttpFileNode& src) {
+    StringView body = src.getBody();
+    if (!src.isFull() || body.mLen < 256) {
+        return nullptr;
+    }
+    Packet out(body.mLen);
+    enc.setInput(body.mData, body.mLen);
+    usz got = enc.compressTo(out.getPointer(), body.mLen, Z_FINISH);
+    if (got >= body.mLen) {
+        return nullptr; //not worth
+    }
+    HttpFileNode* ret = new HttpFileNode(src.getPath(), src.getMime(), got, src.getModifyTime(), true);
+    ret->append(out.getPointer(), got);
+    return ret;
+}
+
+
+HttpGzipPool::HttpGzipPool(u32 maxIdle) : mMaxIdle(maxIdle) {
+}
+
+
+HttpGzipPool::~HttpGzipPool() {
+    for (usz i = 0; i < mIdle.size(); ++i) {
+        delete mIdle[i];
+    }
+    mIdle.clear();
+}
+
+
+EncoderGzip* HttpGzipPool::pop() {
+    if (mIdle.size() > 0) {
+        EncoderGzip* ret = mIdle.getLast();
+        mIdle.resize(mIdle.size() - 1);
+        return ret;
+    }
+    return new EncoderGzip();
+}
+
+
+void HttpGzipPool::push(EncoderGzip* it) {
+    if (!it) {
+        return;
+    }
+    if (mIdle.size() < mMaxIdle) {
+        it->reset();
+        mIdle.pushBack(it);
+    } else {
+        delete it;
+    }
+}
+
+
+}//namespace net
+}//namespace app
+
+#endif // DUSE_ZLIB
@@ -28,7 +28,93 @@
 namespace app {
 namespace net {
 
+static const StringView G_HEAD_NAME[EHH_COUNT] = {
+    {"Accept", sizeof("Accept") - 1},
+    {"Accept-Charset", sizeof("Accept-Charset") - 1},
+    {"Accept-Encoding", sizeof("Accept-Encoding") - 1},
+    {"Accept-Language", sizeof("Accept-Language") - 1},
+    {"Accept-Ranges", sizeof("Accept-Ranges") - 1},
+    {"Access-Control-Allow-Origin", sizeof("Access-Control-Allow-Origin") - 1},
+    {"Age", sizeof("Age") - 1},
+    {"Allow", sizeof("Allow") - 1},
+    {"Authorization", sizeof("Authorization") - 1},
+    {"Cache-Control", sizeof("Cache-Control") - 1},
+    {"Connection", sizeof("Connection") - 1},
+    {"Content-Disposition", sizeof("Content-Disposition") - 1},
+    {"Content-Encoding", sizeof("Content-Encoding") - 1},
+    {"Content-Language", sizeof("Content-Language") - 1},
+    {"Content-Length", sizeof("Content-Length") - 1},
+    {"Content-Location", sizeof("Content-Location") - 1},
+    {"Content-Range", sizeof("Content-Range") - 1},
+    {"Content-Type", sizeof("Content-Type") - 1},
+    {"Cookie", sizeof("Cookie") - 1},
+    {"Date", sizeof("Date") - 1},
+    {"ETag", sizeof("ETag") - 1},
+    {"Expect", sizeof("Expect") - 1},
+    {"Expires", sizeof("Expires") - 1},
+    {"Host", sizeof("Host") - 1},
+    {"If-Match", sizeof("If-Match") - 1},
+    {"If-Modified-Since", sizeof("If-Modified-Since") - 1},
+    {"If-None-Match", sizeof("If-None-Match") - 1},
+    {"If-Range", sizeof("If-Range") - 1},
+    {"If-Unmodified-Since", sizeof("If-Unmodified-Since") - 1},
+    {"Keep-Alive", sizeof("Keep-Alive") - 1},
+    {"Last-Modified", sizeof("Last-Modified") - 1},
+    {"Location", sizeof("Location") - 1},
+    {"Origin", sizeof("Origin") - 1},
+    {"Pragma", sizeof("Pragma") - 1},
+    {"Proxy-Authorization", sizeof("Proxy-Authorization") - 1},
+    {"Proxy-Connection", sizeof("Proxy-Connection") - 1},
+    {"Range", sizeof("Range") - 1},
+    {"Referer", sizeof("Referer") - 1},
+    {"Server", sizeof("Server") - 1},
+    {"Set-Cookie", sizeof("Set-Cookie") - 1},
+    {"TE", sizeof("TE") - 1},
+    {"Transfer-Encoding", sizeof("Transfer-Encoding") - 1},
+    {"Upgrade", sizeof("Upgrade") - 1},
+    {"User-Agent", sizeof("User-Agent") - 1},
+    {"Vary", sizeof("Vary") - 1},
+    {"Via", sizeof("Via") - 1},
+    {"X-Forwarded-For", sizeof("X-Forwarded-For") - 1},
+    {"X-Real-IP", sizeof("X-Real-IP") - 1},
+};
+
+static const s8 G_HEAD_SLOT[128] = {
+    -1,  9, -1, -1, -1, -1, 47,  4, 40, -1, -1, -1, -1,  0, -1, -1,
+    -1, -1, 30, 39, 23, -1, 44,  2, 45,  1, -1, 38, 19, 24, -1, 22,
+    36, 16, -1, 42, -1, -1, -1, 29, -1, -1, -1, 12, 37, -1, -1, -1,
+    31, -1, -1,  5, -1, -1, -1, 15, -1, 20, 46, 18, -1, -1, -1, 25,
+    -1, -1, -1,  3, 35, -1, -1, 32, -1, -1, -1, 10, -1, 27, 41, 14,
+    -1, 43, -1, -1, -1, -1, -1, 13, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, 28, -1, -1, -1, -1, -1, -1, -1,  6, -1, 11, -1,  7,
+    -1, -1, -1, -1, -1, 21, -1, 26, 33, -1, 34, 17, -1, -1, -1,  8,
+};
+
+
+//perfect hash of the well-known names, verified by G_HEAD_SLOT
+EHttpHeadID HttpHead::getID(const StringView& key) {
+    if (key.mLen < 2 || key.mLen > 32) {
+        return EHH_UNKNOWN;
+    }
+    const u8* str = reinterpret_cast<const u8*>(key.mData);
+    u32 slot = (u32)(key.mLen * 18 + (str[0] | 0x20) + (str[key.mLen - 2] | 0x20) * 12) & 127;
+    s32 id = G_HEAD_SLOT[slot];
+    if (id < 0 || G_HEAD_NAME[id].mLen != key.mLen
+        || 0 != AppStrNocaseCMP(G_HEAD_NAME[id].mData, key.mData, key.mLen)) {
+        return EHH_UNKNOWN;
+    }
+    return (EHttpHeadID)id;
+}
+
+
+const StringView& HttpHead::getName(EHttpHeadID id) {
+    DASSERT(id < EHH_COUNT);
+    return G_HEAD_NAME[id];
+}
+
+
 HttpHead::HttpHead() {
+    memset(mIndex, 0, sizeof(mIndex));
 }
 
 
@@ -37,36 +123,85 @@ HttpHead::~HttpHead() {
 
 
 bool HttpHead::isChunked()const {
-    StringView nm("Transfer-Encoding", sizeof("Transfer-Encoding") - 1);
-    const StringView& par = get(nm);
+    const StringView par = get(EHH_TRANSFER_ENCODING);
     return 7 == par.mLen && 0 == AppStrNocaseCMP("chunked", par.mData, sizeof("chunked") - 1);
 }
 
+void HttpHead::addIndex(EHttpHeadID id) {
+    if (id < EHH_COUNT && 0 == mIndex[id] && mData.size() < 0xFFFF) {
+        mIndex[id] = (u16)mData.size();
+    }
+}
+
+void HttpHead::resetIndex() {
+    memset(mIndex, 0, sizeof(mIndex));
+    const usz mx = mData.size() < 0xFFFF ? mData.size() : 0xFFFF;
+    for (usz i = mx; i > 0; --i) {
+        const String& key = mData[i - 1].mKey;
+        EHttpHeadID id = getID(StringView(key.c_str(), key.getLen()));
+        if (id < EHH_COUNT) {
+            mIndex[id] = (u16)i;
+        }
+    }
+}
+
 void HttpHead::add(const StringView& key, const StringView& val) {
     HeadLine nd = {key, val};
     mData.emplaceBack(nd);
+    addIndex(getID(key));
 }
 
 void HttpHead::add(const String& key, const String& val) {
     HeadLine nd = {key, val};
     mData.emplaceBack(nd);
+    addIndex(getID(StringView(key.c_str(), key.getLen())));
+}
+
+void HttpHead::add(EHttpHeadID id, const StringView& val) {
+    HeadLine nd = {getName(id), val};
+    mData.emplaceBack(nd);
+    addIndex(id);
 }
 
 void HttpHead::remove(const StringView& key, s32 cnt) {
-    usz mx = mData.size();
-    for (usz i = 0; i < mx; ++i) {
+    const usz total = mData.size();
+    usz mx = total;
+    for (usz i = 0; i < mx;) {
         if (key.mLen == mData[i].mKey.getLen() && 0 == AppStrNocaseCMP(mData[i].mKey.c_str(), key.mData, key.mLen)) {
-            mData[i] = mData[mx - 1];
-            mData.resize(mx - 1);
+            mData[i] = mData[--mx];
+            mData.resize(mx);
             if (--cnt < 1) {
                 break;
             }
+        } else {
+            ++i;
         }
     }
+    if (total != mData.size()) {
+        resetIndex();
+    }
+}
+
+
+StringView HttpHead::get(EHttpHeadID id)const {
+    StringView ret;
+    if (id < EHH_COUNT) {
+        if (mIndex[id] > 0) {
+            const HeadLine& nd = mData[mIndex[id] - 1];
+            ret.set(nd.mVal.c_str(), nd.mVal.getLen());
+        }
+    }
+    return ret;
 }
 
 
 StringView HttpHead::get(const StringView& key, usz pos)const {
+    if (0 == pos) {
+        EHttpHeadID id = getID(key);
+        if (id < EHH_COUNT) {
+            return get(id);
+        }
+    }
     StringView ret;
     size_t mx = mData.size();
     for (; pos < mx; ++pos) {
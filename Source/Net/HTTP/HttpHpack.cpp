@@ -0,0 +1,514 @@
+#include "Net/HTTP/HttpHpack.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+//max bytes of decoded strings of one header block
+static const usz G_HPACK_MAX_LIST = 64 * 1024;
+
+//RFC 7541, Appendix A
+static const StringView G_HPACK_STATIC[][2] = {
+    {{":authority", 10}, {"", 0}},
+    {{":method", 7}, {"GET", 3}},
+    {{":method", 7}, {"POST", 4}},
+    {{":path", 5}, {"/", 1}},
+    {{":path", 5}, {"/index.html", 11}},
+    {{":scheme", 7}, {"http", 4}},
+    {{":scheme", 7}, {"https", 5}},
+    {{":status", 7}, {"200", 3}},
+    {{":status", 7}, {"204", 3}},
+    {{":status", 7}, {"206", 3}},
+    {{":status", 7}, {"304", 3}},
+    {{":status", 7}, {"400", 3}},
+    {{":status", 7}, {"404", 3}},
+    {{":status", 7}, {"500", 3}},
+    {{"accept-charset", 14}, {"", 0}},
+    {{"accept-encoding", 15}, {"gzip, deflate", 13}},
+    {{"accept-language", 15}, {"", 0}},
+    {{"accept-ranges", 13}, {"", 0}},
+    {{"accept", 6}, {"", 0}},
+    {{"access-control-allow-origin", 27}, {"", 0}},
+    {{"age", 3}, {"", 0}},
+    {{"allow", 5}, {"", 0}},
+    {{"authorization", 13}, {"", 0}},
+    {{"cache-control", 13}, {"", 0}},
+    {{"content-disposition", 19}, {"", 0}},
+    {{"content-encoding", 16}, {"", 0}},
+    {{"content-language", 16}, {"", 0}},
+    {{"content-length", 14}, {"", 0}},
+    {{"content-location", 16}, {"", 0}},
+    {{"content-range", 13}, {"", 0}},
+    {{"content-type", 12}, {"", 0}},
+    {{"cookie", 6}, {"", 0}},
+    {{"date", 4}, {"", 0}},
+    {{"etag", 4}, {"", 0}},
+    {{"expect", 6}, {"", 0}},
+    {{"expires", 7}, {"", 0}},
+    {{"from", 4}, {"", 0}},
+    {{"host", 4}, {"", 0}},
+    {{"if-match", 8}, {"", 0}},
+    {{"if-modified-since", 17}, {"", 0}},
+    {{"if-none-match", 13}, {"", 0}},
+    {{"if-range", 8}, {"", 0}},
+    {{"if-unmodified-since", 19}, {"", 0}},
+    {{"last-modified", 13}, {"", 0}},
+    {{"link", 4}, {"", 0}},
+    {{"location", 8}, {"", 0}},
+    {{"max-forwards", 12}, {"", 0}},
+    {{"proxy-authenticate", 18}, {"", 0}},
+    {{"proxy-authorization", 19}, {"", 0}},
+    {{"range", 5}, {"", 0}},
+    {{"referer", 7}, {"", 0}},
+    {{"refresh", 7}, {"", 0}},
+    {{"retry-after", 11}, {"", 0}},
+    {{"server", 6}, {"", 0}},
+    {{"set-cookie", 10}, {"", 0}},
+    {{"strict-transport-security", 25}, {"", 0}},
+    {{"transfer-encoding", 17}, {"", 0}},
+    {{"user-agent", 10}, {"", 0}},
+    {{"vary", 4}, {"", 0}},
+    {{"via", 3}, {"", 0}},
+    {{"www-authenticate", 16}, {"", 0}}
+};
+
+static const u32 G_HPACK_STATIC_SIZE = sizeof(G_HPACK_STATIC) / sizeof(G_HPACK_STATIC[0]);
+
+//RFC 7541, Appendix B, the last one is EOS
+static const u32 G_HUFF_CODE[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff
+};
+
+static const u8 G_HUFF_LEN[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30
+};
+
+//decode tree of huffman, node 0 is root, a negative child is leaf of symbol (-child - 1)
+static s16 G_HUFF_TREE[256][2];
+
+static bool AppInitHuffTree() {
+    s16 used = 1;
+    for (s32 sym = 0; sym < 257; ++sym) {
+        s32 node = 0;
+        for (s32 bit = G_HUFF_LEN[sym] - 1; bit > 0; --bit) {
+            s32 b = (G_HUFF_CODE[sym] >> bit) & 1;
+            if (0 == G_HUFF_TREE[node][b]) {
+                G_HUFF_TREE[node][b] = used++;
+            }
+            node = G_HUFF_TREE[node][b];
+        }
+        G_HUFF_TREE[node][G_HUFF_CODE[sym] & 1] = (s16)(-sym - 1);
+    }
+    DASSERT(256 == used);
+    return true;
+}
+
+static const bool G_HUFF_INITED = AppInitHuffTree();
+
+
+/**
+ * @param out must have room of (len * 8 / 5) bytes, the shortest code is 5 bits.
+ * @return bytes of decoded string, or -1 if error.
+ */
+static ssz AppDecodeHuffman(const u8* buf, usz len, s8* out) {
+    s8* pos = out;
+    s32 node = 0;
+    u32 pad = 0;        //bits since the last symbol
+    u32 ones = 1;       //padding must be the most significant bits of EOS
+    for (usz i = 0; i < len; ++i) {
+        for (s32 bit = 7; bit >= 0; --bit) {
+            s32 b = (buf[i] >> bit) & 1;
+            s32 next = G_HUFF_TREE[node][b];
+            if (next < 0) {
+                if (256 == -next - 1) {
+                    return -1; //EOS in string
+                }
+                *pos++ = (s8)(-next - 1);
+                node = 0;
+                pad = 0;
+                ones = 1;
+            } else {
+                node = next;
+                ++pad;
+                ones &= b;
+            }
+        }
+    }
+    return (pad > 7 || 0 == ones) ? -1 : pos - out;
+}
+
+
+static usz AppGetHuffmanSize(const s8* str, usz len) {
+    usz bits = 0;
+    for (usz i = 0; i < len; ++i) {
+        bits += G_HUFF_LEN[(u8)str[i]];
+    }
+    return (bits + 7) >> 3;
+}
+
+
+static void AppEncodeHuffman(const s8* str, usz len, Packet& out) {
+    u64 bits = 0;
+    u32 cnt = 0;
+    for (usz i = 0; i < len; ++i) {
+        const u8 ch = (u8)str[i];
+        bits = (bits << G_HUFF_LEN[ch]) | G_HUFF_CODE[ch];
+        cnt += G_HUFF_LEN[ch];
+        while (cnt >= 8) {
+            cnt -= 8;
+            out.writeU8((u8)(bits >> cnt));
+        }
+    }
+    if (cnt > 0) {
+        out.writeU8((u8)((bits << (8 - cnt)) | (0xFF >> cnt)));
+    }
+}
+
+
+//RFC 7541, 5.1
+static void AppEncodeInt(u32 val, u8 prefix, u8 flags, Packet& out) {
+    const u32 mask = (1U << prefix) - 1;
+    if (val < mask) {
+        out.writeU8((u8)(flags | val));
+        return;
+    }
+    out.writeU8((u8)(flags | mask));
+    val -= mask;
+    while (val >= 128) {
+        out.writeU8((u8)(0x80 | (val & 0x7F)));
+        val >>= 7;
+    }
+    out.writeU8((u8)val);
+}
+
+
+//@return next position, or nullptr if error
+static const u8* AppDecodeInt(const u8* p, const u8* end, u8 prefix, u32& val) {
+    const u32 mask = (1U << prefix) - 1;
+    u64 ret = *p++ & mask;
+    if (ret < mask) {
+        val = (u32)ret;
+        return p;
+    }
+    for (u32 m = 0; p < end && m <= 28; m += 7) {
+        u8 b = *p++;
+        ret += (u64)(b & 0x7F) << m;
+        if (0 == (b & 0x80)) {
+            if (ret > 0x7FFFFFFF) {
+                return nullptr;
+            }
+            val = (u32)ret;
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+
+static void AppEncodeString(const StringView& str, Packet& out) {
+    usz hsz = AppGetHuffmanSize(str.mData, str.mLen);
+    if (hsz < str.mLen) {
+        AppEncodeInt((u32)hsz, 7, 0x80, out);
+        AppEncodeHuffman(str.mData, str.mLen, out);
+    } else {
+        AppEncodeInt((u32)str.mLen, 7, 0, out);
+        out.write(str.mData, str.mLen);
+    }
+}
+
+
+//@return next position, or nullptr if error
+static const u8* AppDecodeString(const u8* p, const u8* end, Packet& cache, StringView& out) {
+    const bool huff = 0 != (*p & 0x80);
+    u32 len;
+    p = AppDecodeInt(p, end, 7, len);
+    if (!p || len > (usz)(end - p)) {
+        return nullptr;
+    }
+    if (huff) {
+        s8* dst = cache.getWritePointer();
+        ssz dlen = AppDecodeHuffman(p, len, dst);
+        if (dlen < 0) {
+            return nullptr;
+        }
+        DASSERT((usz)dlen <= cache.getWriteSize());
+        cache.resize(cache.size() + dlen);
+        out.set(dst, dlen);
+    } else {
+        out.set(reinterpret_cast<const s8*>(p), len);
+    }
+    return p + len;
+}
+
+
+struct HpackEntry {
+    u32 mKeyLen;
+    u32 mValLen;
+
+    s8* getKey() {
+        return reinterpret_cast<s8*>(this + 1);
+    }
+    s8* getValue() {
+        return getKey() + mKeyLen;
+    }
+    u32 getSize()const {
+        return mKeyLen + mValLen + 32;
+    }
+};
+
+
+HttpHpack::HttpHpack(u32 maxTable)
+    : mCapacity(maxTable / 32 + 1)
+    , mFirst(0)
+    , mCount(0)
+    , mSize(0)
+    , mMaxSize(maxTable)
+    , mLimit(maxTable)
+    , mSizeUpdate(false) {
+    mEntries = new HpackEntry * [mCapacity];
+}
+
+
+HttpHpack::~HttpHpack() {
+    mMaxSize = 0;
+    evict(0);
+    delete[] mEntries;
+}
+
+
+bool HttpHpack::getField(u32 idx, StringView& key, StringView& val)const {
+    if (0 == idx) {
+        return false;
+    }
+    if (idx <= G_HPACK_STATIC_SIZE) {
+        key = G_HPACK_STATIC[idx - 1][0];
+        val = G_HPACK_STATIC[idx - 1][1];
+        return true;
+    }
+    idx -= G_HPACK_STATIC_SIZE + 1;
+    if (idx >= mCount) {
+        return false;
+    }
+    HpackEntry* nd = mEntries[(mFirst + idx) % mCapacity];
+    key.set(nd->getKey(), nd->mKeyLen);
+    val.set(nd->getValue(), nd->mValLen);
+    return true;
+}
+
+
+u32 HttpHpack::findField(const StringView& key, const StringView& val, u32& keyIdx)const {
+    keyIdx = 0;
+    for (u32 i = 0; i < G_HPACK_STATIC_SIZE; ++i) {
+        if (key == G_HPACK_STATIC[i][0]) {
+            if (val == G_HPACK_STATIC[i][1]) {
+                return i + 1;
+            }
+            if (0 == keyIdx) {
+                keyIdx = i + 1;
+            }
+        }
+    }
+    for (u32 i = 0; i < mCount; ++i) {
+        HpackEntry* nd = mEntries[(mFirst + i) % mCapacity];
+        if (nd->mKeyLen == key.mLen && 0 == memcmp(nd->getKey(), key.mData, key.mLen)) {
+            if (nd->mValLen == val.mLen && 0 == memcmp(nd->getValue(), val.mData, val.mLen)) {
+                return G_HPACK_STATIC_SIZE + 1 + i;
+            }
+            if (0 == keyIdx) {
+                keyIdx = G_HPACK_STATIC_SIZE + 1 + i;
+            }
+        }
+    }
+    return 0;
+}
+
+
+void HttpHpack::evict(u32 room) {
+    while (mCount > 0 && mSize + room > mMaxSize) {
+        --mCount;
+        HpackEntry* nd = mEntries[(mFirst + mCount) % mCapacity];
+        mSize -= nd->getSize();
+        delete[] reinterpret_cast<s8*>(nd);
+    }
+}
+
+
+void HttpHpack::addField(const StringView& key, const StringView& val) {
+    const u32 esz = (u32)(key.mLen + val.mLen + 32);
+    if (esz > mMaxSize) {
+        evict(mMaxSize + 1); //RFC 7541, 4.4: the table is emptied
+        return;
+    }
+    //copy before evicting, key may be a view of an old entry
+    HpackEntry* nd = reinterpret_cast<HpackEntry*>(new s8[sizeof(HpackEntry) + key.mLen + val.mLen]);
+    nd->mKeyLen = (u32)key.mLen;
+    nd->mValLen = (u32)val.mLen;
+    memcpy(nd->getKey(), key.mData, key.mLen);
+    memcpy(nd->getValue(), val.mData, val.mLen);
+    evict(esz);
+    mFirst = (mFirst + mCapacity - 1) % mCapacity;
+    mEntries[mFirst] = nd;
+    ++mCount;
+    mSize += esz;
+}
+
+
+void HttpHpack::setMaxTableSize(u32 size) {
+    mMaxSize = size < mLimit ? size : mLimit;
+    evict(0);
+    mSizeUpdate = true;
+}
+
+
+s32 HttpHpack::decode(const u8* buf, usz len, HttpHead& out) {
+    const u8* p = buf;
+    const u8* end = buf + len;
+    usz total = 0;
+    StringView key;
+    StringView val;
+    u32 idx;
+    const usz fields = out.size();
+
+    //huffman strings are decoded into mCache, keep it from realloc while decoding
+    mCache.resize(0);
+    mCache.reallocate(len * 8 / 5 + 8);
+
+    while (p < end) {
+        const u8 ch = *p;
+        if (ch & 0x80) {
+            //indexed field
+            p = AppDecodeInt(p, end, 7, idx);
+            if (!p || !getField(idx, key, val)) {
+                return EE_ERROR;
+            }
+        } else if (0x20 == (ch & 0xE0)) {
+            //dynamic table size update, it's allowed at the beginning of block only
+            p = AppDecodeInt(p, end, 5, idx);
+            if (!p || idx > mLimit || out.size() > fields) {
+                return EE_ERROR;
+            }
+            mMaxSize = idx;
+            evict(0);
+            continue;
+        } else {
+            //literal field, with incremental indexing(01), without indexing(0000), never indexed(0001)
+            const bool indexing = 0x40 == (ch & 0xC0);
+            p = AppDecodeInt(p, end, indexing ? 6 : 4, idx);
+            if (!p) {
+                return EE_ERROR;
+            }
+            if (idx > 0) {
+                if (!getField(idx, key, val)) {
+                    return EE_ERROR;
+                }
+            } else if (p >= end || nullptr == (p = AppDecodeString(p, end, mCache, key))) {
+                return EE_ERROR;
+            }
+            if (p >= end || nullptr == (p = AppDecodeString(p, end, mCache, val))) {
+                return EE_ERROR;
+            }
+            if (indexing) {
+                out.add(key, val);
+                addField(key, val);
+                total += key.mLen + val.mLen + 32;
+                if (total > G_HPACK_MAX_LIST) {
+                    return EE_ERROR;
+                }
+                continue;
+            }
+        }
+        total += key.mLen + val.mLen + 32;
+        if (total > G_HPACK_MAX_LIST) {
+            return EE_ERROR;
+        }
+        out.add(key, val);
+    }
+    return EE_OK;
+}
+
+
+void HttpHpack::beginBlock(Packet& out) {
+    if (mSizeUpdate) {
+        mSizeUpdate = false;
+        AppEncodeInt(mMaxSize, 5, 0x20, out);
+    }
+}
+
+
+void HttpHpack::encode(const StringView& key, const StringView& val, Packet& out, bool index) {
+    u32 keyIdx;
+    u32 idx = findField(key, val, keyIdx);
+    if (idx > 0) {
+        AppEncodeInt(idx, 7, 0x80, out);
+        return;
+    }
+    index = index && key.mLen + val.mLen + 32 <= mMaxSize;
+    AppEncodeInt(keyIdx, index ? 6 : 4, index ? 0x40 : 0, out);
+    if (0 == keyIdx) {
+        AppEncodeString(key, out);
+    }
+    AppEncodeString(val, out);
+    if (index) {
+        addField(key, val);
+    }
+}
+
+
+void HttpHpack::encodeStatus(u16 status, Packet& out) {
+    static const StringView G_STATUS(":status", sizeof(":status") - 1);
+    s8 tmp[8];
+    StringView val(tmp, snprintf(tmp, sizeof(tmp), "%03u", (u32)(status % 1000)));
+    encode(G_STATUS, val, out);
+}
+
+
+}//namespace net
+}//namespace app
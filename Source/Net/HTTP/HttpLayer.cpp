@@ -25,10 +25,20 @@
 
 #include "Net/HTTP/HttpLayer.h"
 #include "Net/HTTP/Website.h"
+#include "Net/HTTP/Http2Layer.h"
+#include "Net/HTTP/HttpClientPool.h"
 #include "Net/Acceptor.h"
 #include "Loop.h"
 #include "Timer.h"
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DHTTP_SCAN_X86
+#include <immintrin.h>
+#if defined(DOS_WINDOWS)
+#include <intrin.h>
+#endif
+#endif
+
 namespace app {
 namespace net {
 
@@ -37,6 +47,17 @@ HttpLayer::HttpLayer(EHttpParserType tp) :
     mPType(tp),
     mWebsite(nullptr),
     mMsg(nullptr),
+    mPipeHead(nullptr),
+    mPipeTail(nullptr),
+    mPipeCount(0),
+    mReadPaused(nullptr),
+    mHttp2(nullptr),
+    mPool(nullptr),
+    mPoolHost(nullptr),
+    mIdleTime(0),
+    mConnected(false),
+    mReadHold(false),
+    mProtocol(0),
     mHttpError(HPE_OK),
     mHTTPS(true) {
     clear();
@@ -45,14 +66,34 @@ HttpLayer::HttpLayer(EHttpParserType tp) :
 
 HttpLayer::~HttpLayer() {
     //onClose();
+    delete mHttp2;
 }
 
 
 s32 HttpLayer::get(const String& gurl) {
-    mMsg->clear();
-    if (EE_OK != mMsg->writeGet(gurl)) {
+    return request(HTTP_GET, gurl);
+}
+
+s32 HttpLayer::post(const String& gurl) {
+    return request(HTTP_POST, gurl);
+}
+
+
+s32 HttpLayer::request(EHttpMethod method, const String& gurl) {
+    if (!mMsg) {
+        mMsg = new HttpMsg(this);
+    }
+    //the headers of request are kept
+    mMsg->getHeadIn().clear();
+    mMsg->getCacheIn().reset();
+    mMsg->getURL().clear();
+    if (EE_OK != mMsg->writeRequest(method, gurl)) {
         return EE_ERROR;
     }
+    if (mConnected) {
+        //reused connection, the read is in flight
+        return sendReq() ? EE_OK : EE_ERROR;
+    }
 
     mHTTPS = mMsg->getURL().isHttps();
     if (!mHTTPS) {
@@ -77,15 +118,36 @@ s32 HttpLayer::get(const String& gurl) {
         RequestFD::delRequest(nd);
         return ret;
     }
+    if (mHTTPS) {
+        mTCP.setHost(shost, strlen(shost));
+    }
     return EE_OK;
 }
 
-s32 HttpLayer::post(const String& gurl) {
-    return EE_ERROR;
+bool HttpLayer::isAlive() {
+    const u32 need = EHF_READABLE | EHF_WRITEABLE;
+    u32 flag = mHTTPS ? mTCP.getFlag() : mTCP.getHandleTCP().getFlag();
+    return mConnected && need == (need & flag);
+}
+
+
+void HttpLayer::onResponse() {
+    if (!mPool) {
+        return;
+    }
+    if (HPE_OK != mHttpError || !shouldKeepAlive() || !mPool->release(this)) {
+        postClose();
+    }
 }
 
 
 void HttpLayer::msgBegin() {
+    if (mMsg && EHTTP_RESPONSE == mPType && !mWebsite) {
+        //client: the response is parsed into the msg of request
+        mMsg->mStationID = ES_INIT;
+        msgStep();
+        return;
+    }
     if (mMsg) {
         mHttpError = HPE_CB_MsgBegin;
         postClose();
@@ -93,6 +155,9 @@ void HttpLayer::msgBegin() {
     }
 
     mMsg = new HttpMsg(this);
+    if (mWebsite) {
+        pushPipe(mMsg);
+    }
     mMsg->mStationID = ES_INIT;
     msgStep();
 }
@@ -104,6 +169,12 @@ void HttpLayer::msgEnd() {
         msgStep();
         mMsg->drop();
         mMsg = nullptr;
+        if (EHTTP_RESPONSE == mPType) {
+            onResponse();
+        }
+    }
+    if (mWebsite && mPipeCount >= mWebsite->getConfig().mPipeline && HPE_OK == mHttpError) {
+        pauseParse(true); //parseBuf() stop here, see resumeRead()
     }
 }
 
@@ -124,6 +195,9 @@ s32 HttpLayer::headDone() {
         mMsg->mFlags = mFlags;
         mMsg->mStationID = ES_HEAD;
         msgStep();
+        if (EHTTP_RESPONSE == mPType && HTTP_HEAD == mMsg->getMethod()) {
+            return 1; //response of HEAD has no body
+        }
     }
     return 0;
 }
@@ -131,14 +205,42 @@ s32 HttpLayer::headDone() {
 void HttpLayer::chunkHeadDone() {
     DASSERT(mMsg);
     if (mMsg) {
+        //size line of a chunk, the headers had been reported by headDone()
         mMsg->mFlags = mFlags;
-        mMsg->mStationID = ES_HEAD;
-        msgStep();
     }
 }
 
 void HttpLayer::msgStep() {
-    if (EE_OK != mWebsite->stepMsg(mMsg)) {
+    if (mWebsite) {
+        if (EE_OK != mWebsite->stepMsg(mMsg)) {
+            postClose();
+        }
+        return;
+    }
+    //a layer without website is a pure parser, or a client which reports to the eventer of msg
+    HttpEventer* evt = EHTTP_RESPONSE == mPType && mMsg ? mMsg->getEvent() : nullptr;
+    if (!evt) {
+        return;
+    }
+    s32 ret = EE_OK;
+    switch (mMsg->mStationID) {
+    case ES_HEAD:
+        ret = evt->onHead(*mMsg);
+        if (EE_OK == ret) {
+            ret = evt->onOpen(*mMsg);
+        }
+        break;
+    case ES_BODY:
+        ret = evt->onBodyPart(*mMsg);
+        break;
+    case ES_BODY_DONE:
+        ret = evt->onFinish(*mMsg);
+        break;
+    default:
+        break;
+    }
+    if (EE_OK != ret) {
+        mHttpError = HPE_CB_MsgComplete;
         postClose();
     }
 }
@@ -167,14 +269,76 @@ void HttpLayer::chunkMsg() {
 void HttpLayer::chunkDone() {
     if (mMsg) {
         mMsg->mStationID = ES_BODY_DONE;
-        mWebsite->stepMsg(mMsg);
+        if (mWebsite) {
+            mWebsite->stepMsg(mMsg);
+        } else {
+            msgStep();
+        }
         mMsg->drop();
         mMsg = nullptr;
+        if (EHTTP_RESPONSE == mPType) {
+            onResponse();
+        }
+    }
+}
+
+
+void HttpLayer::pushPipe(HttpMsg* msg) {
+    msg->grab();
+    msg->mPipeNext = nullptr;
+    if (mPipeTail) {
+        mPipeTail->mPipeNext = msg;
+    } else {
+        mPipeHead = msg;
+    }
+    mPipeTail = msg;
+    ++mPipeCount;
+}
+
+
+void HttpLayer::popPipe(HttpMsg* msg) {
+    if (msg != mPipeHead) {
+        return;
+    }
+    mPipeHead = msg->mPipeNext;
+    if (!mPipeHead) {
+        mPipeTail = nullptr;
+    }
+    msg->mPipeNext = nullptr;
+    --mPipeCount;
+    msg->drop();
+
+    HttpMsg* next = mPipeHead;
+    if (next && 2 == next->getRespStatus()) {
+        next->setRespStatus(0);
+        if (!(next->getFileNode() ? sendFile(next) : sendResp(next))) {
+            postClose();
+            return;
+        }
+    }
+    resumeRead();
+}
+
+
+void HttpLayer::resumeRead() {
+    if (!mReadPaused || mReadHold || (mWebsite && mPipeCount >= mWebsite->getConfig().mPipeline)) {
+        return;
+    }
+    RequestFD* it = mReadPaused;
+    mReadPaused = nullptr;
+    pauseParse(false);
+    if (it->mUsed > 0) {
+        onRead(it); //parse the leftover
+    } else if (EE_OK != readIF(it)) {
+        RequestFD::delRequest(it);
     }
 }
 
 
 bool HttpLayer::sendReq() {
+    if (!mConnected || !mMsg || mMsg->getRespStatus() > 0) {
+        return true; //sent by onConnect() or onWrite()
+    }
     RingBuffer& bufs = mMsg->getCacheOut();
     if (bufs.getSize() > 0) {
         RequestFD* nd = RequestFD::newRequest(0);
@@ -189,16 +353,25 @@ bool HttpLayer::sendReq() {
             RequestFD::delRequest(nd);
             return false;
         }
+        mMsg->grab(); //dropped by onWrite()
+        mMsg->setRespStatus(1);
     }
     return true;
 }
 
 bool HttpLayer::sendResp(HttpMsg* msg) {
     DASSERT(msg);
+    if (mHttp2) {
+        return mHttp2->sendResp(msg);
+    }
 
     if (msg->getRespStatus() > 0) {
         return true;
     }
+    if (mPipeHead && msg != mPipeHead) {
+        msg->setRespStatus(2); //sent after the previous responses, by popPipe()
+        return true;
+    }
 
     RingBuffer& bufs = msg->getCacheOut();
     RequestFD* nd = RequestFD::newRequest(0);
@@ -218,6 +391,71 @@ bool HttpLayer::sendResp(HttpMsg* msg) {
     return true;
 }
 
+void HttpLayer::onBodyUsed(HttpMsg* msg) {
+    if (mHttp2) {
+        mHttp2->onBodyUsed(msg);
+    }
+}
+
+
+void HttpLayer::holdRead(bool hold) {
+    if (mHttp2 || mReadHold == hold) {
+        return;
+    }
+    mReadHold = hold;
+    resumeRead();
+}
+
+
+bool HttpLayer::sendFile(HttpMsg* msg) {
+    DASSERT(msg && msg->getFileNode());
+    if (mHttp2) {
+        return mHttp2->sendFile(msg);
+    }
+
+    if (msg->getRespStatus() > 0) {
+        return true;
+    }
+    if (mPipeHead && msg != mPipeHead) {
+        msg->setRespStatus(2);
+        return true;
+    }
+
+    HttpFileNode* node = msg->getFileNode();
+    StringView pack = node->getResp();
+    if (!msg->isKeepAlive()) {
+        //the cached head says keep-alive, send a copy of it with close, then the body
+        static const StringView tail("Connection:close\r\n\r\n", sizeof("Connection:close\r\n\r\n") - 1);
+        StringView base = node->getHeadBase();
+        RequestFD* hd = RequestFD::newRequest((u32)(base.mLen + tail.mLen));
+        hd->mUser = msg;
+        hd->mCall = HttpLayer::funcOnWriteHead;
+        memcpy(hd->mData, base.mData, base.mLen);
+        memcpy(hd->mData + base.mLen, tail.mData, tail.mLen);
+        hd->mUsed = (u32)(base.mLen + tail.mLen);
+        if (EE_OK != writeIF(hd)) {
+            RequestFD::delRequest(hd);
+            return false;
+        }
+        pack = node->getBody();
+    }
+
+    RequestFD* nd = RequestFD::newRequest(0);
+    nd->mUser = msg;
+    nd->mCall = HttpLayer::funcOnWriteFile;
+    nd->mData = pack.mData;
+    nd->mAllocated = (u32)pack.mLen;
+    nd->mUsed = (u32)pack.mLen;
+    s32 ret = writeIF(nd);
+    if (EE_OK != ret) {
+        RequestFD::delRequest(nd);
+        return false;
+    }
+    msg->grab();
+    msg->setRespStatus(1);
+    return true;
+}
+
 
 
 #ifdef DDEBUG
@@ -281,6 +519,9 @@ s32 TestHttpReceive(HttpLayer& mMsg) {
 
 
 s32 HttpLayer::onTimeout(HandleTime& it) {
+    if (mHttp2) {
+        return mHttp2->onTimeout();
+    }
     return shouldKeepAlive() ? EE_OK : EE_ERROR;
 }
 
@@ -294,16 +535,40 @@ void HttpLayer::onClose(Handle* it) {
     }
 #endif
 
+    if (mHttp2) {
+        mHttp2->onClose();
+    }
     if (mMsg) {
         mMsg->mStationID = ES_CLOSE;
-        mWebsite->stepMsg(mMsg);
+        if (mWebsite) {
+            mWebsite->stepMsg(mMsg);
+        }
         mMsg->drop();
         mMsg = nullptr;
     }
+    for (HttpMsg* nd = mPipeHead; nd; nd = mPipeHead) {
+        mPipeHead = nd->mPipeNext;
+        nd->mPipeNext = nullptr;
+        nd->drop();
+    }
+    mPipeTail = nullptr;
+    mPipeCount = 0;
+    if (mReadPaused) {
+        RequestFD::delRequest(mReadPaused);
+        mReadPaused = nullptr;
+    }
+    mReadHold = false;
+    mConnected = false;
     if (mWebsite) {
         Website* site = mWebsite;
         mWebsite = nullptr;
         site->unbind(this);
+    } else if (EHTTP_RESPONSE == mPType) {
+        //client
+        if (mPool) {
+            mPool->onClose(this);
+        }
+        drop();
     } else {
         drop();
         Logger::log(ELL_ERROR, "HttpLayer::onClose>>null website");
@@ -341,7 +606,8 @@ bool HttpLayer::onLink(RequestFD* it) {
 }
 
 void HttpLayer::onConnect(RequestFD* it) {
-    if (0 == it->mError && sendReq()) {
+    mConnected = 0 == it->mError;
+    if (mConnected && sendReq()) {
         it->mCall = HttpLayer::funcOnRead;
         if (EE_OK == readIF(it)) {
             return;
@@ -356,11 +622,28 @@ void HttpLayer::onWrite(RequestFD* it, HttpMsg* msg) {
     } else {
         msg->setRespStatus(0);
         msg->getCacheOut().commitHead(static_cast<s32>(it->mUsed));
-        if (msg->getCacheOut().getSize() > 0) {
-            sendResp(msg);
+        if (!mWebsite) {
+            //request of client
+            if (msg->getEvent()) {
+                msg->getEvent()->onDrain(*msg);
+            }
+            if (msg->getCacheOut().getSize() > 0) {
+                if (msg != mMsg || !sendReq()) {
+                    postClose();
+                }
+            } else if (msg->getEvent()) {
+                msg->getEvent()->onSent(*msg);
+            }
         } else {
-            if (EE_OK != mWebsite->stepMsg(msg)) {
+            if (msg->getEvent()) {
+                msg->getEvent()->onDrain(*msg);
+            }
+            if (msg->getCacheOut().getSize() > 0) {
+                sendResp(msg);
+            } else if (EE_OK != mWebsite->stepMsg(msg)) {
                 postClose();
+            } else if (ES_CLOSE == msg->getStationID()) {
+                popPipe(msg);
             }
         }
     }
@@ -369,7 +652,91 @@ void HttpLayer::onWrite(RequestFD* it, HttpMsg* msg) {
 }
 
 
+void HttpLayer::onWriteFile(RequestFD* it, HttpMsg* msg) {
+    if (EE_OK != it->mError) {
+        Logger::log(ELL_ERROR, "HttpLayer::onWriteFile>>size=%u, ecode=%d", it->mUsed, it->mError);
+    } else {
+        msg->setRespStatus(0);
+        msg->setFileNode(nullptr);
+        if (EE_OK != mWebsite->stepMsg(msg)) {
+            postClose();
+        } else if (ES_CLOSE == msg->getStationID()) {
+            popPipe(msg);
+        }
+    }
+    RequestFD::delRequest(it);
+    msg->drop();
+}
+
+
+s32 HttpLayer::checkProtocol(RequestFD*& it) {
+    mProtocol = 1;
+    if (!mWebsite || !mWebsite->getConfig().mHTTP2) {
+        return 1;
+    }
+    s32 ret;
+    StringView alpn = mHTTPS ? mTCP.getALPN() : StringView();
+    if (2 == alpn.mLen && 0 == memcmp(alpn.mData, "h2", 2)) {
+        ret = 1;
+    } else {
+        ret = Http2Layer::checkPreface(it->getBuf(), it->mUsed);
+    }
+    if (0 == ret) {
+        mProtocol = 0;
+        return 0;
+    }
+    if (ret < 0) {
+        return 1; //HTTP/1.x
+    }
+    mProtocol = 2;
+    RequestFD* nd = RequestFD::newRequest(Http2Layer::getReadSize());
+    nd->mUser = it->mUser;
+    nd->mCall = it->mCall;
+    memcpy(nd->getBuf(), it->getBuf(), it->mUsed);
+    nd->mUsed = it->mUsed;
+    RequestFD::delRequest(it);
+    it = nd;
+    mHttp2 = new Http2Layer(*this);
+    return mHttp2->start() ? 1 : -1;
+}
+
+
 void HttpLayer::onRead(RequestFD* it) {
+    if (0 == mProtocol && it->mUsed > 0) {
+        s32 ret = checkProtocol(it);
+        if (0 == ret && EE_OK == readIF(it)) {
+            return;
+        }
+        if (ret <= 0) {
+            if (ret < 0) {
+                postClose();
+            }
+            RequestFD::delRequest(it);
+            return;
+        }
+    }
+    if (mHttp2) {
+        if (it->mUsed > 0) {
+            ssz used = mHttp2->parseBuf(it->getBuf(), it->mUsed);
+            if (used >= 0) {
+                it->clearData((u32)used);
+                if (EE_OK == readIF(it)) {
+                    return;
+                }
+            }
+        }
+        RequestFD::delRequest(it);
+        return;
+    }
+
+    if (!mMsg && mPool && it->mUsed > 0) {
+        //the idle connection of pool got bytes without request
+        Logger::log(ELL_ERROR, "HttpLayer::onRead>>remote=%s, idle got=%u", mTCP.getRemote().getStr(), it->mUsed);
+        postClose();
+        RequestFD::delRequest(it);
+        return;
+    }
+
     const s8* dat = it->getBuf();
     ssz datsz = it->mUsed;
     if (0 == datsz) {
@@ -386,12 +753,26 @@ void HttpLayer::onRead(RequestFD* it) {
             datsz -= stepsz;
         }
         it->clearData((u32)parsed);
+        //the body of Content-Length got by this read, it's reported by msgEnd() when done
+        if (HPE_OK == mHttpError && mMsg && mMsg->getCacheIn().getSize() > 0
+            && (ES_HEAD == mMsg->getStationID() || ES_BODY == mMsg->getStationID())) {
+            msgBody();
+        }
 
+        if (HPE_PAUSED == mHttpError) {
+            //too many requests in flight, the leftover is parsed by resumeRead()
+            mReadPaused = it;
+            return;
+        }
         if (0 == it->getWriteSize()) {
             //可能受到超长header攻击或其它错误
             Logger::logError("HttpLayer::onRead>>remote=%s, msg overflow", mTCP.getRemote().getStr());
             postClose();
         } else {
+            if (0 == mHttpError && mReadHold) {
+                mReadPaused = it; //read again by holdRead(false)
+                return;
+            }
             if (0 == mHttpError && EE_OK == readIF(it)) {
                 return;
             }
@@ -438,6 +819,16 @@ do {                                                                 \
 } while (0)
 
 
+//stop after a message if msgEnd() paused the parser, the rest is parsed after resume
+#define CHECK_PAUSED()                                               \
+do {                                                                 \
+  if (UNLIKELY(HPE_PAUSED == mHttpError)) {                          \
+    mReadSize = nread;                                               \
+    return (p - data + 1);                                           \
+  }                                                                  \
+} while (0)
+
+
 #define PROXY_CONNECTION "proxy-connection"
 #define CONNECTION "connection"
 #define CONTENT_LENGTH "content-length"
@@ -792,6 +1183,187 @@ do {                                                                 \
 #endif
 
 
+/* SIMD scan of request line and headers.
+ * The scan functions only skip the bytes which can't change the state of parser,
+ * and return the first byte which may do, so the scalar code goes on from there
+ * and all the errors are still reported by the scalar code.
+ */
+#if defined(DHTTP_SCAN_X86)
+#if defined(DOS_WINDOWS)
+#define DSCAN_TARGET(V)
+#else
+#define DSCAN_TARGET(V) __attribute__((target(V)))
+#endif
+#endif
+
+typedef const s8* (*AppScanFunc)(const s8* p, const s8* end);
+
+static const s8* AppScanNone(const s8* p, const s8* end) {
+    return p;
+}
+
+#if defined(DHTTP_SCAN_X86)
+static DFINLINE u32 AppBitLow(u32 it) {
+#if defined(DOS_WINDOWS)
+    unsigned long ret;
+    _BitScanForward(&ret, it);
+    return ret;
+#else
+    return __builtin_ctz(it);
+#endif
+}
+
+//@param ranges pairs of [min,max] which stop the scan
+template<s32 RANGE_SIZE>
+DSCAN_TARGET("sse4.2") static DFINLINE const s8* AppScanRanges(const s8* p, const s8* end, const s8* ranges) {
+    const __m128i rgs = _mm_loadu_si128((const __m128i*)ranges);
+    for (; end - p >= 16; p += 16) {
+        __m128i dat = _mm_loadu_si128((const __m128i*)p);
+        s32 idx = _mm_cmpestri(rgs, RANGE_SIZE, dat, 16,
+            _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (idx != 16) {
+            return p + idx;
+        }
+    }
+    return p;
+}
+
+//header value: CTLs except HT, and DEL
+DSCAN_TARGET("sse4.2") static const s8* AppScanValueSSE42(const s8* p, const s8* end) {
+    alignas(16) static const s8 ranges[16] = {'\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'};
+    return AppScanRanges<6>(p, end, ranges);
+}
+
+//header name: CTLs, SP, separators and non ASCII, '|' & '~' are left to scalar code
+DSCAN_TARGET("sse4.2") static const s8* AppScanTokenSSE42(const s8* p, const s8* end) {
+    alignas(16) static const s8 ranges[16] = {
+        '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'};
+    return AppScanRanges<16>(p, end, ranges);
+}
+
+//url path: CTLs, SP, '#', '?' and non ASCII
+DSCAN_TARGET("sse4.2") static const s8* AppScanPathSSE42(const s8* p, const s8* end) {
+    alignas(16) static const s8 ranges[16] = {'\x00', '\x20', '#', '#', '?', '?', '\x7f', '\xff'};
+    return AppScanRanges<8>(p, end, ranges);
+}
+
+//url query: CTLs, SP, '#' and non ASCII
+DSCAN_TARGET("sse4.2") static const s8* AppScanQuerySSE42(const s8* p, const s8* end) {
+    alignas(16) static const s8 ranges[16] = {'\x00', '\x20', '#', '#', '\x7f', '\xff'};
+    return AppScanRanges<6>(p, end, ranges);
+}
+
+//@return mask of bytes in [min, min+len]
+DSCAN_TARGET("avx2") static DFINLINE __m256i AppInRangeAVX2(__m256i dat, s8 min, s8 len) {
+    __m256i off = _mm256_sub_epi8(dat, _mm256_set1_epi8(min));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(off, _mm256_set1_epi8(len)), off);
+}
+
+DSCAN_TARGET("avx2") static const s8* AppScanValueAVX2(const s8* p, const s8* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i dat = _mm256_loadu_si256((const __m256i*)p);
+        __m256i ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(dat, _mm256_set1_epi8(9)),
+            AppInRangeAVX2(dat, 0, 0x1f));
+        ctl = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(dat, _mm256_set1_epi8(0x7f)));
+        u32 stop = (u32)_mm256_movemask_epi8(ctl);
+        if (stop) {
+            return p + AppBitLow(stop);
+        }
+    }
+    return AppScanValueSSE42(p, end);
+}
+
+//only [0-9a-zA-Z-] are skipped, which are most of header names
+DSCAN_TARGET("avx2") static const s8* AppScanTokenAVX2(const s8* p, const s8* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i dat = _mm256_loadu_si256((const __m256i*)p);
+        __m256i yes = AppInRangeAVX2(_mm256_or_si256(dat, _mm256_set1_epi8(0x20)), 'a', 'z' - 'a');
+        yes = _mm256_or_si256(yes, AppInRangeAVX2(dat, '0', 9));
+        yes = _mm256_or_si256(yes, _mm256_cmpeq_epi8(dat, _mm256_set1_epi8('-')));
+        u32 stop = ~(u32)_mm256_movemask_epi8(yes);
+        if (stop) {
+            return p + AppBitLow(stop);
+        }
+    }
+    return AppScanTokenSSE42(p, end);
+}
+
+template<bool PATH>
+DSCAN_TARGET("avx2") static DFINLINE const s8* AppScanURLAVX2(const s8* p, const s8* end) {
+    for (; end - p >= 32; p += 32) {
+        __m256i dat = _mm256_loadu_si256((const __m256i*)p);
+        __m256i yes = AppInRangeAVX2(dat, 0x21, 0x7e - 0x21);
+        yes = _mm256_andnot_si256(_mm256_cmpeq_epi8(dat, _mm256_set1_epi8('#')), yes);
+        if (PATH) {
+            yes = _mm256_andnot_si256(_mm256_cmpeq_epi8(dat, _mm256_set1_epi8('?')), yes);
+        }
+        u32 stop = ~(u32)_mm256_movemask_epi8(yes);
+        if (stop) {
+            return p + AppBitLow(stop);
+        }
+    }
+    return PATH ? AppScanPathSSE42(p, end) : AppScanQuerySSE42(p, end);
+}
+
+DSCAN_TARGET("avx2") static const s8* AppScanPathAVX2(const s8* p, const s8* end) {
+    return AppScanURLAVX2<true>(p, end);
+}
+
+DSCAN_TARGET("avx2") static const s8* AppScanQueryAVX2(const s8* p, const s8* end) {
+    return AppScanURLAVX2<false>(p, end);
+}
+
+//@return 2=AVX2, 1=SSE4.2, 0=none
+static s32 AppGetSIMD() {
+#if defined(DOS_WINDOWS)
+    s32 info[4];
+    __cpuid(info, 1);
+    const bool sse42 = 0 != (info[2] & (1 << 20));
+    const bool osxsave = 0 != (info[2] & (1 << 27));
+    __cpuidex(info, 7, 0);
+    const bool avx2 = osxsave && 0 != (info[1] & (1 << 5)) && 6 == (_xgetbv(0) & 6);
+#else
+    __builtin_cpu_init();
+    const bool sse42 = 0 != __builtin_cpu_supports("sse4.2");
+    const bool avx2 = 0 != __builtin_cpu_supports("avx2");
+#endif
+    return avx2 && sse42 ? 2 : (sse42 ? 1 : 0);
+}
+#else
+static s32 AppGetSIMD() {
+    return 0;
+}
+#endif //DHTTP_SCAN_X86
+
+static AppScanFunc GScanValue = AppScanNone;
+static AppScanFunc GScanToken = AppScanNone;
+static AppScanFunc GScanPath = AppScanNone;
+static AppScanFunc GScanQuery = AppScanNone;
+static const bool GScanInited = HttpLayer::setSIMD(true);
+
+bool HttpLayer::setSIMD(bool on) {
+    const s32 simd = on ? AppGetSIMD() : 0;
+    GScanValue = AppScanNone;
+    GScanToken = AppScanNone;
+    GScanPath = AppScanNone;
+    GScanQuery = AppScanNone;
+#if defined(DHTTP_SCAN_X86)
+    if (2 == simd) {
+        GScanValue = AppScanValueAVX2;
+        GScanToken = AppScanTokenAVX2;
+        GScanPath = AppScanPathAVX2;
+        GScanQuery = AppScanQueryAVX2;
+    } else if (1 == simd) {
+        GScanValue = AppScanValueSSE42;
+        GScanToken = AppScanTokenSSE42;
+        GScanPath = AppScanPathSSE42;
+        GScanQuery = AppScanQuerySSE42;
+    }
+#endif
+    return simd > 0;
+}
+
+
  /* Map errno values to strings for human-readable output */
 #define HTTP_STRERROR_GEN(n, s) { "HPE_" #n, s },
 static struct {
@@ -1194,6 +1766,9 @@ void HttpLayer::clear() {
     mLenientHeaders = 0;
     if (EHTTP_REQUEST == mPType) {
         msgBegin();
+    } else if (EHTTP_RESPONSE == mPType && !mMsg) {
+        //client: msg of the first request
+        mMsg = new HttpMsg(this);
     }
     reset();
 }
@@ -1667,6 +2242,12 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                 }
                 turl.set(nullptr, 0);
                 msgPath();
+            } else if (s_req_path == p_state || s_req_query_string == p_state) {
+                //skip the plain chars of url, but not beyond the limit of header size
+                const s8* pe = p + 1 + DMIN((usz)(end - p - 1), (usz)(GMAX_HEAD_SIZE - nread));
+                const s8* pos = (s_req_path == p_state ? GScanPath : GScanQuery)(p + 1, pe);
+                nread += (u32)(pos - p - 1);
+                p = pos - 1;
             }
             break;
         }
@@ -1839,6 +2420,9 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                 {
                     usz left = end - p;
                     const s8* pe = p + DMIN(left, GMAX_HEAD_SIZE);
+                    if (p + 1 < pe) {
+                        p = GScanToken(p + 1, pe) - 1;
+                    }
                     while (p + 1 < pe && TOKEN(p[1])) {
                         p++;
                     }
@@ -2176,6 +2760,9 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                 {
                     usz left = end - p;
                     const s8* pe = p + DMIN(left, GMAX_HEAD_SIZE);
+                    if (!lenient) {
+                        p = GScanValue(p, pe);
+                    }
                     for (; p != pe; p++) {
                         ch = *p;
                         if (ch == CR || ch == LF) {
@@ -2583,6 +3170,7 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                 //CALLBACK_NOTIFY(MsgComplete);
                 msgEnd();
                 mState = p_state;
+                CHECK_PAUSED();
             } else if (mFlags & F_CHUNKED) {
                 //chunked encoding, ignore Content-Length header
                 p_state = s_chunk_size_start;
@@ -2619,6 +3207,7 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                     p_state = (NEW_MESSAGE());
                     msgEnd();
                     mState = p_state;
+                    CHECK_PAUSED();
                 } else if (mContentLen != ULLONG_MAX) {
                     /* Content-Length header given and non-zero */
                     p_state = s_body_identity;
@@ -2628,6 +3217,7 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
                         p_state = (NEW_MESSAGE());
                         msgEnd();
                         mState = p_state;
+                        CHECK_PAUSED();
                     } else {
                         /* Read body until EOF */
                         p_state = (s_body_identity_eof);
@@ -2695,6 +3285,7 @@ usz HttpLayer::parseBuf(const s8* data, usz len) {
             p_state = (NEW_MESSAGE());
             msgEnd();
             mState = p_state;
+            CHECK_PAUSED();
             mReadSize = nread;
             if (mUpgrade) {
                 //Exit, the rest of the message is in a different protocol
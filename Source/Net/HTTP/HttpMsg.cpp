@@ -26,6 +26,7 @@
 #include "Net/HTTP/HttpMsg.h"
 #include "Logger.h"
 #include "Net/HTTP/HttpLayer.h"
+#include "Net/HTTP/HttpFileCache.h"
 
 namespace app {
 namespace net {
@@ -36,6 +37,8 @@ HttpMsg::HttpMsg(HttpLayer* it) :
     mRespStatus(0),
     mLayer(it),
     mEvent(nullptr),
+    mFileNode(nullptr),
+    mPipeNext(nullptr),
     mFlags(0),
     mMethod(HTTP_GET),
     mType(EHTTP_BOTH),
@@ -51,6 +54,7 @@ HttpMsg::HttpMsg(HttpLayer* it) :
 
 HttpMsg::~HttpMsg() {
     setEvent(nullptr);
+    setFileNode(nullptr);
     if (mLayer) {
         mLayer->drop();
         mLayer = nullptr;
@@ -71,6 +75,17 @@ void HttpMsg::writeStatus(s32 val, const s8* str) {
 }
 
 
+void HttpMsg::setFileNode(HttpFileNode* it) {
+    if (it) {
+        it->grab();
+    }
+    if (mFileNode) {
+        mFileNode->drop();
+    }
+    mFileNode = it;
+}
+
+
 void HttpMsg::writeOutBody(const void* buf, usz bsz) {
     mCacheOut.write(buf, bsz);
 }
@@ -329,13 +344,21 @@ const StringView HttpMsg::getMimeType(const s8* filename, usz iLen) {
 
 
 s32 HttpMsg::writeGet(const String& req) {
+    return writeRequest(HTTP_GET, req);
+}
+
+
+s32 HttpMsg::writeRequest(EHttpMethod method, const String& req) {
     mCacheOut.reset();
     mURL.append(req.c_str(), req.getLen());
     if (!mURL.parser()) {
         return EE_ERROR;
     }
-    StringView buf = mURL.getPath();
-    mCacheOut.write("GET ", sizeof("GET ") - 1);
+    mMethod = method;
+    StringView buf = HttpLayer::getMethodStr(method);
+    mCacheOut.write(buf.mData, buf.mLen);
+    mCacheOut.write(" ", 1);
+    buf = mURL.getPath();
     mCacheOut.write(buf.mData, mURL.get().getLen() - (buf.mData - mURL.get().c_str()));
     mCacheOut.write(" HTTP/1.1\r\n", sizeof(" HTTP/1.1\r\n") - 1);
 
@@ -344,7 +367,7 @@ s32 HttpMsg::writeGet(const String& req) {
     mCacheOut.write(buf.mData,buf.mLen);
     mCacheOut.write("\r\n", sizeof("\r\n") - 1);
 
-    dumpHead(mHeadIn, mCacheOut);
+    dumpHead(mHeadOut, mCacheOut);
     mCacheOut.write("\r\n", sizeof("\r\n") - 1);
     return EE_OK;
 }
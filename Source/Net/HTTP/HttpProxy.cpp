@@ -0,0 +1,494 @@
+#include "Net/HTTP/HttpProxy.h"
+#include "Net/HTTP/HttpLayer.h"
+#include "Net/HTTP/Website.h"
+#include "Net/HTTP/MsgStation.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+//watermarks of output cache per direction, the sender is held above G_HIGH_MARK,
+//and goes on when the output drains to G_LOW_MARK
+static const s32 G_HIGH_MARK = 256 * 1024;
+static const s32 G_LOW_MARK = 64 * 1024;
+
+//hop-by-hop headers, which are not forwarded
+static bool IsHopHead(EHttpHeadID id) {
+    switch (id) {
+    case EHH_CONNECTION:
+    case EHH_KEEP_ALIVE:
+    case EHH_PROXY_CONNECTION:
+    case EHH_TE:
+    case EHH_UPGRADE:
+    case EHH_TRANSFER_ENCODING:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//reason phrase of a known status, or empty, which is allowed by RFC 9112
+static const s8* GetStatusBrief(u16 status) {
+    switch (status) {
+#define XX(num, name, string) case num: return #string;
+        HTTP_STATUS_MAP(XX)
+#undef XX
+    default:
+        return "";
+    }
+}
+
+
+/**
+ * @brief eventer of the msg of backend connection, reports the response to HttpEvtProxy.
+ */
+class HttpEvtProxyBack : public HttpEventer {
+public:
+    HttpEvtProxyBack(HttpEvtProxy* it) : mProxy(it) {
+        mProxy->grab();
+    }
+
+    virtual ~HttpEvtProxyBack() {
+        mProxy->drop();
+    }
+
+    virtual s32 onClose() override {
+        mProxy->onBackClose();
+        return EE_OK;
+    }
+
+    virtual s32 onHead(HttpMsg& msg) override {
+        return mProxy->onBackHead(msg);
+    }
+
+    virtual s32 onOpen(HttpMsg& msg) override {
+        return EE_OK;
+    }
+
+    virtual s32 onSent(HttpMsg& req) override {
+        return EE_OK;
+    }
+
+    virtual s32 onFinish(HttpMsg& msg) override {
+        return mProxy->onBackFinish(msg);
+    }
+
+    virtual s32 onBodyPart(HttpMsg& msg) override {
+        return mProxy->onBackBody(msg);
+    }
+
+    virtual s32 onDrain(HttpMsg& msg) override {
+        return mProxy->onBackDrain(msg);
+    }
+
+private:
+    HttpEvtProxy* mProxy;
+};
+
+
+
+HttpUpstream::HttpUpstream(const EngineConfig::UpstreamCfg& cfg) :
+    mPath(cfg.mPath),
+    mHost(cfg.mHost),
+    mNext(0),
+    mBalance(cfg.mBalance) {
+    mBackends.resize(cfg.mBackend.size());
+    for (usz i = 0; i < cfg.mBackend.size(); ++i) {
+        mBackends[i].mURL = cfg.mBackend[i];
+        if ('/' == mBackends[i].mURL.lastChar()) {
+            mBackends[i].mURL.setLen(mBackends[i].mURL.getLen() - 1);
+        }
+    }
+}
+
+
+HttpUpstream::~HttpUpstream() {
+}
+
+
+bool HttpUpstream::match(const StringView& host, const StringView& path)const {
+    if (path.mLen < mPath.getLen() || !path.equalsn(mPath.c_str(), mPath.getLen())) {
+        return false;
+    }
+    if (0 == mHost.getLen()) {
+        return true;
+    }
+    usz len = 0;
+    while (len < host.mLen && ':' != host.mData[len]) {
+        ++len;
+    }
+    return len == mHost.getLen() && 0 == AppStrNocaseCMP(host.mData, mHost.c_str(), len);
+}
+
+
+HttpBackend* HttpUpstream::pick() {
+    const usz cnt = mBackends.size();
+    if (0 == cnt) {
+        return nullptr;
+    }
+    usz idx = mNext++ % cnt;
+    if (1 == mBalance) {
+        //least outstanding, ties are broken by the round-robin start
+        for (usz i = 1; i < cnt; ++i) {
+            usz pos = (mNext - 1 + i) % cnt;
+            if (mBackends[pos].mFly < mBackends[idx].mFly) {
+                idx = pos;
+            }
+        }
+    }
+    HttpBackend* ret = &mBackends[idx];
+    ++ret->mFly;
+    ++ret->mTotal;
+    return ret;
+}
+
+
+
+HttpProxy::HttpProxy(Loop* loop, const EngineConfig::WebsiteCfg& cfg) :
+    mPool(loop, this),
+    mMaxIdle(cfg.mUpstreamIdle),
+    mIdleTime(cfg.mUpstreamIdleTime) {
+    for (usz i = 0; i < cfg.mUpstream.size(); ++i) {
+        mGroups.pushBack(new HttpUpstream(cfg.mUpstream[i]));
+    }
+}
+
+
+HttpProxy::~HttpProxy() {
+    for (usz i = 0; i < mGroups.size(); ++i) {
+        delete mGroups[i];
+    }
+    mGroups.clear();
+}
+
+
+s32 HttpProxy::open() {
+    return mPool.open(mMaxIdle, mIdleTime);
+}
+
+
+void HttpProxy::close() {
+    mPool.close();
+}
+
+
+HttpUpstream* HttpProxy::match(HttpMsg& msg) {
+    const StringView host = msg.getHeadIn().get(EHH_HOST);
+    const StringView path = msg.getURL().getPath();
+    HttpUpstream* ret = nullptr;
+    for (usz i = 0; i < mGroups.size(); ++i) {
+        if (mGroups[i]->match(host, path)
+            && (!ret || mGroups[i]->getPath().getLen() > ret->getPath().getLen())) {
+            ret = mGroups[i];
+        }
+    }
+    return ret;
+}
+
+
+
+HttpEvtProxy::HttpEvtProxy(HttpProxy* proxy, HttpUpstream* group) :
+    mProxy(proxy),
+    mGroup(group),
+    mBackend(nullptr),
+    mReq(nullptr),
+    mBack(nullptr),
+    mStation(ES_INIT),
+    mReqChunked(false),
+    mRespChunked(false),
+    mReqDone(false),
+    mRespDone(false) {
+    DASSERT(proxy && group);
+    mProxy->grab();
+}
+
+
+HttpEvtProxy::~HttpEvtProxy() {
+    DASSERT(!mBackend && !mBack);
+    mProxy->drop();
+}
+
+
+s32 HttpEvtProxy::onHead(HttpMsg& msg) {
+    mReq = &msg;
+    mReqChunked = msg.isChunked();
+    //the cached file or eventer of path is replaced by proxy
+    msg.setFileNode(nullptr);
+    msg.getHeadOut().clear();
+
+    mBackend = mGroup->pick();
+    String url(mBackend->mURL);
+    url += msg.getURL().get();
+    HttpLayer* back = mProxy->getPool().acquire(url);
+    if (!back) {
+        mGroup->release(mBackend);
+        mBackend = nullptr;
+        failResp();
+        return EE_OK;
+    }
+    mBack = back;
+
+    //headers of request, the Host is of backend
+    HttpMsg& req = *back->getMsg();
+    HttpHead& hed = req.getHeadOut();
+    hed.clear();
+    const HttpHead& hin = msg.getHeadIn();
+    StringView host;
+    for (usz i = 0; i < hin.size(); ++i) {
+        const HeadLine& line = hin[i];
+        const EHttpHeadID id = HttpHead::getID(StringView(line.mKey.c_str(), line.mKey.getLen()));
+        if (EHH_HOST == id) {
+            host.set(line.mVal.c_str(), line.mVal.getLen());
+        } else if (EHH_EXPECT != id && !IsHopHead(id)) {
+            //the body is forwarded without waiting "100 Continue" of backend
+            hed.add(line.mKey, line.mVal);
+        }
+    }
+    if (mReqChunked) {
+        hed.writeChunked();
+    }
+    hed.writeKeepAlive(true);
+    if (host.mLen > 0) {
+        hed.add(StringView("X-Forwarded-Host", sizeof("X-Forwarded-Host") - 1), host);
+    }
+    const s8* remote = msg.getHttpLayer()->getHandle().getRemote().getStr();
+    const s8* port = strrchr(remote, ':');
+    StringView rip(remote, port ? port - remote : strlen(remote));
+    StringView xff = hin.get(EHH_X_FORWARDED_FOR);
+    if (xff.mLen > 0) {
+        String val(xff.mData, xff.mLen);
+        val += ", ";
+        val.append(rip.mData, rip.mLen);
+        hed.add(EHH_X_FORWARDED_FOR, StringView(val.c_str(), val.getLen()));
+    } else {
+        hed.add(EHH_X_FORWARDED_FOR, rip);
+    }
+
+    HttpEventer* evt = new HttpEvtProxyBack(this);
+    req.setEvent(evt);
+    evt->drop();
+
+    if (EE_OK != back->request(msg.getMethod(), url)) {
+        //onBackClose() responses 502 to client
+        Logger::log(ELL_ERROR, "HttpEvtProxy::onHead>>fail url=%s", url.c_str());
+        mProxy->getPool().abort(back);
+    }
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onOpen(HttpMsg& msg) {
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onSent(HttpMsg& msg) {
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onBodyPart(HttpMsg& msg) {
+    HttpMsg* req = mBack && !mRespDone ? mBack->getMsg() : nullptr;
+    if (!req) {
+        msg.getCacheIn().reset(); //the backend is gone or had responded, drop the body
+        return EE_OK;
+    }
+    if (req->getCacheOut().getSize() >= G_HIGH_MARK) {
+        //the backend is slow, the body waits in CacheIn, see onBackDrain()
+        msg.getHttpLayer()->holdRead(true);
+        return EE_OK;
+    }
+    moveBody(msg.getCacheIn(), req->getCacheOut(), mReqChunked);
+    if (!mBack->sendReq()) {
+        mBack->postClose(); //onBackClose() responses 502 to client
+    }
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onFinish(HttpMsg& msg) {
+    if (mReqDone) {
+        return stepResp();
+    }
+    mReqDone = true;
+    msg.getHttpLayer()->holdRead(false);
+    HttpMsg* req = mBack && !mRespDone ? mBack->getMsg() : nullptr;
+    if (req) {
+        RingBuffer& out = req->getCacheOut();
+        moveBody(msg.getCacheIn(), out, mReqChunked);
+        if (mReqChunked) {
+            out.write("0\r\n\r\n", 5);
+        }
+        if (!mBack->sendReq()) {
+            mBack->postClose(); //onBackClose() responses 502 to client
+        }
+    }
+    return stepResp();
+}
+
+
+s32 HttpEvtProxy::onClose() {
+    //the msg of client is released
+    mReq = nullptr;
+    if (mBack && !mRespDone) {
+        mBack->postClose(); //response is not done, the connection can't be reused
+    }
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onBackHead(HttpMsg& msg) {
+    if (!mReq) {
+        return EE_ERROR;
+    }
+    HttpHead& hed = mReq->getHeadOut();
+    hed.clear();
+    const HttpHead& hin = msg.getHeadIn();
+    for (usz i = 0; i < hin.size(); ++i) {
+        const HeadLine& line = hin[i];
+        if (!IsHopHead(HttpHead::getID(StringView(line.mKey.c_str(), line.mKey.getLen())))) {
+            hed.add(line.mKey, line.mVal);
+        }
+    }
+    const u16 status = msg.getStatus();
+    const bool hasBody = HTTP_HEAD != mReq->getMethod() && 204 != status && 304 != status && status >= 200;
+    mRespChunked = hasBody && 0 == hin.get(EHH_CONTENT_LENGTH).mLen;
+    if (mRespChunked) {
+        hed.writeChunked();
+    }
+    hed.writeKeepAlive(mReq->isKeepAlive());
+
+    mReq->getCacheOut().reset();
+    //the reason phrase of backend is passed through
+    mReq->writeStatus(status, msg.getBrief().getLen() > 0 ? msg.getBrief().c_str() : GetStatusBrief(status));
+    mReq->dumpHeadOut();
+    mReq->writeOutBody("\r\n", 2);
+    mStation = ES_RESP_BODY;
+    return stepResp();
+}
+
+
+s32 HttpEvtProxy::onBackBody(HttpMsg& msg) {
+    if (!mReq) {
+        return EE_ERROR;
+    }
+    if (mReq->getCacheOut().getSize() >= G_HIGH_MARK) {
+        //the client is slow, the body waits in CacheIn of backend, see onDrain()
+        msg.getHttpLayer()->holdRead(true);
+        return EE_OK;
+    }
+    moveBody(msg.getCacheIn(), mReq->getCacheOut(), mRespChunked);
+    return stepResp();
+}
+
+
+s32 HttpEvtProxy::onDrain(HttpMsg& msg) {
+    HttpMsg* resp = mBack && !mRespDone ? mBack->getMsg() : nullptr;
+    if (resp && msg.getCacheOut().getSize() <= G_LOW_MARK) {
+        //sent by the caller after this
+        moveBody(resp->getCacheIn(), msg.getCacheOut(), mRespChunked);
+        mBack->holdRead(false);
+    }
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onBackDrain(HttpMsg& msg) {
+    if (mReq && !mReqDone && msg.getCacheOut().getSize() <= G_LOW_MARK) {
+        //sent by the caller after this
+        moveBody(mReq->getCacheIn(), msg.getCacheOut(), mReqChunked);
+        HttpLayer* layer = mReq->getHttpLayer();
+        layer->onBodyUsed(mReq);
+        layer->holdRead(false);
+    }
+    return EE_OK;
+}
+
+
+s32 HttpEvtProxy::onBackFinish(HttpMsg& msg) {
+    if (!mReq) {
+        return EE_ERROR;
+    }
+    moveBody(msg.getCacheIn(), mReq->getCacheOut(), mRespChunked);
+    if (mRespChunked) {
+        mReq->writeOutBody("0\r\n\r\n", 5);
+    }
+    //the connection may be reused by others
+    msg.getHttpLayer()->holdRead(false);
+    mRespDone = true;
+    mStation = ES_RESP_BODY_DONE;
+    return stepResp();
+}
+
+
+void HttpEvtProxy::onBackClose() {
+    //the msg of backend is released, by end of response or close of connection
+    mBack = nullptr;
+    if (mBackend) {
+        mGroup->release(mBackend);
+        mBackend = nullptr;
+    }
+    if (!mRespDone && mReq) {
+        failResp();
+    }
+    if (mReq && !mReqDone) {
+        //the held body is dropped by onBodyPart()
+        mReq->getHttpLayer()->holdRead(false);
+    }
+}
+
+
+void HttpEvtProxy::failResp() {
+    mRespDone = true;
+    if (ES_INIT == mStation) {
+        mReq->getCacheOut().reset();
+        mReq->getHeadOut().clear();
+        mReq->setStatus(502);
+        mStation = ES_ERROR;
+        stepResp();
+    } else {
+        mReq->getHttpLayer()->postClose();
+    }
+}
+
+
+s32 HttpEvtProxy::stepResp() {
+    if (!mReqDone || !mReq || ES_INIT == mStation) {
+        return EE_OK; //the response is kept in CacheOut before request done
+    }
+    Website* site = mReq->getHttpLayer()->getWebsite();
+    if (!site) {
+        return EE_ERROR;
+    }
+    if (mReq->getStationID() < mStation || ES_ERROR == mStation) {
+        mReq->setStationID(mStation);
+        if (ES_ERROR == mStation) {
+            mStation = ES_RESP_BODY_DONE; //error page is sent by StationError
+        }
+    }
+    return site->stepMsg(mReq);
+}
+
+
+void HttpEvtProxy::moveBody(RingBuffer& in, RingBuffer& out, bool chunked) {
+    s32 len = in.getSize();
+    if (len <= 0) {
+        return;
+    }
+    if (chunked) {
+        s8 head[16];
+        out.write(head, snprintf(head, sizeof(head), "%x\r\n", len));
+    }
+    while (in.getSize() > 0) {
+        StringView buf = in.peekHead();
+        out.write(buf.mData, (s32)buf.mLen);
+        in.commitHead((s32)buf.mLen);
+    }
+    if (chunked) {
+        out.write("\r\n", 2);
+    }
+}
+
+
+} //namespace net
+} //namespace app
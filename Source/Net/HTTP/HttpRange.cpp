@@ -0,0 +1,189 @@
+#include "Net/HTTP/HttpRange.h"
+#include "Net/HTTP/HttpMsg.h"
+
+namespace app {
+namespace net {
+
+static bool AppIsSpace(s8 it) {
+    return ' ' == it || '\t' == it;
+}
+
+//@return count of digits parsed, 0 if none or overflow
+static usz AppParseSize(const s8* str, const s8* end, usz& out) {
+    out = 0;
+    const s8* pos = str;
+    for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos) {
+        if (out > (~(usz)0 - 9) / 10) {
+            return 0;
+        }
+        out = out * 10 + (*pos - '0');
+    }
+    return pos - str;
+}
+
+
+usz HttpRange::writeETag(s8* tag, usz tsz, s64 mtime, usz fsize, bool gzip) {
+    s32 ret = snprintf(tag, tsz, "\"%llx-%llx%s\"",
+        (unsigned long long)mtime, (unsigned long long)fsize, gzip ? "-gz" : "");
+    return ret < (s32)tsz ? ret : tsz - 1;
+}
+
+
+bool HttpRange::matchETag(const StringView& list, const StringView& etag) {
+    const s8* pos = list.mData;
+    const s8* end = list.mData + list.mLen;
+    while (pos < end) {
+        while (pos < end && (AppIsSpace(*pos) || ',' == *pos)) {
+            ++pos;
+        }
+        const s8* tag = pos;
+        while (pos < end && ',' != *pos) {
+            ++pos;
+        }
+        const s8* tend = pos;
+        while (tend > tag && AppIsSpace(tend[-1])) {
+            --tend;
+        }
+        if (tend - tag == 1 && '*' == *tag) {
+            return true;
+        }
+        if (tend - tag > 2 && 'W' == tag[0] && '/' == tag[1]) {
+            tag += 2;
+        }
+        if ((usz)(tend - tag) == etag.mLen && 0 == memcmp(tag, etag.mData, etag.mLen)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+s32 HttpRange::parseRange(const StringView& range, usz fsize, usz& start, usz& len) {
+    const s8* pos = range.mData;
+    const s8* end = range.mData + range.mLen;
+    if (range.mLen < 7 || 0 != AppStrNocaseCMP(pos, "bytes=", 6)) {
+        return HTTP_STATUS_OK;
+    }
+    pos += 6;
+    for (const s8* it = pos; it < end; ++it) {
+        if (',' == *it) {
+            return HTTP_STATUS_OK; //multiple ranges
+        }
+    }
+    while (pos < end && AppIsSpace(*pos)) {
+        ++pos;
+    }
+    while (end > pos && AppIsSpace(end[-1])) {
+        --end;
+    }
+
+    usz first = 0;
+    usz last = 0;
+    usz cnt = AppParseSize(pos, end, first);
+    pos += cnt;
+    if (pos >= end || '-' != *pos) {
+        return HTTP_STATUS_OK;
+    }
+    ++pos;
+    if (0 == cnt) {
+        //suffix: "-n", the last n bytes
+        if (pos == end || pos + AppParseSize(pos, end, last) != end) {
+            return HTTP_STATUS_OK;
+        }
+        if (0 == last || 0 == fsize) {
+            return HTTP_STATUS_RANGE_NOT_SATISFIABLE;
+        }
+        len = AppMin<usz>(last, fsize);
+        start = fsize - len;
+        return HTTP_STATUS_PARTIAL_CONTENT;
+    }
+    if (pos == end) {
+        last = fsize - 1; //"n-"
+    } else if (pos + AppParseSize(pos, end, last) != end || last < first) {
+        return HTTP_STATUS_OK;
+    }
+    if (first >= fsize) {
+        return HTTP_STATUS_RANGE_NOT_SATISFIABLE;
+    }
+    start = first;
+    len = AppMin<usz>(last, fsize - 1) - first + 1;
+    return HTTP_STATUS_PARTIAL_CONTENT;
+}
+
+
+s32 HttpRange::check(const HttpHead& in, const StringView& etag, const StringView& mtime,
+    usz fsize, usz& start, usz& len) {
+    start = 0;
+    len = fsize;
+
+    StringView val = in.get(EHH_IF_NONE_MATCH);
+    if (val.mLen > 0) {
+        if (matchETag(val, etag)) {
+            return HTTP_STATUS_NOT_MODIFIED;
+        }
+    } else {
+        val = in.get(EHH_IF_MODIFIED_SINCE);
+        if (val.mLen > 0 && val == mtime) {
+            return HTTP_STATUS_NOT_MODIFIED;
+        }
+    }
+
+    StringView range = in.get(EHH_RANGE);
+    if (0 == range.mLen) {
+        return HTTP_STATUS_OK;
+    }
+    val = in.get(EHH_IF_RANGE);
+    if (val.mLen > 0 && !(val == etag) && !(val == mtime)) {
+        return HTTP_STATUS_OK; //changed, send the whole file
+    }
+    s32 ret = parseRange(range, fsize, start, len);
+    if (HTTP_STATUS_PARTIAL_CONTENT != ret) {
+        start = 0;
+        len = fsize;
+    }
+    return ret;
+}
+
+
+void HttpRange::writeHead(HttpMsg& msg, s32 status, const StringView& etag, const StringView& mtime,
+    usz fsize, usz start, usz len) {
+    HttpHead& hed = msg.getHeadOut();
+    StringView key("Transfer-Encoding", sizeof("Transfer-Encoding") - 1);
+    hed.remove(key);
+    hed.add(EHH_ETAG, etag);
+    hed.add(EHH_LAST_MODIFIED, mtime);
+    const s8* brief = "OK";
+    switch (status) {
+    case HTTP_STATUS_NOT_MODIFIED:
+        brief = "Not Modified";
+        break;
+    case HTTP_STATUS_PARTIAL_CONTENT:
+        brief = "Partial Content";
+        hed.writeContentRange(fsize, start, start + len - 1);
+        hed.writeLength(len);
+        break;
+    case HTTP_STATUS_RANGE_NOT_SATISFIABLE:
+    {
+        brief = "Range Not Satisfiable";
+        s8 tmp[64];
+        StringView val(tmp, snprintf(tmp, sizeof(tmp), "bytes */%llu", (unsigned long long)fsize));
+        hed.add(EHH_CONTENT_RANGE, val);
+        hed.writeLength(0);
+        break;
+    }
+    default:
+    {
+        StringView val("bytes", sizeof("bytes") - 1);
+        hed.add(EHH_ACCEPT_RANGES, val);
+        hed.writeLength(fsize);
+        break;
+    }
+    }
+    msg.getCacheOut().reset();
+    msg.writeStatus(status, brief);
+    msg.dumpHeadOut();
+    msg.writeOutBody("\r\n", 2);
+}
+
+}//namespace net
+}//namespace app
@@ -4,6 +4,9 @@
 #include "Net/HTTP/HttpFileSave.h"
 #include "Net/HTTP/HttpEvtLua.h"
 #include "Net/HTTP/Website.h"
+#include "Net/HTTP/HttpGzip.h"
+#include "Net/HTTP/HttpProxy.h"
+#include "Net/HTTP/HttpRange.h"
 
 // def str view
 #define DSTRV(V) V, sizeof(V) - 1
@@ -47,8 +50,16 @@ s32 StationPath::onMsg(HttpMsg* msg) {
     }
 
     StringView requrl = msg->getURL().getPath();
+    net::Website* site = msg->getHttpLayer()->getWebsite();
+    HttpFileNode* cached = nullptr;
+    if (site && HTTP_GET == msg->getMethod()) {
+        cached = site->getCache().get(requrl);
+    }
 
-    if (requrl.equalsn("/lua/", sizeof("/lua/") - 1)) {
+    if (cached) {
+        msg->setFileNode(cached);
+        return EE_OK;
+    } else if (requrl.equalsn("/lua/", sizeof("/lua/") - 1)) {
         //requrl.set(requrl.mData + 5, requrl.mLen - 5);
         HttpEventer* evt = new HttpEvtLua(requrl);
         msg->setEvent(evt);
@@ -72,13 +83,6 @@ s32 StationPath::onMsg(HttpMsg* msg) {
     const StringView str = HttpMsg::getMimeType(requrl.mData, requrl.mLen);
     msg->getHeadOut().writeContentType(str);
 
-    StringView svv("If-Range", sizeof("If-Range") - 1);
-    svv = msg->getHeadIn().get(svv);
-    if (svv.mLen > 0) {
-        svv.set("Range", sizeof("Range") - 1);
-        // msg->getHeadOut().add()
-    }
-
     return EE_OK;
 }
 
@@ -88,6 +92,20 @@ s32 StationReqHead::onMsg(HttpMsg* msg) {
 
     msg->getHeadOut().writeKeepAlive(msg->isKeepAlive());
 
+#if defined(DUSE_ZLIB)
+    HttpFileNode* cached = msg->getFileNode();
+    if (cached && !cached->isGzip() && HttpGzip::isAccept(msg->getHeadIn())) {
+        net::Website* site = msg->getHttpLayer()->getWebsite();
+        HttpFileNode* gz = site ? site->getCache().get(cached->getPath(), true) : nullptr;
+        if (gz) {
+            msg->setFileNode(gz);
+        }
+    }
+#endif
+    if (msg->getEvent()) {
+        msg->getEvent()->onHead(*msg);
+    }
+
     if (msg->isChunked()) {
         // msg->getHeadIn().clear();
     } else {
@@ -98,8 +116,12 @@ s32 StationReqHead::onMsg(HttpMsg* msg) {
 
 s32 StationBody::onMsg(HttpMsg* msg) {
     DASSERT(msg);
-    if (msg->getEvent()) {
-        msg->getEvent()->onBodyPart(*msg);
+    HttpEventer* evt = msg->getEvent();
+    if (evt) {
+        evt->onBodyPart(*msg);
+    }
+    if (!evt || !evt->isReadBody()) {
+        msg->getCacheIn().reset(); //nobody reads it, don't hold the memory and HTTP/2 window
     }
 
     if (msg->isChunked()) {
@@ -109,6 +131,34 @@ s32 StationBody::onMsg(HttpMsg* msg) {
 
 s32 StationBodyDone::onMsg(HttpMsg* msg) {
     DASSERT(msg);
+    HttpFileNode* node = msg->getFileNode();
+    if (node) {
+        usz start, len;
+        s32 status = HttpRange::check(msg->getHeadIn(), node->getETag(), node->getLastModified(),
+            node->getFileSize(), start, len);
+        msg->setStationID(ES_RESP_BODY_DONE);
+        if (HTTP_STATUS_OK == status) {
+            //cached file: status line, headers and body had been ready
+            return msg->getHttpLayer()->sendFile(msg) ? EE_OK : EE_ERROR;
+        }
+        //304, 416, or a slice of the cached body
+        msg->getHeadOut().writeContentType(node->getMime());
+#if defined(DUSE_ZLIB)
+        if (node->isGzip()) {
+            HttpGzip::writeHead(msg->getHeadOut());
+        } else if (HttpGzip::isCompressible(node->getMime())) {
+            HttpGzip::writeVary(msg->getHeadOut());
+        }
+#endif
+        HttpRange::writeHead(*msg, status, node->getETag(), node->getLastModified(),
+            node->getFileSize(), start, len);
+        if (HTTP_STATUS_PARTIAL_CONTENT == status) {
+            msg->writeOutBody(node->getBody().mData + start, len);
+        }
+        msg->setFileNode(nullptr);
+        return msg->getHttpLayer()->sendResp(msg) ? EE_OK : EE_ERROR;
+    }
+
     HttpHead& hed = msg->getHeadOut();
     StringView key(DSTRV("Host"));
     StringView val(DSTRV("127.0.0.1"));
@@ -132,7 +182,9 @@ s32 StationBodyDone::onMsg(HttpMsg* msg) {
     HttpEventer* evt = msg->getEvent();
     if (!evt || EE_OK != evt->onOpen(*msg)) {
         msg->setStationID(ES_ERROR);
-        msg->setStatus(404);
+        if (msg->getStatus() < HTTP_STATUS_BAD_REQUEST) {
+            msg->setStatus(404); //the eventer may had set its error, eg: 413
+        }
         StringView key("Transfer-Encoding", sizeof("Transfer-Encoding") - 1);
         hed.remove(key);
         net::Website* site = msg->getHttpLayer()->getWebsite();
@@ -142,6 +194,10 @@ s32 StationBodyDone::onMsg(HttpMsg* msg) {
         return EE_ERROR;
     }
 
+    if (ES_RESP_BODY_DONE == msg->getStationID()) {
+        //the eventer had done all the response, eg: 304 or HEAD
+        return msg->getHttpLayer()->sendResp(msg) ? EE_OK : EE_ERROR;
+    }
     msg->setStationID(ES_RESP_HEAD);
     return EE_OK;
 }
@@ -221,5 +277,36 @@ s32 StationError::onMsg(HttpMsg* msg) {
     return msg->getHttpLayer()->sendResp(msg) ? EE_OK : EE_ERROR;
 }
 
+
+StationProxy::StationProxy(HttpProxy* proxy, MsgStation* next) : mProxy(proxy) {
+    DASSERT(proxy && next);
+    mProxy->grab();
+    mNext = next;
+    mNext->grab();
+}
+
+StationProxy::~StationProxy() {
+    mNext->drop();
+    mProxy->drop();
+}
+
+s32 StationProxy::onMsg(HttpMsg* msg) {
+    DASSERT(msg);
+
+    HttpUpstream* group = mProxy->match(*msg);
+    if (!group) {
+        return mNext->onMsg(msg);
+    }
+    if (ES_HEAD == msg->getStationID()) {
+        HttpEventer* evt = new HttpEvtProxy(mProxy, group);
+        msg->setEvent(evt);
+        evt->drop();
+        return evt->onHead(*msg);
+    }
+    //ES_BODY_DONE
+    HttpEventer* evt = msg->getEvent();
+    return evt ? evt->onFinish(*msg) : EE_ERROR;
+}
+
 } // namespace net
 } // namespace app
@@ -2,6 +2,7 @@
 #include "Logger.h"
 #include "FileReader.h"
 #include "Packet.h"
+#include "Engine.h"
 
 namespace app {
 namespace net {
@@ -11,7 +12,9 @@ static const s8* G_CERT_FILE = "server.crt";
 static const s8* G_PRIVATE_FILE = "server.unsecure.key";
 
 Website::Website(EngineConfig::WebsiteCfg& cfg)
-    : mConfig(cfg) {
+    : mCache(cfg.mDict, cfg.mCacheSize, cfg.mCacheFileSize, cfg.mCacheTime)
+    , mProxy(nullptr)
+    , mConfig(cfg) {
     init();
 }
 
@@ -33,6 +36,12 @@ s32 Website::stepMsg(HttpMsg* msg) {
 
 
 void Website::clear() {
+    if (mProxy) {
+        mProxy->close();
+        mProxy->drop(); //deleted when all connections of backends are closed
+        mProxy = nullptr;
+    }
+    mCache.clear();
     for (s32 i = 0; i < ES_COUNT; ++i) {
         if (mStations[i]) {
             mStations[i]->drop();
@@ -72,6 +81,18 @@ void Website::loadTLS() {
             }
         }
     }
+    if (mConfig.mHTTP2) {
+        static const s8 G_ALPN[] = "\x02h2\x08http/1.1";
+        mTlsContext.setALPN(G_ALPN, sizeof(G_ALPN) - 1);
+    }
+    mTlsContext.setHandshakePool(mConfig.mTlsPool);
+    if (mConfig.mKTLS && EE_OK != mTlsContext.setKTLS(true)) {
+        Logger::logError("Website::init, host=%s, kTLS is not supported", mConfig.mLocal.getStr());
+    }
+    const s8* host = mConfig.mLocal.getStr();
+    if (EE_OK != mTlsContext.setSessionCache(Engine::getInstance().getTlsSessionCache(), host, strlen(host))) {
+        Logger::logError("Website::init, host=%s, session cache err", host);
+    }
 }
 
 
@@ -121,6 +142,30 @@ void Website::init() {
     nd = new StationClose();
     setStation(ES_CLOSE, nd);
     nd->drop();
+
+    initProxy();
+}
+
+
+void Website::initProxy() {
+    if (0 == mConfig.mUpstream.size()) {
+        return;
+    }
+    mProxy = new HttpProxy(&Engine::getInstance().getLoop(), mConfig);
+    if (EE_OK != mProxy->open()) {
+        Logger::logError("Website::initProxy, host=%s, fail to open pool", mConfig.mLocal.getStr());
+        mProxy->drop();
+        mProxy = nullptr;
+        return;
+    }
+    const EStationID ids[] = {ES_HEAD, ES_BODY_DONE};
+    for (usz i = 0; i < sizeof(ids) / sizeof(ids[0]); ++i) {
+        MsgStation* nd = new StationProxy(mProxy, mStations[ids[i]]);
+        setStation(ids[i], nd);
+        nd->drop();
+    }
+    Logger::log(ELL_INFO, "Website::initProxy>>host=%s, routes=%llu", mConfig.mLocal.getStr(),
+        (u64)mConfig.mUpstream.size());
 }
 
 
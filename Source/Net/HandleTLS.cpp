@@ -27,17 +27,31 @@
 #include "Net/Acceptor.h"
 #include "Net/TlsSession.h"
 #include "Engine.h"
+#include "System.h"
 
 
 namespace app {
 namespace net {
 
+//handshakes running in ThreadPool of this process
+static std::atomic<u32> G_TLS_POOL_JOBS(0);
+
+//max nodes of output gathered into one write
+static const s32 G_TLS_GATHER_NODES = 8;
+//max bytes of ciphertext buffered by sealWrites()
+static const s32 G_TLS_SEAL_SIZE = G_TLS_GATHER_NODES * D_RBUF_BLOCK_SIZE;
+
 HandleTLS::HandleTLS() :
     mTlsSession(nullptr),
     mFlyWrites(nullptr),
+    mWaitWrites(nullptr),
     mFlyReads(nullptr),
     mLandWrites(nullptr),
-    mLandReads(nullptr) {
+    mLandReads(nullptr),
+    mPoolLimit(0),
+    mHandshakeRet(0),
+    mHandshaking(false),
+    mCloseLater(false) {
     mLoop = &Engine::getInstance().getLoop();
     mHostName[0] = 0;
     mHostName[sizeof(mHostName) - 1] = 0;
@@ -72,14 +86,25 @@ void HandleTLS::init(const TlsContext& tlsCTX) {
     mWrite.mUser = nullptr; //nullʾδʹУΪռ
     mHostName[0] = 0;
     mCommitPos = mOutBuffers.getHead();
+    ((TlsSession*)mTlsSession)->setKTLS(tlsCTX.isKTLS() ? &mTCP.getSock() : nullptr);
+    mPoolLimit = tlsCTX.getHandshakePool();
+    mHandshaking = false;
+    mCloseLater = false;
 }
 
 
-s32 HandleTLS::handshake() {
+s32 HandleTLS::handshake(bool pool) {
+    if (mHandshaking) {
+        return EE_POSTED;
+    }
     TlsSession* session = (TlsSession*)mTlsSession;
 #ifdef DDEBUG
     assert(!session->isInitFinished() && "Handshake shouldn't be finished");
 #endif
+    //the buffers are not touched by loop while no read or write is in flight
+    if (pool && mPoolLimit > 0 && nullptr == mWrite.mUser && postHandshake()) {
+        return EE_POSTED;
+    }
     s32 rc = session->handshake();
     if (rc <= 0) {
         s32 err = session->getError(rc);
@@ -95,6 +120,80 @@ s32 HandleTLS::handshake() {
 }
 
 
+bool HandleTLS::postHandshake() {
+    if (G_TLS_POOL_JOBS.fetch_add(1) >= mPoolLimit) {
+        //too many, go on in loop
+        --G_TLS_POOL_JOBS;
+        return false;
+    }
+    mHandshaking = true;
+    mLoop->bindFly(&mTCP);
+    if (!Engine::getInstance().getThreadPool().postTask(&HandleTLS::handshakeByPool, this, &mRead)) {
+        mHandshaking = false;
+        mLoop->unbindFly(&mTCP);
+        --G_TLS_POOL_JOBS;
+        return false;
+    }
+    return true;
+}
+
+
+// called by thread pool
+void HandleTLS::handshakeByPool(RequestFD* it) {
+    TlsSession* session = (TlsSession*)mTlsSession;
+    s32 rc = session->handshake();
+    mHandshakeRet = EE_OK;
+    if (rc <= 0) {
+        //the error queue of OpenSSL is per thread
+        s32 err = session->getError(rc);
+        if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_NONE) {
+            TlsSession::showError();
+            mHandshakeRet = EE_ERROR;
+        }
+    }
+    if (EE_OK != mLoop->postTask(&HandleTLS::handshakeByLoop, this, it)) {
+        //the loop is stopping, undo postHandshake() here
+        Logger::log(ELL_ERROR, "HandleTLS::handshakeByPool>>post ecode=%d", System::getAppError());
+        --G_TLS_POOL_JOBS;
+        mHandshaking = false;
+        mLoop->unbindFly(&mTCP);
+    }
+}
+
+
+// called by loop thread
+void HandleTLS::handshakeByLoop(RequestFD* it) {
+    --G_TLS_POOL_JOBS;
+    mHandshaking = false;
+    s32 ret = mHandshakeRet;
+    if (EE_OK == ret) {
+        mWrite.mCall = HandleTLS::funcOnWriteHello;
+        ret = postWrite();
+    }
+    if (mCloseLater) {
+        mCloseLater = false;
+        launchClose();
+    } else if (!onHandshake(ret)) {
+        mInBuffers.setRet(0);
+        mFlag = mTCP.getFlag();
+    }
+    mLoop->unbindFly(&mTCP);
+}
+
+
+s32 HandleTLS::launchClose() {
+    if (mHandshaking) {
+        mCloseLater = true;
+        mFlag |= EHF_CLOSING;
+        mFlag &= ~(EHF_READABLE | EHF_WRITEABLE);
+        return EE_OK;
+    }
+    s32 ret = mTCP.launchClose();
+    mFlag = mTCP.getFlag();
+    return ret;
+}
+
+
 s32 HandleTLS::postRead() {
     if (mRead.mUser) {
         return EE_OK;
@@ -120,14 +219,30 @@ s32 HandleTLS::postWrite() {
     }
 
     if (mOutBuffers.getSize() > 0) {
-        s32 bufcnt = 1;
-        StringView buf;
-        mCommitPos = mOutBuffers.peekHeadNode(mOutBuffers.getHead(), &buf, &bufcnt);
+        //a segment of kTLS goes alone, such as a control record
+        u8 rtype;
+        const s32 limit = ((TlsSession*)mTlsSession)->getSendLimit(rtype);
+        s32 bufcnt = G_TLS_GATHER_NODES;
+        StringView bufs[G_TLS_GATHER_NODES];
+        mCommitPos = mOutBuffers.peekHeadNode(mOutBuffers.getHead(), bufs, &bufcnt, limit);
         //mWrite.mCall = HandleTLS::funcOnWrite;
-        mWrite.mData = buf.mData;
-        mWrite.mAllocated = (u32)buf.mLen;
+        if (1 == bufcnt) {
+            mWrite.mData = bufs[0].mData;
+            mWrite.mAllocated = (u32)bufs[0].mLen;
+        } else {
+            //one write for all nodes
+            mCache.resize(0);
+            for (s32 i = 0; i < bufcnt; ++i) {
+                mCache.write(bufs[i].mData, bufs[i].mLen);
+            }
+            mWrite.mData = mCache.getPointer();
+            mWrite.mAllocated = (u32)mCache.size();
+        }
         mWrite.mUsed = mWrite.mAllocated;
         DASSERT(mWrite.mUsed > 0);
+#if defined(DUSE_KTLS)
+        mWrite.mRecordType = rtype;
+#endif
         mWrite.mUser = this;
         mWrite.mError = mTCP.write(&mWrite);
         return mWrite.mError;
@@ -147,6 +262,18 @@ s32 HandleTLS::verify(s32 vfg) {
 }
 
 
+bool HandleTLS::isKTLS()const {
+    TlsSession* session = (TlsSession*)mTlsSession;
+    return session && session->isKTLS();
+}
+
+
+StringView HandleTLS::getALPN()const {
+    TlsSession* session = (TlsSession*)mTlsSession;
+    return session ? session->getALPN() : StringView();
+}
+
+
 void HandleTLS::landQueue(RequestFD*& que) {
     for (RequestFD* nd = AppPopRingQueueHead_1(que);
         nd; nd = AppPopRingQueueHead_1(que)) {
@@ -163,9 +290,10 @@ void HandleTLS::doRead() {
     do {
         for (RequestFD* it = AppPopRingQueueHead_1(mFlyReads);
             it && gogo; it = AppPopRingQueueHead_1(mFlyReads)) {
-            s32 nread = session->read(it->mData, (s32)it->mAllocated);
+            //append to the leftover of last read, same as HandleTCP
+            s32 nread = session->read(it->mData + it->mUsed, (s32)it->getWriteSize());
             if (nread > 0) {
-                it->mUsed = nread;
+                it->mUsed += nread;
                 AppPushRingQueueTail_1(mLandReads, it);
                 //it->mCall(it);
             } else {
@@ -295,27 +423,66 @@ s32 HandleTLS::write(RequestFD* req) {
     req->mType = ERT_WRITE;
     req->mHandle = this;
 
-    if (mFlyWrites) {
-        AppPushRingQueueTail_1(mFlyWrites, req);
+    req->mStepSize = 0;
+
+    TlsSession* session = (TlsSession*)mTlsSession;
+    if (session->isKTLS() && !mWaitWrites && !mWrite.mUser && 0 == mOutBuffers.getSize()) {
+        //plaintext to socket directly, the kernel encrypts it
+        return mTCP.write(req);
+    }
+
+    AppPushRingQueueTail_1(mWaitWrites, req);
+    if (!mWrite.mUser) {
+        sealWrites();
         postWrite();
-        return EE_OK;
     }
+    //else coalesced with others when the sending is done
+    return EE_OK;
+}
+
 
+void HandleTLS::sealWrites() {
     TlsSession* session = (TlsSession*)mTlsSession;
-    s32 wsz = session->write(req->mData, (s32)req->mUsed);
-    if (wsz > 0) {
-        if ((u32)wsz >= req->mUsed) {
-            //done
-            AppPushRingQueueTail_1(mLandWrites, req);
-            postWrite();
-            return EE_OK;
+    if (!mWaitWrites || mWrite.mUser || !session->isInitFinished()) {
+        return;
+    }
+    while (mWaitWrites && mOutBuffers.getSize() < G_TLS_SEAL_SIZE) {
+        const u32 rsize = session->getRecordSize(mLoop->getTime());
+        RequestFD* req = mWaitWrites->mNext;
+        const s8* rec;
+        u32 len = req->mUsed - req->mStepSize;
+        if (len >= rsize) {
+            //big one, no copy
+            rec = req->mData + req->mStepSize;
+            len = rsize;
+            req->mStepSize += len;
+            if (req->mStepSize >= req->mUsed) {
+                AppPopRingQueueHead_1(mWaitWrites);
+                AppPushRingQueueTail_1(mLandWrites, req);
+            }
         } else {
-            req->setStepSize(wsz);
+            //coalesce small ones into one record
+            mCache.resize(0);
+            while (mWaitWrites && mCache.size() < rsize) {
+                req = mWaitWrites->mNext;
+                u32 step = AppMin<u32>(rsize - (u32)mCache.size(), req->mUsed - req->mStepSize);
+                mCache.write(req->mData + req->mStepSize, step);
+                req->mStepSize += step;
+                if (req->mStepSize >= req->mUsed) {
+                    AppPopRingQueueHead_1(mWaitWrites);
+                    AppPushRingQueueTail_1(mLandWrites, req);
+                }
+            }
+            rec = mCache.getPointer();
+            len = (u32)mCache.size();
+        }
+        if (len > 0 && session->write(rec, (s32)len) <= 0) {
+            TlsSession::showError();
+            Logger::log(ELL_ERROR, "HandleTLS::sealWrites>>size=%u", len);
+            close();
+            return;
         }
     }
-    AppPushRingQueueHead_1(mFlyWrites, req);
-    postWrite();
-    return EE_OK;
 }
 
 
@@ -336,7 +503,7 @@ s32 HandleTLS::read(RequestFD* req) {
     TlsSession* session = (TlsSession*)mTlsSession;
     s32 wsz = session->read(buf.mData, (s32)buf.mLen);
     if (wsz > 0) {
-        req->mUsed = wsz;
+        req->mUsed += wsz;
         AppPushRingQueueTail_1(mLandReads, req);
         //done
     } else {
@@ -349,6 +516,10 @@ s32 HandleTLS::read(RequestFD* req) {
 
 s32 HandleTLS::onTimeout(HandleTime& it) {
     DASSERT(mTCP.getGrabCount() > 0);
+    if (mHandshaking) {
+        //keep the socket until the handshake is back from ThreadPool
+        return EE_OK;
+    }
     return mCallTime(this);
 }
 
@@ -358,6 +529,11 @@ void HandleTLS::onClose(Handle* it) {
     mFlag = mTCP.getFlag();
     landReads();
     landWrites();
+    for (RequestFD* nd = AppPopRingQueueHead_1(mWaitWrites);
+        nd; nd = AppPopRingQueueHead_1(mWaitWrites)) {
+        nd->mError = EE_NO_WRITEABLE;
+        nd->mCall(nd);
+    }
     landQueue(mFlyWrites);
     landQueue(mFlyReads);
     uninit();
@@ -370,6 +546,10 @@ void HandleTLS::onWriteHello(RequestFD* it) {
     if (0 == it->mError) {
         mWrite.mUser = nullptr;
         mOutBuffers.commitHeadPos(mCommitPos);
+        if (EE_OK != ((TlsSession*)mTlsSession)->commitSend((s32)it->mUsed)) {
+            close();
+            return;
+        }
         handshake();
         return;
     }
@@ -384,6 +564,11 @@ void HandleTLS::onWrite(RequestFD* it) {
     if (0 == it->mError) {
         mWrite.mUser = nullptr;
         mOutBuffers.commitHeadPos(mCommitPos);
+        if (EE_OK != ((TlsSession*)mTlsSession)->commitSend((s32)it->mUsed)) {
+            close();
+            return;
+        }
+        sealWrites();
         postWrite();
         return;
     }
@@ -413,34 +598,8 @@ void HandleTLS::onReadHello(RequestFD* it) {
     if (it->mUsed > 0) {
         mRead.mUser = nullptr;
         mInBuffers.commitTailPos((s32)it->mUsed);
-        s32 ret = handshake();
-        if (0 == ret) {
-            TlsSession* session = (TlsSession*)mTlsSession;
-            if (session->isInitFinished()) {
-                it->mCall = HandleTLS::funcOnRead;
-                mWrite.mCall = HandleTLS::funcOnWrite;
-
-                if (EHT_TCP_CONNECT == mType) {
-                    RequestFD* oit = AppPopRingQueueHead_1(mFlyWrites);
-                    DASSERT(oit);
-                    if (oit) {
-                        //صоǷҪ֤֤飬 HandleTLS::verify(1, "www.baidu.com");
-                        oit->mError = 0;
-                        oit->mCall(oit);
-                    }
-                } else {
-                    //link type
-                    doRead();
-                }
-            }
-        } else {
-            close();
-        }
-
-        if (EE_OK == postRead()) {
-            if (HandleTLS::funcOnReadHello == it->mCall && mOutBuffers.getSize() > 0) {
-                handshake();
-            }
+        s32 ret = handshake(true);
+        if (EE_POSTED == ret || onHandshake(ret)) {
             return;
         }
     }
@@ -451,6 +610,42 @@ void HandleTLS::onReadHello(RequestFD* it) {
 }
 
 
+bool HandleTLS::onHandshake(s32 ret) {
+    if (0 == ret) {
+        TlsSession* session = (TlsSession*)mTlsSession;
+        if (session->isInitFinished()) {
+            mRead.mCall = HandleTLS::funcOnRead;
+            mWrite.mCall = HandleTLS::funcOnWrite;
+
+            if (EHT_TCP_CONNECT == mType) {
+                RequestFD* oit = AppPopRingQueueHead_1(mFlyWrites);
+                DASSERT(oit);
+                if (oit) {
+                    //صоǷҪ֤֤飬 HandleTLS::verify(1, "www.baidu.com");
+                    oit->mError = 0;
+                    oit->mCall(oit);
+                }
+            } else {
+                //link type
+                doRead();
+            }
+            sealWrites();
+            postWrite();
+        }
+    } else {
+        close();
+    }
+
+    if (EE_OK == postRead()) {
+        if (HandleTLS::funcOnReadHello == mRead.mCall && mOutBuffers.getSize() > 0) {
+            handshake();
+        }
+        return true;
+    }
+    return false;
+}
+
+
 void HandleTLS::onConnect(RequestFD* it) {
     DASSERT(it == &mWrite);
     mWrite.mUser = nullptr;
@@ -0,0 +1,623 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#include "Net/MySQL/MySQLClient.h"
+#include "Logger.h"
+#include "Net/MySQL/MySQLClientPool.h"
+#include "Net/MySQL/MySQLRequest.h"
+#include <openssl/sha.h>
+#include <openssl/pem.h>
+#include <openssl/evp.h>
+#include <openssl/rsa.h>
+
+namespace app {
+namespace net {
+
+//capability flags of client
+static const u32 G_CLIENT_LONG_PASSWORD = 0x00000001;
+static const u32 G_CLIENT_LONG_FLAG = 0x00000004;
+static const u32 G_CLIENT_CONNECT_WITH_DB = 0x00000008;
+static const u32 G_CLIENT_PROTOCOL_41 = 0x00000200;
+static const u32 G_CLIENT_TRANSACTIONS = 0x00002000;
+static const u32 G_CLIENT_SECURE_CONNECTION = 0x00008000;
+static const u32 G_CLIENT_MULTI_RESULTS = 0x00020000;
+static const u32 G_CLIENT_PLUGIN_AUTH = 0x00080000;
+
+//utf8mb4_general_ci
+static const u8 G_CHARSET_UTF8MB4 = 45;
+
+
+MySQLClient::MySQLClient(MySQLClientPool* pool) :
+    mStatus(0),
+    mStep(EHS_GREETING),
+    mPlugin(EAP_NATIVE),
+    mConnectionID(0),
+    mSeq(0),
+    mPool(pool),
+    mFlyCount(0),
+    mUnsent(0),
+    mReplied(0),
+    mStalled(false),
+    mWriting(nullptr),
+    mOutCache(nullptr),
+    mKept(0),
+    mLoop(pool->getLoop()) {
+
+    memset(mScramble, 0, sizeof(mScramble));
+    mTCP.setClose(EHT_TCP_CONNECT, MySQLClient::funcOnClose, this);
+    mTCP.setTime(MySQLClient::funcOnTime, 15 * 1000, 20 * 1000, -1);
+}
+
+
+MySQLClient::~MySQLClient() {
+    if (mOutCache) {
+        RequestFD::delRequest(mOutCache);
+        mOutCache = nullptr;
+    }
+}
+
+
+void MySQLClient::onClose(Handle* it) {
+    mWriting = nullptr;
+    mUnsent = 0;
+    mStalled = false;
+    mKept = 0;
+    while (!mFlyQueue.empty()) {
+        mResult.makeError(2013, "MySQLClient::onClose>>lost connection");
+        callback();
+    }
+    mResult.clear();
+    const bool fly = 0 == (4 & mStatus);
+    mStatus = 0;
+    mPool->onClose(this, fly);
+}
+
+
+void MySQLClient::onWrite(RequestFD* it) {
+    if (it == mWriting) {
+        mWriting = nullptr;
+        if (0 == it->mError) {
+            flush();
+        }
+    }
+    if (it != mOutCache) {
+        RequestFD::delRequest(it);
+    }
+}
+
+
+void MySQLClient::onRead(RequestFD* it) {
+    if (it->mUsed > mKept) {
+        const u8* pos = reinterpret_cast<const u8*>(it->mData);
+        const u8* const end = pos + it->mUsed;
+        //many packets may be in one read, a packet is decoded after all of it is received
+        while (end - pos >= 4) {
+            const u32 len = pos[0] | (pos[1] << 8) | (pos[2] << 16);
+            if (len >= MySQLRequest::G_MAX_PACKET) {
+                Logger::log(ELL_ERROR, "MySQLClient::onRead>>packet over 16MB, addr=%s",
+                    mPool->getRemoterAddr().getStr());
+                close();
+                break;
+            }
+            if (static_cast<u32>(end - pos) < 4 + len) {
+                break;
+            }
+            const u8* pkt = pos + 4;
+            mSeq = pos[3] + 1;
+            pos += 4 + len;
+            if (1 & mStatus) {
+                if (!onHandshake(pkt, len)) {
+                    close();
+                    break;
+                }
+                continue;
+            }
+            if (mFlyQueue.empty()) {
+                Logger::log(ELL_ERROR, "MySQLClient::onRead>>no request of reply, addr=%s",
+                    mPool->getRemoterAddr().getStr());
+                close();
+                break;
+            }
+            s32 ret = mResult.decode(pkt, len);
+            if (ret < 0) {
+                Logger::log(ELL_ERROR, "MySQLClient::onRead>>bad reply, addr=%s",
+                    mPool->getRemoterAddr().getStr());
+                close();
+                break;
+            }
+            if (ret > 0) {
+                callback();
+            }
+        }
+        if ((4 & mStatus) && !isFull()) {
+            mPool->push(this);
+        }
+        it = keepTail(it, reinterpret_cast<const s8*>(pos));
+        if (EE_OK == mTCP.read(it)) {
+            return;
+        }
+    }
+    Logger::log(ELL_INFO, "MySQLClient::onRead>>addr=%s, ecode=%d",
+        mPool->getRemoterAddr().getStr(), it->mError);
+    RequestFD::delRequest(it);
+}
+
+
+void MySQLClient::callback() {
+    MySQLRequest* cmd = static_cast<MySQLRequest*>(mFlyQueue.getPrevious());
+    DASSERT(cmd != &mFlyQueue);
+    cmd->delink();
+    cmd->setClient(nullptr);
+    --mFlyCount;
+    ++mReplied;
+    AppMySQLCaller fun = cmd->getCallback();
+    if (fun) {
+        fun(cmd, &mResult);
+    }
+    cmd->drop();
+    mResult.clear();
+}
+
+
+RequestFD* MySQLClient::keepTail(RequestFD* it, const s8* pos) {
+    mKept = static_cast<u32>(it->mData + it->mUsed - pos);
+    if (mKept > 0 && pos > it->mData) {
+        memmove(it->mData, pos, mKept);
+    }
+    it->mUsed = mKept;
+    u32 cap = it->mAllocated;
+    if (mKept == cap) {
+        cap *= 2;   //a large packet
+    } else if (0 == mKept && cap > G_READ_SIZE) {
+        cap = G_READ_SIZE;
+    } else {
+        return it;
+    }
+    RequestFD* nd = RequestFD::newRequest(cap);
+    memcpy(nd->mData, it->mData, mKept);
+    nd->mUsed = mKept;
+    nd->mUser = it->mUser;
+    nd->mCall = it->mCall;
+    RequestFD::delRequest(it);
+    return nd;
+}
+
+
+s32 MySQLClient::open() {
+    if (EE_OK != mLoop->openHandle(&mTCP)) {
+        Logger::logError("MySQLClient::open>>fail to open mysql = %s", mTCP.getRemote().getStr());
+        return EE_ERROR;
+    }
+    mStatus = 1;
+    mStep = EHS_GREETING;
+
+    RequestFD* it = RequestFD::newRequest(G_READ_SIZE);
+    it->mUser = this;
+    it->mCall = funcOnConnect;
+    s32 ret = mTCP.connect(it);
+    if (EE_OK != ret) {
+        RequestFD::delRequest(it);
+        Logger::logError("MySQLClient::open>>fail to connect mysql = %s", mTCP.getRemote().getStr());
+    }
+    return EE_OK;
+}
+
+
+s32 MySQLClient::close() {
+    return mLoop->closeHandle(&mTCP);
+}
+
+
+s32 MySQLClient::onTimeout(HandleTime& it) {
+    DASSERT(mTCP.getGrabCount() > 0);
+    if (mStatus & 1) {
+        return EE_ERROR;
+    }
+    //no reply for a whole period while commands are in flight
+    bool stall = mFlyCount > 0 && 0 == mReplied;
+    if (stall && mStalled) {
+        Logger::log(ELL_ERROR, "MySQLClient::onTimeout>>addr=%s, fly=%u",
+            mPool->getRemoterAddr().getStr(), mFlyCount);
+        return EE_ERROR;
+    }
+    mStalled = stall;
+    mReplied = 0;
+    return EE_OK;
+}
+
+
+bool MySQLClient::isFull()const {
+    return mFlyCount >= mPool->getMaxPipeline();
+}
+
+
+bool MySQLClient::postTask(MySQLRequest* it) {
+    if (0 == (4 & mStatus) || isFull()) {
+        return false;
+    }
+    it->grab();
+    it->setClient(this);
+    mFlyQueue.pushBack(*it);
+    ++mFlyCount;
+    ++mUnsent;
+    if (flush()) {
+        return true;
+    }
+    //the new one is the only unsent command
+    it->delink();
+    it->setClient(nullptr);
+    it->drop();
+    --mFlyCount;
+    --mUnsent;
+    return false;
+}
+
+
+bool MySQLClient::flush() {
+    if (mWriting || 0 == mUnsent) {
+        return true;
+    }
+    //the oldest unsent command
+    Node2* first = &mFlyQueue;
+    for (u32 i = 0; i < mUnsent; ++i) {
+        first = first->getNext();
+    }
+    u32 allsz = 0;
+    for (Node2* nd = first; nd != &mFlyQueue; nd = nd->getPrevious()) {
+        allsz += static_cast<MySQLRequest*>(nd)->getRequestSize();
+    }
+    RequestFD* out;
+    if (allsz <= G_OUT_CACHE) {
+        //small commands are copied into the reused buffer, no allocation
+        if (!mOutCache) {
+            mOutCache = RequestFD::newRequest(G_OUT_CACHE);
+        }
+        out = mOutCache;
+    } else if (1 == mUnsent) {
+        MySQLRequest* cmd = static_cast<MySQLRequest*>(first);
+        out = RequestFD::newRequest(0);
+        out->mData = (s8*)cmd->getRequestBuf();
+        out->mAllocated = allsz;
+    } else {
+        out = RequestFD::newRequest(allsz);
+    }
+    if (out->mData != static_cast<MySQLRequest*>(first)->getRequestBuf()) {
+        s8* curr = out->mData;
+        for (Node2* nd = first; nd != &mFlyQueue; nd = nd->getPrevious()) {
+            MySQLRequest* cmd = static_cast<MySQLRequest*>(nd);
+            memcpy(curr, cmd->getRequestBuf(), cmd->getRequestSize());
+            curr += cmd->getRequestSize();
+        }
+    }
+    out->mUsed = allsz;
+    out->mUser = this;
+    out->mCall = MySQLClient::funcOnWrite;
+    if (0 != mTCP.write(out)) {
+        if (out != mOutCache) {
+            RequestFD::delRequest(out);
+        }
+        return false;
+    }
+    mWriting = out;
+    mUnsent = 0;
+    return true;
+}
+
+
+bool MySQLClient::writePacket(const u8* data, u32 len) {
+    RequestFD* out = RequestFD::newRequest(4 + len);
+    out->mData[0] = (s8)(len & 0xFF);
+    out->mData[1] = (s8)((len >> 8) & 0xFF);
+    out->mData[2] = (s8)((len >> 16) & 0xFF);
+    out->mData[3] = (s8)mSeq++;
+    if (len > 0) {
+        memcpy(out->mData + 4, data, len);
+    }
+    out->mUsed = 4 + len;
+    out->mUser = this;
+    out->mCall = MySQLClient::funcOnWrite;
+    if (0 != mTCP.write(out)) {
+        RequestFD::delRequest(out);
+        return false;
+    }
+    return true;
+}
+
+
+u32 MySQLClient::getPlugin(const s8* name, usz len) {
+    if (sizeof("mysql_native_password") - 1 == len && 0 == memcmp(name, "mysql_native_password", len)) {
+        return EAP_NATIVE;
+    }
+    if (sizeof("caching_sha2_password") - 1 == len && 0 == memcmp(name, "caching_sha2_password", len)) {
+        return EAP_CACHING_SHA2;
+    }
+    return EAP_UNKNOWN;
+}
+
+
+u32 MySQLClient::getAuthData(u8* out)const {
+    const String& pwd = mPool->getPassword();
+    if (0 == pwd.getLen()) {
+        return 0;
+    }
+    const u8* pass = reinterpret_cast<const u8*>(pwd.c_str());
+    if (EAP_NATIVE == mPlugin) {
+        //SHA1(password) XOR SHA1(scramble + SHA1(SHA1(password)))
+        u8 hash[SHA_DIGEST_LENGTH];
+        u8 mix[G_SCRAMBLE_SIZE + SHA_DIGEST_LENGTH];
+        SHA1(pass, pwd.getLen(), out);
+        SHA1(out, SHA_DIGEST_LENGTH, hash);
+        memcpy(mix, mScramble, G_SCRAMBLE_SIZE);
+        memcpy(mix + G_SCRAMBLE_SIZE, hash, SHA_DIGEST_LENGTH);
+        SHA1(mix, sizeof(mix), hash);
+        for (u32 i = 0; i < SHA_DIGEST_LENGTH; ++i) {
+            out[i] ^= hash[i];
+        }
+        return SHA_DIGEST_LENGTH;
+    }
+    //SHA256(password) XOR SHA256(SHA256(SHA256(password)) + scramble)
+    u8 hash[SHA256_DIGEST_LENGTH];
+    u8 mix[SHA256_DIGEST_LENGTH + G_SCRAMBLE_SIZE];
+    SHA256(pass, pwd.getLen(), out);
+    SHA256(out, SHA256_DIGEST_LENGTH, mix);
+    memcpy(mix + SHA256_DIGEST_LENGTH, mScramble, G_SCRAMBLE_SIZE);
+    SHA256(mix, sizeof(mix), hash);
+    for (u32 i = 0; i < SHA256_DIGEST_LENGTH; ++i) {
+        out[i] ^= hash[i];
+    }
+    return SHA256_DIGEST_LENGTH;
+}
+
+
+bool MySQLClient::onGreeting(const u8* pkt, u32 len) {
+    const u8* pos = pkt;
+    const u8* const end = pkt + len;
+    if (len < 1 || 10 != *pos++) {
+        return false;
+    }
+    //server version
+    while (pos < end && *pos) {
+        ++pos;
+    }
+    if (end - pos < 1 + 4 + 8 + 1 + 2) {
+        return false;
+    }
+    ++pos;
+    mConnectionID = pos[0] | (pos[1] << 8) | (pos[2] << 16) | ((u32)pos[3] << 24);
+    pos += 4;
+    memcpy(mScramble, pos, 8);
+    pos += 8 + 1;
+    u32 caps = pos[0] | (pos[1] << 8);
+    pos += 2;
+    if (0 == (G_CLIENT_PROTOCOL_41 & caps) || end - pos < 1 + 2 + 2 + 1 + 10 + 12) {
+        Logger::logError("MySQLClient::onGreeting>>server is too old, addr=%s",
+            mPool->getRemoterAddr().getStr());
+        return false;
+    }
+    pos += 1 + 2;   //charset, status
+    caps |= (pos[0] | (pos[1] << 8)) << 16;
+    pos += 2;
+    const u32 authsz = *pos;
+    pos += 1 + 10;
+    memcpy(mScramble + 8, pos, 12);
+    pos += AppMax<u32>(13, authsz > 8 ? authsz - 8 : 0);
+    mPlugin = EAP_NATIVE;
+    if ((G_CLIENT_PLUGIN_AUTH & caps) && pos < end) {
+        const u8* name = pos;
+        while (pos < end && *pos) {
+            ++pos;
+        }
+        mPlugin = getPlugin(reinterpret_cast<const s8*>(name), pos - name);
+        if (EAP_UNKNOWN == mPlugin) {
+            //the server switches to the plugin of user if this one is wrong
+            mPlugin = EAP_NATIVE;
+        }
+    }
+
+    //HandshakeResponse41
+    const String& user = mPool->getUser();
+    const String& db = mPool->getDatabase();
+    u32 flags = G_CLIENT_LONG_PASSWORD | G_CLIENT_LONG_FLAG | G_CLIENT_PROTOCOL_41
+        | G_CLIENT_TRANSACTIONS | G_CLIENT_SECURE_CONNECTION | G_CLIENT_MULTI_RESULTS | G_CLIENT_PLUGIN_AUTH;
+    if (db.getLen() > 0) {
+        flags |= G_CLIENT_CONNECT_WITH_DB;
+    }
+    flags &= caps;
+    const s8* plugin = EAP_NATIVE == mPlugin ? "mysql_native_password" : "caching_sha2_password";
+    String out(4 + 4 + 1 + 23 + user.getLen() + 1 + 1 + SHA256_DIGEST_LENGTH + db.getLen() + 1 + 32);
+    const s8 head[9] = { (s8)(flags & 0xFF), (s8)((flags >> 8) & 0xFF), (s8)((flags >> 16) & 0xFF),
+        (s8)((flags >> 24) & 0xFF), 0, 0, 0, 1, (s8)G_CHARSET_UTF8MB4 };
+    const s8 zero[23] = { 0 };
+    out.append(head, sizeof(head));
+    out.append(zero, sizeof(zero));
+    out.append(user.c_str(), user.getLen());
+    out += '\0';
+    u8 auth[SHA256_DIGEST_LENGTH];
+    const u32 authlen = getAuthData(auth);
+    out += (s8)authlen;
+    out.append(reinterpret_cast<const s8*>(auth), authlen);
+    if (G_CLIENT_CONNECT_WITH_DB & flags) {
+        out.append(db.c_str(), db.getLen());
+        out += '\0';
+    }
+    if (G_CLIENT_PLUGIN_AUTH & flags) {
+        out.append(plugin);
+        out += '\0';
+    }
+    mStep = EHS_AUTH;
+    return writePacket(reinterpret_cast<const u8*>(out.c_str()), static_cast<u32>(out.getLen()));
+}
+
+
+bool MySQLClient::onAuth(const u8* pkt, u32 len) {
+    switch (pkt[0]) {
+    case 0x00:
+        mStep = EHS_READY;
+        mStatus |= 4;
+        mStatus &= ~1;
+        mPool->push(this);
+        return true;
+
+    case 0xFE:
+    {
+        //auth switch request: plugin name, scramble
+        const u8* pos = pkt + 1;
+        const u8* const end = pkt + len;
+        const u8* name = pos;
+        while (pos < end && *pos) {
+            ++pos;
+        }
+        mPlugin = getPlugin(reinterpret_cast<const s8*>(name), pos - name);
+        if (EAP_UNKNOWN == mPlugin || end - pos < 1 + G_SCRAMBLE_SIZE) {
+            Logger::logError("MySQLClient::onAuth>>unsupported auth plugin=%.*s, addr=%s",
+                (s32)(pos - name), name, mPool->getRemoterAddr().getStr());
+            return false;
+        }
+        memcpy(mScramble, pos + 1, G_SCRAMBLE_SIZE);
+        u8 auth[SHA256_DIGEST_LENGTH];
+        return writePacket(auth, getAuthData(auth));
+    }
+
+    case 0x01:
+        //more data of caching_sha2_password: 3=fast auth done, 4=full auth needed
+        if (len >= 2 && 3 == pkt[1]) {
+            return true;
+        }
+        if (len >= 2 && 4 == pkt[1]) {
+            //no TLS, the password is encrypted by the public key of server
+            const String& key = mPool->getServerPublicKey();
+            if (key.getLen() > 0) {
+                return writePassword(reinterpret_cast<const u8*>(key.c_str()), static_cast<u32>(key.getLen()));
+            }
+            if (!mPool->isGetServerPublicKey()) {
+                Logger::logError("MySQLClient::onAuth>>full auth of caching_sha2_password needs the public key"
+                    " of server, see MySQLClientPool::setServerPublicKey(), addr=%s, user=%s",
+                    mPool->getRemoterAddr().getStr(), mPool->getUser().c_str());
+                return false;
+            }
+            //the key got is not verified, it's enabled by MySQLClientPool::setGetServerPublicKey()
+            const u8 req = 2;
+            mStep = EHS_PUBLIC_KEY;
+            return writePacket(&req, 1);
+        }
+        return false;
+
+    case 0xFF:
+    {
+        MySQLResponse err;
+        err.decode(pkt, len);
+        Logger::logError("MySQLClient::onAuth>>addr=%s, user=%s, err=%u, %s",
+            mPool->getRemoterAddr().getStr(), mPool->getUser().c_str(),
+            err.getErrorCode(), err.getError());
+        return false;
+    }
+
+    default:
+        break;
+    }
+    return false;
+}
+
+
+bool MySQLClient::onPublicKey(const u8* pkt, u32 len) {
+    if (len < 2 || 0x01 != pkt[0]) {
+        return onAuth(pkt, len);
+    }
+    return writePassword(pkt + 1, len - 1);
+}
+
+
+bool MySQLClient::writePassword(const u8* pem, u32 len) {
+    //RSA_OAEP(password + '\0' XOR scramble)
+    const String& pwd = mPool->getPassword();
+    String plain(pwd.c_str(), pwd.getLen() + 1);
+    for (usz i = 0; i < plain.getLen(); ++i) {
+        plain[i] ^= mScramble[i % G_SCRAMBLE_SIZE];
+    }
+    bool ret = false;
+    BIO* bio = BIO_new_mem_buf(pem, static_cast<s32>(len));
+    EVP_PKEY* key = bio ? PEM_read_bio_PUBKEY(bio, nullptr, nullptr, nullptr) : nullptr;
+    EVP_PKEY_CTX* ctx = key ? EVP_PKEY_CTX_new(key, nullptr) : nullptr;
+    size_t outlen = 0;
+    if (ctx && EVP_PKEY_encrypt_init(ctx) > 0
+        && EVP_PKEY_CTX_set_rsa_padding(ctx, RSA_PKCS1_OAEP_PADDING) > 0
+        && EVP_PKEY_encrypt(ctx, nullptr, &outlen,
+            reinterpret_cast<const u8*>(plain.c_str()), plain.getLen()) > 0) {
+        String out(outlen);
+        out.setLen(outlen);
+        if (EVP_PKEY_encrypt(ctx, reinterpret_cast<u8*>(&out[0]), &outlen,
+            reinterpret_cast<const u8*>(plain.c_str()), plain.getLen()) > 0) {
+            mStep = EHS_AUTH;
+            ret = writePacket(reinterpret_cast<const u8*>(out.c_str()), static_cast<u32>(outlen));
+        }
+    }
+    if (!ret) {
+        Logger::logError("MySQLClient::writePassword>>fail to encrypt password, addr=%s",
+            mPool->getRemoterAddr().getStr());
+    }
+    EVP_PKEY_CTX_free(ctx);
+    EVP_PKEY_free(key);
+    BIO_free(bio);
+    return ret;
+}
+
+
+bool MySQLClient::onHandshake(const u8* pkt, u32 len) {
+    if (0 == len) {
+        return false;
+    }
+    switch (mStep) {
+    case EHS_GREETING:
+        if (0xFF == pkt[0]) {
+            return onAuth(pkt, len);    //eg: too many connections
+        }
+        return onGreeting(pkt, len);
+    case EHS_AUTH:
+        return onAuth(pkt, len);
+    case EHS_PUBLIC_KEY:
+        return onPublicKey(pkt, len);
+    default:
+        break;
+    }
+    return false;
+}
+
+
+void MySQLClient::onConnect(RequestFD* it) {
+    mResult.clear();
+    if (0 == it->mError) {
+        it->mCall = MySQLClient::funcOnRead;
+        if (0 == mTCP.read(it)) {
+            //the server speaks first
+            return;
+        }
+    }
+    //the handle is closed by Loop, see onClose()
+    RequestFD::delRequest(it);
+}
+
+
+} //namespace net
+} //namespace app
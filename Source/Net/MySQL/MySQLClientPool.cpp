@@ -0,0 +1,230 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#include "Net/MySQL/MySQLClientPool.h"
+#include "Logger.h"
+#include "Net/MySQL/MySQLClient.h"
+#include "Net/MySQL/MySQLRequest.h"
+
+namespace app {
+namespace net {
+
+MySQLClientPool::MySQLClientPool(Loop* loop) :
+    mLoop(loop),
+    mRunning(false),
+    mGetServerKey(false),
+    mMaxTCP(0),
+    mFlyCount(0),
+    mIdleCount(0),
+    mMaxPipeline(256),
+    mTaskCount(0) {
+}
+
+
+MySQLClientPool::~MySQLClientPool() {
+    DASSERT(0 == mFlyCount);
+    MySQLClient* nd;
+    while (!mIdleQueue.empty()) {
+        nd = reinterpret_cast<MySQLClient*>(mIdleQueue.getNext());
+        nd->delink();
+        delete nd;
+    }
+}
+
+
+void MySQLClientPool::open(const net::NetAddress& serverIP, s32 maxTCP, const s8* user, const s8* password,
+    const s8* database) {
+    if (mRunning) {
+        return;
+    }
+    mRunning = true;
+    mRemoterAddr = serverIP;
+    mUser = user ? user : "";
+    mPassword = password ? password : "";
+    mDatabase = database ? database : "";
+    for (s32 i = AppClamp(maxTCP, 1, 1000) - mMaxTCP; i > 0; --i) {
+        ++mMaxTCP;
+        pushIdle(new MySQLClient(this));
+    }
+    for (MySQLClient* it = popIdle(); it; it = popIdle()) {
+        if (EE_OK == it->open(serverIP)) {
+            ++mFlyCount;
+        } else {
+            pushIdle(it);
+            Logger::logError("MySQLClientPool::open>>fail to open connect,server=%s", serverIP.getStr());
+            break;
+        }
+    }
+}
+
+
+void MySQLClientPool::onClose(MySQLClient* it, bool fly) {
+    if (!fly) {
+        it->delink();
+        ++mFlyCount;
+        //a lost connection is reopened at once, a failed one waits for the next command
+        if (mRunning && EE_OK == it->open(mRemoterAddr)) {
+            return;
+        }
+    }
+    --mFlyCount;
+    pushIdle(it);
+}
+
+
+MySQLClient* MySQLClientPool::popIdle() {
+    if (mIdleQueue.empty()) {
+        return nullptr;
+    }
+    MySQLClient* ret = reinterpret_cast<MySQLClient*>(mIdleQueue.getPrevious());
+    ret->delink();
+    --mIdleCount;
+    return ret;
+}
+
+
+void MySQLClientPool::pushIdle(MySQLClient* it) {
+    DASSERT(it);
+    mIdleQueue.pushBack(*it);
+    if (++mIdleCount == mMaxTCP) {
+        //no connection alive or connecting, nothing will take the queued commands
+        failTasks("MySQLClientPool::pushIdle>>no connection");
+    }
+}
+
+
+MySQLClient* MySQLClientPool::pop() {
+    Node2* nd = mAliveQueue.getPrevious();
+    for (; nd != &mAliveQueue; nd = nd->getPrevious()) {
+        MySQLClient* ret = static_cast<MySQLClient*>(nd);
+        if (!ret->isFull()) {
+            ret->delink();
+            mAliveQueue.pushBack(*ret);
+            return ret;
+        }
+    }
+    return nullptr;
+}
+
+
+void MySQLClientPool::push(MySQLClient* it) {
+    DASSERT(it);
+    if (it->empty()) {
+        mAliveQueue.pushBack(*it);
+        --mFlyCount;
+    }
+    if (!mRunning) {
+        it->close();
+        return;
+    }
+    while (!it->isFull()) {
+        MySQLRequest* req = popTask();
+        if (!req) {
+            break;
+        }
+        if (!it->postTask(req)) {
+            mTask.pushFront(*req); //keep order
+            ++mTaskCount;
+            break;
+        }
+        req->drop();
+    }
+}
+
+
+MySQLRequest* MySQLClientPool::popTask() {
+    if (mTask.empty()) {
+        return nullptr;
+    }
+    MySQLRequest* ret = static_cast<MySQLRequest*>(mTask.getPrevious());
+    ret->delink();
+    --mTaskCount;
+    return ret;
+}
+
+
+void MySQLClientPool::pushTask(MySQLRequest* req) {
+    DASSERT(req);
+    mTask.pushBack(*req);
+    ++mTaskCount;
+}
+
+
+void MySQLClientPool::failTasks(const s8* msg) {
+    if (mTask.empty()) {
+        return;
+    }
+    MySQLResponse resp;
+    resp.makeError(2013, msg);
+    for (MySQLRequest* tsk = popTask(); tsk; tsk = popTask()) {
+        if (tsk->getCallback()) {
+            tsk->getCallback()(tsk, &resp);
+        }
+        tsk->drop();
+    }
+}
+
+
+bool MySQLClientPool::postTask(MySQLRequest* req) {
+    if (!mRunning) {
+        return false;
+    }
+    MySQLClient* nd = mTask.empty() ? pop() : nullptr;
+    if (nd && nd->postTask(req)) {
+        return true;
+    }
+    //all ready connections are full, one more connection if any
+    MySQLClient* idle = popIdle();
+    if (idle) {
+        if (EE_OK == idle->open(mRemoterAddr)) {
+            ++mFlyCount;
+        } else {
+            pushIdle(idle);
+        }
+    }
+    if (mIdleCount == mMaxTCP) {
+        return false;
+    }
+    req->grab();
+    pushTask(req);
+    return true;
+}
+
+
+void MySQLClientPool::close() {
+    if (!mRunning) {
+        return;
+    }
+    mRunning = false;
+    failTasks("MySQLClientPool::close");
+
+    MySQLClient* nd = reinterpret_cast<MySQLClient*>(mAliveQueue.getNext());
+    for (; nd != &mAliveQueue; nd = reinterpret_cast<MySQLClient*>(nd->getNext())) {
+        nd->close();
+    }
+}
+
+} //namespace net
+} // namespace app
@@ -0,0 +1,97 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#include "Net/MySQL/MySQLRequest.h"
+#include "Net/MySQL/MySQLClientPool.h"
+
+namespace app {
+namespace net {
+
+MySQLRequest::MySQLRequest() :
+    mPool(nullptr),
+    mLink(nullptr),
+    mCallback(nullptr),
+    mUserPointer(nullptr) {
+}
+
+
+MySQLRequest::~MySQLRequest() {
+}
+
+
+bool MySQLRequest::launch(u8 cmd, const s8* data, usz len) {
+    if (!mPool || len + 1 >= G_MAX_PACKET) {
+        return false;
+    }
+    //a new command from client always starts with sequence 0
+    const u32 plen = static_cast<u32>(len + 1);
+    const s8 head[5] = { (s8)(plen & 0xFF), (s8)((plen >> 8) & 0xFF), (s8)((plen >> 16) & 0xFF), 0, (s8)cmd };
+    mRequest.setLen(0);
+    mRequest.reserve(sizeof(head) + len);
+    mRequest.append(head, sizeof(head));
+    if (len > 0) {
+        mRequest.append(data, len);
+    }
+    return mPool->postTask(this);
+}
+
+
+bool MySQLRequest::query(const s8* sql, usz len) {
+    return launch(0x03, sql, len);
+}
+
+
+bool MySQLRequest::ping() {
+    return launch(0x0E, nullptr, 0);
+}
+
+
+usz MySQLRequest::escape(s8* out, const s8* in, usz len) {
+    s8* curr = out;
+    for (usz i = 0; i < len; ++i) {
+        s8 ch = 0;
+        switch (in[i]) {
+        case 0: ch = '0'; break;
+        case '\n': ch = 'n'; break;
+        case '\r': ch = 'r'; break;
+        case '\\': ch = '\\'; break;
+        case '\'': ch = '\''; break;
+        case '"': ch = '"'; break;
+        case '\032': ch = 'Z'; break;
+        default: break;
+        }
+        if (ch) {
+            *curr++ = '\\';
+            *curr++ = ch;
+        } else {
+            *curr++ = in[i];
+        }
+    }
+    *curr = 0;
+    return curr - out;
+}
+
+} //namespace net
+} //namespace app
@@ -0,0 +1,320 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+#include "Net/MySQL/MySQLResponse.h"
+#include <stdlib.h>
+
+namespace app {
+namespace net {
+
+/**
+* @brief read a length encoded integer.
+* @return false if out of packet, or it's 0xFB(NULL) or 0xFF.
+*/
+static bool AppReadLenenc(const u8*& pos, const u8* end, u64& val) {
+    if (pos >= end) {
+        return false;
+    }
+    u32 cnt;
+    switch (*pos) {
+    case 0xFC: cnt = 2; break;
+    case 0xFD: cnt = 3; break;
+    case 0xFE: cnt = 8; break;
+    case 0xFB:
+    case 0xFF:
+        return false;
+    default:
+        val = *pos++;
+        return true;
+    }
+    if (end - pos <= cnt) {
+        return false;
+    }
+    val = 0;
+    for (u32 i = cnt; i > 0; --i) {
+        val = (val << 8) | pos[i];
+    }
+    pos += 1 + cnt;
+    return true;
+}
+
+static bool AppReadLenencStr(const u8*& pos, const u8* end, const u8*& str, u32& len) {
+    u64 val;
+    if (!AppReadLenenc(pos, end, val) || val > static_cast<u64>(end - pos)) {
+        return false;
+    }
+    str = pos;
+    len = static_cast<u32>(val);
+    pos += len;
+    return true;
+}
+
+
+MySQLResponse::MySQLResponse() :
+    mData(128) {
+    clear();
+}
+
+
+MySQLResponse::~MySQLResponse() {
+}
+
+
+void MySQLResponse::clear() {
+    mStep = EDS_HEAD;
+    mSkip = false;
+    mErrorCode = 0;
+    mWarnings = 0;
+    mFieldLeft = 0;
+    mFieldTotal = 0;
+    mRowCount = 0;
+    mAffectedRows = 0;
+    mLastInsertID = 0;
+    mData.setLen(0);
+    mFields.resize(0);
+    mCells.resize(0);
+}
+
+
+void MySQLResponse::makeError(u16 code, const s8* msg) {
+    mData.setLen(0);
+    mFields.resize(0);
+    mCells.resize(0);
+    mRowCount = 0;
+    mErrorCode = code;
+    mData.append(msg);
+}
+
+
+StringView MySQLResponse::getFieldName(u32 col)const {
+    if (col >= mFields.size()) {
+        return StringView("", 0);
+    }
+    return StringView(mData.c_str() + mFields[col].mPos, mFields[col].mLen);
+}
+
+
+s32 MySQLResponse::findField(const s8* name)const {
+    const usz len = strlen(name);
+    for (usz i = 0; i < mFields.size(); ++i) {
+        if (len == mFields[i].mLen && 0 == memcmp(mData.c_str() + mFields[i].mPos, name, len)) {
+            return static_cast<s32>(i);
+        }
+    }
+    return -1;
+}
+
+
+const MySQLResponse::Cell* MySQLResponse::getCell(u32 row, u32 col)const {
+    if (row >= mRowCount || col >= mFields.size()) {
+        return nullptr;
+    }
+    return &mCells[row * mFields.size() + col];
+}
+
+
+bool MySQLResponse::isNull(u32 row, u32 col)const {
+    const Cell* it = getCell(row, col);
+    return !it || G_NULL_CELL == it->mLen;
+}
+
+
+StringView MySQLResponse::getValue(u32 row, u32 col)const {
+    const Cell* it = getCell(row, col);
+    if (!it || G_NULL_CELL == it->mLen) {
+        return StringView("", 0);
+    }
+    return StringView(mData.c_str() + it->mPos, it->mLen);
+}
+
+
+s64 MySQLResponse::getS64(u32 row, u32 col)const {
+    return strtoll(getValue(row, col).mData, nullptr, 10);
+}
+
+
+u64 MySQLResponse::getU64(u32 row, u32 col)const {
+    return strtoull(getValue(row, col).mData, nullptr, 10);
+}
+
+
+f64 MySQLResponse::getF64(u32 row, u32 col)const {
+    return strtod(getValue(row, col).mData, nullptr);
+}
+
+
+void MySQLResponse::append(TVector<Cell>& out, const u8* str, u32 len) {
+    Cell nd;
+    if (str) {
+        nd.mPos = static_cast<u32>(mData.getLen());
+        nd.mLen = len;
+        mData.append(reinterpret_cast<const s8*>(str), len);
+        mData += '\0';
+    } else {
+        nd.mPos = 0;
+        nd.mLen = G_NULL_CELL;
+    }
+    out.pushBack(nd);
+}
+
+
+s32 MySQLResponse::onEnd(u16 status) {
+    if (G_SERVER_MORE_RESULTS & status) {
+        mSkip = true;
+        mStep = EDS_HEAD;
+        return 0;
+    }
+    return 1;
+}
+
+
+s32 MySQLResponse::decodeOK(const u8* pkt, u32 len) {
+    const u8* pos = pkt + 1;
+    const u8* end = pkt + len;
+    u64 rows, lastid;
+    if (!AppReadLenenc(pos, end, rows) || !AppReadLenenc(pos, end, lastid) || end - pos < 4) {
+        return -1;
+    }
+    const u16 status = pos[0] | (pos[1] << 8);
+    if (!mSkip) {
+        mAffectedRows = rows;
+        mLastInsertID = lastid;
+        mWarnings = pos[2] | (pos[3] << 8);
+    }
+    return onEnd(status);
+}
+
+
+s32 MySQLResponse::decodeError(const u8* pkt, u32 len) {
+    if (len < 3) {
+        return -1;
+    }
+    const u16 code = pkt[1] | (pkt[2] << 8);
+    const u8* pos = pkt + 3;
+    const u8* end = pkt + len;
+    if (end - pos >= 6 && '#' == *pos) {
+        pos += 6;   //sql state
+    }
+    makeError(code, "");
+    mData.append(reinterpret_cast<const s8*>(pos), end - pos);
+    return 1;
+}
+
+
+s32 MySQLResponse::decodeRow(const u8* pkt, u32 len) {
+    const u8* pos = pkt;
+    const u8* end = pkt + len;
+    for (u32 i = 0; i < mFieldTotal; ++i) {
+        const u8* str = nullptr;
+        u32 slen = 0;
+        if (pos < end && 0xFB == *pos) {
+            ++pos;
+        } else if (!AppReadLenencStr(pos, end, str, slen)) {
+            return -1;
+        }
+        if (!mSkip) {
+            append(mCells, str, slen);
+        }
+    }
+    if (!mSkip) {
+        ++mRowCount;
+    }
+    return 0;
+}
+
+
+s32 MySQLResponse::decode(const u8* pkt, u32 len) {
+    if (0 == len) {
+        return -1;
+    }
+    switch (mStep) {
+    case EDS_HEAD:
+    {
+        if (0x00 == pkt[0]) {
+            return decodeOK(pkt, len);
+        }
+        if (0xFF == pkt[0]) {
+            return decodeError(pkt, len);
+        }
+        const u8* pos = pkt;
+        u64 cnt;
+        if (!AppReadLenenc(pos, pkt + len, cnt) || 0 == cnt || cnt > 4096) {
+            return -1;  //0xFB, LOCAL INFILE is not supported
+        }
+        mFieldLeft = static_cast<u32>(cnt);
+        mFieldTotal = mFieldLeft;
+        mStep = EDS_FIELD;
+        if (!mSkip) {
+            mFields.reallocate(mFieldLeft);
+        }
+        return 0;
+    }
+    case EDS_FIELD:
+    {
+        //catalog, schema, table, org_table, name, ...
+        const u8* pos = pkt;
+        const u8* str = nullptr;
+        u32 slen = 0;
+        for (u32 i = 0; i < 5; ++i) {
+            if (!AppReadLenencStr(pos, pkt + len, str, slen)) {
+                return -1;
+            }
+        }
+        if (!mSkip) {
+            append(mFields, str, slen);
+        }
+        if (0 == --mFieldLeft) {
+            mStep = EDS_FIELD_EOF;
+        }
+        return 0;
+    }
+    case EDS_FIELD_EOF:
+        if (0xFE != pkt[0] || len >= 9) {
+            return -1;
+        }
+        mStep = EDS_ROW;
+        return 0;
+    case EDS_ROW:
+        if (0xFE == pkt[0] && len < 9) {
+            if (len < 5) {
+                return -1;
+            }
+            if (!mSkip) {
+                mWarnings = pkt[1] | (pkt[2] << 8);
+            }
+            return onEnd(pkt[3] | (pkt[4] << 8));
+        }
+        if (0xFF == pkt[0]) {
+            return decodeError(pkt, len);
+        }
+        return decodeRow(pkt, len);
+    default:
+        break;
+    }
+    return -1;
+}
+
+} //namespace net
+} //namespace app
@@ -0,0 +1,242 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+
+#include "Net/RedisClient/RedisBatch.h"
+#include "Logger.h"
+
+namespace app {
+namespace net {
+
+RedisBatch::RedisBatch() :
+    mAllocated(0),
+    mWait(0),
+    mParent(nullptr),
+    mResult(nullptr) {
+    mBatch = true;
+}
+
+RedisBatch::~RedisBatch() {
+    if (mResult) {
+        mResult->~RedisResponse();
+        mHub->release(mResult);
+        mResult = nullptr;
+    }
+    if (mParent) {
+        mParent->drop();
+        mParent = nullptr;
+    }
+}
+
+bool RedisBatch::multi() {
+    const s8* argv[1];
+    argv[0] = "MULTI";
+    u32 lens[1];
+    lens[0] = sizeof("MULTI") - 1;
+    return launch(1, argv, lens);
+}
+
+bool RedisBatch::exec() {
+    const s8* argv[1];
+    argv[0] = "EXEC";
+    u32 lens[1];
+    lens[0] = sizeof("EXEC") - 1;
+    return launch(1, argv, lens);
+}
+
+bool RedisBatch::append(u32 slot, u32 argc, const s8** argv, const u32* lens) {
+    if (mReplyCount > 0) {
+        return false; //committed
+    }
+    setMemHub(mCluster ? mCluster->getMemHub() : (mPool ? mPool->getMemHub() : nullptr));
+    if (!mHub) {
+        return false;
+    }
+    u64 allsz = getEncodeSize(argc, lens);
+    if (!reserve(allsz)) {
+        return false;
+    }
+    mRequestSize += encode(mRequestBuf + mRequestSize, allsz, argc, argv, lens);
+    Part nd;
+    nd.mEnd = mRequestSize;
+    nd.mIndex = getCount();
+    nd.mSlot = static_cast<u16>(slot);
+    mParts.pushBack(nd);
+    return true;
+}
+
+bool RedisBatch::appendRaw(const s8* buf, u32 len, u32 index, u16 slot) {
+    if (!reserve(len + 1ULL)) {
+        return false;
+    }
+    memcpy(mRequestBuf + mRequestSize, buf, len);
+    mRequestSize += len;
+    mRequestBuf[mRequestSize] = '\0';
+    Part nd;
+    nd.mEnd = mRequestSize;
+    nd.mIndex = index;
+    nd.mSlot = slot;
+    mParts.pushBack(nd);
+    return true;
+}
+
+bool RedisBatch::reserve(u64 len) {
+    u64 need = mRequestSize + len;
+    if (need <= mAllocated) {
+        return true;
+    }
+    if (!mRequestBuf && need <= G_INLINE_SIZE) {
+        mRequestBuf = mInline;
+        mAllocated = G_INLINE_SIZE;
+        return true;
+    }
+    if (need > 0xFFFFFFFFULL) {
+        Logger::logError("RedisBatch::reserve>>too large batch, size=%llu", need);
+        return false;
+    }
+    u64 cap = AppClamp<u64>(mAllocated * 2ULL, need, 0xFFFFFFFFULL);
+    cap = AppMax<u64>(cap, 256);
+    s8* buf = mHub->allocate(cap);
+    if (mRequestBuf) {
+        memcpy(buf, mRequestBuf, mRequestSize);
+        releaseBuf(mRequestBuf);
+    }
+    mRequestBuf = buf;
+    mAllocated = static_cast<u32>(cap);
+    return true;
+}
+
+bool RedisBatch::commit() {
+    if (mReplyCount > 0 || mParent || 0 == getCount()) {
+        return false;
+    }
+    mReplyCount = getCount();
+    if (mCluster) {
+        return split();
+    }
+    return mPool && mPool->postTask(this);
+}
+
+void RedisBatch::fixSlots() {
+    const u32 cnt = getCount();
+    u16 slot = 0;
+    for (u32 i = 0; i < cnt; ++i) {
+        if (G_NO_SLOT != mParts[i].mSlot) {
+            slot = mParts[i].mSlot;
+            break;
+        }
+    }
+    //leading keyless commands go with the first keyed one, others go with the previous one
+    for (u32 i = 0; i < cnt; ++i) {
+        if (G_NO_SLOT == mParts[i].mSlot) {
+            mParts[i].mSlot = slot;
+        } else {
+            slot = mParts[i].mSlot;
+        }
+    }
+}
+
+RedisResponse* RedisBatch::createResult() {
+    return new (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
+}
+
+bool RedisBatch::split() {
+    fixSlots();
+    const u32 cnt = getCount();
+    TVector<RedisClientPool*> pools(cnt);
+    bool single = true;
+    for (u32 i = 0; i < cnt; ++i) {
+        RedisClientPool* pool = mCluster->getBySlot(mParts[i].mSlot);
+        if (nullptr == pool) {
+            Logger::logError("RedisBatch::split>>can't get pool, slot=%u", mParts[i].mSlot);
+            return false;
+        }
+        pools.pushBack(pool);
+        single = single && pool == pools[0];
+    }
+    if (single) {
+        setPool(pools[0]);
+        return mPool->postTask(this);
+    }
+
+    //the hub is shared by pools of cluster, so responses of sub-batches can be moved into mResult
+    TVector<RedisBatch*> subs(8);
+    for (u32 i = 0; i < cnt; ++i) {
+        RedisBatch* sub = nullptr;
+        for (usz k = 0; k < subs.size(); ++k) {
+            if (subs[k]->getPool() == pools[i]) {
+                sub = subs[k];
+                break;
+            }
+        }
+        if (!sub) {
+            sub = new RedisBatch();
+            sub->mParent = this;
+            grab();
+            sub->setPool(pools[i]);
+            sub->setCallback(RedisBatch::funcOnPart);
+            subs.pushBack(sub);
+        }
+        const u32 start = i > 0 ? mParts[i - 1].mEnd : 0;
+        sub->appendRaw(mRequestBuf + start, mParts[i].mEnd - start, i, mParts[i].mSlot);
+    }
+    mResult = createResult();
+    mResult->makeArray(cnt);
+    mWait = static_cast<u32>(subs.size());
+    for (usz k = 0; k < subs.size(); ++k) {
+        RedisBatch* sub = subs[k];
+        sub->mReplyCount = sub->getCount();
+        if (!sub->mPool->postTask(sub)) {
+            onPart(sub, nullptr);
+        }
+        sub->drop();
+    }
+    return true;
+}
+
+void RedisBatch::onPart(RedisBatch* part, RedisResponse* res) {
+    const bool err = nullptr == res || res->isError();
+    const u32 cnt = part->getCount();
+    for (u32 i = 0; i < cnt; ++i) {
+        RedisResponse* nd = err ? nullptr : res->takeResult(i);
+        if (!nd) {
+            nd = createResult();
+            nd->makeError(res && res->isError() ? res->getStr() : "RedisBatch::onPart");
+        }
+        mResult->setResult(part->mParts[i].mIndex, nd);
+    }
+    if (0 == --mWait) {
+        RedisResponse* rst = mResult;
+        mResult = nullptr;
+        if (mCallback) {
+            mCallback(this, rst);
+        }
+        rst->~RedisResponse();
+        mHub->release(rst);
+    }
+}
+
+} //namespace net
+} //namespace app
@@ -0,0 +1,225 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+
+#include "Net/RedisClient/RedisCache.h"
+#include "Net/RedisClient/RedisResponse.h"
+#include "HashFunctions.h"
+#include "Converter.h"
+
+namespace app {
+namespace net {
+
+RedisCache::RedisCache(u32 maxKeys) :
+    mCount(0),
+    mMaxKeys(AppMax<u32>(maxKeys, 1)),
+    mHits(0),
+    mMisses(0) {
+    u32 cnt = 16;
+    while (cnt < mMaxKeys && cnt < 0x80000000U) {
+        cnt <<= 1;
+    }
+    mMask = cnt - 1;
+    mBuckets = new Entry * [cnt];
+    memset(mBuckets, 0, sizeof(Entry*) * cnt);
+}
+
+RedisCache::~RedisCache() {
+    clear();
+    delete[] mBuckets;
+    mBuckets = nullptr;
+}
+
+u32 RedisCache::getCacheKey(u32 argc, const s8** argv, const u32* lens, StringView* out) {
+    if (2 == argc && 3 == lens[0] && 0 == AppStrNocaseCMP(argv[0], "GET", 3)) {
+        out[0].set(argv[1], lens[1]);
+        return 1;
+    }
+    if (3 == argc && 4 == lens[0] && 0 == AppStrNocaseCMP(argv[0], "HGET", 4)) {
+        out[0].set(argv[1], lens[1]);
+        out[1].set(argv[2], lens[2]);
+        return 2;
+    }
+    return 0;
+}
+
+u32 RedisCache::getCacheKey(const s8* req, u32 size, StringView* out) {
+    //the request is encoded by RedisCommand: *argc\r\n$len\r\nval\r\n...
+    const s8* const end = req + size;
+    if (size < 4 || '*' != *req) {
+        return 0;
+    }
+    const s8* pos = req + 1;
+    u32 argc = App10StrToU32(pos, &pos);
+    if (argc < 2 || argc > 3) {
+        return 0;
+    }
+    const s8* argv[3];
+    u32 lens[3];
+    pos += 2;
+    for (u32 i = 0; i < argc; ++i) {
+        if (pos >= end || '$' != *pos) {
+            return 0;
+        }
+        lens[i] = App10StrToU32(pos + 1, &pos);
+        argv[i] = pos + 2;
+        pos += 2 + lens[i] + 2;
+        if (pos > end) {
+            return 0;
+        }
+    }
+    return getCacheKey(argc, argv, lens, out);
+}
+
+RedisCache::Entry* RedisCache::findEntry(const StringView& key, u64 hash, Entry*** prev) {
+    Entry** link = &mBuckets[hash & mMask];
+    for (Entry* nd = *link; nd; link = &nd->mChain, nd = nd->mChain) {
+        if (nd->mHash == hash && nd->mKey.getLen() == key.mLen
+            && 0 == memcmp(nd->mKey.c_str(), key.mData, key.mLen)) {
+            if (prev) {
+                *prev = link;
+            }
+            return nd;
+        }
+    }
+    return nullptr;
+}
+
+bool RedisCache::find(const StringView* key, u32 cnt, StringView& out) {
+    Entry* nd = findEntry(key[0], AppHashMurmur64(key[0].mData, key[0].mLen), nullptr);
+    if (nd) {
+        const StringView field = cnt > 1 ? key[1] : StringView();
+        for (Value* val = nd->mValues; val; val = val->mNext) {
+            if (val->mField.getLen() == field.mLen
+                && 0 == memcmp(val->mField.c_str(), field.mData, field.mLen)) {
+                out.set(val->mNil ? nullptr : val->mValue.c_str(), val->mValue.getLen());
+                nd->delink();
+                mLRU.pushBack(*nd);
+                ++mHits;
+                return true;
+            }
+        }
+    }
+    ++mMisses;
+    return false;
+}
+
+void RedisCache::insert(const StringView* key, u32 cnt, const RedisResponse& val) {
+    if (ERRT_BULK_STR != val.mType && ERRT_NIL != val.mType) {
+        return;
+    }
+    const u64 hash = AppHashMurmur64(key[0].mData, key[0].mLen);
+    Entry* nd = findEntry(key[0], hash, nullptr);
+    if (!nd) {
+        if (mCount >= mMaxKeys) {
+            //drop the least recently used one
+            Entry* old = static_cast<Entry*>(mLRU.getPrevious());
+            Entry** prev = nullptr;
+            findEntry(StringView(old->mKey.c_str(), old->mKey.getLen()), old->mHash, &prev);
+            remove(old, prev);
+        }
+        nd = new Entry();
+        nd->mHash = hash;
+        nd->mKey.append(key[0].mData, key[0].mLen);
+        nd->mValues = nullptr;
+        nd->mChain = mBuckets[hash & mMask];
+        mBuckets[hash & mMask] = nd;
+        ++mCount;
+    } else {
+        nd->delink();
+    }
+    mLRU.pushBack(*nd);
+
+    const StringView field = cnt > 1 ? key[1] : StringView();
+    Value* it = nd->mValues;
+    for (; it; it = it->mNext) {
+        if (it->mField.getLen() == field.mLen && 0 == memcmp(it->mField.c_str(), field.mData, field.mLen)) {
+            break;
+        }
+    }
+    if (!it) {
+        it = new Value();
+        it->mField.append(field.mData, field.mLen);
+        it->mNext = nd->mValues;
+        nd->mValues = it;
+    }
+    it->mNil = ERRT_NIL == val.mType;
+    it->mValue.setLen(0);
+    if (!it->mNil) {
+        it->mValue.append(val.getStr(), val.mUsed);
+    }
+}
+
+void RedisCache::remove(Entry* it, Entry** prev) {
+    *prev = it->mChain;
+    it->delink();
+    for (Value* val = it->mValues; val;) {
+        Value* nxt = val->mNext;
+        delete val;
+        val = nxt;
+    }
+    delete it;
+    --mCount;
+}
+
+void RedisCache::invalidate(const StringView& key) {
+    Entry** prev = nullptr;
+    Entry* nd = findEntry(key, AppHashMurmur64(key.mData, key.mLen), &prev);
+    if (nd) {
+        remove(nd, prev);
+    }
+}
+
+void RedisCache::onPush(const RedisResponse& msg) {
+    //>2 invalidate [key...], or >2 invalidate _ if all of the keys are flushed
+    RedisResponse* kind = msg.getResult(0);
+    if (msg.mUsed < 2 || !kind || kind->mUsed != sizeof("invalidate") - 1
+        || 0 != AppStrNocaseCMP(kind->getStr(), "invalidate", kind->mUsed)) {
+        return;
+    }
+    RedisResponse* keys = msg.getResult(1);
+    if (!keys || !keys->isAggregate()) {
+        clear();
+        return;
+    }
+    for (u32 i = 0; i < keys->mUsed; ++i) {
+        RedisResponse* nd = keys->getResult(i);
+        if (nd && nd->getStr()) {
+            invalidate(StringView(nd->getStr(), nd->mUsed));
+        }
+    }
+}
+
+void RedisCache::clear() {
+    for (u32 i = 0; i <= mMask; ++i) {
+        while (mBuckets[i]) {
+            remove(mBuckets[i], &mBuckets[i]);
+        }
+    }
+    DASSERT(0 == mCount && mLRU.empty());
+}
+
+} //namespace net
+} //namespace app
@@ -25,17 +25,26 @@
 
 #include "Net/RedisClient/RedisClient.h"
 #include "Logger.h"
+#include "Net/RedisClient/RedisCache.h"
 
 namespace app {
 namespace net {
 
 RedisClient::RedisClient(RedisClientPool* pool, MemoryHub* hub) :
     mStatus(0),
+    mStep(EHS_AUTH),
     mPool(pool),
     mHub(hub),
     mUserPointer(nullptr),
     mResult(nullptr),
-    mCMD(nullptr),
+    mBatchResult(nullptr),
+    mFlyCount(0),
+    mUnsent(0),
+    mReplied(0),
+    mStalled(false),
+    mWriting(nullptr),
+    mOutCache(nullptr),
+    mKept(0),
     mLoop(pool->getLoop()) {
 
     mTCP.setClose(EHT_TCP_CONNECT, RedisClient::funcOnClose, this);
@@ -44,23 +53,42 @@ RedisClient::RedisClient(RedisClientPool* pool, MemoryHub* hub) :
 
 
 RedisClient::~RedisClient() {
-    if (mResult) {
-        mResult->~RedisResponse();
-        mHub->release(mResult);
-        mResult = nullptr;
+    releaseResult(mResult);
+    releaseResult(mBatchResult);
+    if (mOutCache) {
+        RequestFD::delRequest(mOutCache);
+        mOutCache = nullptr;
+    }
+}
+
+
+void RedisClient::releaseResult(RedisResponse*& it) {
+    if (it) {
+        it->~RedisResponse();
+        mHub->release(it);
+        it = nullptr;
     }
 }
 
 
 void RedisClient::onClose(Handle* it) {
-    if (mCMD) {
+    mWriting = nullptr;
+    mUnsent = 0;
+    mStalled = false;
+    mKept = 0;
+    mScanner.reset();
+    releaseResult(mBatchResult);
+    if ((8 & mStatus) && mPool->getCache()) {
+        //the invalidations of keys tracked by this connection are lost
+        mPool->getCache()->clear();
+    }
+    mStatus &= ~8;
+    while (!mFlyQueue.empty()) {
         if (!mResult) {
             mResult = new
             (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
         }
-        if (!mResult->isFinished()) {
-            mResult->makeError("RedisClient::onClose");
-        }
+        mResult->makeError("RedisClient::onClose");
         callback();
     }
     mPool->onClose(this, mStatus & 1);
@@ -68,29 +96,61 @@ void RedisClient::onClose(Handle* it) {
 
 
 void RedisClient::onWrite(RequestFD* it) {
-    RequestFD::delRequest(it);
+    if (it == mWriting) {
+        mWriting = nullptr;
+        if (0 == it->mError) {
+            flush();
+        }
+    }
+    if (it != mOutCache) {
+        RequestFD::delRequest(it);
+    }
 }
 
 
 void RedisClient::onRead(RequestFD* it) {
-    if (it->mUsed > 0) {
-        if (nullptr == mResult) {
-            mResult = new
-            (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
-        }
-        StringView dat = it->getReadBuf();
-        mResult->import(dat.mData, dat.mLen);
-
-        if (mResult->isFinished()) {
-            if (3 == mStatus) {
-                onSelectDB();
-            } else if (1 == mStatus) {
-                onPassword();
-            } else {
+    if (it->mUsed > mKept) {
+        s8* pos = it->mData;
+        s8* const end = pos + it->mUsed;
+        //many responses may be in one read, a response is decoded after all of it is received
+        while (pos < end) {
+            u64 len = mScanner.scan(pos, end - pos);
+            if (0 == len) {
+                if (mScanner.isError()) {
+                    Logger::log(ELL_ERROR, "RedisClient::onRead>>bad response, addr=%s",
+                        mPool->getRemoterAddr().getStr());
+                    close();
+                }
+                break;
+            }
+            if (nullptr == mResult) {
+                mResult = new
+                (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
+            }
+            mResult->decode(pos, len, mScanner.getNodeCount());
+            mScanner.reset();
+            pos += len;
+            if (ERRT_PUSH == mResult->mType) {
+                //out of band, not a response of command
+                if (mPool->getCache()) {
+                    mPool->getCache()->onPush(*mResult);
+                }
+                mResult->clear();
+            } else if (1 & mStatus) {
+                onStep();
+            } else if (mFlyQueue.empty()) {
+                Logger::log(ELL_ERROR, "RedisClient::onRead>>no request of response, addr=%s",
+                    mPool->getRemoterAddr().getStr());
+                close();
+                break;
+            } else if (collect()) {
                 callback();
             }
         }
-        it->mUsed = 0;
+        if ((4 & mStatus) && !isFull()) {
+            mPool->push(this);
+        }
+        it = keepTail(it, pos);
         if (EE_OK == mTCP.read(it)) {
             return;
         }
@@ -102,12 +162,13 @@ void RedisClient::onRead(RequestFD* it) {
 
 
 void RedisClient::callback() {
-    RedisRequest* cmd = mCMD;
+    RedisRequest* cmd = static_cast<RedisRequest*>(mFlyQueue.getPrevious());
     RedisResponse* rst = mResult;
+    DASSERT(cmd != &mFlyQueue);
+    cmd->delink();
+    --mFlyCount;
+    ++mReplied;
     mResult = nullptr;
-    mCMD = nullptr;
-    net::RedisClientPool* pool = cmd->getPool();
-    DASSERT(pool);
     if (rst->isError()) {
         s32 replay = (rst->isAsk() ? 2 : (rst->isMoved() ? 4 : 1));
         if (replay > 1) {
@@ -117,8 +178,6 @@ void RedisClient::callback() {
             slot = App10StrToU32(ipt, &ipt);
             ++ipt;
             if (cmd->relaunch(slot, ipt, replay)) {
-                mStatus &= ~1;
-                pool->push(this);
                 rst->clear();
                 cmd->drop();
                 cmd = nullptr;
@@ -126,8 +185,15 @@ void RedisClient::callback() {
         }
     }
     if (cmd) {
-        mStatus &= ~1;
-        pool->push(this);
+        RedisCache* cache = (8 & mStatus) ? mPool->getCache() : nullptr;
+        if (cache && 0 == cmd->getReplyCount() && !rst->isError()) {
+            //the key is tracked by server since this read, so it's invalidated by push messages
+            StringView key[2];
+            u32 cnt = RedisCache::getCacheKey(cmd->getRequestBuf(), cmd->getRequestSize(), key);
+            if (cnt > 0) {
+                cache->insert(key, cnt, *rst);
+            }
+        }
         AppRedisCaller fun = cmd->getCallback();
         if (fun) {
             fun(cmd, rst);
@@ -140,6 +206,52 @@ void RedisClient::callback() {
 }
 
 
+RequestFD* RedisClient::keepTail(RequestFD* it, const s8* pos) {
+    mKept = static_cast<u32>(it->mData + it->mUsed - pos);
+    if (mKept > 0 && pos > it->mData) {
+        memmove(it->mData, pos, mKept);
+    }
+    it->mUsed = mKept;
+    u32 cap = it->mAllocated;
+    if (mKept == cap) {
+        cap *= 2;   //a large response
+    } else if (0 == mKept && cap > G_READ_SIZE) {
+        cap = G_READ_SIZE;
+    } else {
+        return it;
+    }
+    RequestFD* nd = RequestFD::newRequest(cap);
+    memcpy(nd->mData, it->mData, mKept);
+    nd->mUsed = mKept;
+    nd->mUser = it->mUser;
+    nd->mCall = it->mCall;
+    RequestFD::delRequest(it);
+    return nd;
+}
+
+
+bool RedisClient::collect() {
+    const u32 cnt = static_cast<RedisCommand*>(mFlyQueue.getPrevious())->getReplyCount();
+    if (0 == cnt) {
+        return true;
+    }
+    if (!mBatchResult) {
+        mBatchResult = new
+        (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
+        mBatchResult->makeArray(cnt);
+    }
+    mResult->own(); //it's kept after the read buffer is reused
+    mBatchResult->setResult(mBatchResult->mUsed, mResult);
+    mResult = nullptr;
+    if (!mBatchResult->isFinished()) {
+        return false;
+    }
+    mResult = mBatchResult;
+    mBatchResult = nullptr;
+    return true;
+}
+
+
 s32 RedisClient::open() {
     if (EE_OK != mLoop->openHandle(&mTCP)) {
         Logger::logError("RedisClient::open>>fail to open redis = %s", mTCP.getRemote().getStr());
@@ -147,7 +259,7 @@ s32 RedisClient::open() {
     }
     mStatus = 1;
 
-    RequestFD* it = RequestFD::newRequest(4 * 1024);
+    RequestFD* it = RequestFD::newRequest(G_READ_SIZE);
     it->mUser = this;
     it->mCall = funcOnConnect;
     s32 ret = mTCP.connect(it);
@@ -178,76 +290,207 @@ s32 RedisClient::onTimeout(HandleTime& it) {
     if (mStatus & 1) {
         return EE_ERROR;
     }
+    //no response for a whole period while commands are in flight
+    bool stall = mFlyCount > 0 && 0 == mReplied;
+    if (stall && mStalled) {
+        Logger::log(ELL_ERROR, "RedisClient::onTimeout>>addr=%s, fly=%u",
+            mPool->getRemoterAddr().getStr(), mFlyCount);
+        return EE_ERROR;
+    }
+    mStalled = stall;
+    mReplied = 0;
     return EE_OK;
 }
 
 
+bool RedisClient::isFull()const {
+    return mFlyCount >= mPool->getMaxPipeline();
+}
+
+
 bool RedisClient::postTask(RedisCommand* it) {
-    if (mCMD) {
-        DASSERT(0);
+    if (0 == (4 & mStatus) || isFull()) {
         return false;
     }
-    mCMD = static_cast<RedisRequest*>(it);
-    mCMD->grab();
+    it->grab();
+    it->setClient(this);
+    mFlyQueue.pushBack(*it);
+    ++mFlyCount;
+    ++mUnsent;
+    if (flush()) {
+        return true;
+    }
+    //the new one is the only unsent command
+    it->delink();
+    it->setClient(nullptr);
+    it->drop();
+    --mFlyCount;
+    --mUnsent;
+    return false;
+}
 
-    RequestFD* out = RequestFD::newRequest(0);
-    out->mData = (s8*)it->getRequestBuf();
-    out->mAllocated = it->getRequestSize();
-    out->mUsed = out->mAllocated;
-    out->mCall = RedisClient::funcOnWrite;
-    if (0 == mTCP.write(out)) {
-        mStatus |= 1;
+
+bool RedisClient::flush() {
+    if (mWriting || 0 == mUnsent) {
         return true;
     }
+    //the oldest unsent command
+    Node2* first = &mFlyQueue;
+    for (u32 i = 0; i < mUnsent; ++i) {
+        first = first->getNext();
+    }
+    u32 allsz = 0;
+    for (Node2* nd = first; nd != &mFlyQueue; nd = nd->getPrevious()) {
+        allsz += static_cast<RedisCommand*>(nd)->getRequestSize();
+    }
+    RequestFD* out;
+    if (allsz <= G_OUT_CACHE) {
+        //small commands are copied into the reused buffer, no allocation
+        if (!mOutCache) {
+            mOutCache = RequestFD::newRequest(G_OUT_CACHE);
+        }
+        out = mOutCache;
+    } else if (1 == mUnsent) {
+        RedisCommand* cmd = static_cast<RedisCommand*>(first);
+        out = RequestFD::newRequest(0);
+        out->mData = (s8*)cmd->getRequestBuf();
+        out->mAllocated = allsz;
+    } else {
+        out = RequestFD::newRequest(allsz);
+    }
+    if (out->mData != static_cast<RedisCommand*>(first)->getRequestBuf()) {
+        s8* curr = out->mData;
+        for (Node2* nd = first; nd != &mFlyQueue; nd = nd->getPrevious()) {
+            RedisCommand* cmd = static_cast<RedisCommand*>(nd);
+            memcpy(curr, cmd->getRequestBuf(), cmd->getRequestSize());
+            curr += cmd->getRequestSize();
+        }
+    }
+    out->mUsed = allsz;
+    out->mUser = this;
+    out->mCall = RedisClient::funcOnWrite;
+    if (0 != mTCP.write(out)) {
+        if (out != mOutCache) {
+            RequestFD::delRequest(out);
+        }
+        return false;
+    }
+    mWriting = out;
+    mUnsent = 0;
+    return true;
+}
 
-    RequestFD::delRequest(out);
-    mCMD->drop();
-    mCMD = nullptr;
-    return false;
+
+void RedisClient::writeCommand(u32 argc, const s8** argv, const u32* lens) {
+    u64 allsz = RedisCommand::getEncodeSize(argc, lens);
+    RequestFD* out = RequestFD::newRequest(static_cast<u32>(allsz));
+    out->mUser = this;
+    out->mCall = RedisClient::funcOnWrite;
+    out->mUsed = RedisCommand::encode(out->mData, allsz, argc, argv, lens);
+    if (0 != mTCP.write(out)) {
+        RequestFD::delRequest(out);
+    }
 }
 
 
-void RedisClient::onPassword() {
-    if (mResult->isOK()) {
-        mResult->clear();
-        if (mPool->getDatabaseID() <= 0) {
-            setUserPointer(nullptr);
-            mStatus |= 2 | 4;
-            mStatus &= ~1;
-            mPool->push(this);
-        } else {
-            mStatus |= 2;
-            RequestFD* out = RequestFD::newRequest(128);
-            out->mUser = this;
-            out->mCall = RedisClient::funcOnWrite;
-            out->mUsed = snprintf(out->mData, out->mAllocated, "%d", mPool->getDatabaseID());
-            out->mUsed = snprintf(out->mData, out->mAllocated,
-                "*2\r\n$6\r\nSELECT$%u\r\n%d", out->mUsed, mPool->getDatabaseID());
-            if (0 != mTCP.write(out)) {
-                RequestFD::delRequest(out);
+void RedisClient::launchStep() {
+    for (; mStep < EHS_READY; ++mStep) {
+        switch (mStep) {
+        case EHS_AUTH:
+        {
+            const String& pwd = mPool->getPassword();
+            if (pwd.getLen() > 0) {
+                const s8* argv[] = { "AUTH", pwd.c_str() };
+                const u32 lens[] = { 4, static_cast<u32>(pwd.getLen()) };
+                writeCommand(2, argv, lens);
+                return;
             }
+            break;
+        }
+        case EHS_HELLO:
+            if (mPool->getCache()) {
+                const s8* argv[] = { "HELLO", "3" };
+                const u32 lens[] = { 5, 1 };
+                writeCommand(2, argv, lens);
+                return;
+            }
+            break;
+        case EHS_TRACKING:
+            if (mPool->getCache()) {
+                const s8* argv[] = { "CLIENT", "TRACKING", "ON" };
+                const u32 lens[] = { 6, 8, 2 };
+                writeCommand(3, argv, lens);
+                return;
+            }
+            break;
+        case EHS_SELECT:
+            if (mPool->getDatabaseID() > 0) {
+                s8 dbid[16];
+                const s8* argv[] = { "SELECT", dbid };
+                const u32 lens[] = { 6, AppU32To10Str(static_cast<u32>(mPool->getDatabaseID()), dbid) };
+                writeCommand(2, argv, lens);
+                return;
+            }
+            break;
+        case EHS_READONLY:
+            if (mPool->isReadOnly()) {
+                const s8* argv[] = { "READONLY" };
+                const u32 lens[] = { 8 };
+                writeCommand(1, argv, lens);
+                return;
+            }
+            break;
+        default:
+            break;
         }
-        return;
-    } else {
-        Logger::logError("RedisClient::onPassword>>addr=%s, err password=%s",
-            mPool->getRemoterAddr().getStr(), mPool->getPassword().c_str());
-        mPool->close();
     }
-    mResult->clear();
-    close();
+    setUserPointer(nullptr);
+    mStatus |= 2 | 4;
+    mStatus &= ~1;
+    mPool->push(this);
 }
 
 
-void RedisClient::onSelectDB() {
-    if (mResult->isOK()) {
-        mResult->clear();
-        mStatus |= 4;
-        mStatus &= ~1;
-        mPool->push(this);
-        return;
+void RedisClient::onStep() {
+    bool ok = mResult->isOK();
+    switch (mStep) {
+    case EHS_AUTH:
+        if (!ok) {
+            Logger::logError("RedisClient::onStep>>addr=%s, auth fail, err=%s",
+                mPool->getRemoterAddr().getStr(), mResult->isError() ? mResult->getStr() : "");
+            mPool->close();
+        }
+        break;
+    case EHS_HELLO:
+    case EHS_TRACKING:
+        if (mResult->isError()) {
+            //server before 6.0, go on without the cache
+            Logger::log(ELL_ERROR, "RedisClient::onStep>>cache off, step=%u, addr=%s, err=%s",
+                mStep, mPool->getRemoterAddr().getStr(), mResult->getStr());
+            mPool->setCache(0);
+        } else if (EHS_TRACKING == mStep) {
+            mStatus |= 8;
+        }
+        ok = true;
+        break;
+    case EHS_READONLY:
+        if (!ok) {
+            //the reads are redirected to master by MOVED
+            Logger::log(ELL_ERROR, "RedisClient::onStep>>READONLY failed, addr=%s",
+                mPool->getRemoterAddr().getStr());
+            ok = true;
+        }
+        break;
+    default:
+        break;
     }
     mResult->clear();
-    close();
+    if (!ok) {
+        close();
+        return;
+    }
+    ++mStep;
+    launchStep();
 }
 
 
@@ -261,31 +504,8 @@ void RedisClient::onConnect(RequestFD* it) {
     if (0 == it->mError) {
         it->mCall = RedisClient::funcOnRead;
         if (0 == mTCP.read(it)) {
-            const String& pwd = mPool->getPassword();
-            const s32 dbid = mPool->getDatabaseID();
-            if (dbid <= 0 && 0 == pwd.getLen()) {
-                mStatus |= 2|4;
-                mStatus &= ~1;
-                mPool->push(this);
-            } else {
-                RequestFD* out = RequestFD::newRequest(128);
-                out->mUser = this;
-                out->mCall = RedisClient::funcOnWrite;
-                if (pwd.getLen() > 0) {
-                    //"CLUSTER SLOTS"="*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n"
-                    //"AUTH 123456"="*2\r\n$4\r\nAUTH\r\n$6\r\n123456\r\n"
-                    out->mUsed = snprintf(out->mData, out->mAllocated,
-                        "*2\r\n$4\r\nAUTH\r\n$%llu\r\n%s\r\n", pwd.getLen(), pwd.c_str());
-                } else {
-                    mStatus |= 2;
-                    //"SELECT 5"="*2\r\n$6\r\nSELECT\r\n$1\r\n5\r\n"
-                    out->mUsed = snprintf(out->mData, out->mAllocated,
-                        "*2\r\n$6\r\nSELECT\r\n$%llu\r\n%s\r\n", pwd.getLen(), pwd.c_str());
-                }
-                if (0 != mTCP.write(out)) {
-                    RequestFD::delRequest(out);
-                }
-            }
+            mStep = EHS_AUTH;
+            launchStep();
             return;
         }
     }
@@ -296,4 +516,3 @@ void RedisClient::onConnect(RequestFD* it) {
 
 } //namespace net
 } //namespace app
-
@@ -29,6 +29,7 @@
 #include "MemoryHub.h"
 #include "Net/RedisClient/RedisRequest.h"
 #include "Engine.h"
+#include "Timer.h"
 
 
 namespace app {
@@ -40,14 +41,33 @@ void AppClusterCallback(RedisRequest* it, RedisResponse* res) {
 }
 
 
+RedisClientCluster::SlotTable::SlotTable(u32 cnt) :
+    mReplicas(16) {
+    mMaster = new RedisClientPool * [cnt];
+    mReplica = new u32[cnt];
+    memset(mMaster, 0, cnt * sizeof(RedisClientPool*));
+    memset(mReplica, 0, cnt * sizeof(u32));
+}
+
+
+RedisClientCluster::SlotTable::~SlotTable() {
+    delete[] mMaster;
+    delete[] mReplica;
+}
+
+
 RedisClientCluster::RedisClientCluster() :
     mMaxSlots(16384),
     mLoop(&Engine::getInstance().getLoop()),
     mStatus(0),
     mMaxRedirect(3),
+    mReplicaNext(0),
+    mReadReplica(false),
+    mRefreshing(false),
+    mRefreshTime(0),
     mMaxTCP(3) {
-    mSlots = new RedisClientPool * [mMaxSlots];
-    memset(mSlots, 0, mMaxSlots * sizeof(RedisClientPool*));
+    mHub = new MemoryHub();
+    mSlots = new SlotTable(mMaxSlots);
 }
 
 
@@ -59,37 +79,71 @@ RedisClientCluster::~RedisClientCluster() {
         nd++;
     }
 
-    delete[] mSlots;
+    delete mSlots;
     mSlots = nullptr;
+    mHub->drop();
+    mHub = nullptr;
 }
 
 
 void RedisClientCluster::updateSlots(RedisResponse* res) {
+    mRefreshing = false;
+    mRefreshTime = Timer::getRelativeTime();
+    if (0 == mStatus) {
+        return; //closed
+    }
     if (res->isError()) {
-        mStatus = 2;
-        Logger::logError("RedisClientCluster::updateSlots>>failed");
+        if (3 != mStatus) {
+            mStatus = 2;
+        }
+        Logger::logError("RedisClientCluster::updateSlots>>failed, err=%s", res->getStr());
         return;
     }
-    res->show();
+    if (3 != mStatus) {
+        res->show();
+    }
+
+    //the slots not in response are kept, the replicas of them are dropped
+    SlotTable* tab = new SlotTable(mMaxSlots);
+    memcpy(tab->mMaster, mSlots->mMaster, mMaxSlots * sizeof(RedisClientPool*));
     net::NetAddress addr;
-    s8* ids;
     for (u32 i = 0; i < res->mUsed; ++i) {
         RedisResponse* ndj = res->getResult(i);
+        if (!ndj || ndj->mUsed < 3) {
+            continue;
+        }
         u64 slot1 = ndj->getResult(0)->getS64();
         u64 slot2 = ndj->getResult(1)->getS64();
         RedisResponse* ndk = ndj->getResult(2);
         addr.setIP(ndk->getResult(0)->getStr());
         addr.setPort((u16)ndk->getResult(1)->getS64());
-        ids = ndk->getResult(2)->getStr();
         RedisClientPool* pool = open(addr, 0, nullptr);
-        if (pool && slot2 < mMaxSlots) {
-            for (; slot1 <= slot2; ++slot1) {
-                mSlots[slot1] = pool;
-            }
-        } else {
+        if (!pool || slot2 >= mMaxSlots || slot1 > slot2) {
             DASSERT(0);
+            continue;
+        }
+        u32 first = static_cast<u32>(tab->mReplicas.size());
+        u32 cnt = 0;
+        for (u32 k = 3; mReadReplica && k < ndj->mUsed && cnt < 0xFF; ++k) {
+            ndk = ndj->getResult(k);
+            addr.setIP(ndk->getResult(0)->getStr());
+            addr.setPort((u16)ndk->getResult(1)->getS64());
+            RedisClientPool* rep = open(addr, 0, nullptr, true);
+            if (rep) {
+                tab->mReplicas.pushBack(rep);
+                ++cnt;
+            }
+        }
+        for (; slot1 <= slot2; ++slot1) {
+            tab->mMaster[slot1] = pool;
+            tab->mReplica[slot1] = cnt > 0 ? ((first << 8) | cnt) : 0;
         }
     }
+
+    //the loop of cluster is the only reader, so the table is replaced at once
+    SlotTable* old = mSlots;
+    mSlots = tab;
+    delete old;
     mStatus = 3;
 }
 
@@ -133,7 +187,8 @@ RedisClientPool* RedisClientCluster::open(const s8* ipport, u32 maxTCP, const s8
 }
 
 
-RedisClientPool* RedisClientCluster::open(const net::NetAddress& addr, u32 maxTCP, const s8* passowrd) {
+RedisClientPool* RedisClientCluster::open(const net::NetAddress& addr, u32 maxTCP, const s8* passowrd,
+    bool replica) {
     maxTCP = 0 == maxTCP ? mMaxTCP : AppClamp(maxTCP, 1U, mMaxTCP);
     TMap<net::NetAddress::ID, RedisClientPool*>::Node* nd = mAllPool.find(addr.toID());
     if (nd) {
@@ -154,10 +209,11 @@ RedisClientPool* RedisClientCluster::open(const net::NetAddress& addr, u32 maxTC
         pass = passowrd;
         setPassword(addr, passowrd);
     }
+    pool->setReadOnly(replica);
     pool->open(addr, maxTCP, pass.c_str(), 0);
     if (1 == mAllPool.size()) {
         for (u32 i = 0; i < mMaxSlots; ++i) {
-            mSlots[i] = pool;
+            mSlots->mMaster[i] = pool;
         }
         updateSlots();
     }
@@ -183,19 +239,45 @@ bool RedisClientCluster::updateSlots() {
     }
 
     if (0 == mStatus) {
-        RedisClientPool* pool = mAllPool.getIterator().getNode()->getValue();
-        RedisRequest* cmd = new RedisRequest();
-        cmd->setCallback(AppClusterCallback);
-        cmd->setPool(pool);
-        cmd->setCluster(this);
-        mStatus = cmd->clusterSlots() ? 1 : 0;
-        cmd->drop();
+        mStatus = launchSlots(mAllPool.getIterator().getNode()->getValue()) ? 1 : 0;
     }
 
     return 0 != mStatus;
 }
 
 
+bool RedisClientCluster::launchSlots(RedisClientPool* pool) {
+    RedisRequest* cmd = new RedisRequest();
+    cmd->setCallback(AppClusterCallback);
+    cmd->setPool(pool);
+    cmd->setCluster(this);
+    mRefreshing = cmd->clusterSlots();
+    cmd->drop();
+    return mRefreshing;
+}
+
+
+bool RedisClientCluster::refreshSlots(RedisClientPool* it) {
+    if (3 != mStatus || mRefreshing || 0 == mAllPool.size()) {
+        return false;
+    }
+    if (Timer::getRelativeTime() - mRefreshTime < G_REFRESH_GAP) {
+        return false;
+    }
+    if (!it) {
+        it = mAllPool.getIterator().getNode()->getValue();
+    }
+    Logger::log(ELL_INFO, "RedisClientCluster::refreshSlots>>addr=%s", it->getRemoterAddr().getStr());
+    return launchSlots(it);
+}
+
+
+void RedisClientCluster::onMoved(u32 slot, RedisClientPool* it) {
+    setSlot(slot, it);
+    refreshSlots(it);
+}
+
+
 void RedisClientCluster::close() {
     if (!mStatus) {
         return;
@@ -212,15 +294,21 @@ void RedisClientCluster::close() {
 
 void RedisClientCluster::clearSlot(u32 it) {
     if (it < mMaxSlots) {
-        mSlots[it] = nullptr;
+        mSlots->mMaster[it] = nullptr;
+        mSlots->mReplica[it] = 0;
     }
 }
 
 
 void RedisClientCluster::clearSlots(RedisClientPool* it) {
     for (u32 i = 0; i < mMaxSlots; ++i) {
-        if (mSlots[i] == it) {
-            mSlots[i] = nullptr;
+        if (mSlots->mMaster[i] == it) {
+            mSlots->mMaster[i] = nullptr;
+        }
+    }
+    for (usz i = 0; i < mSlots->mReplicas.size(); ++i) {
+        if (mSlots->mReplicas[i] == it) {
+            mSlots->mReplicas[i] = nullptr; //skipped by getBySlot()
         }
     }
 }
@@ -228,18 +316,22 @@ void RedisClientCluster::clearSlots(RedisClientPool* it) {
 
 void RedisClientCluster::setSlot(u32 pos, RedisClientPool* it) {
     if (it && pos < mMaxSlots) {
-        mSlots[pos] = it;
+        mSlots->mMaster[pos] = it;
     }
 }
 
 
-RedisClientPool* RedisClientCluster::getBySlot(u32 it) {
+RedisClientPool* RedisClientCluster::getBySlot(u32 it, bool read) {
     it = it % mMaxSlots;
-    if (nullptr == mSlots[it]) {
-        return nullptr;
+    const u32 rep = read ? mSlots->mReplica[it] : 0;
+    const u32 cnt = rep & 0xFF;
+    for (u32 i = 0; i < cnt; ++i) {
+        RedisClientPool* ret = mSlots->mReplicas[(rep >> 8) + (mReplicaNext++ % cnt)];
+        if (ret) {
+            return ret;
+        }
     }
-    RedisClientPool* ret = mSlots[it];
-    return ret;
+    return mSlots->mMaster[it];
 }
 
 
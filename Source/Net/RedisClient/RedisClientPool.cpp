@@ -28,6 +28,7 @@
 #include "MemoryHub.h"
 #include "Net/RedisClient/RedisClient.h"
 #include "Net/RedisClient/RedisRequest.h"
+#include "Net/RedisClient/RedisCache.h"
 
 namespace app {
 namespace net {
@@ -39,10 +40,19 @@ RedisClientPool::RedisClientPool(Loop* loop, RedisClientCluster* cls) :
     mFlyCount(0),
     mFailCount(0),
     mMaxRetry(2),
+    mMaxPipeline(256),
     mRunning(false),
+    mReadOnly(false),
     mPassword(32),
+    mCache(nullptr),
     mMaxTCP(3) {
-    mHub = new MemoryHub();
+    if (cls) {
+        //pools of a cluster share the hub, results of them can be merged, see RedisBatch
+        mHub = cls->getMemHub();
+        mHub->grab();
+    } else {
+        mHub = new MemoryHub();
+    }
 }
 
 RedisClientPool::~RedisClientPool() {
@@ -58,10 +68,21 @@ RedisClientPool::~RedisClientPool() {
         delete nd;
     }
 
+    setCache(0);
     mHub->drop();
     mHub = nullptr;
 }
 
+void RedisClientPool::setCache(u32 maxKeys) {
+    if (mCache) {
+        delete mCache;
+        mCache = nullptr;
+    }
+    if (maxKeys > 0) {
+        mCache = new RedisCache(maxKeys);
+    }
+}
+
 void RedisClientPool::open(const net::NetAddress& serverIP, s32 maxTCP, const s8* passowrd, s32 dbID) {
     if (mRunning) {
         return;
@@ -88,19 +109,15 @@ void RedisClientPool::onTimeout(RedisClient* it) {
 }
 
 void RedisClientPool::onClose(RedisClient* it, bool fly) {
-    if (fly) {
-        if (mRunning && EE_OK == it->open(mRemoterAddr)) {
-            return;
-        }
-        --mFlyCount;
-        pushIdle(it);
-    } else {
+    if (!fly) {
         it->delink();
-        if (mRunning && EE_OK == it->open(mRemoterAddr)) {
-            return;
-        }
-        pushIdle(it);
+        ++mFlyCount;
     }
+    if (mRunning && EE_OK == it->open(mRemoterAddr)) {
+        return;
+    }
+    --mFlyCount;
+    pushIdle(it);
     //Logger::logError("RedisClientPool::onClose>>stop reconnect server=%s", mRemoterAddr.getStr());
 }
 
@@ -136,39 +153,46 @@ void RedisClientPool::pushIdle(RedisClient* it) {
 }
 
 RedisClient* RedisClientPool::pop() {
-    if (mAliveQueue.empty()) {
-        return nullptr;
+    Node2* nd = mAliveQueue.getPrevious();
+    for (; nd != &mAliveQueue; nd = nd->getPrevious()) {
+        RedisClient* ret = static_cast<RedisClient*>(nd);
+        if (!ret->isFull()) {
+            ret->delink();
+            mAliveQueue.pushBack(*ret);
+            return ret;
+        }
     }
-    RedisClient* ret = reinterpret_cast<RedisClient*>(mAliveQueue.getPrevious());
-    ret->delink();
-    ++mFlyCount;
-    return ret;
+    return nullptr;
 }
 
 void RedisClientPool::push(RedisClient* it) {
     DASSERT(it);
-    RedisCommand* req = popTask();
-    if (req) {
-        if (it->postTask(req)) {
-            req->drop();
-            return;
-        }
-        //req->grab();
-        pushTask(req);
+    if (it->empty()) {
+        mAliveQueue.pushBack(*it);
+        --mFlyCount;
     }
-
     if (!mRunning) {
         it->close();
+        return;
+    }
+    while (!it->isFull()) {
+        RedisCommand* req = popTask();
+        if (!req) {
+            break;
+        }
+        if (!it->postTask(req)) {
+            mTask.pushFront(*req); //keep order
+            break;
+        }
+        req->drop();
     }
-    mAliveQueue.pushBack(*it);
-    --mFlyCount;
 }
 
 RedisCommand* RedisClientPool::popTask() {
     if (mTask.empty()) {
         return nullptr;
     }
-    RedisRequest* ret = reinterpret_cast<RedisRequest*>(mTask.getPrevious());
+    RedisRequest* ret = static_cast<RedisRequest*>(mTask.getPrevious());
     ret->delink();
     return ret;
 }
@@ -182,12 +206,9 @@ bool RedisClientPool::postTask(RedisCommand* req) {
     if (!mRunning) {
         return false;
     }
-    RedisClient* nd = pop();
-    if (nd) {
-        if (nd->postTask(req)) {
-            return true;
-        }
-        push(nd);
+    RedisClient* nd = mTask.empty() ? pop() : nullptr;
+    if (nd && nd->postTask(req)) {
+        return true;
     }
     req->grab();
     pushTask(req);
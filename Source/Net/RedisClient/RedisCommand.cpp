@@ -25,7 +25,9 @@
 
 #include "Net/RedisClient/RedisCommand.h"
 #include "Net/RedisClient/RedisClient.h"
+#include "Net/RedisClient/RedisCache.h"
 #include "CheckCRC.h"
+#include "Converter.h"
 #include "Logger.h"
 
 namespace app {
@@ -42,18 +44,18 @@ RedisCommand::RedisCommand() :
     mRequestBuf(nullptr),
     mRequestSize(0),
     mRequestCount(0),
+    mReplyCount(0),
+    mBatch(false),
     mUserPointer(nullptr),
     mCallback(nullptr) {
 }
 
 RedisCommand::~RedisCommand() {
-    if (mRequestBuf) {
-        mHub->release(mRequestBuf);
-        mRequestBuf = nullptr;
-        mRequestSize = 0;
+    releaseRequestBuf();
+    if (mHub) {
+        mHub->drop();
+        mHub = nullptr;
     }
-    mHub->drop();
-    mHub = nullptr;
 }
 
 
@@ -70,12 +72,20 @@ void RedisCommand::drop() {
     }
 }
 
+bool RedisCommand::append(u32 slot, u32 argc, const s8** argv, const u32* lens) {
+    return false;
+}
+
 bool RedisCommand::launch(u32 slot, u32 argc, const s8** argv, const u32* lens) {
+    if (mBatch) {
+        return append(slot, argc, argv, lens);
+    }
     if (nullptr == mCluster) {
         DASSERT(0);
         return false;
     }
-    RedisClientPool* pool = mCluster->getBySlot(slot);
+    RedisClientPool* pool = mCluster->getBySlot(slot,
+        mCluster->isReadReplica() && isReadCommand(argv[0], lens[0]));
     if (nullptr == pool) {
         Logger::logError("RedisCommand::launch>>can't get pool, slot=%u", slot);
         DASSERT(0);
@@ -86,37 +96,84 @@ bool RedisCommand::launch(u32 slot, u32 argc, const s8** argv, const u32* lens)
 }
 
 bool RedisCommand::launch(u32 argc, const s8** argv, const u32* lens) {
+    if (mBatch) {
+        return append(G_NO_SLOT, argc, argv, lens);
+    }
     if (!mPool) {
         return false;
     }
-    if (mRequestBuf) { //reuse?
-        mHub->release(mRequestBuf);
-        mRequestBuf = nullptr;
-        mRequestSize = 0;
+    RedisCache* cache = mPool->getCache();
+    if (cache && mCallback) {
+        StringView key[2];
+        StringView val;
+        u32 cnt = RedisCache::getCacheKey(argc, argv, lens, key);
+        if (cnt > 0 && cache->find(key, cnt, val)) {
+            //a hot key is replied at once, no round trip
+            RedisResponse res(*mHub);
+            res.makeView(val.mData ? ERRT_BULK_STR : ERRT_NIL, val.mData, static_cast<u32>(val.mLen));
+            grab();
+            mCallback(static_cast<RedisRequest*>(this), &res);
+            res.clear();
+            drop();
+            return true;
+        }
+    }
+    releaseRequestBuf();
+    //a typical command is encoded in the inline buffer, no allocation
+    u64 allsz = getEncodeSize(argc, lens);
+    mRequestBuf = allsz <= G_INLINE_SIZE ? mInline : mHub->allocate(allsz);
+    mRequestSize = encode(mRequestBuf, allsz, argc, argv, lens);
+    if (mPool->postTask(this)) {
+        return true;
     }
-    u64 allsz = 13ULL + 13ULL * argc + 1; //0xFFFFFFFF 10λ
+    releaseRequestBuf();
+    mRequestCount = 1;
+    return false;
+}
+
+u64 RedisCommand::getEncodeSize(u32 argc, const u32* lens) {
+    u64 allsz = 3ULL + AppDigitCount(argc) + 1; //"*argc\r\n" and tail '\0'
     for (u32 i = 0; i < argc; ++i) {
-        allsz += lens[i];
+        allsz += 5ULL + AppDigitCount(lens[i]) + lens[i]; //"$len\r\nval\r\n"
     }
-    s8* const buf = mHub->allocate(allsz);
-    s8* curr = buf + snprintf(buf, allsz, "*%u\r\n", argc);
+    return allsz;
+}
+
+u32 RedisCommand::encode(s8* buf, u64 allsz, u32 argc, const s8** argv, const u32* lens) {
+    DASSERT(allsz >= getEncodeSize(argc, lens));
+    s8* curr = buf;
+    *curr++ = '*';
+    curr += AppU32To10Str(argc, curr);
+    *curr++ = '\r';
+    *curr++ = '\n';
     for (u32 i = 0; i < argc; ++i) {
-        curr += snprintf(curr, allsz - (curr - buf), "$%u\r\n", lens[i]);
+        *curr++ = '$';
+        curr += AppU32To10Str(lens[i], curr);
+        *curr++ = '\r';
+        *curr++ = '\n';
         memcpy(curr, argv[i], lens[i]);
         curr += lens[i];
         *curr++ = '\r';
         *curr++ = '\n';
     }
     *curr = '\0';   //for debug: show str
-    mRequestBuf = buf;
-    mRequestSize = static_cast<u32>(curr - buf);
-    if (mPool->postTask(this)) {
-        return true;
+    return static_cast<u32>(curr - buf);
+}
+
+bool RedisCommand::isReadCommand(const s8* name, u32 len) {
+    static const s8* const cmds[] = {
+        "GET", "MGET", "STRLEN", "GETRANGE", "GETBIT", "BITCOUNT", "BITPOS", "EXISTS", "TYPE", "TTL", "PTTL",
+        "HGET", "HMGET", "HGETALL", "HEXISTS", "HLEN", "HKEYS", "HVALS", "HSTRLEN", "HSCAN",
+        "LRANGE", "LLEN", "LINDEX", "SCARD", "SMEMBERS", "SISMEMBER", "SRANDMEMBER", "SSCAN",
+        "ZRANGE", "ZREVRANGE", "ZRANGEBYSCORE", "ZREVRANGEBYSCORE", "ZRANGEBYLEX", "ZSCORE", "ZCARD",
+        "ZRANK", "ZREVRANK", "ZCOUNT", "ZLEXCOUNT", "ZSCAN", "PFCOUNT",
+        "GEOPOS", "GEODIST", "GEOHASH"
+    };
+    for (u32 i = 0; i < DSIZEOF(cmds); ++i) {
+        if (len == strlen(cmds[i]) && 0 == AppStrNocaseCMP(name, cmds[i], len)) {
+            return true;
+        }
     }
-    mHub->release(buf);
-    mRequestBuf = nullptr;
-    mRequestSize = 0;
-    mRequestCount = 1;
     return false;
 }
 
@@ -135,8 +192,7 @@ bool RedisCommand::relaunch(u32 slot, const s8* iport, s32 itype) {
             return false;
         }
         if (4 == itype) {
-            mCluster->setSlot(mSlot, mPool);
-            mCluster->setSlot(slot, mPool);
+            mCluster->onMoved(slot, mPool);
         }
     } else {
         //ǼȺģʽ
@@ -153,12 +209,18 @@ bool RedisCommand::relaunch(u32 slot, const s8* iport, s32 itype) {
     if (mPool->postTask(this)) {
         return true;
     }
-    mHub->release(mRequestBuf);
-    mRequestBuf = nullptr;
-    mRequestSize = 0;
+    releaseRequestBuf();
     return false;
 }
 
+void RedisCommand::releaseRequestBuf() {
+    if (mRequestBuf) {
+        releaseBuf(mRequestBuf);
+        mRequestBuf = nullptr;
+        mRequestSize = 0;
+    }
+}
+
 u16 RedisCommand::hashSlot(const s8* key, u64 len) {
     if (key) {
         CheckCRC16 crc;
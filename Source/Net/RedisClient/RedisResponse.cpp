@@ -33,16 +33,126 @@ namespace net {
 
 //const static u32 valsize = sizeof(RedisResponse);
 
+//@return the integer of a line, \p str is moved behind the "\r\n"
+static s64 AppDecodeInt(const s8*& str) {
+    bool neg = '-' == *str;
+    if (neg || '+' == *str) {
+        ++str;
+    }
+    s64 ret = 0;
+    for (; *str >= '0' && *str <= '9'; ++str) {
+        ret = ret * 10 + (*str - '0');
+    }
+    str += 2;
+    return neg ? -ret : ret;
+}
+
+
+u64 RedisScanner::scan(const s8* str, u64 len) {
+    while (mPos < len) {
+        const s8* pos = str + mPos;
+        const s8* tail = reinterpret_cast<const s8*>(memchr(pos, '\n', len - mPos));
+        if (nullptr == tail) {
+            return 0;
+        }
+        u64 next = tail + 1 - str;
+        const s8 type = *pos++;
+        switch (type) {
+        case ERRT_ERROR:
+        case ERRT_STRING:
+        case ERRT_INT:
+        case '_':
+        case ERRT_BOOL:
+        case ERRT_DOUBLE:
+        case ERRT_BIG_NUM:
+            break;
+        case ERRT_BULK_STR:
+        case '!':
+        case '=':
+        {
+            s64 cnt = AppDecodeInt(pos);
+            if (cnt >= 0) {
+                next += cnt + 2;
+                if (next > len) {
+                    return 0; //wait the rest of bulk string
+                }
+            }
+            break;
+        }
+        case ERRT_ARRAY:
+        case ERRT_SET:
+        case ERRT_PUSH:
+        case ERRT_MAP:
+        case '|':
+        {
+            s64 cnt = AppDecodeInt(pos);
+            if (ERRT_MAP == type || '|' == type) {
+                cnt *= 2;
+            }
+            if (cnt > 0 || '|' == type) {
+                if (mDepth >= G_MAX_DEPTH) {
+                    mError = true;
+                    return 0;
+                }
+                ++mNodes;
+                mPos = next;
+                if (cnt > 0) {
+                    mAttribute |= '|' == type ? (1U << mDepth) : 0;
+                    mLeft[mDepth++] = cnt;
+                }
+                continue; //an attribute is followed by the node it's attached to
+            }
+            break;
+        }
+        default:
+            mError = true;
+            return 0;
+        }
+        //a node is done, so are the arrays of its last node
+        ++mNodes;
+        mPos = next;
+        bool attr = false;
+        while (mDepth > 0 && 0 == --mLeft[mDepth - 1]) {
+            --mDepth;
+            if (mAttribute & (1U << mDepth)) {
+                mAttribute &= ~(1U << mDepth);
+                attr = true;
+                break;
+            }
+        }
+        if (0 == mDepth && !attr) {
+            return mPos;
+        }
+    }
+    return 0;
+}
+
+
 RedisResponse::RedisResponse(MemoryHub& it) :
     mUsed(0),
     mAllocated(0),
     mHub(it),
     mStatus(EDS_INIT),
-    mType(ERRT_NIL) {
+    mType(ERRT_NIL),
+    mArena(nullptr),
+    mStore(nullptr),
+    mView(false) {
     mHub.grab();
     mValue.mNodes = nullptr;
 }
 
+RedisResponse::RedisResponse(MemoryHub& it, bool view) :
+    mUsed(0),
+    mAllocated(0),
+    mHub(it),
+    mStatus(EDS_INIT),
+    mType(ERRT_NIL),
+    mArena(nullptr),
+    mStore(nullptr),
+    mView(view) {
+    mValue.mNodes = nullptr;
+}
+
 RedisResponse::~RedisResponse() {
     clear();
     mHub.drop();
@@ -52,33 +162,45 @@ void RedisResponse::clear() {
     if (EDS_INIT == mStatus) {
         return;
     }
-    switch (mType) {
-    case ERRT_ERROR:
-    case ERRT_STRING:
-    case ERRT_BULK_STR:
-        mHub.release(mValue.mValStr);
-        break;
+    if (!mView) {
+        switch (mType) {
+        case ERRT_ERROR:
+        case ERRT_STRING:
+        case ERRT_BULK_STR:
+            mHub.release(mValue.mValStr);
+            break;
 
-    case ERRT_ARRAY:
-        if (mValue.mNodes) {
-            for (u32 i = 0; i < mAllocated; ++i) {
-                if (mValue.mNodes[i]) {
-                    RedisResponse* nd = reinterpret_cast<RedisResponse*>(mValue.mNodes[i]);
-                    nd->clear();
-                    mHub.release(nd);
-                    mHub.drop();
+        case ERRT_ARRAY:
+            if (mValue.mNodes) {
+                for (u32 i = 0; i < mAllocated; ++i) {
+                    if (mValue.mNodes[i]) {
+                        RedisResponse* nd = reinterpret_cast<RedisResponse*>(mValue.mNodes[i]);
+                        nd->clear();
+                        mHub.release(nd);
+                        mHub.drop();
+                    }
                 }
+                mHub.release(mValue.mNodes);
+                //mValue.mNodes = nullptr;
             }
-            mHub.release(mValue.mNodes);
-            //mValue.mNodes = nullptr;
-        }
-        break;
+            break;
 
-    case ERRT_INT:
-    case ERRT_NIL:
-    default:
-        break;
-    }//switch
+        case ERRT_INT:
+        case ERRT_NIL:
+        default:
+            break;
+        }//switch
+    }
+    //the whole decoded reply is released at once
+    if (mArena) {
+        mHub.release(mArena);
+        mArena = nullptr;
+    }
+    if (mStore) {
+        mHub.release(mStore);
+        mStore = nullptr;
+    }
+    mView = false;
     mStatus = EDS_INIT;
     mUsed = 0;
     mAllocated = 0;
@@ -86,137 +208,170 @@ void RedisResponse::clear() {
     mValue.mValStr = nullptr;
 }
 
-bool RedisResponse::decodeSize(const s8 ch) {
-    if ('\r' == ch) {
-        return false;
-    }
-    if ('\n' != ch) {
-        mValue.mVal64 *= 10;
-        mValue.mVal64 += ch - '0';
+void RedisResponse::decode(s8* str, u64 len, u32 nodes) {
+    clear();
+    RedisResponse* arena = nullptr;
+    RedisResponse** slots = nullptr;
+    if (nodes > 1) {
+        //each child is a node in arena & a slot in array of its parent
+        mArena = mHub.allocate((sizeof(RedisResponse) + sizeof(RedisResponse*)) * (nodes - 1ULL));
+        arena = reinterpret_cast<RedisResponse*>(mArena);
+        slots = reinterpret_cast<RedisResponse**>(arena + nodes - 1);
     }
-    return ('\n' == ch);
+    s8* end = decodeNode(str, arena, slots);
+    DASSERT(end == str + len);
+    (void)end;
 }
 
-const s8* RedisResponse::import(const s8* str, u64 len) {
-    const s8* const end = str + len;
-    for (; str < end; ++str) {
-        switch (mStatus) {
-        case EDS_INT:
-            if (decodeSize(str[0])) {
-                mStatus = EDS_DONE;
-            }
-            break;
-
-        case EDS_INIT:
-            mType = static_cast<ERedisResultType>(str[0]);
-            switch (mType) {
-            case ERRT_ARRAY:
-                mStatus = EDS_ARRAY_SIZE;
-                break;
-            case ERRT_ERROR:
-            case ERRT_STRING:
-                mAllocated = 120;
-                mValue.mValStr = reinterpret_cast<s8*>(mHub.allocateAndClear(mAllocated));
-                mStatus = EDS_STR;
-                break;
-            case ERRT_BULK_STR:
-                mStatus = EDS_BULK_SIZE;
-                break;
-            case ERRT_INT:
-                mStatus = EDS_INT;
-                break;
-            default:
-                DASSERT(0);
-                break;
-            }
-            continue;//skip \r
-
-        case EDS_BULK_STR:
-            if (mUsed + 1 < mAllocated) {
-                mValue.mValStr[mUsed++] = str[0];
-            } else {
-                if ('\n' == str[0]) {
-                    mValue.mValStr[mUsed] = 0;
-                    mStatus = EDS_DONE;
-                }
-            }
-            break;
-
-        case EDS_STR:
-            if ('\n' == str[0]) {
-                mValue.mValStr[mUsed] = 0;
-                mStatus = EDS_DONE;
-            } else if ('\r' != str[0]) {
-                if (mUsed + 1 >= mAllocated) {
-                    mAllocated += 32;
-                    s8* nstr = reinterpret_cast<s8*>(mHub.allocateAndClear(mAllocated));
-                    memcpy(nstr, mValue.mValStr, mUsed);
-                    mHub.release(mValue.mValStr);
-                    mValue.mValStr = nstr;
-                    mValue.mValStr[mUsed++] = str[0];
-                }
-                mValue.mValStr[mUsed++] = str[0];
-            }
-            break;
-
-            //case EDS_ARRAY:
-        case EDS_ARRAY_SIZE:
-            if (decodeSize(str[0])) {
-                if(0 == mValue.mVal64) {
-                    mStatus = EDS_DONE;
-                    break;
-                }
-                mStatus = EDS_ARRAY;
-                mUsed = 0;
-                mAllocated = mValue.mVal64;
-                mValue.mNodes = reinterpret_cast<RedisResponse**>
-                    (mHub.allocateAndClear(sizeof(RedisResponse*)*mAllocated));
-                for (u32 i = 0; i < mAllocated; ++i) {
-                    mValue.mNodes[i] = new
-                    (reinterpret_cast<RedisResponse*>(mHub.allocateAndClear(sizeof(RedisResponse)))) RedisResponse(mHub);
-                }
-            }
-            break;
+s8* RedisResponse::decodeNode(s8* str, RedisResponse*& nodes, RedisResponse**& slots) {
+    mView = true;
+    mStatus = EDS_DONE;
+    mType = static_cast<u8>(*str++);
+    switch (mType) {
+    case ERRT_ERROR:
+    case ERRT_STRING:
+    case ERRT_DOUBLE:
+    case ERRT_BIG_NUM:
+    {
+        s8* tail = str;
+        while ('\r' != *tail) {
+            ++tail;
+        }
+        *tail = '\0';
+        mValue.mValStr = str;
+        mUsed = static_cast<u32>(tail - str);
+        mAllocated = mUsed + 1;
+        return tail + 2;
+    }
+    case ERRT_INT:
+    {
+        const s8* pos = str;
+        mValue.mVal64 = AppDecodeInt(pos);
+        return const_cast<s8*>(pos);
+    }
+    case '_':
+        mType = ERRT_NIL;
+        return str + 2;
+    case ERRT_BOOL:
+        mValue.mVal64 = 't' == *str ? 1 : 0;
+        return str + 3;
+    case ERRT_BULK_STR:
+    case '!':   //blob error
+    case '=':   //verbatim string, "txt:" or "mkd:" is skipped
+    {
+        const s8* pos = str;
+        s64 cnt = AppDecodeInt(pos);
+        str = const_cast<s8*>(pos);
+        if (cnt < 0) {
+            mType = ERRT_NIL;
+            return str;
+        }
+        if ('=' == mType && cnt >= 4) {
+            str += 4;
+            cnt -= 4;
+        }
+        mType = '!' == mType ? ERRT_ERROR : ('=' == mType ? ERRT_BULK_STR : mType);
+        mValue.mValStr = str;
+        mUsed = static_cast<u32>(cnt);
+        mAllocated = mUsed + 1;
+        str[cnt] = '\0';
+        return str + cnt + 2;
+    }
+    case '|':
+    {
+        //attributes are skipped, they are left in arena
+        const s8* pos = str;
+        s64 cnt = AppDecodeInt(pos) * 2;
+        str = const_cast<s8*>(pos);
+        for (s64 i = 0; i < cnt; ++i) {
+            str = (new (nodes++) RedisResponse(mHub, true))->decodeNode(str, nodes, slots);
+        }
+        return decodeNode(str, nodes, slots);
+    }
+    case ERRT_ARRAY:
+    case ERRT_SET:
+    case ERRT_PUSH:
+    case ERRT_MAP:
+    {
+        const s8* pos = str;
+        s64 cnt = AppDecodeInt(pos);
+        str = const_cast<s8*>(pos);
+        if (cnt < 0) {
+            mType = ERRT_NIL;
+            return str;
+        }
+        if (ERRT_MAP == mType) {
+            cnt *= 2;
+        }
+        mUsed = static_cast<u32>(cnt);
+        mAllocated = mUsed;
+        mValue.mNodes = cnt > 0 ? slots : nullptr;
+        slots += cnt;
+        for (u32 i = 0; i < mUsed; ++i) {
+            RedisResponse* nd = new (nodes++) RedisResponse(mHub, true);
+            mValue.mNodes[i] = nd;
+            str = nd->decodeNode(str, nodes, slots);
+        }
+        return str;
+    }
+    default:
+        DASSERT(0);
+        return str;
+    }
+}
 
-        case EDS_ARRAY:
-        {
-            RedisResponse* nd = reinterpret_cast<RedisResponse*>(mValue.mNodes[mUsed]);
-            str = nd->import(str, end - str);
-            if (nd->isFinished()) {
-                if (++mUsed == mAllocated) {
-                    mStatus = EDS_DONE;
-                }
-                --str;
+u64 RedisResponse::getViewSize()const {
+    u64 ret = 0;
+    if (isAggregate() && mView) {
+        for (u32 i = 0; i < mAllocated; ++i) {
+            if (mValue.mNodes[i]) {
+                ret += mValue.mNodes[i]->getViewSize();
             }
-            break;
         }
+    } else if (mView && mValue.mValStr
+        && (ERRT_ERROR == mType || ERRT_STRING == mType || ERRT_BULK_STR == mType
+        || ERRT_DOUBLE == mType || ERRT_BIG_NUM == mType)) {
+        ret = mUsed + 1ULL;
+    }
+    return ret;
+}
 
-        case EDS_BULK_SIZE:
-            if (decodeSize(str[0])) {
-                mStatus = EDS_BULK_STR;
-                mUsed = 0;
-                if (mValue.mVal64 > 0) {
-                    mAllocated = mValue.mVal64 + 1;
-                    mValue.mValStr = reinterpret_cast<s8*>(mHub.allocateAndClear(mAllocated));
-                } else if (0 == mValue.mVal64) {
-                    mStatus = EDS_DONE; //empty str
-                } else {
-                    mType = ERRT_NIL;
-                    mStatus = EDS_DONE;
-                }
+s8* RedisResponse::copyView(s8* pos) {
+    if (isAggregate() && mView) {
+        for (u32 i = 0; i < mAllocated; ++i) {
+            if (mValue.mNodes[i]) {
+                pos = mValue.mNodes[i]->copyView(pos);
             }
-            break;
-
-        case EDS_DONE:
-            return str;
+        }
+    } else if (mView && mValue.mValStr
+        && (ERRT_ERROR == mType || ERRT_STRING == mType || ERRT_BULK_STR == mType
+        || ERRT_DOUBLE == mType || ERRT_BIG_NUM == mType)) {
+        memcpy(pos, mValue.mValStr, mUsed + 1ULL);
+        mValue.mValStr = pos;
+        pos += mUsed + 1ULL;
+    }
+    return pos;
+}
 
-        default:
-            DASSERT(0);
-            break;
-        }//switch status
-    }//for
+void RedisResponse::makeView(u8 type, const s8* str, u32 len) {
+    clear();
+    mView = true;
+    mStatus = EDS_DONE;
+    mType = type;
+    mValue.mValStr = const_cast<s8*>(str);
+    mUsed = len;
+    mAllocated = len + 1;
+}
 
-    return str;
+void RedisResponse::own() {
+    if (mStore || EDS_DONE != mStatus) {
+        return;
+    }
+    u64 size = getViewSize();
+    if (size > 0) {
+        mStore = mHub.allocate(size);
+        copyView(mStore);
+    }
 }
 
 void RedisResponse::makeError(const s8* str) {
@@ -230,6 +385,34 @@ void RedisResponse::makeError(const s8* str) {
     memcpy(mValue.mValStr, str, mAllocated);
 }
 
+void RedisResponse::makeArray(u32 cnt) {
+    clear();
+    mType = ERRT_ARRAY;
+    mStatus = 0 == cnt ? EDS_DONE : EDS_ARRAY;
+    mUsed = 0;
+    mAllocated = cnt;
+    mValue.mNodes = 0 == cnt ? nullptr
+        : reinterpret_cast<RedisResponse**>(mHub.allocateAndClear(sizeof(RedisResponse*) * cnt));
+}
+
+void RedisResponse::setResult(u32 idx, RedisResponse* it) {
+    DASSERT(ERRT_ARRAY == mType && !mView && idx < mAllocated && nullptr == mValue.mNodes[idx]);
+    DASSERT(&it->mHub == &mHub);
+    mValue.mNodes[idx] = it;
+    if (++mUsed == mAllocated) {
+        mStatus = EDS_DONE;
+    }
+}
+
+RedisResponse* RedisResponse::takeResult(u32 idx) {
+    if (ERRT_ARRAY != mType || mView || nullptr == mValue.mNodes || idx >= mAllocated) {
+        return nullptr;
+    }
+    RedisResponse* ret = mValue.mNodes[idx];
+    mValue.mNodes[idx] = nullptr;
+    return ret;
+}
+
 void RedisResponse::show(u32 level, u32 index)const {
     if (EDS_DONE != mStatus) {
         printf("status!=EDS_DONE\n");
@@ -240,7 +423,11 @@ void RedisResponse::show(u32 level, u32 index)const {
     }
     switch (mType) {
     case ERRT_ARRAY:
-        printf("[%u.%u][array]=%u\n", level, index, mUsed);
+    case ERRT_MAP:
+    case ERRT_SET:
+    case ERRT_PUSH:
+        printf("[%u.%u][%s]=%u\n", level, index, ERRT_ARRAY == mType ? "array"
+            : (ERRT_MAP == mType ? "map" : (ERRT_SET == mType ? "set" : "push")), mUsed);
         for (u32 i = 0; i < mUsed; ++i) {
             RedisResponse* nd = reinterpret_cast<RedisResponse*>(mValue.mNodes[i]);
             if (nd) {
@@ -251,8 +438,15 @@ void RedisResponse::show(u32 level, u32 index)const {
     case ERRT_ERROR:
     case ERRT_STRING:
     case ERRT_BULK_STR:
+    case ERRT_BIG_NUM:
         printf("[%u.%u][string]=%s\n", level, index, mValue.mValStr);
         break;
+    case ERRT_DOUBLE:
+        printf("[%u.%u][double]=%s\n", level, index, mValue.mValStr);
+        break;
+    case ERRT_BOOL:
+        printf("[%u.%u][bool]=%s\n", level, index, mValue.mVal64 ? "true" : "false");
+        break;
     case ERRT_INT:
         printf("[%u.%u][int]=%lld\n", level, index, mValue.mVal64);
         break;
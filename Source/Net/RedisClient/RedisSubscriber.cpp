@@ -0,0 +1,551 @@
+/***************************************************************************************************
+ * MIT License
+ *
+ * Copyright (c) 2021 antmuse@live.cn/antmuse@qq.com
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+***************************************************************************************************/
+
+
+
+#include "Net/RedisClient/RedisSubscriber.h"
+#include "Net/RedisClient/RedisCommand.h"
+#include "MemoryHub.h"
+#include "HashFunctions.h"
+#include "Logger.h"
+#include "Script/HLua.h"
+
+namespace app {
+namespace net {
+
+RedisSubscriber::RedisSubscriber(Loop* loop) :
+    mStatus(0),
+    mRetry(0),
+    mKept(0),
+    mRunning(false),
+    mWaiting(false),
+    mActive(false),
+    mPinged(false),
+    mMask(15),
+    mCount(0),
+    mMessages(0),
+    mEvents(64),
+    mDead(4),
+    mDispatching(false),
+    mLoop(loop),
+    mResult(nullptr) {
+    mHub = new MemoryHub();
+    mBuckets = new Channel * [mMask + 1];
+    memset(mBuckets, 0, sizeof(Channel*) * (mMask + 1));
+    mTCP.setClose(EHT_TCP_CONNECT, RedisSubscriber::funcOnClose, this);
+    mRetryTime.setClose(EHT_TIME, RedisSubscriber::funcOnRetryClose, this);
+}
+
+
+RedisSubscriber::~RedisSubscriber() {
+    DASSERT(isClosed());
+    for (u32 i = 0; i <= mMask; ++i) {
+        while (mBuckets[i]) {
+            Channel* nd = mBuckets[i];
+            mBuckets[i] = nd->mChain;
+            for (usz k = 0; k < nd->mListeners.size(); ++k) {
+                releaseListener(nd->mListeners[k]);
+            }
+            delete nd;
+        }
+    }
+    delete[] mBuckets;
+    mBuckets = nullptr;
+    if (mResult) {
+        mResult->~RedisResponse();
+        mHub->release(mResult);
+        mResult = nullptr;
+    }
+    mHub->drop();
+    mHub = nullptr;
+}
+
+
+s32 RedisSubscriber::open(const net::NetAddress& addr, const s8* passowrd) {
+    if (mRunning) {
+        return EE_OK;
+    }
+    mRunning = true;
+    mRetry = 0;
+    mPassword = passowrd ? passowrd : "";
+    mTCP.setRemote(addr);
+    if (0 != mStatus || mWaiting) {
+        return EE_OK; //reconnected after the old handle is closed
+    }
+    if (EE_OK != connect()) {
+        mRunning = false;
+        return EE_ERROR;
+    }
+    return EE_OK;
+}
+
+
+s32 RedisSubscriber::close() {
+    mRunning = false;
+    if (mWaiting) {
+        mLoop->closeHandle(&mRetryTime);
+    }
+    if (0 == mStatus) {
+        return EE_OK;
+    }
+    return mLoop->closeHandle(&mTCP);
+}
+
+
+s32 RedisSubscriber::connect() {
+    //the timeout is made absolute by openHandle(), so it's reset for each connection
+    mTCP.setTime(RedisSubscriber::funcOnTime, 15 * 1000, 20 * 1000, -1);
+    if (EE_OK != mLoop->openHandle(&mTCP)) {
+        Logger::logError("RedisSubscriber::connect>>fail to open redis = %s", mTCP.getRemote().getStr());
+        return EE_ERROR;
+    }
+    mStatus = 1;
+    RequestFD* it = RequestFD::newRequest(G_READ_SIZE);
+    it->mUser = this;
+    it->mCall = funcOnConnect;
+    if (EE_OK != mTCP.connect(it)) {
+        RequestFD::delRequest(it);
+        Logger::logError("RedisSubscriber::connect>>fail to connect redis = %s", mTCP.getRemote().getStr());
+        mLoop->closeHandle(&mTCP); //retried in onClose()
+    }
+    return EE_OK;
+}
+
+
+void RedisSubscriber::onConnect(RequestFD* it) {
+    if (0 == it->mError) {
+        it->mCall = RedisSubscriber::funcOnRead;
+        if (EE_OK == mTCP.read(it)) {
+            if (mPassword.getLen() > 0) {
+                const s8* argv[] = { "AUTH", mPassword.c_str() };
+                const u32 lens[] = { 4, static_cast<u32>(mPassword.getLen()) };
+                mStatus = 2;
+                writeCommand(2, argv, lens);
+            } else {
+                launchAll();
+            }
+            return;
+        }
+    }
+    //the handle is closed by loop, see onClose()
+    RequestFD::delRequest(it);
+}
+
+
+void RedisSubscriber::onClose(Handle* it) {
+    mStatus = 0;
+    mKept = 0;
+    mActive = false;
+    mPinged = false;
+    mScanner.reset();
+    if (mRunning) {
+        retry();
+    }
+}
+
+
+void RedisSubscriber::retry() {
+    if (mWaiting) {
+        return; //see onRetryClose()
+    }
+    s64 delay = G_RETRY_DELAY << (mRetry < 8 ? mRetry : 8);
+    delay = delay < G_MAX_RETRY_DELAY ? delay : G_MAX_RETRY_DELAY;
+    mRetryTime.setTime(RedisSubscriber::funcOnRetry, delay, 0, 0);
+    if (EE_OK != mLoop->openHandle(&mRetryTime)) {
+        mRunning = false;
+        Logger::logError("RedisSubscriber::retry>>stop reconnect, addr=%s, retry=%u",
+            mTCP.getRemote().getStr(), mRetry);
+        return;
+    }
+    mWaiting = true;
+    ++mRetry;
+    Logger::log(ELL_INFO, "RedisSubscriber::retry>>addr=%s, retry=%u, delay=%lldms",
+        mTCP.getRemote().getStr(), mRetry, delay);
+}
+
+
+s32 RedisSubscriber::onRetry(HandleTime& it) {
+    if (mRunning && 0 == mStatus) {
+        connect();
+    }
+    return EE_OK; //closed after once, see onRetryClose()
+}
+
+
+void RedisSubscriber::onRetryClose(Handle* it) {
+    mWaiting = false;
+    //the connect() failed, or the connection was closed before this timer
+    if (mRunning && 0 == mStatus) {
+        retry();
+    }
+}
+
+
+void RedisSubscriber::onWrite(RequestFD* it) {
+    RequestFD::delRequest(it);
+}
+
+
+s32 RedisSubscriber::onTimeout(HandleTime& it) {
+    if (4 != mStatus) {
+        return EE_ERROR;
+    }
+    if (!mActive && mPinged) {
+        Logger::log(ELL_ERROR, "RedisSubscriber::onTimeout>>no pong, addr=%s", mTCP.getRemote().getStr());
+        return EE_ERROR;
+    }
+    //PING is allowed in subscribed state, it's replied by ["pong", ""]
+    mPinged = !mActive;
+    if (mPinged) {
+        const s8* argv[] = { "PING" };
+        const u32 lens[] = { 4 };
+        writeCommand(1, argv, lens);
+    }
+    mActive = false;
+    return EE_OK;
+}
+
+
+void RedisSubscriber::onRead(RequestFD* it) {
+    if (it->mUsed > mKept) {
+        mActive = true;
+        s8* pos = it->mData;
+        s8* const end = pos + it->mUsed;
+        while (pos < end) {
+            u64 len = mScanner.scan(pos, end - pos);
+            if (0 == len) {
+                if (mScanner.isError()) {
+                    Logger::log(ELL_ERROR, "RedisSubscriber::onRead>>bad message, addr=%s",
+                        mTCP.getRemote().getStr());
+                    close();
+                }
+                break;
+            }
+            if (nullptr == mResult) {
+                mResult = new
+                (reinterpret_cast<RedisResponse*>(mHub->allocate(sizeof(RedisResponse)))) RedisResponse(*mHub);
+            }
+            //strings of message are views of read buffer, they are valid till keepTail()
+            mResult->decode(pos, len, mScanner.getNodeCount());
+            mScanner.reset();
+            pos += len;
+            if (2 == mStatus) {
+                if (mResult->isOK()) {
+                    launchAll();
+                } else {
+                    Logger::logError("RedisSubscriber::onRead>>addr=%s, auth fail, err=%s",
+                        mTCP.getRemote().getStr(), mResult->isError() ? mResult->getStr() : "");
+                    mRunning = false;
+                    close();
+                }
+            } else if (mResult->isError()) {
+                Logger::log(ELL_ERROR, "RedisSubscriber::onRead>>addr=%s, err=%s",
+                    mTCP.getRemote().getStr(), mResult->getStr());
+            } else {
+                onMessage();
+            }
+            mResult->clear();
+        }
+        dispatch();
+        it = keepTail(it, pos);
+        if (EE_OK == mTCP.read(it)) {
+            return;
+        }
+    }
+    Logger::log(ELL_INFO, "RedisSubscriber::onRead>>addr=%s, ecode=%d",
+        mTCP.getRemote().getStr(), it->mError);
+    RequestFD::delRequest(it);
+}
+
+
+void RedisSubscriber::onMessage() {
+    //["message", channel, msg] or ["pmessage", pattern, channel, msg], others are ignored
+    const RedisResponse& res = *mResult;
+    RedisResponse* kind = res.getResult(0);
+    if (!res.isAggregate() || !kind || !kind->getStr()) {
+        return;
+    }
+    bool pattern;
+    if (3 == res.mUsed && 7 == kind->mUsed && 0 == memcmp(kind->getStr(), "message", 7)) {
+        pattern = false;
+    } else if (4 == res.mUsed && 8 == kind->mUsed && 0 == memcmp(kind->getStr(), "pmessage", 8)) {
+        pattern = true;
+    } else {
+        return;
+    }
+    RedisResponse* key = res.getResult(1);
+    RedisResponse* name = res.getResult(res.mUsed - 2);
+    RedisResponse* msg = res.getResult(res.mUsed - 1);
+    if (!key->getStr() || !name->getStr()) {
+        return;
+    }
+    StringView kview(key->getStr(), key->mUsed);
+    Channel* ch = findChannel(kview, pattern, getHash(kview, pattern), nullptr);
+    if (ch) {
+        Event evt;
+        evt.mChannel = ch;
+        evt.mName.set(name->getStr(), name->mUsed);
+        evt.mMsg.set(msg->getStr(), msg->getStr() ? msg->mUsed : 0);
+        mEvents.pushBack(evt);
+    }
+    ++mMessages;
+}
+
+
+void RedisSubscriber::dispatch() {
+    mDispatching = true;
+    for (usz i = 0; i < mEvents.size(); ++i) {
+        const Event& evt = mEvents[i];
+        Channel* ch = evt.mChannel;
+        //a listener may subscribe or unsubscribe in callback
+        for (usz k = 0; k < ch->mListeners.size(); ++k) {
+            Listener nd = ch->mListeners[k];
+            call(nd, evt.mName, evt.mMsg);
+        }
+    }
+    mEvents.resize(0);
+    mDispatching = false;
+    for (usz i = 0; i < mDead.size(); ++i) {
+        delete mDead[i];
+    }
+    mDead.resize(0);
+}
+
+
+void RedisSubscriber::call(const Listener& it, const StringView& channel, const StringView& msg) {
+    if (it.mFunc) {
+        it.mFunc(it.mUser, channel, msg);
+        return;
+    }
+    lua_State* vm = it.mVM;
+    lua_rawgeti(vm, LUA_REGISTRYINDEX, it.mRef);
+    lua_pushlstring(vm, channel.mData, channel.mLen);
+    lua_pushlstring(vm, msg.mData, msg.mLen);
+    if (LUA_OK != lua_pcall(vm, 2, 0, 0)) {
+        Logger::log(ELL_ERROR, "RedisSubscriber::call>>channel=%s, lua err=%s",
+            channel.mData, lua_tostring(vm, -1));
+        lua_pop(vm, 1);
+    }
+}
+
+
+void RedisSubscriber::releaseListener(Listener& it) {
+    if (!it.mFunc && it.mVM) {
+        luaL_unref(it.mVM, LUA_REGISTRYINDEX, it.mRef);
+    }
+    it.mVM = nullptr;
+}
+
+
+bool RedisSubscriber::writeCommand(u32 argc, const s8** argv, const u32* lens) {
+    u64 allsz = RedisCommand::getEncodeSize(argc, lens);
+    RequestFD* out = RequestFD::newRequest(static_cast<u32>(allsz));
+    out->mUser = this;
+    out->mCall = RedisSubscriber::funcOnWrite;
+    out->mUsed = RedisCommand::encode(out->mData, allsz, argc, argv, lens);
+    if (0 != mTCP.write(out)) {
+        RequestFD::delRequest(out);
+        return false;
+    }
+    return true;
+}
+
+
+void RedisSubscriber::launch(const s8* cmd, u32 clen, const StringView& channel) {
+    if (4 == mStatus) {
+        const s8* argv[] = { cmd, channel.mData };
+        const u32 lens[] = { clen, static_cast<u32>(channel.mLen) };
+        writeCommand(2, argv, lens);
+    }
+}
+
+
+void RedisSubscriber::launchAll() {
+    mStatus = 4;
+    mRetry = 0;
+    //all channels in one SUBSCRIBE, all patterns in one PSUBSCRIBE
+    TVector<const s8*> argv(mCount + 1);
+    TVector<u32> lens(mCount + 1);
+    for (s32 pattern = 0; pattern < 2; ++pattern) {
+        argv.resize(0);
+        lens.resize(0);
+        argv.pushBack(pattern ? "PSUBSCRIBE" : "SUBSCRIBE");
+        lens.pushBack(pattern ? 10 : 9);
+        for (u32 i = 0; i <= mMask; ++i) {
+            for (Channel* nd = mBuckets[i]; nd; nd = nd->mChain) {
+                if (nd->mPattern == (1 == pattern)) {
+                    argv.pushBack(nd->mName.c_str());
+                    lens.pushBack(static_cast<u32>(nd->mName.getLen()));
+                }
+            }
+        }
+        if (argv.size() > 1) {
+            writeCommand(static_cast<u32>(argv.size()), &argv[0], &lens[0]);
+        }
+    }
+}
+
+
+RequestFD* RedisSubscriber::keepTail(RequestFD* it, const s8* pos) {
+    mKept = static_cast<u32>(it->mData + it->mUsed - pos);
+    if (mKept > 0 && pos > it->mData) {
+        memmove(it->mData, pos, mKept);
+    }
+    it->mUsed = mKept;
+    u32 cap = it->mAllocated;
+    if (mKept == cap) {
+        cap *= 2;   //a large message
+    } else if (0 == mKept && cap > G_READ_SIZE) {
+        cap = G_READ_SIZE;
+    } else {
+        return it;
+    }
+    RequestFD* nd = RequestFD::newRequest(cap);
+    memcpy(nd->mData, it->mData, mKept);
+    nd->mUsed = mKept;
+    nd->mUser = it->mUser;
+    nd->mCall = it->mCall;
+    RequestFD::delRequest(it);
+    return nd;
+}
+
+
+u64 RedisSubscriber::getHash(const StringView& name, bool pattern) {
+    return AppHashMurmur64(name.mData, name.mLen) + (pattern ? 1 : 0);
+}
+
+
+RedisSubscriber::Channel* RedisSubscriber::findChannel(const StringView& name, bool pattern,
+    u64 hash, Channel*** prev) {
+    Channel** link = &mBuckets[hash & mMask];
+    for (Channel* nd = *link; nd; link = &nd->mChain, nd = nd->mChain) {
+        if (nd->mHash == hash && nd->mPattern == pattern && nd->mName.getLen() == name.mLen
+            && 0 == memcmp(nd->mName.c_str(), name.mData, name.mLen)) {
+            if (prev) {
+                *prev = link;
+            }
+            return nd;
+        }
+    }
+    return nullptr;
+}
+
+
+RedisSubscriber::Channel* RedisSubscriber::addChannel(const StringView& name, bool pattern) {
+    const u64 hash = getHash(name, pattern);
+    Channel* nd = findChannel(name, pattern, hash, nullptr);
+    if (nd) {
+        return nd;
+    }
+    if (mCount > mMask) {
+        resize();
+    }
+    nd = new Channel();
+    nd->mHash = hash;
+    nd->mPattern = pattern;
+    nd->mName.append(name.mData, name.mLen);
+    nd->mChain = mBuckets[hash & mMask];
+    mBuckets[hash & mMask] = nd;
+    ++mCount;
+    if (pattern) {
+        launch("PSUBSCRIBE", 10, name);
+    } else {
+        launch("SUBSCRIBE", 9, name);
+    }
+    return nd;
+}
+
+
+void RedisSubscriber::resize() {
+    const u32 cnt = (mMask + 1) * 2;
+    Channel** buckets = new Channel * [cnt];
+    memset(buckets, 0, sizeof(Channel*) * cnt);
+    for (u32 i = 0; i <= mMask; ++i) {
+        while (mBuckets[i]) {
+            Channel* nd = mBuckets[i];
+            mBuckets[i] = nd->mChain;
+            nd->mChain = buckets[nd->mHash & (cnt - 1)];
+            buckets[nd->mHash & (cnt - 1)] = nd;
+        }
+    }
+    delete[] mBuckets;
+    mBuckets = buckets;
+    mMask = cnt - 1;
+}
+
+
+bool RedisSubscriber::subscribe(const StringView& channel, AppRedisSubCaller func, void* user, bool pattern) {
+    if (!func || 0 == channel.mLen) {
+        return false;
+    }
+    Listener nd;
+    nd.mFunc = func;
+    nd.mUser = user;
+    nd.mVM = nullptr;
+    nd.mRef = 0;
+    addChannel(channel, pattern)->mListeners.pushBack(nd);
+    return true;
+}
+
+
+bool RedisSubscriber::subscribe(const StringView& channel, lua_State* vm, s32 ref, bool pattern) {
+    if (!vm || LUA_NOREF == ref || LUA_REFNIL == ref || 0 == channel.mLen) {
+        return false;
+    }
+    Listener nd;
+    nd.mFunc = nullptr;
+    nd.mUser = nullptr;
+    nd.mVM = vm;
+    nd.mRef = ref;
+    addChannel(channel, pattern)->mListeners.pushBack(nd);
+    return true;
+}
+
+
+void RedisSubscriber::unsubscribe(const StringView& channel, bool pattern) {
+    Channel** prev = nullptr;
+    Channel* nd = findChannel(channel, pattern, getHash(channel, pattern), &prev);
+    if (!nd) {
+        return;
+    }
+    if (pattern) {
+        launch("PUNSUBSCRIBE", 12, channel);
+    } else {
+        launch("UNSUBSCRIBE", 11, channel);
+    }
+    *prev = nd->mChain;
+    --mCount;
+    for (usz k = 0; k < nd->mListeners.size(); ++k) {
+        releaseListener(nd->mListeners[k]);
+    }
+    nd->mListeners.resize(0);
+    if (mDispatching) {
+        mDead.pushBack(nd); //the events of this read may refer to it
+    } else {
+        delete nd;
+    }
+}
+
+} //namespace net
+} //namespace app
@@ -47,6 +47,10 @@
 #include <linux/if.h>
 #include <linux/if_ether.h>
 #include <linux/sockios.h>
+
+//@see linux/tls.h
+#define DSOL_TLS 282
+#define DTLS_SET_RECORD_TYPE 1
 #endif  //DOS_WINDOWS
 #include "System.h"
 
@@ -423,6 +427,30 @@ s32 Socket::send(const void* iBuffer, s32 iSize) {
 }
 
 
+s32 Socket::sendRecord(u8 recordType, const void* iBuffer, s32 iSize) {
+#if defined(DOS_WINDOWS)
+    return -1;
+#elif defined(DOS_LINUX) || defined(DOS_ANDROID)
+    s8 cbuf[CMSG_SPACE(sizeof(recordType))];
+    struct iovec iov;
+    iov.iov_base = const_cast<void*>(iBuffer);
+    iov.iov_len = iSize;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cbuf;
+    msg.msg_controllen = sizeof(cbuf);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = DSOL_TLS;
+    cmsg->cmsg_type = DTLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(recordType));
+    *CMSG_DATA(cmsg) = recordType;
+    return (s32)::sendmsg(mSocket, &msg, MSG_NOSIGNAL);
+#endif
+}
+
+
 s32 Socket::receiveAll(void* iBuffer, s32 iSize) {
     s32 ret = 0;
     s32 step;
@@ -26,15 +26,19 @@
 #include "Net/TcpProxy.h"
 #include "EngineConfig.h"
 #include "Net/Acceptor.h"
+#include "HashFunctions.h"
 
 namespace app {
 namespace net {
 
 const u32 gCacheSZ = 4 * 1024;
 
+//virtual nodes of consistent hash ring per weight
+const u32 gRingNodes = 40;
+
 
 TcpProxy::TcpProxy(Loop& loop) :
-    mLoop(loop), mType(0), mHub(nullptr) {
+    mLoop(loop), mType(0), mHub(nullptr), mBackend(-1), mConnected(false) {
 
     //front
     mTLS.getHandleTCP().setClose(EHT_TCP_LINK, TcpProxy::funcOnClose, this);
@@ -64,6 +68,10 @@ s32 TcpProxy::onTimeout2(HandleTime& it) {
 
 void TcpProxy::unbind() {
     if (mHub) {
+        if (mBackend >= 0) {
+            mHub->release(mBackend);
+            mBackend = -1;
+        }
         mHub->drop();
         mHub = nullptr;
     }
@@ -71,7 +79,8 @@ void TcpProxy::unbind() {
 }
 
 void TcpProxy::onClose(Handle* it) {
-    if ((2 & mType) > 0 ? mTLS2.isClose() : mTLS2.getHandleTCP().isClose()) {
+    if (!mTLS2.getHandleTCP().isOpen()
+        || ((2 & mType) > 0 ? mTLS2.isClose() : mTLS2.getHandleTCP().isClose())) {
         Logger::log(ELL_INFO, "TcpProxy::onClose>>front=%s", mTLS.getRemote().getStr());
         unbind();
     } else {
@@ -148,7 +157,9 @@ void TcpProxy::onRead2(RequestFD* it) {
 
 
 void TcpProxy::onConnect(RequestFD* it) {
-    if (EE_OK == it->mError) {
+    mConnected = EE_OK == it->mError;
+    mHub->onConnect(mBackend, mConnected);
+    if (mConnected) {
         it->mCall = TcpProxy::funcOnRead2;
         if (0 == ((2 & mType) > 0 ? mTLS2.read(it) : mTLS2.getHandleTCP().read(it))) {
             RequestFD* read = RequestFD::newRequest(gCacheSZ);
@@ -163,7 +174,8 @@ void TcpProxy::onConnect(RequestFD* it) {
         }
     }
 
-    Logger::log(ELL_ERROR, "TcpProxy::onConnect>>ecode=%d", it->mError);
+    Logger::log(ELL_ERROR, "TcpProxy::onConnect>>backend=%s, ecode=%d",
+        mTLS2.getHandleTCP().getRemote().getStr(), it->mError);
     RequestFD::delRequest(it);
     mLoop.closeHandle(&mTLS.getHandleTCP());
 }
@@ -209,7 +221,6 @@ void TcpProxy::onLink(RequestFD* it) {
     mTLS2.getHandleTCP().setTimeout(tmout);
     mTLS2.getHandleTCP().setTimeGap(tgap);
     mTLS2.getHandleTCP().setLocal(accp->getHandleTCP().getLocal());
-    mTLS2.getHandleTCP().setRemote(accp->getHandleTCP().getRemote());
 
     if (0 == mTLS.getHandleTCP().getTimeGap()) {
         mTLS.getHandleTCP().setTimeCaller(nullptr);
@@ -233,6 +244,17 @@ void TcpProxy::onLink(RequestFD* it) {
         return;
     }
 
+    mBackend = mHub->pick(mTLS.getHandleTCP().getRemote());
+    if (mBackend < 0) {
+        Logger::log(ELL_ERROR, "TcpProxy::onLink>>no alive backend, front=%s",
+            mTLS.getHandleTCP().getRemote().getStr());
+        mHub = nullptr;
+        grab(); //dropped by unbind() in onClose
+        mLoop.closeHandle(&mTLS.getHandleTCP());
+        return;
+    }
+    mTLS2.getHandleTCP().setRemote(mHub->getBackend(mBackend));
+
     //bind
     grab();
     mHub->grab();
@@ -252,7 +274,8 @@ void TcpProxy::onLink(RequestFD* it) {
     if (EE_OK != ecode) {
         Logger::log(ELL_ERROR, "TcpProxy::onLink>> [%s->%s->%s], ecode=%d",
             mTLS.getRemote().getStr(), mTLS2.getLocal().getStr(), mTLS2.getRemote().getStr(), ecode);
-        RequestFD::delRequest(it);
+        RequestFD::delRequest(conn);
+        mHub->onConnect(mBackend, false);
         mLoop.closeHandle(&mTLS.getHandleTCP());
         return;
     }
@@ -261,5 +284,203 @@ void TcpProxy::onLink(RequestFD* it) {
         mTLS.getRemote().getStr(), mTLS2.getLocal().getStr(), mTLS2.getRemote().getStr());
 }
 
+
+TcpProxyHub::TcpProxyHub(EngineConfig::ProxyCfg& cfg) :
+    mConfig(cfg), mLoop(nullptr), mNext(0) {
+    if (0 == mConfig.mBackend.size()) {
+        EngineConfig::BackendCfg bk;
+        bk.mWeight = 1;
+        bk.mAddress = mConfig.mRemote;
+        mConfig.mBackend.pushBack(bk);
+    }
+    mBackends.reallocate(mConfig.mBackend.size());
+    for (usz i = 0; i < mConfig.mBackend.size(); ++i) {
+        Backend* nd = new Backend();
+        nd->mAddress = mConfig.mBackend[i].mAddress;
+        nd->mWeight = AppMax<u32>(1, mConfig.mBackend[i].mWeight);
+        mBackends.pushBack(nd);
+    }
+    if (1 == mConfig.mBalance) {
+        //ring of virtual nodes, the weight is the count of nodes
+        RingNode node;
+        s8 key[64];
+        for (u32 i = 0; i < mBackends.size(); ++i) {
+            for (u32 k = 0; k < mBackends[i]->mWeight * gRingNodes; ++k) {
+                s32 len = snprintf(key, sizeof(key), "%s#%u", mBackends[i]->mAddress.getStr(), k);
+                node.mHash = AppHashMurmur32(key, len);
+                node.mIndex = i;
+                mRing.pushBack(node);
+            }
+        }
+        mRing.quickSort();
+    }
+    mTime.setClose(EHT_TIME, TcpProxyHub::funcOnCloseTime, this);
+}
+
+
+TcpProxyHub::~TcpProxyHub() {
+    for (usz i = 0; i < mBackends.size(); ++i) {
+        delete mBackends[i];
+    }
+    mBackends.clear();
+}
+
+
+s32 TcpProxyHub::open(Loop& loop) {
+    mLoop = &loop;
+    if (0 == mConfig.mCheckTime) {
+        return EE_OK;
+    }
+    mTime.setTime(TcpProxyHub::funcOnTime, mConfig.mCheckTime, mConfig.mCheckTime, -1);
+    s32 ret = mLoop->openHandle(&mTime);
+    if (EE_OK != ret) {
+        Logger::log(ELL_ERROR, "TcpProxyHub::open>>timer ecode=%d", ret);
+        return ret;
+    }
+    grab();
+    return EE_OK;
+}
+
+
+s32 TcpProxyHub::pick(const NetAddress& client) {
+    DASSERT(mLoop);
+    s32 ret = -1;
+    if (mRing.size() > 0) {
+        NetAddress::IP ip = client.toIP();
+        u32 hash = AppHashMurmur32(&ip, sizeof(ip));
+        //first node with mHash >= hash
+        usz left = 0;
+        usz right = mRing.size();
+        while (left < right) {
+            usz mid = (left + right) >> 1;
+            if (mRing[mid].mHash < hash) {
+                left = mid + 1;
+            } else {
+                right = mid;
+            }
+        }
+        //walk clockwise and skip the ejected backends
+        for (usz i = 0; i < mRing.size(); ++i) {
+            u32 idx = mRing[(left + i) % mRing.size()].mIndex;
+            if (isAlive(*mBackends[idx])) {
+                ret = idx;
+                break;
+            }
+        }
+    } else {
+        //weighted least connections: min(links/weight), ties are rotated by mNext
+        for (usz i = 0; i < mBackends.size(); ++i) {
+            u32 idx = (mNext + i) % mBackends.size();
+            const Backend& nd = *mBackends[idx];
+            if (!isAlive(nd)) {
+                continue;
+            }
+            if (ret < 0 || (u64)nd.mLinks * mBackends[ret]->mWeight
+                < (u64)mBackends[ret]->mLinks * nd.mWeight) {
+                ret = (s32)idx;
+            }
+        }
+        if (ret >= 0) {
+            mNext = ret + 1;
+        }
+    }
+    if (ret >= 0) {
+        ++mBackends[ret]->mLinks;
+    }
+    return ret;
+}
+
+
+void TcpProxyHub::onConnect(s32 idx, bool success) {
+    if (idx < 0) {
+        return;
+    }
+    Backend& nd = *mBackends[idx];
+    if (success) {
+        nd.mFails = 0;
+        nd.mEjectTime = 0;
+        return;
+    }
+    ++nd.mFails;
+    if (mConfig.mMaxFails > 0 && nd.mFails >= mConfig.mMaxFails) {
+        eject(idx);
+    }
+}
+
+
+void TcpProxyHub::eject(u32 idx) {
+    Backend& nd = *mBackends[idx];
+    if (0 == nd.mEjectTime) {
+        Logger::log(ELL_ERROR, "TcpProxyHub::eject>>backend=%s, fails=%u, links=%u",
+            nd.mAddress.getStr(), nd.mFails, nd.mLinks);
+    }
+    nd.mEjectTime = mLoop->getTime() + mConfig.mEjectTime;
+}
+
+
+s32 TcpProxyHub::onTimeout(HandleTime& it) {
+    for (u32 i = 0; i < mBackends.size(); ++i) {
+        if (!mBackends[i]->mProbing) {
+            probe(i);
+        }
+    }
+    return EE_OK;
+}
+
+
+void TcpProxyHub::onCloseTime(Handle* it) {
+    drop(); //the hub may be deleted here
+}
+
+
+void TcpProxyHub::probe(u32 idx) {
+    Probe* pb = new Probe();
+    pb->mHub = this;
+    pb->mIndex = idx;
+    pb->mTCP.setClose(EHT_TCP_CONNECT, TcpProxyHub::funcOnCloseProbe, pb);
+    pb->mTCP.setTime(TcpProxyHub::funcOnProbeTime, mConfig.mCheckTime, mConfig.mCheckTime, -1);
+
+    RequestFD* req = RequestFD::newRequest(0);
+    req->mUser = pb;
+    req->mCall = TcpProxyHub::funcOnProbe;
+    mBackends[idx]->mProbing = true;
+    grab();
+    if (EE_OK != pb->mTCP.open(mBackends[idx]->mAddress, req)) {
+        RequestFD::delRequest(req);
+        eject(idx);
+        if (!pb->mTCP.isOpen()) {
+            //not opened, no close callback
+            mBackends[idx]->mProbing = false;
+            delete pb;
+            drop();
+        }
+    }
+}
+
+
+void TcpProxyHub::onProbe(Probe& pb, RequestFD* it) {
+    Backend& nd = *mBackends[pb.mIndex];
+    if (EE_OK == it->mError) {
+        if (nd.mEjectTime > 0) {
+            Logger::log(ELL_INFO, "TcpProxyHub::onProbe>>backend=%s is alive", nd.mAddress.getStr());
+        }
+        nd.mFails = 0;
+        nd.mEjectTime = 0;
+    } else {
+        eject(pb.mIndex);
+    }
+    RequestFD::delRequest(it);
+    mLoop->closeHandle(&pb.mTCP);
+}
+
+
+void TcpProxyHub::funcOnCloseProbe(Handle* it) {
+    Probe* pb = (Probe*)it->getUser();
+    TcpProxyHub* hub = pb->mHub;
+    hub->mBackends[pb->mIndex]->mProbing = false;
+    delete pb;
+    hub->drop();
+}
+
 } //namespace net
 } //namespace app
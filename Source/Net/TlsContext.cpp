@@ -33,10 +33,17 @@
 #include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <openssl/x509v3.h>
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
 
 #include "Logger.h"
 #include "RingBuffer.h"
 #include "Net/Hostcheck.h"
+#include "Net/TlsSessionCache.h"
+#include "Net/TlsSession.h"
 #include "Certs.h"
 #include "Spinlock.h"
 
@@ -139,9 +146,118 @@ static EVP_PKEY* AppLoadKey(const s8* key, usz length) {
 }
 
 
+static s32 AppSelectALPN(SSL* ssl, const u8** out, u8* outlen, const u8* in, u32 inlen, void* arg) {
+    const TlsContext* ctx = reinterpret_cast<const TlsContext*>(arg);
+    u32 len;
+    const u8* protos = reinterpret_cast<const u8*>(ctx->getALPN(len));
+    if (OPENSSL_NPN_NEGOTIATED != SSL_select_next_proto(const_cast<u8**>(out), outlen, protos, len, in, inlen)) {
+        return SSL_TLSEXT_ERR_NOACK;
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+
+static TlsSessionCache* AppGetSessionCache(const SSL* ssl) {
+    const TlsContext* ctx = reinterpret_cast<const TlsContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    return ctx ? ctx->getSessionCache() : nullptr;
+}
+
+
+static s32 AppNewSession(SSL* ssl, SSL_SESSION* sess) {
+    TlsSessionCache* cache = AppGetSessionCache(ssl);
+    u8 buf[4 * 1024];
+    s32 len = i2d_SSL_SESSION(sess, nullptr);
+    if (!cache || len <= 0 || len > (s32)sizeof(buf)) {
+        return 0;
+    }
+    u8* pos = buf;
+    i2d_SSL_SESSION(sess, &pos);
+    u32 idlen;
+    const u8* sid = SSL_SESSION_get_id(sess, &idlen);
+    cache->add(sid, idlen, buf, len, SSL_SESSION_get_time(sess) + SSL_SESSION_get_timeout(sess));
+    return 0; //not hold the sess
+}
+
+
+static SSL_SESSION* AppGetSession(SSL* ssl, const u8* sid, s32 len, s32* copy) {
+    *copy = 0;
+    TlsSessionCache* cache = AppGetSessionCache(ssl);
+    Packet buf(1024);
+    if (!cache || len <= 0 || !cache->get(sid, len, buf)) {
+        return nullptr;
+    }
+    const u8* pos = reinterpret_cast<const u8*>(buf.getPointer());
+    return d2i_SSL_SESSION(nullptr, &pos, (long)buf.size());
+}
+
+
+static void AppRemoveSession(SSL_CTX* ctx, SSL_SESSION* sess) {
+    const TlsContext* it = reinterpret_cast<const TlsContext*>(SSL_CTX_get_app_data(ctx));
+    if (it && it->getSessionCache()) {
+        u32 idlen;
+        const u8* sid = SSL_SESSION_get_id(sess, &idlen);
+        it->getSessionCache()->remove(sid, idlen);
+    }
+}
+
+
+/**
+ * @brief keys of session ticket are taken from the shared cache, so all processes
+ *        encrypt and decrypt tickets by the same keys.
+ * @return -1=error, 0=ticket not decrypted(full handshake), 1=ok, 2=ok and renew the ticket
+ */
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+static s32 AppTicketKey(SSL* ssl, u8* name, u8* iv, EVP_CIPHER_CTX* ectx, EVP_MAC_CTX* hctx, s32 enc) {
+#else
+static s32 AppTicketKey(SSL* ssl, u8* name, u8* iv, EVP_CIPHER_CTX* ectx, HMAC_CTX* hctx, s32 enc) {
+#endif
+    TlsSessionCache* cache = AppGetSessionCache(ssl);
+    if (!cache) {
+        return -1;
+    }
+    TlsTicketKey key;
+    s32 ret = 1;
+    if (enc) {
+        if (!cache->getTicketKey(key) || 1 != RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc()))) {
+            return -1;
+        }
+        memcpy(name, key.mName, sizeof(key.mName));
+        if (1 != EVP_EncryptInit_ex(ectx, EVP_aes_256_cbc(), nullptr, key.mAES, iv)) {
+            return -1;
+        }
+    } else {
+        ret = cache->findTicketKey(name, key);
+        if (0 == ret) {
+            return 0;
+        }
+        if (1 != EVP_DecryptInit_ex(ectx, EVP_aes_256_cbc(), nullptr, key.mAES, iv)) {
+            return -1;
+        }
+    }
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+    OSSL_PARAM params[3];
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.mHMAC, sizeof(key.mHMAC));
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<s8*>("SHA256"), 0);
+    params[2] = OSSL_PARAM_construct_end();
+    if (1 != EVP_MAC_CTX_set_params(hctx, params)) {
+        return -1;
+    }
+#else
+    if (1 != HMAC_Init_ex(hctx, key.mHMAC, sizeof(key.mHMAC), EVP_sha256(), nullptr)) {
+        return -1;
+    }
+#endif
+    return ret;
+}
+
+
 TlsContext::TlsContext() :
     mTlsContext(nullptr),
-    mVerifyFlags(ETLS_VERIFY_NONE) {
+    mSessionCache(nullptr),
+    mVerifyFlags(ETLS_VERIFY_NONE),
+    mALPNSize(0),
+    mPoolJobs(0),
+    mKTLS(false) {
 }
 
 TlsContext::~TlsContext() {
@@ -218,6 +334,70 @@ s32 TlsContext::setCert(const s8* cert, usz length) {
     return 0;
 }
 
+s32 TlsContext::setALPN(const s8* protos, usz length) {
+    if (!mTlsContext || length > sizeof(mALPN)) {
+        return EE_ERROR;
+    }
+    memcpy(mALPN, protos, length);
+    mALPNSize = (u32)length;
+    SSL_CTX_set_alpn_select_cb((SSL_CTX*)mTlsContext, length > 0 ? AppSelectALPN : nullptr, this);
+    return EE_OK;
+}
+
+s32 TlsContext::setSessionCache(TlsSessionCache* cache, const s8* sidCtx, usz length) {
+    if (!mTlsContext) {
+        return EE_ERROR;
+    }
+    SSL_CTX* ctx = (SSL_CTX*)mTlsContext;
+    if (length > SSL_MAX_SID_CTX_LENGTH) {
+        length = SSL_MAX_SID_CTX_LENGTH;
+    }
+    if (length > 0 && 1 != SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const u8*>(sidCtx), (u32)length)) {
+        return EE_ERROR;
+    }
+    mSessionCache = cache;
+    SSL_CTX_set_app_data(ctx, this);
+    if (!cache) {
+        return EE_OK;
+    }
+    SSL_CTX_set_timeout(ctx, cache->getTimeout());
+    if (cache->getMaxCount() > 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+        SSL_CTX_sess_set_new_cb(ctx, AppNewSession);
+        SSL_CTX_sess_set_get_cb(ctx, AppGetSession);
+        SSL_CTX_sess_set_remove_cb(ctx, AppRemoveSession);
+    }
+    if (cache->hasTicket()) {
+#if (OPENSSL_VERSION_NUMBER >= 0x30000000L)
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, AppTicketKey);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(ctx, AppTicketKey);
+#endif
+    } else {
+        //TLS1.3 resumes by the stateful cache then
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+    return EE_OK;
+}
+
+s32 TlsContext::setKTLS(bool on) {
+    if (!mTlsContext) {
+        return EE_ERROR;
+    }
+#if defined(DUSE_KTLS)
+    if (on) {
+        SSL_CTX_set_options((SSL_CTX*)mTlsContext, SSL_OP_ENABLE_KTLS);
+    } else {
+        SSL_CTX_clear_options((SSL_CTX*)mTlsContext, SSL_OP_ENABLE_KTLS);
+    }
+    mKTLS = on;
+    return EE_OK;
+#else
+    mKTLS = false;
+    return on ? EE_ERROR : EE_OK;
+#endif
+}
+
 s32 TlsContext::setPrivateKey(const s8* key, usz length) {
     EVP_PKEY* pkey = AppLoadKey(key, length);
     if (pkey == nullptr) {
@@ -27,11 +27,37 @@
 #include "Net/TlsSession.h"
 #include "Net/Hostcheck.h"
 #include "Logger.h"
+#include "System.h"
+#if defined(DUSE_KTLS)
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+//internal BIO ctrl of OpenSSL 3, @see openssl/bio.h
+#define DBIO_CTRL_SET_KTLS 72
+#define DBIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG 74
+#define DBIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG 75
+#endif
 
 
 namespace app {
 namespace net {
 
+//record sizes of plaintext, a small one fits in one TCP segment(MSS 1460 - IPv6 and TCP options - TLS overhead)
+static const u32 G_TLS_RECORD_SMALL = 1369;
+static const u32 G_TLS_RECORD_FULL = 16 * 1024;
+//bytes sent in small records before switching to full records
+static const u32 G_TLS_RECORD_BOOST = 64 * 1024;
+//idle time in milliseconds before switching back to small records
+static const s64 G_TLS_RECORD_IDLE = 1000;
+
 static RingBuffer* AppGetBufOfBIO(BIO* bio) {
     void* data = BIO_get_data(bio);
     DASSERT(data && "BIO data field should not be nullptr");
@@ -74,6 +100,14 @@ static s32 AppBIORead(BIO* bio, s8* out, s32 len) {
 
 static s32 AppBIOWrite(BIO* bio, const s8* data, s32 len) {
     BIO_clear_retry_flags(bio);
+#if defined(DUSE_KTLS)
+    TlsSession* session = (TlsSession*)BIO_get_app_data(bio);
+    if (session && session->getRecordType()) {
+        u8 tp = session->getRecordType();
+        session->setRecordType(0);
+        return session->writeRecord(tp, data, len);
+    }
+#endif
     AppGetBufOfBIO(bio)->write(data, len);
     return len;
 }
@@ -133,6 +167,31 @@ static long AppBIOCtrl(BIO* bio, s32 cmd, long num, void* ptr) {
     case BIO_CTRL_FLUSH:
         ret = 1;
         break;
+#if defined(DUSE_KTLS)
+    case DBIO_CTRL_SET_KTLS:
+    {
+        //only the output BIO has a session, num=1 for sending
+        TlsSession* session = (TlsSession*)BIO_get_app_data(bio);
+        ret = (session && num) ? session->startKTLS(ptr) : 0;
+        break;
+    }
+    case BIO_CTRL_GET_KTLS_SEND:
+    {
+        TlsSession* session = (TlsSession*)BIO_get_app_data(bio);
+        ret = (session && session->isKTLS()) ? 1 : 0;
+        break;
+    }
+    case DBIO_CTRL_SET_KTLS_TX_SEND_CTRL_MSG:
+    case DBIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG:
+    {
+        TlsSession* session = (TlsSession*)BIO_get_app_data(bio);
+        if (session) {
+            session->setRecordType(DBIO_CTRL_CLEAR_KTLS_TX_CTRL_MSG == cmd ? 0 : (u8)num);
+        }
+        ret = 0;
+        break;
+    }
+#endif
     case BIO_CTRL_PUSH:
     case BIO_CTRL_POP:
     default:
@@ -259,12 +318,23 @@ static EHostMatch AppMatchHost(X509* peer_cert, const s8* mHostName) {
 
 
 
-TlsSession::TlsSession(SSL_CTX* ssl_ctx, RingBuffer* inBuffers, RingBuffer* outBuffers) {
+TlsSession::TlsSession(SSL_CTX* ssl_ctx, RingBuffer* inBuffers, RingBuffer* outBuffers) :
+    mOutBuffers(outBuffers),
+    mSock(nullptr),
+    mWriteTime(0),
+    mWriteSize(0),
+    mSegmentHead(0),
+    mSegmentCount(0),
+    mSegmentBytes(0),
+    mCryptoSize(0),
+    mRecordType(0),
+    mKTLS(false) {
     DASSERT(ssl_ctx);
     SSL_CTX_up_ref(ssl_ctx);
     mSSL = SSL_new(ssl_ctx);
     mInBIO = AppCreateBIO(inBuffers);
     mOutBIO = AppCreateBIO(outBuffers);
+    BIO_set_app_data(mOutBIO, this);
     SSL_set_bio(mSSL, mInBIO, mOutBIO);
 }
 
@@ -290,7 +360,20 @@ void TlsSession::setHost(const s8* hostName) {
 }
 
 s32 TlsSession::write(const void* buf, s32 len) {
-    return SSL_write(mSSL, buf, len);
+    s32 ret = SSL_write(mSSL, buf, len);
+    if (ret > 0 && mWriteSize < G_TLS_RECORD_BOOST) {
+        mWriteSize += ret;
+    }
+    return ret;
+}
+
+u32 TlsSession::getRecordSize(s64 now) {
+    if (now - mWriteTime > G_TLS_RECORD_IDLE) {
+        //the congestion window of TCP may be reset after idle
+        mWriteSize = 0;
+    }
+    mWriteTime = now;
+    return (mKTLS || mWriteSize >= G_TLS_RECORD_BOOST) ? G_TLS_RECORD_FULL : G_TLS_RECORD_SMALL;
 }
 
 s32 TlsSession::read(void* buf, s32 len) {
@@ -309,6 +392,142 @@ bool TlsSession::isInitFinished() {
     return 0 != SSL_is_init_finished(mSSL);
 }
 
+StringView TlsSession::getALPN()const {
+    const u8* proto = nullptr;
+    u32 len = 0;
+    SSL_get0_alpn_selected(mSSL, &proto, &len);
+    return StringView(reinterpret_cast<const s8*>(proto), proto ? len : 0);
+}
+
+s32 TlsSession::startKTLS(const void* cryptoInfo) {
+#if defined(DUSE_KTLS)
+    if (!mSock || !cryptoInfo || mCryptoSize > 0) {
+        return 0;
+    }
+    const tls_crypto_info* info = reinterpret_cast<const tls_crypto_info*>(cryptoInfo);
+    u32 len;
+    switch (info->cipher_type) {
+    case TLS_CIPHER_AES_GCM_128:
+        len = sizeof(tls12_crypto_info_aes_gcm_128);
+        break;
+    case TLS_CIPHER_AES_GCM_256:
+        len = sizeof(tls12_crypto_info_aes_gcm_256);
+        break;
+    case TLS_CIPHER_AES_CCM_128:
+        len = sizeof(tls12_crypto_info_aes_ccm_128);
+        break;
+#if defined(TLS_CIPHER_CHACHA20_POLY1305)
+    case TLS_CIPHER_CHACHA20_POLY1305:
+        len = sizeof(tls12_crypto_info_chacha20_poly1305);
+        break;
+#endif
+    default:
+        return 0;
+    }
+    if (len > sizeof(mCryptoInfo)) {
+        return 0;
+    }
+    //fail if module tls is not loaded, the socket sends as usual until TLS_TX is set
+    if (!mKTLS && 0 != setsockopt(mSock->getValue(), SOL_TCP, TCP_ULP, "tls", sizeof("tls"))) {
+        return 0;
+    }
+    memcpy(mCryptoInfo, info, len);
+    mCryptoSize = len;
+    if (0 == mOutBuffers->getSize()) {
+        //nothing to send before, OpenSSL goes on by itself if the cipher is not supported by kernel
+        if (EE_OK != installKTLS()) {
+            return 0;
+        }
+        mKTLS = true;
+        return 1;
+    }
+    //the keys are passed by commitSend() when the buffered bytes are sent
+    if (!pushSegment(mOutBuffers->getSize() - mSegmentBytes, 0, true)) {
+        mCryptoSize = 0;
+        return 0;
+    }
+    mKTLS = true;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+
+s32 TlsSession::installKTLS() {
+#if defined(DUSE_KTLS)
+    s32 ret = setsockopt(mSock->getValue(), SOL_TLS, TLS_TX, mCryptoInfo, mCryptoSize);
+    mCryptoSize = 0;
+    return 0 == ret ? EE_OK : EE_ERROR;
+#else
+    return EE_ERROR;
+#endif
+}
+
+
+bool TlsSession::pushSegment(s32 size, u8 recordType, bool keyAfter) {
+    if (mSegmentCount >= G_MAX_SEGMENTS) {
+        Logger::log(ELL_ERROR, "TlsSession::pushSegment>>too many segments, size=%d", size);
+        return false;
+    }
+    STlsSegment& seg = mSegments[(mSegmentHead + mSegmentCount) % G_MAX_SEGMENTS];
+    seg.mSize = size;
+    seg.mRecordType = recordType;
+    seg.mKeyAfter = keyAfter;
+    ++mSegmentCount;
+    mSegmentBytes += size;
+    return true;
+}
+
+
+s32 TlsSession::writeRecord(u8 recordType, const void* buf, s32 len) {
+    //the bytes buffered before go as they are
+    const s32 before = mOutBuffers->getSize() - mSegmentBytes;
+    if (mSegmentCount + (before > 0 ? 2 : 1) > G_MAX_SEGMENTS) {
+        Logger::log(ELL_ERROR, "TlsSession::writeRecord>>too many segments, type=%u, size=%d", recordType, len);
+        return -1;
+    }
+    if (before > 0) {
+        pushSegment(before, 0, false);
+    }
+    pushSegment(len, recordType, false);
+    mOutBuffers->write(buf, len);
+    return len;
+}
+
+
+s32 TlsSession::getSendLimit(u8& recordType)const {
+    if (0 == mSegmentCount) {
+        recordType = 0;
+        return 0x7FFFFFFF;
+    }
+    const STlsSegment& seg = mSegments[mSegmentHead];
+    recordType = seg.mRecordType;
+    return seg.mSize;
+}
+
+
+s32 TlsSession::commitSend(s32 size) {
+    while (mSegmentCount > 0) {
+        STlsSegment& seg = mSegments[mSegmentHead];
+        const s32 step = AppMin(size, seg.mSize);
+        seg.mSize -= step;
+        mSegmentBytes -= step;
+        size -= step;
+        if (seg.mSize > 0) {
+            break;
+        }
+        mSegmentHead = (mSegmentHead + 1) % G_MAX_SEGMENTS;
+        --mSegmentCount;
+        if (seg.mKeyAfter && EE_OK != installKTLS()) {
+            Logger::log(ELL_ERROR, "TlsSession::commitSend>>fail to pass keys, ecode=%d", System::getError());
+            return EE_ERROR;
+        }
+    }
+    return EE_OK;
+}
+
+
 s32 TlsSession::verify(s32 verify_flags, const s8* hostname) {
     if (!verify_flags) {
         return EE_OK;
@@ -0,0 +1,257 @@
+#include "Net/TlsSessionCache.h"
+#include <openssl/rand.h>
+#include "HashFunctions.h"
+#include "Logger.h"
+#include "Timer.h"
+
+namespace app {
+namespace net {
+
+//max bytes of a serialized session, bigger one(eg: with client cert chain) is not cached
+static const u32 G_TLS_MAX_SESSION = 4 * 1024;
+static const u32 G_TLS_MAX_BUCKETS = 64 * 1024;
+
+struct TlsCacheNode {
+    TlsCacheNode* mHashNext;
+    TlsCacheNode* mPrev;        //LRU list
+    TlsCacheNode* mNext;
+    s64 mExpire;                //timestamp in seconds
+    u32 mHash;
+    u32 mSize;                  //bytes of serialized session
+    u8 mIDLen;
+    u8 mID[32];                 //SSL_MAX_SSL_SESSION_ID_LENGTH
+
+    u8* getData() {
+        return reinterpret_cast<u8*>(this + 1);
+    }
+};
+
+
+TlsSessionCache* TlsSessionCache::create(MemSlabPool& pool, u32 maxCount, u32 timeout, u32 ticketTime) {
+    if (0 == maxCount && 0 == ticketTime) {
+        return nullptr;
+    }
+    u32 bcnt = 16;
+    while (bcnt < maxCount && bcnt < G_TLS_MAX_BUCKETS) {
+        bcnt <<= 1;
+    }
+    void* mem = pool.callocMem(sizeof(TlsSessionCache));
+    TlsCacheNode** buckets = reinterpret_cast<TlsCacheNode**>(pool.callocMem(sizeof(TlsCacheNode*) * bcnt));
+    if (!mem || !buckets) {
+        Logger::log(ELL_ERROR, "TlsSessionCache::create>>no shared mem, buckets=%u", bcnt);
+        if (mem) {
+            pool.freeMem(mem);
+        }
+        if (buckets) {
+            pool.freeMem(buckets);
+        }
+        return nullptr;
+    }
+    return new (mem) TlsSessionCache(pool, buckets, bcnt, maxCount, timeout, ticketTime);
+}
+
+
+TlsSessionCache::TlsSessionCache(MemSlabPool& pool, TlsCacheNode** buckets, u32 bucketCount,
+    u32 maxCount, u32 timeout, u32 ticketTime)
+    : mPool(pool)
+    , mBuckets(buckets)
+    , mHead(nullptr)
+    , mTail(nullptr)
+    , mBucketCount(bucketCount)
+    , mCount(0)
+    , mMaxCount(maxCount)
+    , mTimeout(timeout)
+    , mTicketTime(ticketTime)
+    , mKeyCount(0)
+    , mKeyTime(0) {
+    memset(mKeys, 0, sizeof(mKeys));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+
+TlsCacheNode* TlsSessionCache::find(const u8* sid, u32 sidLen, u32 hash)const {
+    for (TlsCacheNode* nd = mBuckets[hash & (mBucketCount - 1)]; nd; nd = nd->mHashNext) {
+        if (hash == nd->mHash && sidLen == nd->mIDLen && 0 == memcmp(sid, nd->mID, sidLen)) {
+            return nd;
+        }
+    }
+    return nullptr;
+}
+
+
+void TlsSessionCache::unlink(TlsCacheNode* nd) {
+    TlsCacheNode** pos = &mBuckets[nd->mHash & (mBucketCount - 1)];
+    while (*pos != nd) {
+        pos = &(*pos)->mHashNext;
+    }
+    *pos = nd->mHashNext;
+
+    if (nd->mPrev) {
+        nd->mPrev->mNext = nd->mNext;
+    } else {
+        mHead = nd->mNext;
+    }
+    if (nd->mNext) {
+        nd->mNext->mPrev = nd->mPrev;
+    } else {
+        mTail = nd->mPrev;
+    }
+    --mCount;
+    mPool.freeMem(nd);
+}
+
+
+void TlsSessionCache::add(const u8* sid, u32 sidLen, const u8* data, u32 dataLen, s64 expire) {
+    if (0 == mMaxCount || 0 == sidLen || sidLen > sizeof(TlsCacheNode::mID) || dataLen > G_TLS_MAX_SESSION) {
+        return;
+    }
+    const u32 hash = AppHashMurmur32(sid, sidLen);
+    const s64 now = Timer::getTimestamp();
+    CAutoLock<Spinlock> ak(mLock);
+    TlsCacheNode* nd = find(sid, sidLen, hash);
+    if (nd) {
+        unlink(nd);
+    }
+    while (mTail && (mCount >= mMaxCount || mTail->mExpire <= now)) {
+        if (mTail->mExpire > now) {
+            ++mStats.mEvicts;
+        }
+        unlink(mTail);
+    }
+    nd = reinterpret_cast<TlsCacheNode*>(mPool.allocMem(sizeof(TlsCacheNode) + dataLen));
+    while (!nd && mTail) {
+        //shared memory is full
+        ++mStats.mEvicts;
+        unlink(mTail);
+        nd = reinterpret_cast<TlsCacheNode*>(mPool.allocMem(sizeof(TlsCacheNode) + dataLen));
+    }
+    if (!nd) {
+        return;
+    }
+    nd->mExpire = expire;
+    nd->mHash = hash;
+    nd->mSize = dataLen;
+    nd->mIDLen = (u8)sidLen;
+    memcpy(nd->mID, sid, sidLen);
+    memcpy(nd->getData(), data, dataLen);
+
+    TlsCacheNode*& bucket = mBuckets[hash & (mBucketCount - 1)];
+    nd->mHashNext = bucket;
+    bucket = nd;
+
+    nd->mPrev = nullptr;
+    nd->mNext = mHead;
+    if (mHead) {
+        mHead->mPrev = nd;
+    } else {
+        mTail = nd;
+    }
+    mHead = nd;
+    ++mCount;
+    ++mStats.mStores;
+}
+
+
+bool TlsSessionCache::get(const u8* sid, u32 sidLen, Packet& out) {
+    if (0 == mMaxCount || sidLen > sizeof(TlsCacheNode::mID)) {
+        return false;
+    }
+    const u32 hash = AppHashMurmur32(sid, sidLen);
+    CAutoLock<Spinlock> ak(mLock);
+    TlsCacheNode* nd = find(sid, sidLen, hash);
+    if (!nd || nd->mExpire <= Timer::getTimestamp()) {
+        if (nd) {
+            unlink(nd);
+        }
+        ++mStats.mMisses;
+        return false;
+    }
+    if (nd != mHead) {
+        nd->mPrev->mNext = nd->mNext;
+        if (nd->mNext) {
+            nd->mNext->mPrev = nd->mPrev;
+        } else {
+            mTail = nd->mPrev;
+        }
+        nd->mPrev = nullptr;
+        nd->mNext = mHead;
+        mHead->mPrev = nd;
+        mHead = nd;
+    }
+    out.resize(0);
+    out.write(nd->getData(), nd->mSize);
+    ++mStats.mHits;
+    return true;
+}
+
+
+void TlsSessionCache::remove(const u8* sid, u32 sidLen) {
+    if (0 == mMaxCount || sidLen > sizeof(TlsCacheNode::mID)) {
+        return;
+    }
+    const u32 hash = AppHashMurmur32(sid, sidLen);
+    CAutoLock<Spinlock> ak(mLock);
+    TlsCacheNode* nd = find(sid, sidLen, hash);
+    if (nd) {
+        unlink(nd);
+    }
+}
+
+
+bool TlsSessionCache::rotateKey(s64 now) {
+    TlsTicketKey key;
+    if (1 != RAND_bytes(reinterpret_cast<u8*>(&key), sizeof(key))) {
+        Logger::log(ELL_ERROR, "TlsSessionCache::rotateKey>>RAND_bytes fail");
+        return false;
+    }
+    mKeys[1] = mKeys[0];
+    mKeys[0] = key;
+    mKeyCount = mKeyCount < 2 ? mKeyCount + 1 : 2;
+    mKeyTime = now;
+    return true;
+}
+
+
+bool TlsSessionCache::getTicketKey(TlsTicketKey& out) {
+    if (0 == mTicketTime) {
+        return false;
+    }
+    const s64 now = Timer::getTimestamp();
+    CAutoLock<Spinlock> ak(mLock);
+    if ((0 == mKeyCount || now >= mKeyTime + mTicketTime) && !rotateKey(now) && 0 == mKeyCount) {
+        return false;
+    }
+    out = mKeys[0];
+    ++mStats.mTicketNew;
+    return true;
+}
+
+
+s32 TlsSessionCache::findTicketKey(const u8* name, TlsTicketKey& out) {
+    const s64 now = Timer::getTimestamp();
+    CAutoLock<Spinlock> ak(mLock);
+    for (u32 i = 0; i < mKeyCount; ++i) {
+        if (0 == memcmp(name, mKeys[i].mName, sizeof(mKeys[i].mName))) {
+            //the previous key is still valid for one interval after rotation
+            const bool fresh = now < mKeyTime + mTicketTime;
+            if (0 == i || fresh) {
+                out = mKeys[i];
+                ++mStats.mTicketHits;
+                return (0 == i && fresh) ? 1 : 2;
+            }
+            break;
+        }
+    }
+    ++mStats.mTicketMisses;
+    return 0;
+}
+
+
+void TlsSessionCache::getStats(TlsCacheStats& out) {
+    CAutoLock<Spinlock> ak(mLock);
+    out = mStats;
+}
+
+
+}//namespace net
+}//namespace app
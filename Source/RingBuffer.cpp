@@ -84,10 +84,12 @@ s32 RingBuffer::getSize() const {
 }
 
 void RingBuffer::reset() {
-    while (mHeadPos.mNode != mTailPos.mNode) {
-        SRingBufNode* nd = AppPopRingQueueHead_1(mHeadPos.mNode);
+    //keep the tail node only, the queue pops the node after tail
+    while (mTailPos.mNode && mTailPos.mNode->mNext != mTailPos.mNode) {
+        SRingBufNode* nd = AppPopRingQueueHead_1(mTailPos.mNode);
         delete nd;
     }
+    mHeadPos.mNode = mTailPos.mNode;
     mHeadPos.mPosition = 0;
     mTailPos.mPosition = 0;
     mSize = 0;
@@ -253,6 +255,11 @@ StringView RingBuffer::peekHead() {
         ret.mLen = AppMin(len, mSize);
         ret.mData = mHeadPos.mNode->mData + mHeadPos.mPosition;
     } else {
+        if (sizeof(SRingBufNode::mData) == mHeadPos.mPosition) {
+            //the node was consumed before the tail moved to next
+            popFront();
+            return peekHead();
+        }
         s32 len = sizeof(SRingBufNode::mData) - mHeadPos.mPosition;
         DASSERT(len >= 0);
         ret.mLen = (usz)len;
@@ -277,30 +284,32 @@ void RingBuffer::commitHead(s32 used) {
     }
 }
 
-SRingBufPos RingBuffer::peekHeadNode(SRingBufPos pos, StringView* bufs, s32* bufs_count) {
+SRingBufPos RingBuffer::peekHeadNode(SRingBufPos pos, StringView* bufs, s32* bufs_count, s32 max_size) {
     SRingBufPos current = pos;
     s32 count = 0;
     DASSERT(nullptr!=pos.mNode);
 
-    while (count < *bufs_count) {
+    while (count < *bufs_count && max_size > 0) {
         StringView* buf = bufs + count;
-        if (current.mNode == mTailPos.mNode) {
-            s32 len = mTailPos.mPosition - current.mPosition;
-            DASSERT(mTailPos.mPosition >= current.mPosition);
-            if (len != 0) {
-                buf->mLen = (usz)len;
-                buf->mData = current.mNode->mData + current.mPosition;
-                count++;
-            }
+        const bool tail = current.mNode == mTailPos.mNode;
+        s32 len = (tail ? mTailPos.mPosition : (s32)sizeof(SRingBufNode::mData)) - current.mPosition;
+        DASSERT(len >= 0);
+        if (len >= max_size) {
+            //stop in this node
+            buf->mLen = (usz)max_size;
+            buf->mData = current.mNode->mData + current.mPosition;
+            *bufs_count = count + 1;
+            return SRingBufPos(current.mPosition + max_size, current.mNode);
+        }
+        if (len != 0) {
+            buf->mLen = (usz)len;
+            buf->mData = current.mNode->mData + current.mPosition;
+            count++;
+            max_size -= len;
+        }
+        if (tail) {
             *bufs_count = count;
             return mTailPos;
-        } else {
-            s32 len = sizeof(SRingBufNode::mData) - current.mPosition;
-            if (len != 0) {
-                buf->mLen = len;
-                buf->mData = current.mNode->mData + current.mPosition;
-                count++;
-            }
         }
         current.init(0, current.mNode->mNext);
     }
@@ -43,6 +43,18 @@ s32 AppTestRedis(s32 argc, s8** argv);
 s32 AppTestDefault(s32 argc, s8** argv);
 s32 AppTestHttpsClient(s32 argc, s8** argv);
 s32 AppTestFile(s32 argc, s8** argv);
+s32 AppTestHttpParse(s32 argc, s8** argv);
+s32 AppTestRedisBench(s32 argc, s8** argv);
+s32 AppTestMySQLClient(s32 argc, s8** argv);
+s32 AppTestHttpHead(s32 argc, s8** argv);
+s32 AppTestHttpHpack(s32 argc, s8** argv);
+s32 AppTestRingBuffer(s32 argc, s8** argv);
+s32 AppTestHttpRange(s32 argc, s8** argv);
+s32 AppTestFileWrite(s32 argc, s8** argv);
+s32 AppTestRedisEncode(s32 argc, s8** argv);
+s32 AppTestRedisDecode(s32 argc, s8** argv);
+s32 AppTestMySQLDecode(s32 argc, s8** argv);
+s32 AppTestRedisSubscriber(s32 argc, s8** argv);
 #if defined(DUSE_ZLIB)
 s32 AppTestZlib(s32 argc, s8** argv);
 s32 AppTestRingBlocks(s32 argc, s8** argv);
@@ -105,6 +117,33 @@ int main(int argc, char** argv) {
         // exe 8 127.0.0.1:5000 user passowrd
         ret = 5 == argc ? AppTestDBClient(argc, argv) : argc;
         break;
+    case 9:
+        // exe 9 [rounds]
+        ret = AppTestHttpParse(argc, argv);
+        break;
+    case 10:
+        // exe 10 [requests] [latency ms] [nodes]
+        ret = AppTestRedisBench(argc, argv);
+        break;
+    case 11:
+        // exe 11 127.0.0.1:3306 user password [database] [requests] [public key file of server, or get]
+        ret = argc >= 5 ? AppTestMySQLClient(argc, argv) : argc;
+        break;
+    case 12:
+        // exe 12, unit checks, ret = count of failed cases
+        ret = AppTestHttpHead(argc, argv);
+        ret += AppTestHttpHpack(argc, argv);
+        ret += AppTestRingBuffer(argc, argv);
+        ret += AppTestHttpRange(argc, argv);
+        if (0 == eng.getConfig().mMaxProcess) {
+            //the loop of main process is not run if the children are forked, see Engine::init()
+            ret += AppTestFileWrite(argc, argv);
+            ret += AppTestRedisSubscriber(argc, argv);
+        }
+        ret += AppTestRedisEncode(argc, argv);
+        ret += AppTestRedisDecode(argc, argv);
+        ret += AppTestMySQLDecode(argc, argv);
+        break;
     default:
         if (true) {
             AppTestMD5(argc, argv);
@@ -28,7 +28,9 @@ s32 AsyncFile::open(const String& addr, s32 flag) {
     it->mUser = this;
 
     if (6 & flag) {
-        it->mUsed = snprintf(it->mData, it->mAllocated, "from AsyncFile::write");
+        //the bytes of [mUsed, mAllocated) are written
+        it->mAllocated = snprintf(it->mData, it->mAllocated, "from AsyncFile::write");
+        it->mUsed = 0;
         it->mCall = AsyncFile::funcOnWrite;
         if (0 != mHandleFile.write(it)) {
             RequestFD::delRequest(it);
@@ -63,6 +65,7 @@ void AsyncFile::onWrite(RequestFD* it) {
         //test read then
         it->mCall = AsyncFile::funcOnRead;
         it->mUsed = 0;
+        it->mAllocated = 4 * System::getDiskSectorSize();
         if (0 == mHandleFile.read(it)) {
             return;
         }
@@ -0,0 +1,736 @@
+#include "RedisMock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "Engine.h"
+#include "Timer.h"
+#include "Logger.h"
+#include "CheckCRC.h"
+
+namespace app {
+
+static const u32 G_READ_SIZE = 16 * 1024;
+static const s64 G_MAX_BULK = 64 * 1024 * 1024;
+static const s64 G_MAX_ARGS = 1024 * 1024;
+
+
+static void AppAppendStatus(String& out, const s8* msg) {
+    out += '+';
+    out += msg;
+    out.append("\r\n", 2);
+}
+
+static void AppAppendError(String& out, const s8* msg) {
+    out += '-';
+    out += msg;
+    out.append("\r\n", 2);
+}
+
+static void AppAppendHead(String& out, s8 tp, s64 val) {
+    s8 buf[32];
+    s32 len = snprintf(buf, sizeof(buf), "%c%lld\r\n", tp, (long long)val);
+    out.append(buf, len);
+}
+
+static void AppAppendBulk(String& out, const s8* str, usz len) {
+    AppAppendHead(out, '$', len);
+    out.append(str, len);
+    out.append("\r\n", 2);
+}
+
+static void AppAppendNil(String& out) {
+    out.append("$-1\r\n", 5);
+}
+
+//@note the arg is followed by CRLF, so it's safe for strtoll
+static s64 AppArgToS64(const StringView& it) {
+    return strtoll(it.mData, nullptr, 10);
+}
+
+static bool AppEqual(const String& str, const StringView& it) {
+    return str.size() == it.mLen && 0 == memcmp(str.c_str(), it.mData, it.mLen);
+}
+
+//@brief glob of PSUBSCRIBE, '*' and '?' only
+static bool AppMatchGlob(const String& pattern, const StringView& str) {
+    const s8* pat = pattern.c_str();
+    const usz plen = pattern.size();
+    usz p = 0;
+    usz s = 0;
+    usz star = plen;    //position of the last '*'
+    usz from = 0;       //position of str matched by the last '*'
+    while (s < str.mLen) {
+        if (p < plen && ('?' == pat[p] || str.mData[s] == pat[p])) {
+            ++p;
+            ++s;
+        } else if (p < plen && '*' == pat[p]) {
+            star = p++;
+            from = s;
+        } else if (star < plen) {
+            p = star + 1;
+            s = ++from;
+        } else {
+            return false;
+        }
+    }
+    while (p < plen && '*' == pat[p]) {
+        ++p;
+    }
+    return p == plen;
+}
+
+//@brief slot of key, the hash tag is supported
+static u32 AppKeySlot(const StringView& key) {
+    const s8* str = key.mData;
+    usz len = key.mLen;
+    for (usz i = 0; i < len; ++i) {
+        if ('{' == str[i]) {
+            for (usz j = i + 1; j < len; ++j) {
+                if ('}' == str[j]) {
+                    if (j > i + 1) {
+                        str += i + 1;
+                        len = j - i - 1;
+                    }
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    CheckCRC16 crc;
+    return crc.add(str, static_cast<u32>(len)) % RedisMock::G_MAX_SLOT;
+}
+
+
+RedisMockLink::RedisMockLink(RedisMock& mock) :
+    mMock(mock),
+    mNode(0) {
+    mMock.grab();
+    mTCP.setClose(EHT_TCP_LINK, RedisMockLink::funcOnClose, this);
+    //the time gap is set by the acceptor
+    mTCP.setTime(RedisMockLink::funcOnTime, 1000, 1000, -1);
+}
+
+
+RedisMockLink::~RedisMockLink() {
+    mMock.drop();
+}
+
+
+void RedisMockLink::onLink(RequestFD* it) {
+    net::Acceptor* accp = (net::Acceptor*)(it->mUser);
+    RequestAccept& req = *(RequestAccept*)it;
+    mNode = mMock.getNode(accp);
+    RequestFD* nd = RequestFD::newRequest(G_READ_SIZE);
+    nd->mUser = this;
+    nd->mCall = RedisMockLink::funcOnRead;
+    s32 ret = mTCP.open(req, nd);
+    if (EE_OK == ret) {
+        mTCP.getSock().setDelay(false); //as redis server
+        grab(); //dropped in onClose
+        mMock.bind(this);
+    } else {
+        RequestFD::delRequest(nd);
+        Logger::log(ELL_ERROR, "RedisMockLink::onLink>> [%s->%s], ecode=%d",
+            mTCP.getRemote().getStr(), mTCP.getLocal().getStr(), ret);
+    }
+}
+
+
+s32 RedisMockLink::onTimeout(HandleTime& it) {
+    if (0 == mMarks.size()) {
+        return EE_OK;
+    }
+    const s64 now = Timer::getRelativeTime();
+    usz cnt = 0;
+    while (cnt < mMarks.size() && mMarks[cnt].mTime <= now) {
+        ++cnt;
+    }
+    if (cnt > 0) {
+        const usz len = mMarks[cnt - 1].mEnd;
+        mMarks.erase(0, cnt);
+        for (usz i = 0; i < mMarks.size(); ++i) {
+            mMarks[i].mEnd -= len;
+        }
+        if (!flush(len)) {
+            return EE_ERROR;
+        }
+    }
+    return EE_OK;
+}
+
+
+void RedisMockLink::onClose(Handle* it) {
+    mMock.unbind(this);
+    drop();
+}
+
+
+void RedisMockLink::onRead(RequestFD* it) {
+    if (it->mUsed > 0) {
+        usz parsed = 0;
+        ssz step;
+        while ((step = parseCommand(it->mData + parsed, it->mUsed - parsed)) > 0) {
+            parsed += step;
+            if (!execSubscribe()) {
+                mMock.exec(mNode, mArgs, mOut);
+            }
+            mark();
+        }
+        if (step < 0) {
+            Logger::log(ELL_ERROR, "RedisMockLink::onRead>>bad command, remote=%s",
+                mTCP.getRemote().getStr());
+            RequestFD::delRequest(it);
+            mTCP.launchClose();
+            return;
+        }
+        it->clearData(static_cast<u32>(parsed));
+        if (0 == it->getWriteSize()) {
+            //a large command
+            RequestFD* nd = RequestFD::newRequest(it->mAllocated * 2);
+            memcpy(nd->mData, it->mData, it->mUsed);
+            nd->mUsed = it->mUsed;
+            nd->mUser = it->mUser;
+            nd->mCall = it->mCall;
+            RequestFD::delRequest(it);
+            it = nd;
+        }
+        if (0 == mMock.getLatency() && mOut.size() > 0 && !flush(mOut.size())) {
+            RequestFD::delRequest(it);
+            mTCP.launchClose();
+            return;
+        }
+        if (EE_OK == mTCP.read(it)) {
+            return;
+        }
+    }
+    RequestFD::delRequest(it);
+}
+
+
+void RedisMockLink::onWrite(RequestFD* it) {
+    if (0 != it->mError) {
+        Logger::log(ELL_ERROR, "RedisMockLink::onWrite>>remote=%s, ecode=%d",
+            mTCP.getRemote().getStr(), it->mError);
+    }
+    RequestFD::delRequest(it);
+}
+
+
+void RedisMockLink::mark() {
+    if (mMock.getLatency() > 0) {
+        Mark mk = {mOut.size(), Timer::getRelativeTime() + mMock.getLatency()};
+        mMarks.pushBack(mk);
+    }
+}
+
+
+bool RedisMockLink::execSubscribe() {
+    const StringView& cmd = mArgs[0];
+    bool pattern;
+    bool add;
+    if (9 == cmd.mLen && 0 == AppStrNocaseCMP(cmd.mData, "SUBSCRIBE", 9)) {
+        pattern = false;
+        add = true;
+    } else if (10 == cmd.mLen && 0 == AppStrNocaseCMP(cmd.mData, "PSUBSCRIBE", 10)) {
+        pattern = true;
+        add = true;
+    } else if (11 == cmd.mLen && 0 == AppStrNocaseCMP(cmd.mData, "UNSUBSCRIBE", 11)) {
+        pattern = false;
+        add = false;
+    } else if (12 == cmd.mLen && 0 == AppStrNocaseCMP(cmd.mData, "PUNSUBSCRIBE", 12)) {
+        pattern = true;
+        add = false;
+    } else {
+        return false;
+    }
+    if (add && mArgs.size() < 2) {
+        AppAppendError(mOut, "ERR wrong number of arguments");
+        return true;
+    }
+    TVector<String>& subs = pattern ? mPatterns : mChannels;
+    const s8* kind = add ? (pattern ? "psubscribe" : "subscribe") : (pattern ? "punsubscribe" : "unsubscribe");
+    const usz klen = strlen(kind);
+    if (1 == mArgs.size()) {
+        //unsubscribe all, or reply a nil channel if none
+        if (0 == subs.size()) {
+            AppAppendHead(mOut, '*', 3);
+            AppAppendBulk(mOut, kind, klen);
+            AppAppendNil(mOut);
+            AppAppendHead(mOut, ':', getSubscribeCount());
+        }
+        while (subs.size() > 0) {
+            String name = subs[subs.size() - 1];
+            subs.resize(subs.size() - 1);
+            AppAppendHead(mOut, '*', 3);
+            AppAppendBulk(mOut, kind, klen);
+            AppAppendBulk(mOut, name.c_str(), name.size());
+            AppAppendHead(mOut, ':', getSubscribeCount());
+        }
+        return true;
+    }
+    for (usz i = 1; i < mArgs.size(); ++i) {
+        usz pos = 0;
+        while (pos < subs.size() && !AppEqual(subs[pos], mArgs[i])) {
+            ++pos;
+        }
+        if (add && pos == subs.size()) {
+            subs.pushBack(String(mArgs[i]));
+        } else if (!add && pos < subs.size()) {
+            subs.erase(pos);
+        }
+        AppAppendHead(mOut, '*', 3);
+        AppAppendBulk(mOut, kind, klen);
+        AppAppendBulk(mOut, mArgs[i].mData, mArgs[i].mLen);
+        AppAppendHead(mOut, ':', getSubscribeCount());
+    }
+    return true;
+}
+
+
+u32 RedisMockLink::push(const StringView& channel, const StringView& msg) {
+    u32 ret = 0;
+    for (usz i = 0; i < mChannels.size(); ++i) {
+        if (AppEqual(mChannels[i], channel)) {
+            AppAppendHead(mOut, '*', 3);
+            AppAppendBulk(mOut, "message", 7);
+            AppAppendBulk(mOut, channel.mData, channel.mLen);
+            AppAppendBulk(mOut, msg.mData, msg.mLen);
+            ++ret;
+        }
+    }
+    for (usz i = 0; i < mPatterns.size(); ++i) {
+        if (AppMatchGlob(mPatterns[i], channel)) {
+            AppAppendHead(mOut, '*', 4);
+            AppAppendBulk(mOut, "pmessage", 8);
+            AppAppendBulk(mOut, mPatterns[i].c_str(), mPatterns[i].size());
+            AppAppendBulk(mOut, channel.mData, channel.mLen);
+            AppAppendBulk(mOut, msg.mData, msg.mLen);
+            ++ret;
+        }
+    }
+    if (ret > 0) {
+        mark();
+        if (0 == mMock.getLatency() && !flush(mOut.size())) {
+            mTCP.launchClose();
+        }
+    }
+    return ret;
+}
+
+
+bool RedisMockLink::flush(usz len) {
+    RequestFD* out = RequestFD::newRequest(static_cast<u32>(len));
+    memcpy(out->mData, mOut.c_str(), len);
+    out->mUsed = static_cast<u32>(len);
+    out->mUser = this;
+    out->mCall = RedisMockLink::funcOnWrite;
+    if (len == mOut.size()) {
+        mOut.setLen(0);
+    } else {
+        mOut = mOut.subString(len, mOut.size() - len);
+    }
+    if (EE_OK != mTCP.write(out)) {
+        RequestFD::delRequest(out);
+        return false;
+    }
+    return true;
+}
+
+
+ssz RedisMockLink::parseCommand(const s8* buf, usz len) {
+    const s8* const end = buf + len;
+    const s8* pos = buf;
+    if (pos >= end) {
+        return 0;
+    }
+    if ('*' != *pos) {
+        return -1;
+    }
+    const s8* eol = (const s8*)memchr(pos, '\n', end - pos);
+    if (!eol) {
+        return 0;
+    }
+    const s64 cnt = strtoll(pos + 1, nullptr, 10);
+    if (cnt <= 0 || cnt > G_MAX_ARGS) {
+        return -1;
+    }
+    pos = eol + 1;
+    mArgs.resize(0);
+    for (s64 i = 0; i < cnt; ++i) {
+        if (pos >= end) {
+            return 0;
+        }
+        if ('$' != *pos) {
+            return -1;
+        }
+        eol = (const s8*)memchr(pos, '\n', end - pos);
+        if (!eol) {
+            return 0;
+        }
+        const s64 vlen = strtoll(pos + 1, nullptr, 10);
+        if (vlen < 0 || vlen > G_MAX_BULK) {
+            return -1;
+        }
+        pos = eol + 1;
+        if (end - pos < vlen + 2) {
+            return 0;
+        }
+        if ('\r' != pos[vlen] || '\n' != pos[vlen + 1]) {
+            return -1;
+        }
+        mArgs.pushBack(StringView(pos, static_cast<usz>(vlen)));
+        pos += vlen + 2;
+    }
+    return pos - buf;
+}
+
+
+
+RedisMock::RedisMock(Loop& loop) :
+    mLoop(loop),
+    mLatency(0),
+    mCommands(0),
+    mMoved(0),
+    mPort(0) {
+    memset(mSlots, 0, sizeof(mSlots));
+}
+
+
+RedisMock::~RedisMock() {
+    DASSERT(mLinks.empty());
+    TMap<String, Value*>::Iterator it = mStore.getIterator();
+    for (; !it.atEnd(); it++) {
+        delete it->getValue();
+    }
+    mStore.clear();
+}
+
+
+s32 RedisMock::open(const s8* ip, u16 port, u32 nodes) {
+    if (mAcceptors.size() > 0) {
+        return EE_ERROR;
+    }
+    nodes = AppClamp(nodes, 1U, 255U);
+    mIP = ip;
+    mPort = port;
+    for (u32 i = 0; i < G_MAX_SLOT; ++i) {
+        mSlots[i] = static_cast<u8>(i * nodes / G_MAX_SLOT);
+    }
+    s8 addr[64];
+    for (u32 i = 0; i < nodes; ++i) {
+        snprintf(addr, sizeof(addr), "%s:%u", ip, port + i);
+        net::Acceptor* nd = new net::Acceptor(mLoop, RedisMock::funcOnLink, this);
+        //the delayed replies are checked every ms
+        nd->setTimeout(mLatency > 0 ? 1 : 30 * 1000);
+        if (EE_OK != nd->open(addr)) {
+            Logger::log(ELL_ERROR, "RedisMock::open>>fail to listen=%s", addr);
+            nd->drop();
+            close();
+            return EE_ERROR;
+        }
+        mAcceptors.pushBack(nd);
+    }
+    Logger::log(ELL_INFO, "RedisMock::open>>listen=%s:%u, nodes=%u, latency=%lld",
+        ip, port, nodes, mLatency);
+    return EE_OK;
+}
+
+
+void RedisMock::close() {
+    for (usz i = 0; i < mAcceptors.size(); ++i) {
+        mAcceptors[i]->close(); //dropped by itself when closed
+    }
+    mAcceptors.clear();
+    for (Node2* nd = mLinks.getNext(); nd != &mLinks; nd = nd->getNext()) {
+        static_cast<RedisMockLink*>(nd)->close();
+    }
+}
+
+
+u32 RedisMock::publish(const StringView& channel, const StringView& msg) {
+    u32 ret = 0;
+    for (Node2* nd = mLinks.getNext(); nd != &mLinks; nd = nd->getNext()) {
+        ret += static_cast<RedisMockLink*>(nd)->push(channel, msg);
+    }
+    return ret;
+}
+
+
+u32 RedisMock::getSubscribeCount()const {
+    u32 ret = 0;
+    for (const Node2* nd = mLinks.getNext(); nd != &mLinks; nd = nd->getNext()) {
+        ret += static_cast<const RedisMockLink*>(nd)->getSubscribeCount();
+    }
+    return ret;
+}
+
+
+void RedisMock::moveSlots(u32 first, u32 last, u32 node) {
+    if (node >= mAcceptors.size()) {
+        return;
+    }
+    for (; first <= last && first < G_MAX_SLOT; ++first) {
+        mSlots[first] = static_cast<u8>(node);
+    }
+}
+
+
+u32 RedisMock::getNode(const net::Acceptor* it)const {
+    for (usz i = 0; i < mAcceptors.size(); ++i) {
+        if (it == mAcceptors[i]) {
+            return static_cast<u32>(i);
+        }
+    }
+    return 0;
+}
+
+
+void RedisMock::bind(RedisMockLink* it) {
+    mLinks.pushBack(*it);
+}
+
+
+void RedisMock::unbind(RedisMockLink* it) {
+    it->delink();
+}
+
+
+bool RedisMock::checkSlot(u32 node, const StringView& key, String& out) {
+    if (mAcceptors.size() < 2) {
+        return true;
+    }
+    const u32 slot = AppKeySlot(key);
+    if (mSlots[slot] == node) {
+        return true;
+    }
+    ++mMoved;
+    s8 buf[128];
+    s32 len = snprintf(buf, sizeof(buf), "-MOVED %u %s:%u\r\n", slot, mIP.c_str(), mPort + mSlots[slot]);
+    out.append(buf, len);
+    return false;
+}
+
+
+RedisMock::Value* RedisMock::getValue(const StringView& key, EValueType tp, String& out) {
+    TMap<String, Value*>::Node* nd = mStore.find(String(key));
+    if (!nd) {
+        return nullptr;
+    }
+    if (tp != nd->getValue()->mType) {
+        AppAppendError(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+        return nullptr;
+    }
+    return nd->getValue();
+}
+
+
+RedisMock::Value* RedisMock::getOrAdd(const StringView& key, EValueType tp, String& out) {
+    String kk(key);
+    TMap<String, Value*>::Node* nd = mStore.find(kk);
+    if (nd) {
+        if (tp != nd->getValue()->mType) {
+            AppAppendError(out, "WRONGTYPE Operation against a key holding the wrong kind of value");
+            return nullptr;
+        }
+        return nd->getValue();
+    }
+    Value* val = new Value();
+    val->mType = tp;
+    mStore.insert(kk, val);
+    return val;
+}
+
+
+void RedisMock::replySlots(String& out) {
+    u32 cnt = 0;
+    for (u32 i = 0; i < G_MAX_SLOT; ++i) {
+        if (0 == i || mSlots[i] != mSlots[i - 1]) {
+            ++cnt;
+        }
+    }
+    AppAppendHead(out, '*', cnt);
+    s8 nid[64];
+    for (u32 i = 0; i < G_MAX_SLOT;) {
+        u32 last = i;
+        while (last + 1 < G_MAX_SLOT && mSlots[last + 1] == mSlots[i]) {
+            ++last;
+        }
+        AppAppendHead(out, '*', 3);
+        AppAppendHead(out, ':', i);
+        AppAppendHead(out, ':', last);
+        AppAppendHead(out, '*', 3);
+        AppAppendBulk(out, mIP.c_str(), mIP.size());
+        AppAppendHead(out, ':', mPort + mSlots[i]);
+        s32 len = snprintf(nid, sizeof(nid), "mock%u", mSlots[i]);
+        AppAppendBulk(out, nid, len);
+        i = last + 1;
+    }
+}
+
+
+void RedisMock::exec(u32 node, const TVector<StringView>& argv, String& out) {
+    ++mCommands;
+    const usz argc = argv.size();
+    s8 cmd[16];
+    if (argv[0].mLen >= sizeof(cmd)) {
+        AppAppendError(out, "ERR unknown command");
+        return;
+    }
+    memcpy(cmd, argv[0].mData, argv[0].mLen);
+    cmd[argv[0].mLen] = 0;
+    AppStr2Upper(cmd, argv[0].mLen);
+
+    if (0 == strcmp(cmd, "GET")) {
+        if (2 != argc) {
+            AppAppendError(out, "ERR wrong number of arguments for 'get' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            usz pos = out.size();
+            Value* val = getValue(argv[1], EVT_STRING, out);
+            if (val) {
+                AppAppendBulk(out, val->mStr.c_str(), val->mStr.size());
+            } else if (pos == out.size()) {
+                AppAppendNil(out);
+            }
+        }
+    } else if (0 == strcmp(cmd, "SET")) {
+        if (argc < 3) {
+            AppAppendError(out, "ERR wrong number of arguments for 'set' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            String kk(argv[1]);
+            TMap<String, Value*>::Node* nd = mStore.find(kk);
+            Value* val = nd ? nd->getValue() : new Value();
+            if (!nd) {
+                mStore.insert(kk, val);
+            }
+            //SET overwrites the key of any type
+            val->mType = EVT_STRING;
+            val->mHash.clear();
+            val->mList.clear();
+            val->mStr = argv[2];
+            AppAppendStatus(out, "OK");
+        }
+    } else if (0 == strcmp(cmd, "MGET")) {
+        if (argc < 2) {
+            AppAppendError(out, "ERR wrong number of arguments for 'mget' command");
+            return;
+        }
+        if (mAcceptors.size() > 1) {
+            const u32 slot = AppKeySlot(argv[1]);
+            for (usz i = 2; i < argc; ++i) {
+                if (slot != AppKeySlot(argv[i])) {
+                    AppAppendError(out, "CROSSSLOT Keys in request don't hash to the same slot");
+                    return;
+                }
+            }
+            if (!checkSlot(node, argv[1], out)) {
+                return;
+            }
+        }
+        AppAppendHead(out, '*', argc - 1);
+        for (usz i = 1; i < argc; ++i) {
+            TMap<String, Value*>::Node* nd = mStore.find(String(argv[i]));
+            if (nd && EVT_STRING == nd->getValue()->mType) {
+                AppAppendBulk(out, nd->getValue()->mStr.c_str(), nd->getValue()->mStr.size());
+            } else {
+                AppAppendNil(out);
+            }
+        }
+    } else if (0 == strcmp(cmd, "HSET")) {
+        if (argc < 4 || 0 != (argc & 1)) {
+            AppAppendError(out, "ERR wrong number of arguments for 'hset' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            Value* val = getOrAdd(argv[1], EVT_HASH, out);
+            if (val) {
+                s64 added = 0;
+                for (usz i = 2; i < argc; i += 2) {
+                    String fd(argv[i]);
+                    TMap<String, String>::Node* nd = val->mHash.find(fd);
+                    if (nd) {
+                        nd->getValue() = argv[i + 1];
+                    } else {
+                        val->mHash.insert(fd, String(argv[i + 1]));
+                        ++added;
+                    }
+                }
+                AppAppendHead(out, ':', added);
+            }
+        }
+    } else if (0 == strcmp(cmd, "HGET")) {
+        if (3 != argc) {
+            AppAppendError(out, "ERR wrong number of arguments for 'hget' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            usz pos = out.size();
+            Value* val = getValue(argv[1], EVT_HASH, out);
+            TMap<String, String>::Node* nd = val ? val->mHash.find(String(argv[2])) : nullptr;
+            if (nd) {
+                AppAppendBulk(out, nd->getValue().c_str(), nd->getValue().size());
+            } else if (pos == out.size()) {
+                AppAppendNil(out);
+            }
+        }
+    } else if (0 == strcmp(cmd, "LPUSH")) {
+        if (argc < 3) {
+            AppAppendError(out, "ERR wrong number of arguments for 'lpush' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            Value* val = getOrAdd(argv[1], EVT_LIST, out);
+            if (val) {
+                for (usz i = 2; i < argc; ++i) {
+                    val->mList.pushBack(String(argv[i]));
+                }
+                AppAppendHead(out, ':', val->mList.size());
+            }
+        }
+    } else if (0 == strcmp(cmd, "LRANGE")) {
+        if (4 != argc) {
+            AppAppendError(out, "ERR wrong number of arguments for 'lrange' command");
+        } else if (checkSlot(node, argv[1], out)) {
+            usz pos = out.size();
+            Value* val = getValue(argv[1], EVT_LIST, out);
+            if (pos != out.size()) {
+                return;
+            }
+            const s64 cnt = val ? static_cast<s64>(val->mList.size()) : 0;
+            s64 start = AppArgToS64(argv[2]);
+            s64 stop = AppArgToS64(argv[3]);
+            start = start < 0 ? AppMax<s64>(start + cnt, 0) : start;
+            stop = stop < 0 ? stop + cnt : AppMin<s64>(stop, cnt - 1);
+            if (start > stop) {
+                AppAppendHead(out, '*', 0);
+                return;
+            }
+            AppAppendHead(out, '*', stop - start + 1);
+            for (; start <= stop; ++start) {
+                const String& str = val->mList[cnt - 1 - start];
+                AppAppendBulk(out, str.c_str(), str.size());
+            }
+        }
+    } else if (0 == strcmp(cmd, "CLUSTER")) {
+        if (2 == argc && 5 == argv[1].mLen && 0 == AppStrNocaseCMP(argv[1].mData, "SLOTS", 5)) {
+            if (mAcceptors.size() > 1) {
+                replySlots(out);
+            } else {
+                AppAppendError(out, "ERR This instance has cluster support disabled");
+            }
+        } else {
+            AppAppendError(out, "ERR unknown subcommand of 'cluster'");
+        }
+    } else if (0 == strcmp(cmd, "PUBLISH")) {
+        if (3 != argc) {
+            AppAppendError(out, "ERR wrong number of arguments for 'publish' command");
+        } else {
+            AppAppendHead(out, ':', publish(argv[1], argv[2]));
+        }
+    } else if (0 == strcmp(cmd, "PING")) {
+        if (argc > 1) {
+            AppAppendBulk(out, argv[1].mData, argv[1].mLen);
+        } else {
+            AppAppendStatus(out, "PONG");
+        }
+    } else if (0 == strcmp(cmd, "AUTH") || 0 == strcmp(cmd, "SELECT") || 0 == strcmp(cmd, "READONLY")) {
+        AppAppendStatus(out, "OK");
+    } else {
+        AppAppendError(out, "ERR unknown command");
+    }
+}
+
+} //namespace app
@@ -0,0 +1,221 @@
+#ifndef APP_REDISMOCK_H
+#define	APP_REDISMOCK_H
+
+#include "RefCount.h"
+#include "Node.h"
+#include "TMap.h"
+#include "TVector.h"
+#include "Strings.h"
+#include "Net/Acceptor.h"
+#include "Net/HandleTCP.h"
+
+namespace app {
+
+class RedisMock;
+
+
+/**
+ * @brief a connection of RedisMock, it parses RESP commands and writes the replies in order.
+ *        With latency, a reply is held until it's due on the timer of connection.
+ *        The (P)SUBSCRIBE & (P)UNSUBSCRIBE are kept by connection, see RedisMock::publish().
+ */
+class RedisMockLink : public Node2, public RefCount {
+public:
+    RedisMockLink(RedisMock& mock);
+
+    virtual ~RedisMockLink();
+
+    void onLink(RequestFD* it);
+
+    void close() {
+        mTCP.launchClose();
+    }
+
+    //@return count of messages sent, one for the channel and one for each pattern matched.
+    u32 push(const StringView& channel, const StringView& msg);
+
+    u32 getSubscribeCount()const {
+        return static_cast<u32>(mChannels.size() + mPatterns.size());
+    }
+
+private:
+    struct Mark {
+        usz mEnd;   //end of the reply in mOut
+        s64 mTime;  //due time, ms
+    };
+
+    s32 onTimeout(HandleTime& it);
+
+    void onClose(Handle* it);
+
+    void onRead(RequestFD* it);
+
+    void onWrite(RequestFD* it);
+
+    //@return bytes of a whole command, 0 if partial, -1 if bad
+    ssz parseCommand(const s8* buf, usz len);
+
+    //@brief write the heading bytes of mOut
+    bool flush(usz len);
+
+    //@brief hold the reply of a command till it's due, if latency
+    void mark();
+
+    //@return false if mArgs is not a command of subscription, else it's replied.
+    bool execSubscribe();
+
+    static s32 funcOnTime(HandleTime* it) {
+        RedisMockLink& nd = *(RedisMockLink*)it->getUser();
+        return nd.onTimeout(*it);
+    }
+
+    static void funcOnClose(Handle* it) {
+        RedisMockLink& nd = *(RedisMockLink*)it->getUser();
+        nd.onClose(it);
+    }
+
+    static void funcOnRead(RequestFD* it) {
+        RedisMockLink& nd = *(RedisMockLink*)it->mUser;
+        nd.onRead(it);
+    }
+
+    static void funcOnWrite(RequestFD* it) {
+        RedisMockLink& nd = *(RedisMockLink*)it->mUser;
+        nd.onWrite(it);
+    }
+
+    RedisMock& mMock;
+    u32 mNode;
+    net::HandleTCP mTCP;
+    String mOut;
+    TVector<Mark> mMarks;
+    TVector<StringView> mArgs;
+    TVector<String> mChannels;
+    TVector<String> mPatterns;
+};
+
+
+/**
+ * @brief an in-process redis server for tests and benchmarks, keys are kept in memory.
+ *        Commands: PING, AUTH, SELECT, READONLY, GET, SET, MGET, HGET, HSET, LPUSH, LRANGE, CLUSTER SLOTS,
+ *        PUBLISH, SUBSCRIBE, PSUBSCRIBE, UNSUBSCRIBE, PUNSUBSCRIBE, the patterns support '*' and '?' only.
+ *        In cluster mode, N nodes listen on consecutive ports and share one store, node i
+ *        owns the slots [i*16384/N, (i+1)*16384/N), a key of other node is replied with MOVED.
+ */
+class RedisMock : public RefCount {
+public:
+    RedisMock(Loop& loop);
+
+    virtual ~RedisMock();
+
+    /**
+     * @param ip listen IP.
+     * @param port listen port of the 1st node.
+     * @param nodes count of nodes, 1 to disable cluster.
+     */
+    s32 open(const s8* ip, u16 port, u32 nodes = 1);
+
+    //@brief stop listening and close all connections.
+    void close();
+
+    //@param ms the delay of replies, 0 to reply at once, call it before open().
+    void setLatency(s64 ms) {
+        mLatency = ms > 0 ? ms : 0;
+    }
+
+    s64 getLatency()const {
+        return mLatency;
+    }
+
+    /**
+     * @brief move the slots to another node, the clients get MOVED for keys of them.
+     * @param first first slot.
+     * @param last last slot, included.
+     * @param node new owner.
+     */
+    void moveSlots(u32 first, u32 last, u32 node);
+
+    u64 getCommandCount()const {
+        return mCommands;
+    }
+
+    u64 getMovedCount()const {
+        return mMoved;
+    }
+
+    u32 getNodeCount()const {
+        return static_cast<u32>(mAcceptors.size());
+    }
+
+    bool hasLink()const {
+        return !mLinks.empty();
+    }
+
+    /**
+     * @brief send a message to the connections which subscribe the channel, as PUBLISH.
+     * @return count of receivers.
+     */
+    u32 publish(const StringView& channel, const StringView& msg);
+
+    //@return count of channels and patterns subscribed by all connections
+    u32 getSubscribeCount()const;
+
+    //@return index of node which accepts the link
+    u32 getNode(const net::Acceptor* it)const;
+
+    //@brief run a command of node, the reply is appended to out
+    void exec(u32 node, const TVector<StringView>& argv, String& out);
+
+    void bind(RedisMockLink* it);
+
+    void unbind(RedisMockLink* it);
+
+    static void funcOnLink(RequestFD* it) {
+        RedisMockLink* con = new RedisMockLink(*(RedisMock*)((net::Acceptor*)it->mUser)->getUser());
+        con->onLink(it);
+        con->drop();
+    }
+
+    static const u32 G_MAX_SLOT = 16384;
+
+private:
+    enum EValueType {
+        EVT_STRING,
+        EVT_HASH,
+        EVT_LIST
+    };
+
+    struct Value {
+        EValueType mType;
+        String mStr;
+        TMap<String, String> mHash;
+        TVector<String> mList;  //in reversed order, the head of list is the last one
+    };
+
+    //@return true if the key is owned by node, else a MOVED is replied
+    bool checkSlot(u32 node, const StringView& key, String& out);
+
+    //@return null if not exist, or the type is not tp and a WRONGTYPE is replied
+    Value* getValue(const StringView& key, EValueType tp, String& out);
+
+    Value* getOrAdd(const StringView& key, EValueType tp, String& out);
+
+    void replySlots(String& out);
+
+    Loop& mLoop;
+    s64 mLatency;
+    u64 mCommands;
+    u64 mMoved;
+    u16 mPort;
+    String mIP;
+    Node2 mLinks;
+    TVector<net::Acceptor*> mAcceptors;
+    u8 mSlots[G_MAX_SLOT];  //owner node of slot
+    TMap<String, Value*> mStore;
+};
+
+
+} //namespace app
+
+
+#endif //APP_REDISMOCK_H
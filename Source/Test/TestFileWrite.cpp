@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <string.h>
+#include "Engine.h"
+#include "HandleFile.h"
+#include "System.h"
+#if defined(DOS_LINUX)
+#include <signal.h>
+#include <sys/resource.h>
+#endif
+
+namespace app {
+
+#if defined(DOS_LINUX)
+//the file size limit of process while the first write, far over the other files of process,
+//the block is written at G_PARTIAL_LIMIT - G_PARTIAL_CUT, so the write is cut short after G_PARTIAL_CUT bytes
+static const u64 G_PARTIAL_LIMIT = 1ULL << 36;
+static const u32 G_PARTIAL_CUT = 1000;
+static const u32 G_PARTIAL_SIZE = 4096;
+static const u64 G_PARTIAL_OFFSET = G_PARTIAL_LIMIT - G_PARTIAL_CUT;
+
+struct PartialWrite {
+    HandleFile mFile;
+    struct rlimit mLimit;
+    u32 mFirstUsed;
+    s32 mCalls;
+    bool mDone;
+    bool mClosed;
+};
+
+static void AppOnPartialWrite(RequestFD* it) {
+    PartialWrite& nd = *(PartialWrite*)it->mUser;
+    if (1 == ++nd.mCalls) {
+        nd.mFirstUsed = it->mUsed;
+        setrlimit(RLIMIT_FSIZE, &nd.mLimit);
+        //resume at the end of written bytes, as HttpFileSave does
+        if (0 == it->mError && it->mUsed > 0 && it->mUsed < it->mAllocated
+            && EE_OK == nd.mFile.write(it, G_PARTIAL_OFFSET + it->mUsed)) {
+            return;
+        }
+    }
+    nd.mDone = true;
+}
+
+static void AppOnPartialClose(Handle* it) {
+    PartialWrite& nd = *(PartialWrite*)it->getUser();
+    nd.mClosed = true;
+}
+
+
+//blocks written one by one, each write starts with mUsed = 0 and mAllocated = size of block
+static const u32 G_BLOCK_SIZE = 3000;
+static const u32 G_BLOCK_COUNT = 5;
+
+struct RoundTrip {
+    HandleFile mFile;
+    usz mOffset;
+    u32 mBlock;
+    s32 mError;
+    bool mDone;
+    bool mClosed;
+};
+
+static void AppFillBlock(RequestFD* it, u32 block) {
+    it->mAllocated = G_BLOCK_SIZE;
+    it->mUsed = 0;
+    for (u32 i = 0; i < G_BLOCK_SIZE; ++i) {
+        it->mData[i] = (s8)((block * G_BLOCK_SIZE + i) % 251);
+    }
+}
+
+static void AppOnRoundWrite(RequestFD* it) {
+    RoundTrip& nd = *(RoundTrip*)it->mUser;
+    if (it->mError || 0 == it->mUsed) {
+        nd.mError = it->mError ? it->mError : -1;
+        nd.mDone = true;
+        return;
+    }
+    if (it->mUsed < it->mAllocated) {
+        if (EE_OK != nd.mFile.write(it, nd.mOffset + it->mUsed)) {
+            nd.mDone = true;
+        }
+        return;
+    }
+    nd.mOffset += it->mUsed;
+    if (++nd.mBlock >= G_BLOCK_COUNT) {
+        nd.mDone = true;
+        return;
+    }
+    AppFillBlock(it, nd.mBlock);
+    if (EE_OK != nd.mFile.write(it, nd.mOffset)) {
+        nd.mDone = true;
+    }
+}
+
+static void AppOnRoundRead(RequestFD* it) {
+    RoundTrip& nd = *(RoundTrip*)it->mUser;
+    if (it->mError || it->mUsed == nd.mOffset || it->mUsed == it->mAllocated) {
+        nd.mError = it->mError;
+        nd.mDone = true;
+        return;
+    }
+    //read on till EOF, the read got 0 byte
+    nd.mOffset = it->mUsed;
+    if (EE_OK != nd.mFile.read(it, it->mUsed)) {
+        nd.mDone = true;
+    }
+}
+
+static void AppOnRoundClose(Handle* it) {
+    RoundTrip& nd = *(RoundTrip*)it->getUser();
+    nd.mClosed = true;
+}
+
+
+//@brief write blocks by HandleFile, then read the file back by HandleFile
+static s32 AppTestFileRoundTrip(Loop& loop, const String& fname) {
+    s32 fails = 0;
+    RoundTrip nd;
+    nd.mOffset = 0;
+    nd.mBlock = 0;
+    nd.mError = 0;
+    nd.mDone = false;
+    nd.mClosed = false;
+    nd.mFile.setClose(EHT_FILE, AppOnRoundClose, &nd);
+    if (EE_OK != nd.mFile.open(fname, 6) || !nd.mFile.setFileSize(0)) {
+        printf("AppTestFileWrite>>round trip open fail, file=%s\n", fname.c_str());
+        return 1;
+    }
+    const u32 total = G_BLOCK_SIZE * G_BLOCK_COUNT;
+    RequestFD* req = RequestFD::newRequest(total + 1);
+    req->mUser = &nd;
+    req->mCall = AppOnRoundWrite;
+    AppFillBlock(req, 0);
+    if (EE_OK != nd.mFile.write(req, 0)) {
+        nd.mDone = true;
+    }
+    while (!nd.mDone && loop.run()) {
+    }
+    if (nd.mError || G_BLOCK_COUNT != nd.mBlock || total != nd.mOffset) {
+        printf("AppTestFileWrite>>round trip write fail, blocks=%u, size=%u, ecode=%d\n",
+            nd.mBlock, (u32)nd.mOffset, nd.mError);
+        ++fails;
+    }
+
+    //one byte more than the file, so the last read is short
+    memset(req->mData, 0, total + 1);
+    req->mAllocated = total + 1;
+    req->mUsed = 0;
+    req->mCall = AppOnRoundRead;
+    nd.mOffset = 0;
+    nd.mError = 0;
+    nd.mDone = false;
+    if (EE_OK != nd.mFile.read(req, 0)) {
+        nd.mDone = true;
+    }
+    while (!nd.mDone && loop.run()) {
+    }
+    bool same = total == req->mUsed && 0 == nd.mError;
+    for (u32 i = 0; same && i < total; ++i) {
+        same = req->mData[i] == (s8)(i % 251);
+    }
+    if (!same) {
+        printf("AppTestFileWrite>>round trip read fail, size=%u, ecode=%d\n", req->mUsed, nd.mError);
+        ++fails;
+    }
+    nd.mFile.launchClose();
+    while (!nd.mClosed && loop.run()) {
+    }
+    RequestFD::delRequest(req);
+    remove(fname.c_str());
+    return fails;
+}
+#endif
+
+
+/**
+ * @brief check the writes of HandleFile by reading the file back,
+ *        and the resume of a short write, the write is cut short by RLIMIT_FSIZE.
+ * @return count of failed cases.
+ */
+s32 AppTestFileWrite(s32 argc, s8** argv) {
+    s32 fails = 0;
+#if defined(DOS_LINUX)
+    Loop& loop = Engine::getInstance().getLoop();
+    //a file per process, in case of the forked children run it too
+    s8 tmp[32];
+    snprintf(tmp, sizeof(tmp), "partial_%d.bin", System::getPID());
+    String fname = Engine::getInstance().getConfig().mLogPath;
+    fname += tmp;
+    fails += AppTestFileRoundTrip(loop, fname);
+
+    PartialWrite nd;
+    getrlimit(RLIMIT_FSIZE, &nd.mLimit);
+    if (nd.mLimit.rlim_cur < G_PARTIAL_LIMIT) {
+        //never raise the limit, the resume is not checked
+        printf("AppTestFileWrite>>skip resume, RLIMIT_FSIZE=%llu\n", (u64)nd.mLimit.rlim_cur);
+        printf("AppTestFileWrite>>fails=%d\n", fails);
+        return fails;
+    }
+
+    nd.mFirstUsed = 0;
+    nd.mCalls = 0;
+    nd.mDone = false;
+    nd.mClosed = false;
+    nd.mFile.setClose(EHT_FILE, AppOnPartialClose, &nd);
+    if (EE_OK != nd.mFile.open(fname, 6) || !nd.mFile.setFileSize(0)) {
+        printf("AppTestFileWrite>>open fail, file=%s\n", fname.c_str());
+        ++fails;
+        printf("AppTestFileWrite>>fails=%d\n", fails);
+        return fails;
+    }
+
+    RequestFD* req = RequestFD::newRequest(G_PARTIAL_SIZE);
+    req->mUser = &nd;
+    req->mCall = AppOnPartialWrite;
+    for (u32 i = 0; i < G_PARTIAL_SIZE; ++i) {
+        req->mData[i] = (s8)(i % 251);
+    }
+    //the write over the limit fails with EFBIG instead of SIGXFSZ, the old action is restored at end
+    struct sigaction act;
+    struct sigaction oldact;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = SIG_IGN;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGXFSZ, &act, &oldact);
+    struct rlimit lim = nd.mLimit;
+    lim.rlim_cur = G_PARTIAL_LIMIT;
+    setrlimit(RLIMIT_FSIZE, &lim);
+    if (EE_OK != nd.mFile.write(req, G_PARTIAL_OFFSET)) {
+        setrlimit(RLIMIT_FSIZE, &nd.mLimit);
+        nd.mDone = true;
+        ++fails;
+    }
+    while (!nd.mDone && loop.run()) {
+    }
+    if (nd.mFirstUsed != G_PARTIAL_CUT || 2 != nd.mCalls || req->mUsed != G_PARTIAL_SIZE || req->mError) {
+        printf("AppTestFileWrite>>resume fail, first=%u, calls=%d, used=%u, ecode=%d\n",
+            nd.mFirstUsed, nd.mCalls, req->mUsed, req->mError);
+        ++fails;
+    }
+    nd.mFile.launchClose();
+    while (!nd.mClosed && loop.run()) {
+    }
+    RequestFD::delRequest(req);
+    sigaction(SIGXFSZ, &oldact, nullptr);
+
+    //the file ends with the block, the hole before it is not allocated
+    s8 buf[G_PARTIAL_SIZE + 1];
+    usz got = 0;
+    FILE* fp = fopen(fname.c_str(), "rb");
+    if (fp) {
+        if (0 == fseeko(fp, (off_t)G_PARTIAL_OFFSET, SEEK_SET)) {
+            got = fread(buf, 1, sizeof(buf), fp);
+        }
+        fclose(fp);
+    }
+    for (usz i = 0; i < got && G_PARTIAL_SIZE == got; ++i) {
+        if (buf[i] != (s8)(i % 251)) {
+            got = i;
+            break;
+        }
+    }
+    if (G_PARTIAL_SIZE != got) {
+        printf("AppTestFileWrite>>file data fail, size=%d\n", (s32)got);
+        ++fails;
+    }
+    remove(fname.c_str());
+#endif
+    printf("AppTestFileWrite>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
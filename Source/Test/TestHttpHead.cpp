@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <string.h>
+#include "Strings.h"
+#include "Net/HTTP/HttpHead.h"
+
+namespace app {
+
+static const s8* GTestUnknownHead[] = {
+    "X-Custom",
+    "Accept-Foo",
+    "Hostt",
+    "Content-Lengths",
+    "Cookie2",
+    "Set-Cookie2",
+    "X-Forwarded-Host",
+    "Sec-WebSocket-Key",
+    "A",
+    "",
+    "This-Header-Name-Is-Longer-Than-32"
+};
+
+
+/**
+ * @brief check the perfect hash of HttpHead::getID()
+ * every well-known name must hit its own id in any case, others must miss.
+ * @return count of failed cases.
+ */
+s32 AppTestHttpHead(s32 argc, s8** argv) {
+    s32 fails = 0;
+    s8 buf[64];
+    for (s32 i = 0; i < net::EHH_COUNT; ++i) {
+        const StringView& name = net::HttpHead::getName((net::EHttpHeadID)i);
+        if (net::HttpHead::getID(name) != i) {
+            printf("AppTestHttpHead>>fail, name=%.*s\n", (s32)name.mLen, name.mData);
+            ++fails;
+            continue;
+        }
+        //lower and upper case
+        for (usz k = 0; k < name.mLen; ++k) {
+            buf[k] = (s8)App2Lower(name.mData[k]);
+        }
+        if (net::HttpHead::getID(StringView(buf, name.mLen)) != i) {
+            printf("AppTestHttpHead>>fail lower, name=%.*s\n", (s32)name.mLen, buf);
+            ++fails;
+        }
+        for (usz k = 0; k < name.mLen; ++k) {
+            buf[k] = (s8)App2Upper(name.mData[k]);
+        }
+        if (net::HttpHead::getID(StringView(buf, name.mLen)) != i) {
+            printf("AppTestHttpHead>>fail upper, name=%.*s\n", (s32)name.mLen, buf);
+            ++fails;
+        }
+        //same length, first and last but one chars, so same slot, but not the name
+        if (name.mLen > 2) {
+            memcpy(buf, name.mData, name.mLen);
+            buf[name.mLen - 1] = '_' == buf[name.mLen - 1] ? '#' : '_';
+            if (net::HttpHead::getID(StringView(buf, name.mLen)) != net::EHH_UNKNOWN) {
+                printf("AppTestHttpHead>>fail collision, name=%.*s\n", (s32)name.mLen, buf);
+                ++fails;
+            }
+        }
+    }
+
+    for (usz i = 0; i < sizeof(GTestUnknownHead) / sizeof(GTestUnknownHead[0]); ++i) {
+        StringView key(GTestUnknownHead[i], strlen(GTestUnknownHead[i]));
+        if (net::HttpHead::getID(key) != net::EHH_UNKNOWN) {
+            printf("AppTestHttpHead>>fail unknown, name=%s\n", GTestUnknownHead[i]);
+            ++fails;
+        }
+    }
+
+    //the index of HttpHead follows the lookup
+    net::HttpHead hed;
+    hed.add(StringView("content-length", sizeof("content-length") - 1), StringView("12", 2));
+    hed.add(StringView("X-Custom", sizeof("X-Custom") - 1), StringView("abc", 3));
+    if (!(hed.get(net::EHH_CONTENT_LENGTH) == StringView("12", 2))
+        || !(hed.get(StringView("X-Custom", sizeof("X-Custom") - 1)) == StringView("abc", 3))) {
+        printf("AppTestHttpHead>>fail get\n");
+        ++fails;
+    }
+
+    printf("AppTestHttpHead>>names=%d, fails=%d\n", (s32)net::EHH_COUNT, fails);
+    return fails;
+}
+
+} //namespace app
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Logger.h"
+#include "Strings.h"
+#include "Net/HTTP/HttpHpack.h"
+
+namespace app {
+
+//a header block of RFC 7541 Appendix C, and the expected result
+struct HpackCase {
+    const s8* mHex;
+    const s8* mFields[16];  //key, value, ..., nullptr
+    u32 mTableCount;
+    u32 mTableSize;
+};
+
+//C.3, requests without huffman, C.4, same requests with huffman
+static const HpackCase GTestHpackReq[] = {
+    {"828684410f7777772e6578616d706c652e636f6d",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", nullptr},
+        1, 57},
+    {"828684be58086e6f2d6361636865",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com",
+        "cache-control", "no-cache", nullptr},
+        2, 110},
+    {"828785bf400a637573746f6d2d6b65790c637573746f6d2d76616c7565",
+        {":method", "GET", ":scheme", "https", ":path", "/index.html", ":authority", "www.example.com",
+        "custom-key", "custom-value", nullptr},
+        3, 164}
+};
+
+static const HpackCase GTestHpackReqHuff[] = {
+    {"828684418cf1e3c2e5f23a6ba0ab90f4ff",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com", nullptr},
+        1, 57},
+    {"828684be5886a8eb10649cbf",
+        {":method", "GET", ":scheme", "http", ":path", "/", ":authority", "www.example.com",
+        "cache-control", "no-cache", nullptr},
+        2, 110},
+    {"828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf",
+        {":method", "GET", ":scheme", "https", ":path", "/index.html", ":authority", "www.example.com",
+        "custom-key", "custom-value", nullptr},
+        3, 164}
+};
+
+//C.5, responses without huffman, C.6, same responses with huffman, the table is 256 bytes, so entries are evicted
+static const HpackCase GTestHpackResp[] = {
+    {"4803333032580770726976617465611d4d6f6e2c203231204f637420323031332032303a31333a323120474d54"
+        "6e1768747470733a2f2f7777772e6578616d706c652e636f6d",
+        {":status", "302", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT",
+        "location", "https://www.example.com", nullptr},
+        4, 222},
+    {"4803333037c1c0bf",
+        {":status", "307", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT",
+        "location", "https://www.example.com", nullptr},
+        4, 222},
+    {"88c1611d4d6f6e2c203231204f637420323031332032303a31333a323220474d54c05a04677a69707738666f6f3d"
+        "4153444a4b48514b425a584f5157454f50495541585157454f49553b206d61782d6167653d333630303b2076"
+        "657273696f6e3d31",
+        {":status", "200", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:22 GMT",
+        "location", "https://www.example.com", "content-encoding", "gzip",
+        "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", nullptr},
+        3, 215}
+};
+
+static const HpackCase GTestHpackRespHuff[] = {
+    {"488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff6e919d29ad171863c78f0b97c8e9ae82ae43d3",
+        {":status", "302", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT",
+        "location", "https://www.example.com", nullptr},
+        4, 222},
+    {"4883640effc1c0bf",
+        {":status", "307", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:21 GMT",
+        "location", "https://www.example.com", nullptr},
+        4, 222},
+    {"88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdfcd5b"
+        "3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007",
+        {":status", "200", "cache-control", "private", "date", "Mon, 21 Oct 2013 20:13:22 GMT",
+        "location", "https://www.example.com", "content-encoding", "gzip",
+        "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1", nullptr},
+        3, 215}
+};
+
+
+static usz AppHexToBin(const s8* hex, u8* out, usz max) {
+    usz ret = 0;
+    for (; hex[0] && hex[1] && ret < max; hex += 2) {
+        s8 tmp[3] = {hex[0], hex[1], 0};
+        out[ret++] = (u8)strtoul(tmp, nullptr, 16);
+    }
+    return ret;
+}
+
+
+static s32 AppTestHpackDecode(net::HttpHpack& dec, const s8* hex, net::HttpHead& out) {
+    u8 buf[256];
+    const usz len = AppHexToBin(hex, buf, sizeof(buf));
+    out.clear();
+    return dec.decode(buf, len, out);
+}
+
+
+//@return count of failed cases
+static s32 AppTestHpackCases(const s8* name, u32 table, const HpackCase* cases, usz cnt) {
+    s32 fails = 0;
+    net::HttpHpack dec(table);
+    net::HttpHead out;
+    for (usz i = 0; i < cnt; ++i) {
+        const HpackCase& cs = cases[i];
+        if (EE_OK != AppTestHpackDecode(dec, cs.mHex, out)) {
+            printf("AppTestHttpHpack>>%s[%d] decode fail\n", name, (s32)i);
+            ++fails;
+            continue;
+        }
+        usz pos = 0;
+        for (; cs.mFields[pos * 2]; ++pos) {
+            const s8* key = cs.mFields[pos * 2];
+            const s8* val = cs.mFields[pos * 2 + 1];
+            if (pos >= out.size() || !(out[pos].mKey == key) || !(out[pos].mVal == val)) {
+                printf("AppTestHttpHpack>>%s[%d] field[%d] fail, expect %s: %s\n", name, (s32)i, (s32)pos, key, val);
+                ++fails;
+                break;
+            }
+        }
+        if (pos != out.size() || dec.getTableCount() != cs.mTableCount || dec.getTableSize() != cs.mTableSize) {
+            printf("AppTestHttpHpack>>%s[%d] table fail, fields=%d, count=%u, size=%u\n", name, (s32)i,
+                (s32)out.size(), dec.getTableCount(), dec.getTableSize());
+            ++fails;
+        }
+    }
+    return fails;
+}
+
+
+/**
+ * @brief check HPACK decoder by the examples of RFC 7541 Appendix C,
+ *        and the dynamic table size update.
+ * @return count of failed cases.
+ */
+s32 AppTestHttpHpack(s32 argc, s8** argv) {
+    s32 fails = 0;
+    fails += AppTestHpackCases("C.3", 4096, GTestHpackReq, sizeof(GTestHpackReq) / sizeof(GTestHpackReq[0]));
+    fails += AppTestHpackCases("C.4", 4096, GTestHpackReqHuff, sizeof(GTestHpackReqHuff) / sizeof(GTestHpackReqHuff[0]));
+    fails += AppTestHpackCases("C.5", 256, GTestHpackResp, sizeof(GTestHpackResp) / sizeof(GTestHpackResp[0]));
+    fails += AppTestHpackCases("C.6", 256, GTestHpackRespHuff, sizeof(GTestHpackRespHuff) / sizeof(GTestHpackRespHuff[0]));
+
+    //size update
+    net::HttpHpack dec(4096);
+    net::HttpHead out;
+    for (usz i = 0; i < sizeof(GTestHpackReq) / sizeof(GTestHpackReq[0]); ++i) {
+        AppTestHpackDecode(dec, GTestHpackReq[i].mHex, out);
+    }
+    //size 0 clears the table, then 4096 again, then a field is indexed
+    if (EE_OK != AppTestHpackDecode(dec, "20", out) || 0 != dec.getTableCount() || 0 != dec.getTableSize()) {
+        printf("AppTestHttpHpack>>size update 0 fail\n");
+        ++fails;
+    }
+    if (EE_OK != AppTestHpackDecode(dec, "3fe11f828684410f7777772e6578616d706c652e636f6d", out)
+        || 4 != out.size() || 1 != dec.getTableCount() || 57 != dec.getTableSize()) {
+        printf("AppTestHttpHpack>>size update 4096 fail\n");
+        ++fails;
+    }
+    //the index 62 is evicted by a smaller size
+    if (EE_OK != AppTestHpackDecode(dec, "3f19", out) || 0 != dec.getTableCount()
+        || EE_OK == AppTestHpackDecode(dec, "be", out)) {
+        printf("AppTestHttpHpack>>size update evict fail\n");
+        ++fails;
+    }
+    //over the limit of SETTINGS_HEADER_TABLE_SIZE
+    if (EE_OK == AppTestHpackDecode(dec, "3fe21f", out)) {
+        printf("AppTestHttpHpack>>size update over limit fail\n");
+        ++fails;
+    }
+    //not at the beginning of block
+    if (EE_OK == AppTestHpackDecode(dec, "8220", out)) {
+        printf("AppTestHttpHpack>>size update after field fail\n");
+        ++fails;
+    }
+    //truncated integer and string
+    if (EE_OK == AppTestHpackDecode(dec, "3fe1", out) || EE_OK == AppTestHpackDecode(dec, "410f7777", out)) {
+        printf("AppTestHttpHpack>>truncated block fail\n");
+        ++fails;
+    }
+
+    printf("AppTestHttpHpack>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include "Timer.h"
+#include "Strings.h"
+#include "Converter.h"
+#include "Net/HTTP/HttpLayer.h"
+
+namespace app {
+
+static const s8* GTestReq =
+    "GET /api/v2/items/1234567890/detail?fields=name,price,stock&lang=en-US HTTP/1.1\r\n"
+    "Host: www.example.com:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.9,zh-CN;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: session=3f2a9c8e7d6b5a4f3e2d1c0b9a8f7e6d; theme=dark; tracking=off\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+//bad inputs, the error and offset should be same with or without SIMD
+static const s8* GTestBad[] = {
+    "GET /index.html HTTP/1.1\r\nHost: a.com\r\nX-Bad: abc\x01" "def\r\n\r\n",
+    "GET /index.html HTTP/1.1\r\nHost: a.com\r\nX-Bad: abcdefghijklmnopqrstuvwxyz0123456789\x7f\r\n\r\n",
+    "GET /index.html HTTP/1.1\r\nHost: a.com\r\nX-Bad-Name-Is-Very-Long-To-Be-Scanned{}: 1\r\n\r\n",
+    "GET /path/with/a/long/name/to/be/scanned/by/simd/\x01/bad HTTP/1.1\r\n\r\n",
+    "GET /path/with/a/long/name/to/be/scanned?query=simd&value=1234567890#frag HTTP/1.1\r\n\r\n"
+};
+
+
+static usz AppParseOnce(const s8* buf, usz len, const s8** err) {
+    net::HttpLayer* nd = new net::HttpLayer();
+    usz ret = nd->parseBuf(buf, len);
+    *err = nd->getErrStr();
+    nd->drop();
+    return ret;
+}
+
+
+/**
+ * @brief benchmark of HttpLayer::parseBuf() with and without SIMD scan.
+ */
+s32 AppTestHttpParse(s32 argc, s8** argv) {
+    const usz reqsz = strlen(GTestReq);
+    const usz batch = 64;
+    const usz rounds = argc > 2 ? App10StrToS32(argv[2]) : 20000;
+    String buf(reqsz * batch);
+    for (usz i = 0; i < batch; ++i) {
+        buf.append(GTestReq, reqsz);
+    }
+
+    for (usz i = 0; i < sizeof(GTestBad) / sizeof(GTestBad[0]); ++i) {
+        const s8* err0;
+        const s8* err1;
+        const usz len = strlen(GTestBad[i]);
+        net::HttpLayer::setSIMD(false);
+        usz used0 = AppParseOnce(GTestBad[i], len, &err0);
+        net::HttpLayer::setSIMD(true);
+        usz used1 = AppParseOnce(GTestBad[i], len, &err1);
+        printf("AppTestHttpParse>>bad[%llu], used=%llu/%llu, err=%s/%s, %s\n", (unsigned long long)i,
+            (unsigned long long)used0, (unsigned long long)used1, err0, err1,
+            (used0 == used1 && 0 == strcmp(err0, err1)) ? "same" : "DIFF");
+    }
+
+    for (s32 simd = 0; simd < 2; ++simd) {
+        bool on = net::HttpLayer::setSIMD(1 == simd);
+        if (simd && !on) {
+            printf("AppTestHttpParse>>SIMD is not supported by CPU\n");
+            break;
+        }
+        net::HttpLayer* nd = new net::HttpLayer();
+        usz total = 0;
+        s64 start = Timer::getRealTime();
+        for (usz i = 0; i < rounds; ++i) {
+            total += nd->parseBuf(buf.c_str(), buf.size());
+        }
+        s64 cost = Timer::getRealTime() - start;
+        printf("AppTestHttpParse>>simd=%d, err=%s, bytes=%llu, cost=%lldus, %.2fMB/s, %.0freq/s\n",
+            on ? 1 : 0, nd->getErrStr(), (unsigned long long)total, (long long)cost,
+            cost > 0 ? total / (cost * 1.0) : 0.0,
+            cost > 0 ? (rounds * batch) * 1000000.0 / cost : 0.0);
+        nd->drop();
+    }
+    net::HttpLayer::setSIMD(true);
+    return 0;
+}
+
+} //namespace app
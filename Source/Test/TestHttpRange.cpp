@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <string.h>
+#include "Strings.h"
+#include "Net/HTTP/HttpHead.h"
+#include "Net/HTTP/HttpRange.h"
+
+namespace app {
+
+//a request of the file "0123456789" (10 bytes), and the expected result of HttpRange::check()
+struct RangeCase {
+    const s8* mRange;
+    const s8* mIfRange;
+    const s8* mIfNoneMatch;
+    s32 mStatus;
+    usz mStart;
+    usz mLen;
+};
+
+static const s8* const GTestRangeETag = "\"5f00-a\"";
+static const s8* const GTestRangeTime = "Sat, 01 Jan 2022 00:00:00 GMT";
+static const usz GTestRangeSize = 10;
+
+static const RangeCase GTestRange[] = {
+    //no range
+    {nullptr, nullptr, nullptr, 200, 0, 10},
+    //first and last
+    {"bytes=0-0", nullptr, nullptr, 206, 0, 1},
+    {"bytes=2-5", nullptr, nullptr, 206, 2, 4},
+    {"BYTES= 2-5 ", nullptr, nullptr, 206, 2, 4},
+    {"bytes=9-9", nullptr, nullptr, 206, 9, 1},
+    //the last byte is past EOF, clamped
+    {"bytes=4-100", nullptr, nullptr, 206, 4, 6},
+    //open-ended
+    {"bytes=3-", nullptr, nullptr, 206, 3, 7},
+    {"bytes=0-", nullptr, nullptr, 206, 0, 10},
+    //suffix
+    {"bytes=-3", nullptr, nullptr, 206, 7, 3},
+    {"bytes=-10", nullptr, nullptr, 206, 0, 10},
+    {"bytes=-100", nullptr, nullptr, 206, 0, 10},
+    {"bytes=-0", nullptr, nullptr, 416, 0, 10},
+    //the first byte is past EOF
+    {"bytes=10-", nullptr, nullptr, 416, 0, 10},
+    {"bytes=10-20", nullptr, nullptr, 416, 0, 10},
+    {"bytes=99999999999999999999-", nullptr, nullptr, 200, 0, 10},
+    //multiple ranges get the whole file
+    {"bytes=0-1,4-5", nullptr, nullptr, 200, 0, 10},
+    {"bytes=-2, 0-1", nullptr, nullptr, 200, 0, 10},
+    //bad syntax is ignored
+    {"bytes=5-2", nullptr, nullptr, 200, 0, 10},
+    {"bytes=-", nullptr, nullptr, 200, 0, 10},
+    {"bytes=a-b", nullptr, nullptr, 200, 0, 10},
+    {"bytes=1-2x", nullptr, nullptr, 200, 0, 10},
+    {"items=1-2", nullptr, nullptr, 200, 0, 10},
+    //If-Range, strong comparison with ETag, or the exact Last-Modified
+    {"bytes=2-5", "\"5f00-a\"", nullptr, 206, 2, 4},
+    {"bytes=2-5", "Sat, 01 Jan 2022 00:00:00 GMT", nullptr, 206, 2, 4},
+    {"bytes=2-5", "\"5f00-b\"", nullptr, 200, 0, 10},
+    {"bytes=2-5", "W/\"5f00-a\"", nullptr, 200, 0, 10},
+    {"bytes=2-5", "Sun, 02 Jan 2022 00:00:00 GMT", nullptr, 200, 0, 10},
+    {"bytes=20-", "\"5f00-a\"", nullptr, 416, 0, 10},
+    //If-None-Match, weak comparison, before the Range
+    {nullptr, nullptr, "\"5f00-a\"", 304, 0, 10},
+    {nullptr, nullptr, "W/\"5f00-a\"", 304, 0, 10},
+    {nullptr, nullptr, "\"x\", W/\"5f00-a\" ", 304, 0, 10},
+    {nullptr, nullptr, "*", 304, 0, 10},
+    {nullptr, nullptr, "\"5f00-b\"", 200, 0, 10},
+    {nullptr, nullptr, "W/", 200, 0, 10},
+    {"bytes=2-5", nullptr, "W/\"5f00-a\"", 304, 0, 10},
+    {"bytes=2-5", nullptr, "\"5f00-b\", \"x\"", 206, 2, 4}
+};
+
+
+/**
+ * @brief check HttpRange::check() with the Range, If-Range and If-None-Match of requests.
+ * @return count of failed cases.
+ */
+s32 AppTestHttpRange(s32 argc, s8** argv) {
+    s32 fails = 0;
+    const StringView etag(GTestRangeETag, strlen(GTestRangeETag));
+    const StringView mtime(GTestRangeTime, strlen(GTestRangeTime));
+    for (usz i = 0; i < sizeof(GTestRange) / sizeof(GTestRange[0]); ++i) {
+        const RangeCase& cs = GTestRange[i];
+        net::HttpHead hed;
+        if (cs.mRange) {
+            hed.add(StringView("Range", 5), StringView(cs.mRange, strlen(cs.mRange)));
+        }
+        if (cs.mIfRange) {
+            hed.add(StringView("If-Range", 8), StringView(cs.mIfRange, strlen(cs.mIfRange)));
+        }
+        if (cs.mIfNoneMatch) {
+            hed.add(StringView("If-None-Match", 13), StringView(cs.mIfNoneMatch, strlen(cs.mIfNoneMatch)));
+        }
+        usz start = 99;
+        usz len = 99;
+        s32 status = net::HttpRange::check(hed, etag, mtime, GTestRangeSize, start, len);
+        if (status != cs.mStatus || start != cs.mStart || len != cs.mLen) {
+            printf("AppTestHttpRange>>fail[%d], range=%s, status=%d, start=%d, len=%d\n", (s32)i,
+                cs.mRange ? cs.mRange : "", status, (s32)start, (s32)len);
+            ++fails;
+        }
+    }
+
+    //If-Modified-Since is compared with Last-Modified exactly
+    net::HttpHead hed;
+    usz start, len;
+    hed.add(StringView("If-Modified-Since", 17), mtime);
+    if (304 != net::HttpRange::check(hed, etag, mtime, GTestRangeSize, start, len)) {
+        printf("AppTestHttpRange>>fail If-Modified-Since\n");
+        ++fails;
+    }
+
+    //an empty file has no satisfiable range
+    hed.clear();
+    hed.add(StringView("Range", 5), StringView("bytes=-5", 8));
+    if (416 != net::HttpRange::check(hed, etag, mtime, 0, start, len) || 0 != len) {
+        printf("AppTestHttpRange>>fail empty file\n");
+        ++fails;
+    }
+
+    //the ETag written by us
+    s8 tag[64];
+    usz tlen = net::HttpRange::writeETag(tag, sizeof(tag), 0x5f00, 10, true);
+    if (!(StringView(tag, tlen) == StringView("\"5f00-a-gz\"", 11))) {
+        printf("AppTestHttpRange>>fail writeETag, tag=%.*s\n", (s32)tlen, tag);
+        ++fails;
+    }
+
+    printf("AppTestHttpRange>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
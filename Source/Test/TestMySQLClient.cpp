@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+#include "Engine.h"
+#include "Timer.h"
+#include "Converter.h"
+#include "FileReader.h"
+#include "Net/MySQL/MySQLRequest.h"
+#include "Net/MySQL/MySQLResponse.h"
+#include "Net/MySQL/MySQLClientPool.h"
+
+namespace app {
+
+static const s8* G_TEST_TABLE = "ant_test_user";
+
+struct MySQLTestRound {
+    u32 mSent;
+    u32 mDone;
+    u32 mBad;
+};
+static MySQLTestRound G_MYSQL_ROUND;
+
+
+static void AppMySQLCallback(net::MySQLRequest* it, net::MySQLResponse* res) {
+    ++G_MYSQL_ROUND.mDone;
+    if (res->isError()) {
+        ++G_MYSQL_ROUND.mBad;
+        Logger::log(ELL_ERROR, "AppMySQLCallback>>sql=%.*s, err=%u, %s", (s32)AppMin<usz>(it->getSQL().mLen, 64),
+            it->getSQL().mData, res->getErrorCode(), res->getError());
+        return;
+    }
+    if (res->getFieldCount() > 0) {
+        for (u32 i = 0; i < res->getRowCount(); ++i) {
+            Logger::log(ELL_INFO, "AppMySQLCallback>>id=%llu, mobile=%lld, name=%s", res->getU64(i, 0),
+                res->isNull(i, 1) ? -1LL : res->getS64(i, 1), res->getValue(i, 2).mData);
+        }
+    } else if (it->getUserPointer()) {
+        Logger::log(ELL_INFO, "AppMySQLCallback>>affected rows=%llu, last id=%llu, sql=%.*s",
+            res->getAffectedRows(), res->getLastInsertID(), (s32)AppMin<usz>(it->getSQL().mLen, 64), it->getSQL().mData);
+    }
+}
+
+
+static bool AppMySQLPost(net::MySQLClientPool& pool, const s8* sql, usz len, bool show) {
+    net::MySQLRequest* req = new net::MySQLRequest();
+    req->setPool(&pool);
+    req->setCallback(AppMySQLCallback);
+    req->setUserPointer(show ? &pool : nullptr);
+    bool ret = req->query(sql, len);
+    req->drop();
+    if (ret) {
+        ++G_MYSQL_ROUND.mSent;
+    }
+    return ret;
+}
+
+
+//@brief run the loop till all posted commands are replied
+static void AppMySQLWait(Loop& loop) {
+    while (G_MYSQL_ROUND.mDone < G_MYSQL_ROUND.mSent && loop.run()) {
+    }
+}
+
+
+//@brief the public key of server, "get" to ask it from server, or a PEM file
+static bool AppMySQLSetKey(net::MySQLClientPool& pool, const s8* key) {
+    if (0 == strcmp(key, "get")) {
+        pool.setGetServerPublicKey(true);
+        return true;
+    }
+    FileReader file;
+    if (!file.openFile(key) || file.getFileSize() <= 0 || file.getFileSize() > 16 * 1024) {
+        Logger::log(ELL_ERROR, "AppMySQLSetKey>>bad key file=%s", key);
+        return false;
+    }
+    s8 pem[16 * 1024];
+    const u64 len = file.read(pem, file.getFileSize());
+    pool.setServerPublicKey(pem, static_cast<usz>(len));
+    return true;
+}
+
+
+s32 AppTestMySQLClient(s32 argc, s8** argv) {
+    const s8* database = argc > 5 ? argv[5] : "";
+    const u32 total = argc > 6 ? App10StrToU32(argv[6]) : 10000;
+    Loop& loop = Engine::getInstance().getLoop();
+    net::MySQLClientPool pool(&loop);
+    if (argc > 7 && !AppMySQLSetKey(pool, argv[7])) {
+        return 1;
+    }
+    pool.open(net::NetAddress(argv[2]), 4, argv[3], argv[4], database);
+
+    s8 sql[256];
+    s32 len = snprintf(sql, sizeof(sql), "CREATE TABLE IF NOT EXISTS %s (id INT UNSIGNED NOT NULL AUTO_INCREMENT,"
+        " mobile BIGINT, name VARCHAR(128), PRIMARY KEY (id))", G_TEST_TABLE);
+    AppMySQLPost(pool, sql, len, true);
+    AppMySQLWait(loop);
+
+    //all inserts are in flight at once, they are pipelined on 4 connections
+    s8 name[64];
+    s8 escaped[sizeof(name) * 2 + 1];
+    const s64 start = Timer::getRealTime();
+    for (u32 i = 0; i < total; ++i) {
+        s32 nlen = snprintf(name, sizeof(name), "{\"name\":\"it's %u\"}", i);
+        net::MySQLRequest::escape(escaped, name, nlen);
+        len = snprintf(sql, sizeof(sql), "INSERT INTO %s (mobile,name) VALUES (%llu,'%s')",
+            G_TEST_TABLE, 18023030000ULL + i, escaped);
+        AppMySQLPost(pool, sql, len, i + 1 == total);
+    }
+    AppMySQLWait(loop);
+    const s64 cost = AppMax<s64>(Timer::getRealTime() - start, 1);
+    Logger::log(ELL_INFO, "AppTestMySQLClient>>inserts=%u, bad=%u, qps=%.0f", total, G_MYSQL_ROUND.mBad,
+        total * 1000000.0 / cost);
+
+    len = snprintf(sql, sizeof(sql), "SELECT id,mobile,name FROM %s ORDER BY id DESC LIMIT 5", G_TEST_TABLE);
+    AppMySQLPost(pool, sql, len, true);
+    len = snprintf(sql, sizeof(sql), "DROP TABLE %s", G_TEST_TABLE);
+    AppMySQLPost(pool, sql, len, true);
+    AppMySQLWait(loop);
+
+    pool.close();
+    while (!pool.isClosed() && loop.run()) {
+    }
+    Logger::log(ELL_INFO, "AppTestMySQLClient>>sent=%u, done=%u, bad=%u",
+        G_MYSQL_ROUND.mSent, G_MYSQL_ROUND.mDone, G_MYSQL_ROUND.mBad);
+    return 0;
+}
+
+} //namespace app
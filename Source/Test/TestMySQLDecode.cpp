@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+#include "Strings.h"
+#include "Net/MySQL/MySQLResponse.h"
+
+namespace app {
+
+//payload of a packet, without the 4 bytes head
+struct MySQLPacket {
+    const s8* mData;
+    u32 mLen;
+};
+
+#define DMYSQL_PKT(str) {str, sizeof(str) - 1}
+
+//packets of a reply, the result of the last decode, and the dump of response, see AppDumpMySQL()
+struct MySQLDecodeCase {
+    MySQLPacket mPkts[12];
+    u32 mCount;
+    s32 mLast;
+    const s8* mDump;
+};
+
+//definitions of fields: catalog, schema, table, org_table, name, org_name, fixed fields
+#define DMYSQL_FIELD_ID DMYSQL_PKT("\x03" "def" "\x02" "db" "\x01" "t" "\x01" "t" "\x02" "id" "\x02" "id" \
+    "\x0C\x3F\x00\x0B\x00\x00\x00\x08\x00\x00\x00\x00\x00")
+#define DMYSQL_FIELD_NAME DMYSQL_PKT("\x03" "def" "\x02" "db" "\x01" "t" "\x01" "t" "\x04" "name" "\x04" "name" \
+    "\x0C\x2D\x00\xFF\x00\x00\x00\xFD\x00\x00\x00\x00\x00")
+#define DMYSQL_FIELD_A DMYSQL_PKT("\x03" "def" "\x00\x00\x00\x01" "a" "\x00" \
+    "\x0C\x3F\x00\x01\x00\x00\x00\x08\x81\x00\x00\x00\x00")
+#define DMYSQL_FIELD_B DMYSQL_PKT("\x03" "def" "\x00\x00\x00\x01" "b" "\x00" \
+    "\x0C\x3F\x00\x01\x00\x00\x00\x08\x81\x00\x00\x00\x00")
+
+//EOF: warnings, status; 0x0A = SERVER_STATUS_AUTOCOMMIT | SERVER_MORE_RESULTS_EXISTS
+#define DMYSQL_EOF DMYSQL_PKT("\xFE\x00\x00\x02\x00")
+#define DMYSQL_EOF_MORE DMYSQL_PKT("\xFE\x00\x00\x0A\x00")
+
+static const MySQLDecodeCase GTestMySQLDecode[] = {
+    //OK: 1 byte lenenc
+    {{DMYSQL_PKT("\x00\x01\x05\x02\x00\x00\x00")}, 1, 1, "ok,rows=1,id=5,warn=0"},
+    //OK: 0xFC, 0xFD lenenc, and warnings
+    {{DMYSQL_PKT("\x00\xFC\x2C\x01\xFD\x01\x00\x01\x02\x00\x03\x00")}, 1, 1, "ok,rows=300,id=65537,warn=3"},
+    //OK: 0xFE lenenc of 8 bytes
+    {{DMYSQL_PKT("\x00\xFE\x00\x00\x00\x00\x01\x00\x00\x00\xFC\xFB\x00\x02\x00\x00\x00")}, 1, 1,
+        "ok,rows=4294967296,id=251,warn=0"},
+    //ERR with sql state, and without
+    {{DMYSQL_PKT("\xFF\x28\x04#42000You have an error")}, 1, 1, "!1064:You have an error"},
+    {{DMYSQL_PKT("\xFF\x15\x04" "Access denied")}, 1, 1, "!1045:Access denied"},
+    //resultset: rows with NULL and empty string, ended by EOF with warnings
+    {{DMYSQL_PKT("\x02"), DMYSQL_FIELD_ID, DMYSQL_FIELD_NAME, DMYSQL_EOF,
+        DMYSQL_PKT("\x01" "1" "\x05" "alice"), DMYSQL_PKT("\x01" "2" "\xFB"), DMYSQL_PKT("\x01" "3" "\x00"),
+        DMYSQL_PKT("\xFE\x01\x00\x02\x00")}, 8, 1, "[id,name](1,alice)(2,nil)(3,),warn=1"},
+    //empty resultset
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_ID, DMYSQL_EOF, DMYSQL_EOF}, 4, 1, "[id],warn=0"},
+    //CALL: the later resultsets and the final OK are skipped
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_A, DMYSQL_EOF, DMYSQL_PKT("\x01" "x"), DMYSQL_EOF_MORE,
+        DMYSQL_PKT("\x02"), DMYSQL_FIELD_A, DMYSQL_FIELD_B, DMYSQL_EOF, DMYSQL_PKT("\x01" "y" "\x01" "z"),
+        DMYSQL_EOF_MORE, DMYSQL_PKT("\x00\x07\x00\x02\x00\x00\x00")}, 12, 1, "[a](x),warn=0"},
+    //multi statements: OK with more results, then a resultset which is skipped
+    {{DMYSQL_PKT("\x00\x01\x09\x0A\x00\x00\x00"), DMYSQL_PKT("\x01"), DMYSQL_FIELD_A, DMYSQL_EOF,
+        DMYSQL_PKT("\x01" "x"), DMYSQL_EOF}, 6, 1, "ok,rows=1,id=9,warn=0"},
+    //ERR after some rows, the rows are dropped
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_ID, DMYSQL_EOF, DMYSQL_PKT("\x01" "1"), DMYSQL_PKT("\x01" "2"),
+        DMYSQL_PKT("\xFF\x25\x05#70100Query execution was interrupted")}, 6, 1,
+        "!1317:Query execution was interrupted"},
+    //ERR in the skipped resultset
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_A, DMYSQL_EOF, DMYSQL_PKT("\x01" "x"), DMYSQL_EOF_MORE,
+        DMYSQL_PKT("\xFF\x7A\x04#42S02Table 't' doesn't exist")}, 6, 1, "!1146:Table 't' doesn't exist"},
+    //bad packets
+    {{DMYSQL_PKT("\x00\xFC\x01")}, 1, -1, nullptr},
+    {{DMYSQL_PKT("\x00\x01\x02\x02")}, 1, -1, nullptr},
+    {{DMYSQL_PKT("\xFB" "file.csv")}, 1, -1, nullptr},
+    {{DMYSQL_PKT("\x01"), DMYSQL_PKT("\x03" "def" "\x02" "db")}, 2, -1, nullptr},
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_ID, DMYSQL_PKT("\x01" "1")}, 3, -1, nullptr},
+    {{DMYSQL_PKT("\x01"), DMYSQL_FIELD_ID, DMYSQL_EOF, DMYSQL_PKT("\x05" "abc")}, 4, -1, nullptr}
+};
+
+
+static void AppDumpMySQL(const net::MySQLResponse& it, String& out) {
+    s8 tmp[128];
+    if (it.isError()) {
+        out.append(tmp, snprintf(tmp, sizeof(tmp), "!%u:", it.getErrorCode()));
+        out += it.getError();
+        return;
+    }
+    if (0 == it.getFieldCount()) {
+        out.append(tmp, snprintf(tmp, sizeof(tmp), "ok,rows=%llu,id=%llu,warn=%u",
+            it.getAffectedRows(), it.getLastInsertID(), it.getWarnings()));
+        return;
+    }
+    out += '[';
+    for (u32 i = 0; i < it.getFieldCount(); ++i) {
+        if (i > 0) {
+            out += ',';
+        }
+        StringView name = it.getFieldName(i);
+        out.append(name.mData, name.mLen);
+    }
+    out += ']';
+    for (u32 row = 0; row < it.getRowCount(); ++row) {
+        out += '(';
+        for (u32 i = 0; i < it.getFieldCount(); ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            if (it.isNull(row, i)) {
+                out += "nil";
+            } else {
+                StringView val = it.getValue(row, i);
+                out.append(val.mData, val.mLen);
+            }
+        }
+        out += ')';
+    }
+    out.append(tmp, snprintf(tmp, sizeof(tmp), ",warn=%u", it.getWarnings()));
+}
+
+
+//@return result of the last decode, all the previous decodes should return 0
+static s32 AppDecodeMySQL(net::MySQLResponse& res, const MySQLPacket* pkts, u32 count) {
+    for (u32 i = 0; i < count; ++i) {
+        const s32 ret = res.decode(reinterpret_cast<const u8*>(pkts[i].mData), pkts[i].mLen);
+        if (i + 1 == count || 0 != ret) {
+            return i + 1 == count ? ret : -2;
+        }
+    }
+    return -2;
+}
+
+
+/**
+ * @brief check MySQLResponse::decode() by canned packets: lenenc integers and strings,
+ *        EOF and OK terminators, the later resultsets skipped, and ERR in the middle of rows.
+ * @return count of failed cases.
+ */
+s32 AppTestMySQLDecode(s32 argc, s8** argv) {
+    s32 fails = 0;
+    net::MySQLResponse res;
+
+    for (u32 i = 0; i < DSIZEOF(GTestMySQLDecode); ++i) {
+        const MySQLDecodeCase& cs = GTestMySQLDecode[i];
+        res.clear();
+        const s32 ret = AppDecodeMySQL(res, cs.mPkts, cs.mCount);
+        if (ret != cs.mLast) {
+            printf("AppTestMySQLDecode>>case[%u] decode fail, ret=%d, expect=%d\n", i, ret, cs.mLast);
+            ++fails;
+            continue;
+        }
+        if (!cs.mDump) {
+            continue;
+        }
+        String out;
+        AppDumpMySQL(res, out);
+        if (out != cs.mDump) {
+            printf("AppTestMySQLDecode>>case[%u] dump fail, got=%s, expect=%s\n", i, out.c_str(), cs.mDump);
+            ++fails;
+        }
+    }
+
+    //values of 0xFC and 0xFD lenenc strings, and the numbers
+    static const u32 lens[] = {250, 251, 300, 65535, 65536, 70000};
+    s8* buf = new s8[70000 + 64];
+    for (u32 k = 0; k < DSIZEOF(lens); ++k) {
+        const u32 vlen = lens[k];
+        u32 pos = 0;
+        buf[pos++] = 11;
+        memcpy(buf + pos, "18023030000", 11);
+        pos += 11;
+        if (vlen < 251) {
+            buf[pos++] = (s8)vlen;
+        } else if (vlen < 65536) {
+            buf[pos++] = (s8)0xFC;
+            buf[pos++] = (s8)(vlen & 0xFF);
+            buf[pos++] = (s8)(vlen >> 8);
+        } else {
+            buf[pos++] = (s8)0xFD;
+            buf[pos++] = (s8)(vlen & 0xFF);
+            buf[pos++] = (s8)((vlen >> 8) & 0xFF);
+            buf[pos++] = (s8)(vlen >> 16);
+        }
+        for (u32 i = 0; i < vlen; ++i) {
+            buf[pos + i] = (s8)('a' + i % 26);
+        }
+        pos += vlen;
+        const MySQLPacket full[] = {DMYSQL_PKT("\x02"), DMYSQL_FIELD_ID, DMYSQL_FIELD_NAME, DMYSQL_EOF,
+            {buf, pos}, DMYSQL_EOF};
+        res.clear();
+        bool good = 1 == AppDecodeMySQL(res, full, DSIZEOF(full));
+        if (good) {
+            StringView val = res.getValue(0, 1);
+            good = 1 == res.getRowCount() && 18023030000ULL == res.getU64(0, 0) && 18023030000LL == res.getS64(0, 0)
+                && vlen == val.mLen && 'a' == val.mData[0] && (s8)('a' + (vlen - 1) % 26) == val.mData[vlen - 1]
+                && '\0' == val.mData[vlen] && 1 == res.findField("name") && -1 == res.findField("none");
+        }
+        //the value is cut short by 1 byte
+        const MySQLPacket cut[] = {DMYSQL_PKT("\x02"), DMYSQL_FIELD_ID, DMYSQL_FIELD_NAME, DMYSQL_EOF,
+            {buf, pos - 1}};
+        res.clear();
+        if (!good || -1 != AppDecodeMySQL(res, cut, DSIZEOF(cut))) {
+            printf("AppTestMySQLDecode>>lenenc string fail, len=%u\n", vlen);
+            ++fails;
+        }
+    }
+    delete[] buf;
+
+    printf("AppTestMySQLDecode>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <string.h>
+#include "Engine.h"
+#include "Timer.h"
+#include "Converter.h"
+#include "RedisMock.h"
+#include "Net/RedisClient/RedisRequest.h"
+#include "Net/RedisClient/RedisResponse.h"
+#include "Net/RedisClient/RedisClientPool.h"
+#include "Net/RedisClient/RedisClientCluster.h"
+
+namespace app {
+
+static const u16 G_BENCH_PORT = 16400;
+static const u32 G_BENCH_KEYS = 10000;
+
+struct RedisBenchRound {
+    u32 mTotal;
+    u32 mSent;
+    u32 mDone;
+    u32 mBad;
+    TVector<s64> mStart;   //launch time of request, us
+    TVector<u32> mCost;    //latency of request, us
+};
+static RedisBenchRound G_ROUND;
+
+
+static void AppRedisBenchCallback(net::RedisRequest* it, net::RedisResponse* res) {
+    const usz id = (usz)it->getUserPointer();
+    G_ROUND.mCost.pushBack(static_cast<u32>(Timer::getRealTime() - G_ROUND.mStart[id]));
+    if (res->isError()) {
+        ++G_ROUND.mBad;
+    }
+    ++G_ROUND.mDone;
+}
+
+
+/**
+ * @brief run a round of SET & GET, half and half.
+ * @param window max requests in flight.
+ * @param show print the result or not, false for warm up.
+ */
+static void AppRedisBenchRound(Loop& loop, net::RedisClientPool* pool, net::RedisClientCluster* cls,
+    u32 tcp, u32 depth, u32 payload, u32 total, bool show) {
+    RedisBenchRound& rd = G_ROUND;
+    rd.mTotal = total;
+    rd.mSent = 0;
+    rd.mDone = 0;
+    rd.mBad = 0;
+    rd.mStart.resize(total);
+    rd.mCost.resize(0);
+    rd.mCost.reallocate(total);
+
+    String val(payload);
+    val.setLen(payload);
+    memset(&val[0], 'v', payload);
+    s8 key[32];
+    const u32 window = tcp * depth;
+    const s64 start = Timer::getRealTime();
+    while (rd.mDone < total) {
+        for (; rd.mSent < total && rd.mSent - rd.mDone < window; ++rd.mSent) {
+            const u32 id = rd.mSent;
+            u32 klen = snprintf(key, sizeof(key), "bench:%u", (id >> 1) % G_BENCH_KEYS);
+            net::RedisRequest* req = new net::RedisRequest();
+            req->setCallback(AppRedisBenchCallback);
+            if (cls) {
+                req->setCluster(cls);
+            } else {
+                req->setPool(pool);
+            }
+            req->setUserPointer((void*)(usz)id);
+            rd.mStart[id] = Timer::getRealTime();
+            bool ret = (id & 1) ? req->get(key, klen) : req->set(key, klen, val.c_str(), payload);
+            req->drop();
+            if (!ret) {
+                ++rd.mBad;
+                ++rd.mDone;
+            }
+        }
+        if (rd.mDone < total && !loop.run()) {
+            break;
+        }
+    }
+    const s64 cost = AppMax<s64>(Timer::getRealTime() - start, 1);
+    if (!show) {
+        return;
+    }
+    rd.mCost.quickSort();
+    const usz cnt = rd.mCost.size();
+    u32 p50 = cnt > 0 ? rd.mCost[cnt * 50 / 100] : 0;
+    u32 p99 = cnt > 0 ? rd.mCost[cnt * 99 / 100] : 0;
+    u32 p999 = cnt > 0 ? rd.mCost[cnt * 999 / 1000] : 0;
+    u32 pmax = cnt > 0 ? rd.mCost[cnt - 1] : 0;
+    Logger::log(ELL_INFO, "AppTestRedisBench>>tcp=%u, pipeline=%u, payload=%u, total=%u, bad=%u,"
+        " qps=%.0f, p50=%uus, p99=%uus, p999=%uus, max=%uus",
+        tcp, depth, payload, rd.mDone, rd.mBad, rd.mDone * 1000000.0 / cost, p50, p99, p999, pmax);
+}
+
+
+s32 AppTestRedisBench(s32 argc, s8** argv) {
+    const u32 total = argc > 2 ? App10StrToU32(argv[2]) : 100000;
+    const s64 latency = argc > 3 ? App10StrToU32(argv[3]) : 0;
+    const u32 nodes = argc > 4 ? AppMax<u32>(App10StrToU32(argv[4]), 1) : 1;
+    static const u32 tcps[] = { 1, 4 };
+    static const u32 depths[] = { 1, 16, 128 };
+    static const u32 payloads[] = { 16, 1024 };
+
+    Loop& loop = Engine::getInstance().getLoop();
+    RedisMock* mock = new RedisMock(loop);
+    mock->setLatency(latency);
+    if (EE_OK != mock->open("127.0.0.1", G_BENCH_PORT, nodes)) {
+        mock->drop();
+        return -1;
+    }
+    s8 addr[32];
+    snprintf(addr, sizeof(addr), "127.0.0.1:%u", G_BENCH_PORT);
+
+    TVector<net::RedisClientPool*> pools;
+    TVector<net::RedisClientCluster*> clusters;
+    for (usz i = 0; i < DSIZEOF(tcps); ++i) {
+        net::RedisClientPool* pool = nullptr;
+        net::RedisClientCluster* cls = nullptr;
+        if (nodes > 1) {
+            cls = new net::RedisClientCluster();
+            cls->setMaxTcp(tcps[i]);
+            cls->open(addr);
+            clusters.pushBack(cls);
+        } else {
+            pool = new net::RedisClientPool(&loop);
+            pool->open(net::NetAddress(addr), tcps[i], nullptr);
+            pools.pushBack(pool);
+        }
+        //wait for the connections and slots
+        AppRedisBenchRound(loop, pool, cls, tcps[i], 1, 16, 1000, false);
+
+        if (nodes > 1) {
+            //every slot moves to the next node, the clients are redirected & refresh the slots
+            const u64 moved = mock->getMovedCount();
+            for (u32 k = 0; k < nodes; ++k) {
+                mock->moveSlots(k * RedisMock::G_MAX_SLOT / nodes,
+                    (k + 1) * RedisMock::G_MAX_SLOT / nodes - 1, static_cast<u32>(k + i + 1) % nodes);
+            }
+            AppRedisBenchRound(loop, pool, cls, tcps[i], 16, 16, G_BENCH_KEYS, true);
+            Logger::log(ELL_INFO, "AppTestRedisBench>>slots moved, MOVED=%llu",
+                mock->getMovedCount() - moved);
+        }
+
+        for (usz k = 0; k < DSIZEOF(depths); ++k) {
+            if (pool) {
+                pool->setMaxPipeline(depths[k]);
+            }
+            for (usz j = 0; j < DSIZEOF(payloads); ++j) {
+                AppRedisBenchRound(loop, pool, cls, tcps[i], depths[k], payloads[j], total, true);
+            }
+        }
+    }
+
+    for (usz i = 0; i < pools.size(); ++i) {
+        pools[i]->close();
+    }
+    for (usz i = 0; i < clusters.size(); ++i) {
+        clusters[i]->close();
+    }
+    while (mock->hasLink() && loop.run()) {
+    }
+    mock->close();
+    for (usz i = 0; i < pools.size(); ++i) {
+        delete pools[i];
+    }
+    for (usz i = 0; i < clusters.size(); ++i) {
+        delete clusters[i];
+    }
+    Logger::log(ELL_INFO, "AppTestRedisBench>>commands=%llu, latency=%lldms, nodes=%u",
+        mock->getCommandCount(), latency, nodes);
+    mock->drop();
+    return 0;
+}
+
+} //namespace app
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <string.h>
+#include "Strings.h"
+#include "Net/RedisClient/RedisResponse.h"
+
+namespace app {
+
+//a reply and the dump of decoded nodes, see AppDumpResp()
+struct RespDecodeCase {
+    const s8* mResp;
+    const s8* mDump;
+};
+
+static const RespDecodeCase GTestRespDecode[] = {
+    {"+OK\r\n", "+OK"},
+    {"-ERR bad\r\n", "-ERR bad"},
+    {":-42\r\n", ":-42"},
+    {"$5\r\nhello\r\n", "$hello"},
+    {"$0\r\n\r\n", "$"},
+    //CRLF in bulk string is skipped by size
+    {"$4\r\na\r\nb\r\n", "$a\r\nb"},
+    //null bulk string and null array
+    {"$-1\r\n", "nil"},
+    {"*-1\r\n", "nil"},
+    {"*0\r\n", "[]"},
+    //nested arrays
+    {"*3\r\n:1\r\n*2\r\n$3\r\nfoo\r\n$-1\r\n*1\r\n*-1\r\n", "[:1,[$foo,nil],[nil]]"},
+    {"*1\r\n*1\r\n*1\r\n:7\r\n", "[[[:7]]]"},
+    {"*2\r\n*0\r\n+x\r\n", "[[],+x]"},
+    {"*2\r\n*2\r\n:1\r\n:2\r\n*2\r\n$1\r\na\r\n*0\r\n", "[[:1,:2],[$a,[]]]"},
+    //RESP3
+    {"%2\r\n+a\r\n:1\r\n+b\r\n_\r\n", "%{+a,:1,+b,nil}"},
+    {"~2\r\n#t\r\n#f\r\n", "~{#1,#0}"},
+    {">2\r\n$10\r\ninvalidate\r\n*1\r\n$1\r\nk\r\n", ">{$invalidate,[$k]}"},
+    {",3.25\r\n", ",3.25"},
+    {"(123456789012345678901234567890\r\n", "(123456789012345678901234567890"},
+    {"!7\r\nERR bad\r\n", "-ERR bad"},
+    {"=8\r\ntxt:abcd\r\n", "$abcd"},
+    //attributes are skipped
+    {"|1\r\n+ttl\r\n:3\r\n$2\r\nhi\r\n", "$hi"},
+    {"*2\r\n|1\r\n+a\r\n+b\r\n:1\r\n:2\r\n", "[:1,:2]"}
+};
+
+
+static void AppDumpResp(const net::RedisResponse& it, String& out) {
+    s8 tmp[32];
+    switch (it.mType) {
+    case net::ERRT_NIL:
+        out += "nil";
+        break;
+    case net::ERRT_INT:
+    case net::ERRT_BOOL:
+        out.append(tmp, snprintf(tmp, sizeof(tmp), "%c%lld", it.mType, (long long)it.getS64()));
+        break;
+    case net::ERRT_ERROR:
+    case net::ERRT_STRING:
+    case net::ERRT_BULK_STR:
+    case net::ERRT_DOUBLE:
+    case net::ERRT_BIG_NUM:
+        //the string is ended by '\0' at its length
+        out += (s8)it.mType;
+        out.append(it.getStr(), it.mUsed);
+        if ('\0' != it.getStr()[it.mUsed]) {
+            out += "?";
+        }
+        break;
+    default:
+        if (!it.isAggregate()) {
+            out += "?";
+            break;
+        }
+        if (net::ERRT_ARRAY == it.mType) {
+            out += '[';
+        } else {
+            out += (s8)it.mType;
+            out += '{';
+        }
+        for (u32 i = 0; i < it.mAllocated; ++i) {
+            if (i > 0) {
+                out += ',';
+            }
+            const net::RedisResponse* nd = it.getResult(i);
+            if (nd) {
+                AppDumpResp(*nd, out);
+            }
+        }
+        out += net::ERRT_ARRAY == it.mType ? ']' : '}';
+        break;
+    }
+}
+
+
+//@return true if \p buf is decoded as \p dump, the strings are copied by own() if \p own
+static bool AppCheckRespDump(MemoryHub& hub, s8* buf, u64 len, u32 nodes, const s8* dump, bool own) {
+    net::RedisResponse res(hub);
+    res.decode(buf, len, nodes);
+    if (own) {
+        res.own();
+        memset(buf, '#', len);
+    }
+    String out;
+    AppDumpResp(res, out);
+    res.clear();
+    return out == dump;
+}
+
+
+/**
+ * @brief check RedisScanner with replies split at every byte, and RedisResponse::decode()
+ *        with nested arrays, nulls and RESP3 types.
+ * @return count of failed cases.
+ */
+s32 AppTestRedisDecode(s32 argc, s8** argv) {
+    s32 fails = 0;
+    MemoryHub* hub = new MemoryHub();
+    s8 buf[256];
+
+    for (u32 i = 0; i < DSIZEOF(GTestRespDecode); ++i) {
+        const RespDecodeCase& cs = GTestRespDecode[i];
+        const u64 len = strlen(cs.mResp);
+        memcpy(buf, cs.mResp, len);
+
+        //received byte by byte, the scanned part is kept by scanner
+        net::RedisScanner scan;
+        u64 got = 0;
+        for (u64 k = 1; k < len && 0 == got && !scan.isError(); ++k) {
+            got = scan.scan(buf, k);
+        }
+        got = 0 == got && !scan.isError() ? scan.scan(buf, len) : 0;
+        const u32 nodes = scan.getNodeCount();
+        if (len != got) {
+            printf("AppTestRedisDecode>>case[%u] scan by byte fail, got=%llu\n", i, got);
+            ++fails;
+            continue;
+        }
+
+        //received by 2 reads, split at each byte
+        for (u64 k = 1; k < len; ++k) {
+            scan.reset();
+            if (0 != scan.scan(buf, k) || len != scan.scan(buf, len) || nodes != scan.getNodeCount()) {
+                printf("AppTestRedisDecode>>case[%u] scan split at %llu fail\n", i, k);
+                ++fails;
+                break;
+            }
+        }
+
+        //the next reply is not scanned
+        memcpy(buf + len, "+OK\r\n", 5);
+        scan.reset();
+        if (len != scan.scan(buf, len + 5)) {
+            printf("AppTestRedisDecode>>case[%u] scan with next reply fail\n", i);
+            ++fails;
+        }
+
+        if (!AppCheckRespDump(*hub, buf, len, nodes, cs.mDump, false)) {
+            printf("AppTestRedisDecode>>case[%u] decode fail, expect=%s\n", i, cs.mDump);
+            ++fails;
+        }
+        memcpy(buf, cs.mResp, len);
+        if (!AppCheckRespDump(*hub, buf, len, nodes, cs.mDump, true)) {
+            printf("AppTestRedisDecode>>case[%u] own fail, expect=%s\n", i, cs.mDump);
+            ++fails;
+        }
+    }
+
+    //not RESP
+    net::RedisScanner scan;
+    if (0 != scan.scan("?x\r\n", 4) || !scan.isError()) {
+        printf("AppTestRedisDecode>>bad type fail\n");
+        ++fails;
+    }
+    //too deep
+    u64 len = 0;
+    for (u32 i = 0; i < 17; ++i) {
+        memcpy(buf + len, "*1\r\n", 4);
+        len += 4;
+    }
+    memcpy(buf + len, ":1\r\n", 4);
+    len += 4;
+    scan.reset();
+    if (0 != scan.scan(buf, len) || !scan.isError()) {
+        printf("AppTestRedisDecode>>depth fail\n");
+        ++fails;
+    }
+
+    hub->drop();
+    printf("AppTestRedisDecode>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
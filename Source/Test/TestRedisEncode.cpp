@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <string.h>
+#include "Converter.h"
+#include "Net/RedisClient/RedisCommand.h"
+
+namespace app {
+
+//a command and the RESP of it
+struct RespEncodeCase {
+    u32 mArgc;
+    const s8* mArgv[4];
+    u32 mLens[4];
+    const s8* mResp;
+    u32 mSize;
+};
+
+static RespEncodeCase GTestRespEncode[] = {
+    {1, {"PING"}, {4}, "*1\r\n$4\r\nPING\r\n", 14},
+    {2, {"GET", "k"}, {3, 1}, "*2\r\n$3\r\nGET\r\n$1\r\nk\r\n", 20},
+    //empty value
+    {3, {"SET", "key", ""}, {3, 3, 0}, "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$0\r\n\r\n", 28},
+    //binary value, the CRLF and '\0' are kept by length
+    {3, {"SET", "b", "a\r\n\0z"}, {3, 1, 5}, "*3\r\n$3\r\nSET\r\n$1\r\nb\r\n$5\r\na\r\n\0z\r\n", 31}
+};
+
+
+//@brief scan and decode \p buf, the nodes should be bulk strings of \p argv
+static bool AppCheckRespDecode(MemoryHub& hub, s8* buf, u32 size, u32 argc, const s8** argv, const u32* lens) {
+    net::RedisScanner scan;
+    if (size != scan.scan(buf, size) || argc + 1 != scan.getNodeCount()) {
+        return false;
+    }
+    net::RedisResponse res(hub);
+    res.decode(buf, size, scan.getNodeCount());
+    bool ret = net::ERRT_ARRAY == res.mType && argc == res.mAllocated;
+    for (u32 i = 0; ret && i < argc; ++i) {
+        const net::RedisResponse* nd = res.getResult(i);
+        ret = nd && net::ERRT_BULK_STR == nd->mType && lens[i] == nd->mUsed
+            && 0 == memcmp(nd->getStr(), argv[i], lens[i]) && '\0' == nd->getStr()[lens[i]];
+    }
+    res.clear();
+    return ret;
+}
+
+
+/**
+ * @brief check RedisCommand::encode() by the expected RESP, and decode it back by RedisScanner
+ *        and RedisResponse, the size of length prefix grows at the boundary of digits.
+ * @return count of failed cases.
+ */
+s32 AppTestRedisEncode(s32 argc, s8** argv) {
+    s32 fails = 0;
+    MemoryHub* hub = new MemoryHub();
+    s8 buf[1024];
+
+    for (u32 i = 0; i < DSIZEOF(GTestRespEncode); ++i) {
+        RespEncodeCase& cs = GTestRespEncode[i];
+        const u64 allsz = net::RedisCommand::getEncodeSize(cs.mArgc, cs.mLens);
+        memset(buf, '#', sizeof(buf));
+        const u32 size = net::RedisCommand::encode(buf, allsz, cs.mArgc, cs.mArgv, cs.mLens);
+        if (size != cs.mSize || allsz != size + 1ULL || 0 != memcmp(buf, cs.mResp, size)
+            || '\0' != buf[size] || '#' != buf[allsz]) {
+            printf("AppTestRedisEncode>>case[%u] encode fail, size=%u, expect=%u\n", i, size, cs.mSize);
+            ++fails;
+            continue;
+        }
+        if (!AppCheckRespDecode(*hub, buf, size, cs.mArgc, cs.mArgv, cs.mLens)) {
+            printf("AppTestRedisEncode>>case[%u] decode fail\n", i);
+            ++fails;
+        }
+    }
+
+    //the prefix of argc and lens at 1, 2 and 3 digits
+    s8 val[1000];
+    for (u32 i = 0; i < sizeof(val); ++i) {
+        val[i] = (s8)(i % 251);
+    }
+    const s8* args[12];
+    u32 lens[12];
+    static const u32 vlen[] = {0, 9, 10, 99, 100, 999, 1, 11, 101, 998, 7, 3};
+    for (u32 cnt = 1; cnt <= DSIZEOF(args); ++cnt) {
+        u64 expect = 1 + AppDigitCount(cnt) + 2 + 1;
+        for (u32 i = 0; i < cnt; ++i) {
+            args[i] = val;
+            lens[i] = vlen[i];
+            expect += 1 + AppDigitCount(lens[i]) + 2 + lens[i] + 2;
+        }
+        const u64 allsz = net::RedisCommand::getEncodeSize(cnt, lens);
+        s8* big = hub->allocate(allsz + 1);
+        big[allsz] = '#';
+        const u32 size = net::RedisCommand::encode(big, allsz, cnt, args, lens);
+        if (expect != allsz || allsz != size + 1ULL || '#' != big[allsz]
+            || !AppCheckRespDecode(*hub, big, size, cnt, args, lens)) {
+            printf("AppTestRedisEncode>>argc=%u fail, size=%u, expect=%llu\n", cnt, size, expect);
+            ++fails;
+        }
+        hub->release(big);
+    }
+
+    //the digits of length prefix
+    static const u32 nums[] = {0, 9, 10, 99, 100, 65535, 1000000000, 4294967295U};
+    static const s8* strs[] = {"0", "9", "10", "99", "100", "65535", "1000000000", "4294967295"};
+    for (u32 i = 0; i < DSIZEOF(nums); ++i) {
+        s8 tmp[16];
+        const u32 len = AppU32To10Str(nums[i], tmp);
+        if (len != strlen(strs[i]) || len != AppDigitCount(nums[i]) || 0 != memcmp(tmp, strs[i], len)) {
+            printf("AppTestRedisEncode>>digits fail, num=%u\n", nums[i]);
+            ++fails;
+        }
+    }
+
+    hub->drop();
+    printf("AppTestRedisEncode>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <string.h>
+#include "Engine.h"
+#include "Timer.h"
+#include "RedisMock.h"
+#include "Net/RedisClient/RedisSubscriber.h"
+
+namespace app {
+
+static const u16 G_SUB_PORT = 16410;
+static const s64 G_SUB_WAIT = 10 * 1000;
+
+#define DSUB_VIEW(str) StringView(str, sizeof(str) - 1)
+
+//messages got by the listeners, as "channel=msg;"
+struct RedisSubGot {
+    u32 mCount;
+    String mDump;
+};
+
+
+static void AppOnRedisSub(void* user, const StringView& channel, const StringView& msg) {
+    RedisSubGot& got = *(RedisSubGot*)user;
+    ++got.mCount;
+    got.mDump.append(channel.mData, channel.mLen);
+    got.mDump += '=';
+    got.mDump.append(msg.mData, msg.mLen);
+    got.mDump += ';';
+}
+
+
+//@brief the subscriptions of all channels are received by mock
+static bool AppIsRedisSubReady(const net::RedisSubscriber& sub, const RedisMock& mock) {
+    return sub.isReady() && sub.getChannelCount() == mock.getSubscribeCount();
+}
+
+
+/**
+ * @brief check the messages pushed by RedisMock, and the channels are subscribed again after
+ *        the mock is restarted, the reconnection is retried more times than the old limit.
+ * @return count of failed cases.
+ */
+s32 AppTestRedisSubscriber(s32 argc, s8** argv) {
+    s32 fails = 0;
+    Loop& loop = Engine::getInstance().getLoop();
+    RedisMock* mock = new RedisMock(loop);
+    if (EE_OK != mock->open("127.0.0.1", G_SUB_PORT)) {
+        mock->drop();
+        printf("AppTestRedisSubscriber>>fails=1, listen fail\n");
+        return 1;
+    }
+    s8 addr[32];
+    snprintf(addr, sizeof(addr), "127.0.0.1:%u", G_SUB_PORT);
+
+    RedisSubGot got = {0};
+    net::RedisSubscriber* sub = new net::RedisSubscriber(&loop);
+    sub->subscribe(DSUB_VIEW("news"), AppOnRedisSub, &got);
+    sub->subscribe(DSUB_VIEW("sport.*"), AppOnRedisSub, &got, true);
+    if (EE_OK != sub->open(net::NetAddress(addr))) {
+        printf("AppTestRedisSubscriber>>open fail\n");
+        ++fails;
+    }
+
+    for (u32 round = 0; round < 2 && 0 == fails; ++round) {
+        s64 end = Timer::getRelativeTime() + G_SUB_WAIT;
+        while (!AppIsRedisSubReady(*sub, *mock) && Timer::getRelativeTime() < end && loop.run()) {
+        }
+        if (!AppIsRedisSubReady(*sub, *mock)) {
+            printf("AppTestRedisSubscriber>>round[%u] subscribe fail, retry=%u\n", round, sub->getRetryCount());
+            ++fails;
+            break;
+        }
+
+        //by the channel, by the pattern, and not subscribed
+        got.mCount = 0;
+        got.mDump.setLen(0);
+        u32 cnt = mock->publish(DSUB_VIEW("news"), DSUB_VIEW("m1"));
+        cnt += mock->publish(DSUB_VIEW("sport.tennis"), DSUB_VIEW("m2"));
+        cnt += mock->publish(DSUB_VIEW("weather"), DSUB_VIEW("m3"));
+        end = Timer::getRelativeTime() + G_SUB_WAIT;
+        while (got.mCount < 2 && Timer::getRelativeTime() < end && loop.run()) {
+        }
+        if (2 != cnt || 2 != got.mCount || got.mDump != "news=m1;sport.tennis=m2;") {
+            printf("AppTestRedisSubscriber>>round[%u] message fail, sent=%u, got=%s\n",
+                round, cnt, got.mDump.c_str());
+            ++fails;
+            break;
+        }
+
+        if (0 == round) {
+            //the mock is stopped till the subscriber has retried more than 3 times
+            mock->close();
+            end = Timer::getRelativeTime() + G_SUB_WAIT;
+            while (sub->getRetryCount() < 5 && Timer::getRelativeTime() < end && loop.run()) {
+            }
+            if (sub->getRetryCount() < 5 || !sub->isRunning() || sub->isReady()
+                || EE_OK != mock->open("127.0.0.1", G_SUB_PORT)) {
+                printf("AppTestRedisSubscriber>>reconnect fail, retry=%u\n", sub->getRetryCount());
+                ++fails;
+            }
+        }
+    }
+
+    sub->close();
+    s64 end = Timer::getRelativeTime() + G_SUB_WAIT;
+    while ((!sub->isClosed() || mock->hasLink()) && Timer::getRelativeTime() < end && loop.run()) {
+    }
+    if (!sub->isClosed() || sub->isRunning()) {
+        printf("AppTestRedisSubscriber>>close fail\n");
+        ++fails;
+    } else {
+        delete sub;
+    }
+    mock->close();
+    mock->drop();
+    printf("AppTestRedisSubscriber>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <string.h>
+#include "RingBuffer.h"
+
+namespace app {
+
+static void AppFillRingBuf(s8* buf, s32 len, u32& seq) {
+    for (s32 i = 0; i < len; ++i) {
+        buf[i] = (s8)(seq++ % 251);
+    }
+}
+
+static bool AppCheckRingBuf(const s8* buf, s32 len, u32& seq) {
+    for (s32 i = 0; i < len; ++i) {
+        if (buf[i] != (s8)(seq++ % 251)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief check RingBuffer when the head and tail wrap around the nodes.
+ * @return count of failed cases.
+ */
+s32 AppTestRingBuffer(s32 argc, s8** argv) {
+    s32 fails = 0;
+    s8 buf[D_RBUF_BLOCK_SIZE * 3];
+    u32 wseq = 0;
+    u32 rseq = 0;
+    RingBuffer rb;
+    rb.init();
+
+    //the head node is consumed before the tail moves to next node
+    AppFillRingBuf(buf, D_RBUF_BLOCK_SIZE, wseq);
+    rb.write(buf, D_RBUF_BLOCK_SIZE);
+    StringView head = rb.peekHead();
+    if (D_RBUF_BLOCK_SIZE != head.mLen || !AppCheckRingBuf(head.mData, (s32)head.mLen, rseq)) {
+        printf("AppTestRingBuffer>>peek full node fail\n");
+        ++fails;
+    }
+    rb.commitHead((s32)head.mLen);
+    AppFillRingBuf(buf, 10, wseq);
+    rb.write(buf, 10);
+    head = rb.peekHead();
+    if (10 != head.mLen || 10 != rb.getSize() || !AppCheckRingBuf(head.mData, (s32)head.mLen, rseq)) {
+        printf("AppTestRingBuffer>>peek after consumed node fail, len=%d\n", (s32)head.mLen);
+        ++fails;
+    }
+    rb.commitHead((s32)head.mLen);
+
+    //stream through the ring with odd sizes, the nodes are reused
+    for (s32 i = 0; i < 200 && 0 == fails; ++i) {
+        s32 wlen = 1 + (i * 977) % (D_RBUF_BLOCK_SIZE * 2);
+        AppFillRingBuf(buf, wlen, wseq);
+        rb.write(buf, wlen);
+        while (rb.getSize() > D_RBUF_BLOCK_SIZE) {
+            head = rb.peekHead();
+            if (0 == head.mLen || !AppCheckRingBuf(head.mData, (s32)head.mLen, rseq)) {
+                printf("AppTestRingBuffer>>stream peek fail, step=%d\n", i);
+                ++fails;
+                break;
+            }
+            rb.commitHead((s32)head.mLen);
+        }
+    }
+    s32 left = rb.getSize();
+    if (left != rb.read(buf, sizeof(buf)) || !AppCheckRingBuf(buf, left, rseq) || 0 != rb.getSize()) {
+        printf("AppTestRingBuffer>>stream read fail, left=%d\n", left);
+        ++fails;
+    }
+
+    //gather nodes with a limit, then commit the position
+    AppFillRingBuf(buf, sizeof(buf), wseq);
+    rb.write(buf, sizeof(buf));
+    StringView bufs[4];
+    s32 cnt = 4;
+    const s32 limit = D_RBUF_BLOCK_SIZE + 100;
+    SRingBufPos pos = rb.peekHeadNode(rb.getHead(), bufs, &cnt, limit);
+    s32 total = 0;
+    for (s32 i = 0; i < cnt; ++i) {
+        if (!AppCheckRingBuf(bufs[i].mData, (s32)bufs[i].mLen, rseq)) {
+            printf("AppTestRingBuffer>>gather data fail, buf=%d\n", i);
+            ++fails;
+        }
+        total += (s32)bufs[i].mLen;
+    }
+    rb.commitHeadPos(pos);
+    if (limit != total || (s32)sizeof(buf) - limit != rb.getSize()) {
+        printf("AppTestRingBuffer>>gather limit fail, total=%d, size=%d\n", total, rb.getSize());
+        ++fails;
+    }
+    cnt = 4;
+    pos = rb.peekHeadNode(rb.getHead(), bufs, &cnt);
+    total = 0;
+    for (s32 i = 0; i < cnt; ++i) {
+        if (!AppCheckRingBuf(bufs[i].mData, (s32)bufs[i].mLen, rseq)) {
+            printf("AppTestRingBuffer>>gather rest data fail, buf=%d\n", i);
+            ++fails;
+        }
+        total += (s32)bufs[i].mLen;
+    }
+    rb.commitHeadPos(pos);
+    if (total + limit != (s32)sizeof(buf) || 0 != rb.getSize()) {
+        printf("AppTestRingBuffer>>gather all fail, total=%d, size=%d\n", total, rb.getSize());
+        ++fails;
+    }
+
+    //reset keeps one node and drops the data
+    AppFillRingBuf(buf, sizeof(buf), wseq);
+    rb.write(buf, sizeof(buf));
+    rb.reset();
+    head = rb.peekHead();
+    if (0 != rb.getSize() || 0 != head.mLen || rb.getHead().mNode != rb.getTail().mNode
+        || rb.getHead().mNode != rb.getHead().mNode->mNext) {
+        printf("AppTestRingBuffer>>reset fail, size=%d\n", rb.getSize());
+        ++fails;
+    }
+    rseq = wseq;
+    AppFillRingBuf(buf, sizeof(buf), wseq);
+    rb.write(buf, sizeof(buf));
+    if ((s32)sizeof(buf) != rb.read(buf, sizeof(buf)) || !AppCheckRingBuf(buf, sizeof(buf), rseq)) {
+        printf("AppTestRingBuffer>>write after reset fail\n");
+        ++fails;
+    }
+    rb.uninit();
+
+    printf("AppTestRingBuffer>>fails=%d\n", fails);
+    return fails;
+}
+
+} //namespace app
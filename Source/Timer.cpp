@@ -262,6 +262,16 @@ u64 Timer::getTimeStr(wchar_t* cache, usz max, const wchar_t* format) {
     return wcsftime(cache, max, format, &timeinfo);
 }
 
+u64 Timer::getTimeStrGMT(s64 iTime, s8* cache, usz max, const s8* format) {
+    struct tm timeinfo;
+#if defined(DOS_WINDOWS)
+    gmtime_s(&timeinfo, &iTime);
+#elif defined(DOS_LINUX) || defined(DOS_ANDROID)
+    gmtime_r((time_t*)& iTime, &timeinfo);
+#endif
+    return strftime(cache, max, format, &timeinfo);
+}
+
 
 bool Timer::isLeapYear(u32 iYear) {
     return ((0 == iYear % 4 && 0 != iYear % 100) || 0 == iYear % 400);
@@ -32,7 +32,8 @@ namespace app {
 
 HandleFile::HandleFile()
     :mFile(INVALID_HANDLE_VALUE)
-    , mFileSize(0) {
+    , mFileSize(0)
+    , mModifyTime(0) {
     mType = EHT_FILE;
     mLoop = &Engine::getInstance().getLoop();
 }
@@ -49,6 +50,7 @@ s32 HandleFile::close() {
         mFile = INVALID_HANDLE_VALUE;
         mFilename.setLen(0);
         mFileSize = 0;
+        mModifyTime = 0;
     }
     return EE_OK;
 }
@@ -68,6 +70,15 @@ bool HandleFile::setFileSize(usz fsz) {
     return false;
 }
 
+bool HandleFile::reserve(usz offset, usz len) {
+    if (INVALID_HANDLE_VALUE != mFile) {
+        FILE_ALLOCATION_INFO info;
+        info.AllocationSize.QuadPart = offset + len;
+        return TRUE == SetFileInformationByHandle(mFile, FileAllocationInfo, &info, sizeof(info));
+    }
+    return false;
+}
+
 s32 HandleFile::open(const String& fname, s32 flag) {
     close();
     mFilename = fname;
@@ -113,6 +124,15 @@ s32 HandleFile::open(const String& fname, s32 flag) {
         mFileSize = fsize.QuadPart;
     }
 
+    FILETIME wtime;
+    if (TRUE == GetFileTime(mFile, nullptr, nullptr, &wtime)) {
+        ULARGE_INTEGER tm;
+        tm.LowPart = wtime.dwLowDateTime;
+        tm.HighPart = wtime.dwHighDateTime;
+        //100ns since 1601-01-01 to seconds since 1970-01-01
+        mModifyTime = (s64)(tm.QuadPart / 10000000ULL) - 11644473600LL;
+    }
+
     return mLoop->openHandle(this);
 }
 
@@ -129,7 +149,9 @@ s32 HandleFile::write(RequestFD* req, usz offset) {
     req->clearOverlap();
     req->mOverlapped.Pointer = (void*)offset;
 
-    if (FALSE == WriteFile(mFile, req->mData, req->mUsed, nullptr, &req->mOverlapped)) {
+    //same as Linux, the bytes of [mUsed, mAllocated) are written, mUsed grows by the written size
+    if (FALSE == WriteFile(mFile, req->mData + req->mUsed,
+        req->mAllocated - req->mUsed, nullptr, &req->mOverlapped)) {
         const s32 ecode = System::getError();
         if (ERROR_IO_PENDING != ecode) {
             return mLoop->closeHandle(this);
@@ -199,7 +199,13 @@ void Loop::updatePending() {
             RequestFD* nd = (RequestFD*)req;
             Handle* hnd = nd->mHandle;
             if ((NTSTATUS)(nd->mOverlapped.Internal) >= 0) {
-                nd->mError = (nd->mUsed) ^ ((u32)nd->mOverlapped.InternalHigh);
+                if (EHT_FILE == hnd->getType()) {
+                    //a file write may be short, the caller goes on from mUsed
+                    nd->mUsed += (u32)nd->mOverlapped.InternalHigh;
+                    nd->mError = 0;
+                } else {
+                    nd->mError = (nd->mUsed) ^ ((u32)nd->mOverlapped.InternalHigh);
+                }
                 relinkTime((HandleTime*)hnd);
             } else {
                 nd->mError = System::convNtstatus2NetError((NTSTATUS)(nd->mOverlapped.Internal));